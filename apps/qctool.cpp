@@ -36,12 +36,16 @@
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/SNPDataSourceChain.hpp"
 #include "genfile/SNPDataSourceRack.hpp"
+#include "genfile/Profile.hpp"
+#include "genfile/ProfilingSNPDataSource.hpp"
+#include "genfile/ProfilingSNPDataSourceProcessor.hpp"
 #include "genfile/MergingSNPDataSource.hpp"
 #include "genfile/SampleMappingSNPDataSource.hpp"
 #include "genfile/SNPDataSinkChain.hpp"
+#include "genfile/BGenFileSNPDataSink.hpp"
 #include "genfile/GenFileSNPDataSink.hpp"
 #include "genfile/VCFFormatSNPDataSink.hpp"
-#include "genfile/SortingBGenFileSNPDataSink.hpp"
+#include "genfile/SortingSNPDataSink.hpp"
 #include "genfile/TrivialSNPDataSink.hpp"
 #include "genfile/CategoricalCohortIndividualSource.hpp"
 #include "genfile/CountingCohortIndividualSource.hpp"
@@ -53,6 +57,10 @@
 #include "genfile/StrandAligningSNPDataSource.hpp"
 #include "genfile/ThreshholdingSNPDataSource.hpp"
 #include "genfile/VCFFormatSNPDataSource.hpp"
+#include "genfile/BedFileSNPDataSource.hpp"
+#include "genfile/BGenFileSNPDataSource.hpp"
+#include "genfile/bgen/Query.hpp"
+#include "genfile/bgen/IndexQuery.hpp"
 #include "genfile/PloidyConvertingSNPDataSource.hpp"
 #include "genfile/CommonSNPFilter.hpp"
 #include "genfile/SNPFilteringSNPDataSource.hpp"
@@ -78,6 +86,8 @@
 #include "statfile/SNPDataSourceAdapter.hpp"
 
 #include "qcdb/FlatFileOutputter.hpp"
+#include "qcdb/ColumnarFileOutputter.hpp"
+#include "statfile/ColumnarFormat.hpp"
 #include "qcdb/FlatTableDBOutputter.hpp"
 
 #include "worker/QueuedMultiThreadedWorker.hpp"
@@ -395,7 +405,13 @@ public:
 	        .set_takes_values( 1 )
 			.set_maximum_multiplicity( 1 ) ;
 		options[ "-sort" ]
-			.set_description( "Sort the genotypes in the output file.  Currently this is only supported if BGEN, unzipped GEN, unzipped VCF format is output." ) ;
+			.set_description( "Sort the genotypes in the output file.  Variants are held in memory and spilled in sorted runs "
+				"to temporary files as needed, then merged into the output file, which may be of any format." ) ;
+		options[ "-sort-memory" ]
+			.set_description( "Sort the output file using about the specified number of megabytes of memory before spilling "
+				"variants to temporary files." )
+			.set_takes_single_value()
+			.set_default_value( 1024 ) ;
 		options[ "-os" ]
 	        .set_description( "Output sample information to the file specified.  " )
 	        .set_takes_single_value() ;
@@ -407,7 +423,9 @@ public:
 			.set_default_value( "traditional" ) ;
 	
 		options[ "-osnp" ]
-			.set_description( "Set the name of the file used to output results of per-SNP computations." )
+			.set_description( "Set the name of the file used to output results of per-SNP computations."
+				" If the filename ends in .qcol, results are written in a compressed columnar binary format;"
+				" append :none to the filename to turn off compression." )
 			.set_takes_single_value() ;
 
 		options[ "-osample" ]
@@ -472,6 +490,7 @@ public:
 		;
 
 		options.option_implies_option( "-sort", "-og" ) ;
+		options.option_implies_option( "-sort-memory", "-sort" ) ;
 		options.option_implies_option( "-omit-chromosome", "-og" ) ;
 		options.option_implies_option( "-output-sample-format", "-os" ) ;
 
@@ -537,6 +556,15 @@ public:
 			.set_description( "Specify the number of worker threads to use in computationally intensive tasks." )
 			.set_takes_single_value()
 			.set_default_value( 0 ) ;
+		options [ "-prefetch-memory" ]
+			.set_description( "Specify the number of megabytes of decoded genotype data that each background thread "
+				"may hold ahead of processing, when -threads is used." )
+			.set_takes_single_value()
+			.set_default_value( 64 ) ;
+		options [ "-profile" ]
+			.set_description( "Record the time spent in, and the variants and bytes passing through, each stage of processing "
+				"(each data source and each computation) and write them to the given file in JSON format." )
+			.set_takes_single_value() ;
 		options[ "-analysis-name" ]
 			.set_description( "Specify a name to label results from this analysis with." )
 			.set_takes_single_value()
@@ -566,6 +594,8 @@ public:
 				"each dose is one of add,dom,het,rec,or gen."
 				" If the field is omitted, it is assumed to be rsid;"
 				" if the dose is omitted it is assumed to be add."
+				" The genotype files are read a second time to find these SNPs, so this option cannot be used"
+				" when genotypes are read from standard input."
 			)
 			.set_takes_values( 1 )
 			.set_minimum_multiplicity( 0 )
@@ -740,7 +770,8 @@ struct QCToolCmdLineContext
 	QCToolCmdLineContext( appcontext::OptionProcessor const& options, appcontext::UIContext& ui_context ):
 		m_options( options ),
 		m_mangled_options( options ),
-		m_ui_context( ui_context )
+		m_ui_context( ui_context ),
+		m_conditioning_test( 0 )
 	{
 		try {
 			setup() ;
@@ -798,6 +829,11 @@ struct QCToolCmdLineContext
 		return *m_snp_data_source ;
 	}
 
+	// Return the profile of processing stages, or 0 if not profiling.
+	genfile::Profile* profile() const {
+		return m_profile.get() ;
+	}
+
 	SNPDataSink& fltrd_in_snp_data_sink() const {
 		return *m_fltrd_in_snp_data_sink ;
 	}
@@ -1053,6 +1089,7 @@ private:
 	typedef std::vector< StrandSpec > StrandSpecs ;
 	std::auto_ptr< StrandSpecs > m_strand_specs ;
 	genfile::CohortIndividualSource::UniquePtr m_samples ; // this must go before the snp_data_sinks.
+	genfile::Profile::UniquePtr m_profile ; // this must go before the snp data source.
 	std::auto_ptr< genfile::SNPDataSource > m_snp_data_source ;
 	std::auto_ptr< genfile::SNPDataSinkChain > m_fltrd_in_snp_data_sink ;
 	std::auto_ptr< genfile::SNPDataSinkChain > m_fltrd_out_snp_data_sink ;
@@ -1061,6 +1098,9 @@ private:
 	
 	genfile::SampleFilterConjunction::UniquePtr m_sample_filter ;
 	mutable genfile::CommonSNPFilter::UniquePtr m_snp_filter ;
+	// Set while opening the sources used to read -condition-on variants, see condition_on().
+	genfile::VariantIdentifyingDataTest const* m_conditioning_test ;
+	boost::optional< genfile::bgen::Query > m_conditioning_query ;
 	Eigen::MatrixXd m_sample_filter_diagnostic_matrix ;
 
 	std::vector< std::size_t > m_indices_of_filtered_out_samples ;
@@ -1071,6 +1111,9 @@ private:
 private:
 	
 	void setup() {
+		if( m_options.check( "-profile" )) {
+			m_profile = genfile::Profile::create() ;
+		}
 		m_sample_filter = get_sample_filter() ;
 		process_other_options() ;
 		
@@ -1101,10 +1144,8 @@ private:
 			if( m_options.check( "-condition-on" )) {
 				m_samples = condition_on(
 					m_samples,
-					*m_snp_data_source,
 					genfile::string_utils::join( m_options.get_values< std::string >( "-condition-on" ), "," )
 				) ;
-				m_snp_data_source->reset_to_start() ;
 			}
 		}
 		m_indices_of_filtered_out_samples = compute_excluded_samples( m_samples ) ;
@@ -1116,6 +1157,7 @@ private:
 					std::set< std::size_t >( m_indices_of_filtered_out_samples.begin(), m_indices_of_filtered_out_samples.end() )
 				)
 			) ;
+			m_snp_data_source = profiled( m_snp_data_source, "sample-filter" ) ;
 			
 			if( m_samples.get() ) {
 				m_samples.reset(
@@ -1217,6 +1259,7 @@ private:
 			m_snp_data_source.reset(
 				new genfile::ReorderingSNPDataSource( m_snp_data_source, order )
 			) ;
+			m_snp_data_source = profiled( m_snp_data_source, "reorder" ) ;
 			m_samples.reset(
 				new genfile::ReorderingCohortIndividualSource( m_samples, order )
 			) ;
@@ -1442,6 +1485,7 @@ public:
 				snp_data_source, *samples,
 				(*merge_in_sources)[0], (*merge_in_sources)[1]
 			) ;
+			snp_data_source = profiled( snp_data_source, "merge" ) ;
 		}
 
 		if( m_options.check( "-infer-ploidy-from" )) {
@@ -1472,12 +1516,14 @@ public:
 					boost::bind( &genfile::get_ploidy_from_sex, sexes, _1, _2 )
 				).release()
 			) ;
+			snp_data_source = profiled( snp_data_source, "ploidy-conversion" ) ;
 		}
 		
 		if( m_options.check( "-threshold" )) {
 			snp_data_source.reset(
 				new genfile::ThreshholdingSNPDataSource( snp_data_source, m_options.get< double >( "-threshold" ))
 			) ;
+			snp_data_source = profiled( snp_data_source, "threshold" ) ;
 		}
 		
 		// Put results in output variables
@@ -1522,6 +1568,29 @@ private:
 	}
 
 private:
+	std::size_t get_max_prefetch_queue_bytes() const {
+		return m_options.get_value< std::size_t >( "-prefetch-memory" ) * 1024 * 1024 ;
+	}
+
+	// Return the specs that processing reads from each variant, so that prefetching sources buffer only those.
+	// Output files, and intensity computations, may read any field; in that case all specs are buffered.
+	std::vector< std::string > get_prefetched_specs() const {
+		std::vector< std::string > result ;
+		if(
+			!m_options.check( "-og" )
+			&& !m_options.check( "-intensity-stats" )
+			&& !m_options.check( "-fit-clusters" )
+			&& !m_options.check( "-sample-stats" )
+		) {
+			result.push_back( ":genotypes:" ) ;
+			// -threshold computes genotypes from the probabilities.
+			if( m_options.check( "-threshold" )) {
+				result.push_back( "GP" ) ;
+			}
+		}
+		return result ;
+	}
+
 	genfile::SNPDataSource::UniquePtr open_snp_data_sources(
 		std::vector< std::vector< genfile::wildcard::FilenameMatch > > const& filenames,
 		bool match_alleles_between_cohorts
@@ -1552,6 +1621,13 @@ private:
 		genfile::SNPDataSource::UniquePtr source ;
 
 		std::vector< genfile::VariantIdentifyingData > cohort1_snps ;
+
+		// With several cohorts, read each cohort in its own thread so that cohorts are read concurrently.
+		std::size_t const number_of_threads = m_options.get_value< std::size_t >( "-threads" ) ;
+		bool const prefetch_rack = rack.get() && number_of_threads > 0 && !m_options.check( "-write-snp-excl-list" ) ;
+		if( prefetch_rack ) {
+			rack->prefetch_sources( get_max_prefetch_queue_bytes(), get_prefetched_specs() ) ;
+		}
 		
 		for( std::size_t i = 0; i < filenames.size(); ++i ) {
 			genfile::SNPDataSourceChain::UniquePtr chain( new genfile::SNPDataSourceChain() ) ;
@@ -1567,7 +1643,19 @@ private:
 
 				progress_context.notify_progress( ++progress_count, file_count ) ;
 			}
+
+			// Decode the chained files ahead of processing, in parallel, using the worker threads.
+			// Excluded SNPs are written as files are filtered, so in that case use one thread to keep them in order.
+			// Cohorts in a rack are instead prefetched as a whole (see above).
+			if( number_of_threads > 0 && !prefetch_rack ) {
+				chain->prefetch_sources(
+					m_options.check( "-write-snp-excl-list" ) ? 1 : number_of_threads,
+					get_max_prefetch_queue_bytes(),
+					get_prefetched_specs()
+				) ;
+			}
 			source.reset( chain.release() ) ;
+			source = profiled( source, "chain" ) ;
 			
 			// If we have strand alignment information, implement it now
 			if( m_strand_specs.get() ) {
@@ -1585,6 +1673,7 @@ private:
 					)
 					.release()
 				) ;
+				source = profiled( source, "strand-alignment" ) ;
 			}
 
 			if( rack.get() ) {
@@ -1596,6 +1685,7 @@ private:
 		
 		if( rack.get() ) {
 			source.reset( rack.release() ) ;
+			source = profiled( source, "rack" ) ;
 		}
 
 		return source ;
@@ -1652,6 +1742,11 @@ private:
 		) ;
 
 		merged_source->add_source( snp_data_source ) ;
+		// The main cohort is already read ahead if there are worker threads (see open_snp_data_sources()),
+		// so only the merged-in source needs a prefetching thread here.
+		if( m_options.get_value< std::size_t >( "-threads" ) > 0 ) {
+			merged_source->prefetch_sources( get_max_prefetch_queue_bytes(), get_prefetched_specs() ) ;
+		}
 		std::string id_prefix = "" ;
 		if( m_options.check( "-merge-prefix" )) {
 			id_prefix = m_options.get< std::string >( "-merge-prefix" ) ;
@@ -1760,6 +1855,38 @@ private:
 		}
 
 		genfile::CommonSNPFilter* snp_filter = get_snp_filter() ;
+		// Excluded SNPs are written from the main sources only.
+		bool const write_excluded_snps = m_options.check( "-write-snp-excl-list" ) && !m_conditioning_test ;
+
+		// BED files can seek to the records that pass the filter, so we narrow them up front.
+		// (Not when writing excluded SNPs, which requires the filter to see every variant.)
+		if( genfile::BedFileSNPDataSource* bed_source = dynamic_cast< genfile::BedFileSNPDataSource* >( source.get() ) ) {
+			if( snp_filter && !write_excluded_snps ) {
+				std::vector< genfile::GenomePositionRange > const ranges = get_included_ranges() ;
+				if( ranges.size() > 0 ) {
+					bed_source->restrict_to_ranges( ranges ) ;
+				}
+				bed_source->restrict_to( *snp_filter ) ;
+			}
+			if( m_conditioning_test ) {
+				bed_source->restrict_to( *m_conditioning_test ) ;
+			}
+		}
+		// BGEN files can test positions and IDs before constructing each variant.
+		// Conditioning variants are looked up in the index, if there is one.
+		if( genfile::BGenFileSNPDataSource* bgen_source = dynamic_cast< genfile::BGenFileSNPDataSource* >( source.get() ) ) {
+			if( m_conditioning_test ) {
+				std::string const index_filename = uf.second + ".bgi" ;
+				if( m_conditioning_query && boost::filesystem::exists( index_filename )) {
+					bgen_source->restrict_to_offsets( get_indexed_offsets( index_filename, *m_conditioning_query )) ;
+				}
+				bgen_source->set_prefilter( *m_conditioning_test ) ;
+			} else if( snp_filter && !write_excluded_snps ) {
+				bgen_source->set_prefilter( *snp_filter ) ;
+			}
+		}
+		source = profiled( source, filename ) ;
+
 		// Filter SNPs if necessary
 		if( snp_filter ) {
 			genfile::VariantIdentifyingDataFilteringSNPDataSource::UniquePtr snp_filtering_source
@@ -1768,7 +1895,7 @@ private:
 					*snp_filter
 				) ;
 
-			if( m_options.check( "-write-snp-excl-list" )) {
+			if( write_excluded_snps ) {
 				snp_filtering_source->send_filtered_out_SNPs_to(
 					boost::bind(
 						&QCToolCmdLineContext::write_excluded_SNP,
@@ -1781,6 +1908,7 @@ private:
 			source.reset(
 				snp_filtering_source.release()
 			) ;
+			source = profiled( source, "snp-filter" ) ;
 		}
 		
 		// Translate SNP identifying data if necessary
@@ -1791,10 +1919,19 @@ private:
 					*m_snp_dictionary
 				).release()
 			) ;
+			source = profiled( source, "snp-translation" ) ;
 		}
 
 		return source ;
 	}
+
+	// Record the time spent in the given source as a stage of the profile, if profiling.
+	genfile::SNPDataSource::UniquePtr profiled( genfile::SNPDataSource::UniquePtr source, std::string const& name ) const {
+		if( m_profile.get() ) {
+			source.reset( genfile::ProfilingSNPDataSource::create( source, m_profile->add_stage( name, "source" )).release() ) ;
+		}
+		return source ;
+	}
 	
 	genfile::SNPDataSource::UniquePtr
 	open_vcf_format_snp_data_source( std::pair< std::string, std::string > const& uf ) const {
@@ -1881,6 +2018,28 @@ private:
 		return result ;
 	}
 
+	// Return the ranges given by -incl-range and -incl-ranges.
+	std::vector< genfile::GenomePositionRange > get_included_ranges() const {
+		std::vector< genfile::GenomePositionRange > result ;
+		if( m_options.check_if_option_was_supplied( "-incl-range" )) {
+			std::vector< std::string > specs = m_options.get_values< std::string >( "-incl-range" ) ;
+			for ( std::size_t i = 0; i < specs.size(); ++i ) {
+				result.push_back( genfile::GenomePositionRange::parse( specs[i] ) ) ;
+			}
+		}
+		if( m_options.check_if_option_was_supplied( "-incl-ranges" )) {
+			std::vector< std::string > files = m_options.get_values< std::string >( "-incl-ranges" ) ;
+			BOOST_FOREACH( std::string const& filename, files ) {
+				std::auto_ptr< std::istream > in = genfile::open_text_file_for_input( filename ) ;
+				std::string range ;
+				while( (*in) >> range ) {
+					result.push_back( genfile::GenomePositionRange::parse( range ) ) ;
+				}
+			}
+		}
+		return result ;
+	}
+
 	genfile::CommonSNPFilter* get_snp_filter() const {
 		if( !m_snp_filter.get() ) {
 			m_snp_filter = construct_snp_filter() ;
@@ -2026,12 +2185,10 @@ private:
 				}
 			}
 		
-			if( m_options.check_if_option_was_supplied( "-incl-range" )) {
-				std::vector< std::string > specs = m_options.get_values< std::string >( "-incl-range" ) ;
-				for ( std::size_t i = 0; i < specs.size(); ++i ) {
-					snp_filter->include_snps_in_range(
-						genfile::GenomePositionRange::parse( specs[i] )
-					) ;
+			{
+				std::vector< genfile::GenomePositionRange > const ranges = get_included_ranges() ;
+				for ( std::size_t i = 0; i < ranges.size(); ++i ) {
+					snp_filter->include_snps_in_range( ranges[i] ) ;
 				}
 			}
 
@@ -2044,19 +2201,6 @@ private:
 				}
 			}
 
-			if( m_options.check_if_option_was_supplied( "-incl-ranges" )) {
-				std::vector< std::string > files = m_options.get_values< std::string >( "-incl-ranges" ) ;
-				BOOST_FOREACH( std::string const& filename, files ) {
-					std::auto_ptr< std::istream > in = genfile::open_text_file_for_input( filename ) ;
-					std::string range ;
-					while( (*in) >> range ) {
-						snp_filter->include_snps_in_range(
-							genfile::GenomePositionRange::parse( range )
-						) ;
-					}
-				}
-			}
-
 			if( m_options.check_if_option_was_supplied( "-excl-ranges" )) {
 				std::vector< std::string > files = m_options.get_values< std::string >( "-excl-ranges" ) ;
 				BOOST_FOREACH( std::string const& filename, files ) {
@@ -2190,11 +2334,20 @@ private:
 						}
 					}
 					if( m_options.check( "-sort" )) {
+						// GEN and BGEN sinks only read genotypes, so only these need to be held while sorting.
+						std::vector< std::string > sorted_specs ;
+						if(
+							dynamic_cast< genfile::BasicBGenFileSNPDataSink* >( sink.get() )
+							|| dynamic_cast< genfile::GenFileSNPDataSink* >( sink.get() )
+						) {
+							sorted_specs.push_back( ":genotypes:" ) ;
+						}
 						sink.reset(
-							new genfile::SortingBGenFileSNPDataSink(
-								filename,
+							new genfile::SortingSNPDataSink(
 								sink,
-								m_options.get< std::string >( "-compare-variants-by" )
+								m_options.get< std::string >( "-compare-variants-by" ),
+								m_options.get< std::size_t >( "-sort-memory" ) * 1024 * 1024,
+								sorted_specs
 							)
 						) ;
 					}
@@ -2403,12 +2556,84 @@ private:
 		return std::vector< std::size_t >( excluded_samples.begin(), excluded_samples.end() ) ;
 	}
 	
+	// Return the file offsets of variants in a BGEN file that match the given query, using its index.
+	std::vector< int64_t > get_indexed_offsets( std::string const& index_filename, genfile::bgen::Query const& query ) const {
+		genfile::bgen::IndexQuery::UniquePtr index_query ;
+		try {
+			index_query = genfile::bgen::IndexQuery::create( index_filename, query ) ;
+		} catch( std::invalid_argument const& ) {
+			throw genfile::ResourceNotOpenedError( index_filename ) ;
+		}
+		std::vector< int64_t > result( index_query->number_of_variants() ) ;
+		for( std::size_t i = 0; i < result.size(); ++i ) {
+			result[i] = index_query->locate_variant( i ).first ;
+		}
+		return result ;
+	}
+
+	// Return a query finding the variants matching the given -condition-on matchers in a BGEN index,
+	// if they can all be expressed as rsids or positions.
+	boost::optional< genfile::bgen::Query > get_conditioning_query( std::vector< std::string > const& matchers ) const {
+		genfile::bgen::Query result ;
+		std::vector< std::string > rsids ;
+		for( std::size_t i = 0; i < matchers.size(); ++i ) {
+			std::vector< std::string > bits = genfile::string_utils::split_and_strip( matchers[i], "~", " " ) ;
+			if( bits.size() == 1 ) {
+				bits.insert( bits.begin(), "rsid" ) ;
+			}
+			if( bits.size() == 2 && bits[0] == "rsid" && bits[1].find( '%' ) == std::string::npos ) {
+				rsids.push_back( bits[1] ) ;
+			} else if( bits.size() == 2 && ( bits[0] == "pos" || bits[0] == "position" )) {
+				genfile::GenomePosition const position( bits[1] ) ;
+				if( position.chromosome().is_missing() ) {
+					return boost::optional< genfile::bgen::Query >() ;
+				}
+				result.include_range(
+					genfile::bgen::Query::GenomicRange( position.chromosome(), position.position(), position.position() )
+				) ;
+			} else {
+				return boost::optional< genfile::bgen::Query >() ;
+			}
+		}
+		std::sort( rsids.begin(), rsids.end() ) ;
+		rsids.erase( std::unique( rsids.begin(), rsids.end() ), rsids.end() ) ;
+		if( rsids.size() > 0 ) {
+			result.include_rsids( rsids ) ;
+		}
+		return result ;
+	}
+
+	// Add columns of dosages of the given variants to the samples.
+	// The variants are read from a second copy of the data sources, opened in the same way as the main ones
+	// except that each file visits only variants that may match: BED files and indexed BGEN files look them up
+	// directly, and other BGEN files scan only the variant headers.  The main sources are not read.
+	// Standard input cannot be read twice, so is not supported.
 	genfile::CohortIndividualSource::UniquePtr condition_on(
 		genfile::CohortIndividualSource::UniquePtr samples,
-		genfile::SNPDataSource& snps,
 		std::string const& conditioning_spec
 	) {
+		{
+			std::vector< std::string > input_filenames ;
+			for( std::size_t i = 0; i < m_mangled_options.gen_filenames().size(); ++i ) {
+				for( std::size_t j = 0; j < m_mangled_options.gen_filenames()[i].size(); ++j ) {
+					input_filenames.push_back( m_mangled_options.gen_filenames()[i][j].filename() ) ;
+				}
+			}
+			if( m_options.check( "-merge-in" )) {
+				input_filenames.push_back( m_options.get_values< std::string >( "-merge-in" )[0] ) ;
+			}
+			if( std::find( input_filenames.begin(), input_filenames.end(), "-" ) != input_filenames.end() ) {
+				throw genfile::BadArgumentError(
+					"QCToolContext::condition_on()",
+					"conditioning_spec=\"" + conditioning_spec + "\"",
+					"-condition-on cannot be used when genotypes are read from standard input (\"-\")"
+				) ;
+			}
+		}
+
 		genfile::WithSNPDosagesCohortIndividualSource::SNPDosageSpec spec ;
+		genfile::VariantIdentifyingDataTestDisjunction conditioning_test ;
+		std::vector< std::string > matchers ;
 
 		using genfile::string_utils::split_and_strip ;
 		using genfile::string_utils::split ;
@@ -2431,6 +2656,8 @@ private:
 			genfile::VariantIdentifyingDataTest::SharedPtr snp_matcher(
 				genfile::WithSNPDosagesCohortIndividualSource::create_snp_matcher( parts[0] ).release()
 			) ;
+			conditioning_test.add_subtest( genfile::WithSNPDosagesCohortIndividualSource::create_snp_matcher( parts[0] )) ;
+			matchers.push_back( parts[0] ) ;
 			
 			std::vector< std::string > types = split( parts[1], "|" ) ;
 			for( std::size_t j = 0; j < types.size(); ++j ) {
@@ -2443,9 +2670,33 @@ private:
 			spec[ snp_matcher ] = std::set< std::string >( types.begin(), types.end() ) ;
 		}
 
+		genfile::SNPDataSource::UniquePtr snps ;
+		{
+			genfile::CohortIndividualSource::UniquePtr unused_samples ;
+			m_conditioning_test = &conditioning_test ;
+			m_conditioning_query = get_conditioning_query( matchers ) ;
+			try {
+				open_data_sources(
+					m_mangled_options.gen_filenames(),
+					m_options.check( "-s" ) ? m_options.get_values< std::string >( "-s" ) : boost::optional< std::vector< std::string > >(),
+					m_options.check( "-merge-in" ) ? m_options.get_values< std::string >( "-merge-in" ) : boost::optional< std::vector< std::string > >(),
+					&snps,
+					&unused_samples
+				) ;
+			}
+			catch( ... ) {
+				// Don't leave m_conditioning_test pointing at conditioning_test, which is about to go away.
+				m_conditioning_test = 0 ;
+				m_conditioning_query.reset() ;
+				throw ;
+			}
+			m_conditioning_test = 0 ;
+			m_conditioning_query.reset() ;
+		}
+
 		genfile::CohortIndividualSource::ConstUniquePtr const_samples( samples.release() ) ;
 		return genfile::CohortIndividualSource::UniquePtr(
-			genfile::WithSNPDosagesCohortIndividualSource::create( const_samples, snps, spec )
+			genfile::WithSNPDosagesCohortIndividualSource::create( const_samples, *snps, spec )
 			.release()
 		) ;
 	}
@@ -2690,6 +2941,8 @@ private:
 
 		if( elts[0].size() >= 7 && elts[0].substr( elts[0].size() - 7, 7 ) == ".sqlite" ) {
 			result[0] = "sqlite" ;
+		} else if( result[0] == "flat" && statfile::columnar::is_columnar_filename( elts[0] )) {
+			result[0] = "columnar" ;
 		}
 		result[1] = elts[0] ;
 
@@ -2697,10 +2950,13 @@ private:
 			throw genfile::BadArgumentError(
 				"QCToolProcessor::parse_filespec()",
 				"spec=\"" + spec + "\"",
-				"Expected format for filespec is <filename> or sqlite://<filename>[:<tablename>]."
+				"Expected format for filespec is <filename>, <filename>.qcol[:<compression>] or sqlite://<filename>[:<tablename>]."
 			) ;
 		}
-		if( elts.size() == 2 ) {
+		if( elts.size() == 2 && result[0] == "columnar" ) {
+			statfile::columnar::parse_compression( elts[1] ) ;
+			result.push_back( elts[1] ) ;
+		} else if( elts.size() == 2 ) {
 			if( result[0] != "sqlite" ) {
 				throw genfile::BadArgumentError(
 					"QCToolProcessor::parse_filespec()",
@@ -2728,7 +2984,13 @@ private:
 			get_ui_context()
 		) ;
 
-		genfile::SimpleSNPDataSourceProcessor processor ;
+		std::auto_ptr< genfile::SNPDataSourceProcessor > processor_ptr ;
+		if( context.profile() ) {
+			processor_ptr.reset( new genfile::ProfilingSNPDataSourceProcessor( *context.profile(), options().get< std::string >( "-profile" ) )) ;
+		} else {
+			processor_ptr.reset( new genfile::SimpleSNPDataSourceProcessor() ) ;
+		}
+		genfile::SNPDataSourceProcessor& processor = *processor_ptr ;
 
 		qcdb::Storage::SharedPtr per_snp_storage ;
 		if( SNPSummaryComponent::is_needed( options() )) {
@@ -2758,6 +3020,13 @@ private:
 					table_storage->set_no_alt_identifiers() ;
 				}
 				per_snp_storage = table_storage ;
+			} else if( file_spec[0] == "columnar" ) {
+				per_snp_storage = qcdb::ColumnarFileOutputter::create_shared(
+					file_spec[1],
+					options().get< std::string >( "-analysis-name" ),
+					options().get_values_as_map(),
+					( file_spec.size() == 3 ) ? statfile::columnar::parse_compression( file_spec[2] ) : statfile::columnar::eZstdCompression
+				) ;
 			} else {
 				assert( file_spec[0] == "flat" ) ;
 				per_snp_storage = qcdb::FlatFileOutputter::create_shared(
@@ -2798,6 +3067,12 @@ private:
 					dbStorage->set_table_name( file_spec[2] ) ;
 				}
 				per_sample_storage = dbStorage ;
+			} else if( file_spec[0] == "columnar" ) {
+				throw genfile::BadArgumentError(
+					"QCToolApplication::unsafe_process()",
+					"-osample=\"" + options().get< std::string >( "-osample" ) + "\"",
+					"Columnar output is only supported for per-variant results (-osnp)."
+				) ;
 			} else {
 				assert( file_spec[0] == "flat" ) ;
 				per_sample_storage = sample_stats::FlatFileOutputter::create_shared(
@@ -2920,6 +3195,8 @@ private:
 		} else {
 			get_ui_context().logger() << "SNPs do not need to be visited -- skipping.\n" ;
 		}
+		// Write any output held back by sinks, e.g. for sorting.
+		context.fltrd_in_snp_data_sink().finalise() ;
 		if( per_sample_storage ) {
 			per_sample_storage->finalise() ;
 		}
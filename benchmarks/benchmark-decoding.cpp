@@ -0,0 +1,278 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Micro-benchmarks of genotype decoding on synthetic data:
+// BGEN parse_probability_data() at each layout, bit depth and compression,
+// vcf::CallReader for GT, GP and DS fields, BedFileSNPDataReader, and the ToGP setters
+// that convert each of these to genotype probabilities.
+// Usage: benchmark-decoding [number of samples] [number of variants] [directory]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/timer/timer.hpp>
+#include "genfile/bgen/bgen.hpp"
+#include "genfile/vcf/Types.hpp"
+#include "genfile/vcf/CallReader.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/ToGP.hpp"
+#include "genfile/Error.hpp"
+#include "synthetic_data.hpp"
+
+namespace {
+	// Receives values as clients of the readers do, summing them so that no work can be elided.
+	struct SummingSetter: public genfile::VariantDataReader::PerSampleSetter {
+		SummingSetter(): sum( 0 ), count( 0 ) {}
+		void initialise( std::size_t, std::size_t ) {}
+		bool set_sample( std::size_t ) { return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) {}
+		void set_value( std::size_t, genfile::MissingValue const ) { ++count ; }
+		void set_value( std::size_t, std::string& value ) { sum += value.size() ; ++count ; }
+		void set_value( std::size_t, Integer const value ) { sum += value ; ++count ; }
+		void set_value( std::size_t, double const value ) { sum += value ; ++count ; }
+		void finalise() {}
+		double sum ;
+		uint64_t count ;
+	} ;
+
+	struct Benchmark {
+		Benchmark( std::size_t number_of_samples, std::size_t number_of_variants, std::size_t repeats ):
+			m_number_of_samples( number_of_samples ),
+			m_number_of_variants( number_of_variants ),
+			m_repeats( repeats )
+		{
+			std::cout << std::setw( 56 ) << std::left << "benchmark" << std::right
+				<< std::setw( 12 ) << "seconds"
+				<< std::setw( 16 ) << "variants/s"
+				<< std::setw( 24 ) << "samples x variants/s"
+				<< "\n" ;
+		}
+
+		// Run the given function the given number of times and report the fastest run.
+		void run( std::string const& name, boost::function< void() > f ) {
+			double best = 0 ;
+			for( std::size_t i = 0; i < m_repeats; ++i ) {
+				boost::timer::cpu_timer timer ;
+				f() ;
+				double const elapsed = timer.elapsed().wall / 1E9 ;
+				best = ( i == 0 ) ? elapsed : std::min( best, elapsed ) ;
+			}
+			std::cout << std::setw( 56 ) << std::left << name << std::right
+				<< std::setw( 12 ) << std::setprecision( 4 ) << best
+				<< std::setw( 16 ) << std::setprecision( 4 ) << ( m_number_of_variants / best )
+				<< std::setw( 24 ) << std::setprecision( 4 ) << ( m_number_of_samples * m_number_of_variants / best )
+				<< "\n" ;
+		}
+
+	private:
+		std::size_t const m_number_of_samples ;
+		std::size_t const m_number_of_variants ;
+		std::size_t const m_repeats ;
+	} ;
+
+	// BGEN
+	typedef std::vector< genfile::byte_t > Buffer ;
+
+	struct BgenData {
+		genfile::bgen::Context context ;
+		std::vector< Buffer > compressed ;
+		std::vector< Buffer > uncompressed ;
+	} ;
+
+	void load_bgen( std::string const& filename, BgenData* result ) {
+		std::ifstream stream( filename.c_str(), std::ios::binary ) ;
+		if( !stream ) {
+			throw genfile::ResourceNotOpenedError( filename ) ;
+		}
+		uint32_t offset = 0 ;
+		genfile::bgen::read_offset( stream, &offset ) ;
+		genfile::bgen::read_header_block( stream, &result->context ) ;
+		stream.seekg( offset + 4 ) ;
+		std::string SNPID, rsid, chromosome, allele1, allele2 ;
+		uint32_t position ;
+		result->compressed.clear() ;
+		while( genfile::bgen::read_snp_identifying_data( stream, result->context, &SNPID, &rsid, &chromosome, &position, &allele1, &allele2 )) {
+			result->compressed.push_back( Buffer() ) ;
+			genfile::bgen::read_genotype_data_block( stream, result->context, &result->compressed.back() ) ;
+		}
+		result->uncompressed.resize( result->compressed.size() ) ;
+		for( std::size_t i = 0; i < result->compressed.size(); ++i ) {
+			genfile::bgen::uncompress_probability_data( result->context, result->compressed[i], &result->uncompressed[i] ) ;
+		}
+	}
+
+	void uncompress_bgen( BgenData const& data ) {
+		Buffer buffer ;
+		for( std::size_t i = 0; i < data.compressed.size(); ++i ) {
+			genfile::bgen::uncompress_probability_data( data.context, data.compressed[i], &buffer ) ;
+		}
+	}
+
+	template< typename Setter >
+	void parse_bgen( BgenData const& data, Setter& setter ) {
+		for( std::size_t i = 0; i < data.uncompressed.size(); ++i ) {
+			Buffer const& buffer = data.uncompressed[i] ;
+			genfile::bgen::parse_probability_data( &buffer[0], &buffer[0] + buffer.size(), data.context, setter ) ;
+		}
+	}
+
+	void parse_bgen_to_GP( BgenData const& data, SummingSetter& setter ) {
+		genfile::ToGP< SummingSetter > to_GP = genfile::to_GP( setter ) ;
+		parse_bgen( data, to_GP ) ;
+	}
+
+	void benchmark_bgen( Benchmark& benchmark, std::string const& filename, std::string const& name ) {
+		BgenData data ;
+		load_bgen( filename, &data ) ;
+		SummingSetter setter ;
+		benchmark.run( name + ": uncompress", boost::bind( &uncompress_bgen, boost::cref( data ))) ;
+		benchmark.run( name + ": parse_probability_data", boost::bind( &parse_bgen< SummingSetter >, boost::cref( data ), boost::ref( setter ))) ;
+		benchmark.run( name + ": parse_probability_data + ToGP", boost::bind( &parse_bgen_to_GP, boost::cref( data ), boost::ref( setter ))) ;
+	}
+
+	// VCF
+	struct VcfData {
+		std::vector< std::string > formats ;
+		std::vector< std::string > data ;
+		boost::ptr_map< std::string, genfile::vcf::VCFEntryType > types ;
+	} ;
+
+	void add_entry_type( VcfData* result, std::string const& id, std::string const& number, std::string const& type ) {
+		genfile::vcf::VCFEntryType::Spec spec ;
+		spec[ "ID" ] = id ;
+		spec[ "Number" ] = number ;
+		spec[ "Type" ] = type ;
+		spec[ "Description" ] = id ;
+		std::string key = id ;
+		result->types.insert( key, genfile::vcf::VCFEntryType::create( spec )) ;
+	}
+
+	// Load the FORMAT and per-sample columns of each line of the given VCF file.
+	void load_vcf( std::string const& filename, VcfData* result ) {
+		std::ifstream stream( filename.c_str() ) ;
+		if( !stream ) {
+			throw genfile::ResourceNotOpenedError( filename ) ;
+		}
+		add_entry_type( result, "GT", "1", "String" ) ;
+		add_entry_type( result, "GP", "G", "Float" ) ;
+		add_entry_type( result, "DS", "1", "Float" ) ;
+		std::string line ;
+		while( std::getline( stream, line )) {
+			if( line.size() > 0 && line[0] != '#' ) {
+				std::size_t format_start = 0 ;
+				for( std::size_t column = 0; column < 8; ++column ) {
+					format_start = line.find( '\t', format_start ) + 1 ;
+				}
+				std::size_t const format_end = line.find( '\t', format_start ) ;
+				result->formats.push_back( line.substr( format_start, format_end - format_start )) ;
+				result->data.push_back( line.substr( format_end + 1 )) ;
+			}
+		}
+	}
+
+	template< typename Setter >
+	void read_vcf( VcfData const& data, std::size_t number_of_samples, std::string const& field, Setter& setter ) {
+		for( std::size_t i = 0; i < data.data.size(); ++i ) {
+			genfile::vcf::CallReader( number_of_samples, 2, data.formats[i], data.data[i], data.types ).get( field, setter ) ;
+		}
+	}
+
+	void read_vcf_to_GP( VcfData const& data, std::size_t number_of_samples, std::string const& field, SummingSetter& setter ) {
+		genfile::ToGP< SummingSetter > to_GP = genfile::to_GP( setter ) ;
+		read_vcf( data, number_of_samples, field, to_GP ) ;
+	}
+
+	void benchmark_vcf( Benchmark& benchmark, std::string const& filename, std::size_t number_of_samples, std::string const& field ) {
+		VcfData data ;
+		load_vcf( filename, &data ) ;
+		SummingSetter setter ;
+		benchmark.run(
+			"vcf " + field + ": CallReader",
+			boost::bind( &read_vcf< SummingSetter >, boost::cref( data ), number_of_samples, field, boost::ref( setter ))
+		) ;
+		if( field != "DS" ) {
+			benchmark.run(
+				"vcf " + field + ": CallReader + ToGP",
+				boost::bind( &read_vcf_to_GP, boost::cref( data ), number_of_samples, field, boost::ref( setter ))
+			) ;
+		}
+	}
+
+	// BED
+	template< typename Setter >
+	void read_source( genfile::SNPDataSource& source, Setter& setter ) {
+		source.reset_to_start() ;
+		genfile::VariantIdentifyingData variant ;
+		while( source.get_snp_identifying_data( &variant )) {
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+		}
+	}
+
+	void read_source_to_GP( genfile::SNPDataSource& source, SummingSetter& setter ) {
+		genfile::ToGP< SummingSetter > to_GP = genfile::to_GP( setter ) ;
+		read_source( source, to_GP ) ;
+	}
+
+	void benchmark_bed( Benchmark& benchmark, std::string const& filename ) {
+		genfile::SNPDataSource::UniquePtr source = genfile::SNPDataSource::create( filename ) ;
+		SummingSetter setter ;
+		benchmark.run( "bed: BedFileSNPDataReader", boost::bind( &read_source< SummingSetter >, boost::ref( *source ), boost::ref( setter ))) ;
+		benchmark.run( "bed: BedFileSNPDataReader + ToGP", boost::bind( &read_source_to_GP, boost::ref( *source ), boost::ref( setter ))) ;
+	}
+}
+
+int main( int argc, char** argv ) {
+	benchmarks::SyntheticDataSpec spec ;
+	spec.number_of_samples = ( argc > 1 ) ? std::atoi( argv[1] ) : 1000 ;
+	spec.number_of_variants = ( argc > 2 ) ? std::atoi( argv[2] ) : 1000 ;
+	std::string const directory = ( argc > 3 ) ? argv[3] : "/tmp/qctool-benchmarks" ;
+	std::size_t const repeats = 3 ;
+
+	try {
+		boost::filesystem::create_directories( directory ) ;
+		std::string const stub = directory + "/synthetic" ;
+
+		std::cerr << "Generating " << spec.number_of_samples << " samples x " << spec.number_of_variants << " variants in \"" << directory << "\"...\n" ;
+		benchmarks::write_gen_file( stub + ".gen", spec ) ;
+		std::vector< std::pair< std::string, std::string > > bgen_files ;
+		benchmarks::convert( stub + ".gen", stub + ".v11.bgen", "bgen_v1.1" ) ;
+		bgen_files.push_back( std::make_pair( stub + ".v11.bgen", "bgen v1.1 zlib" )) ;
+		int const bits[] = { 8, 16, 32 } ;
+		char const* compressions[] = { "none", "zlib", "zstd" } ;
+		for( std::size_t b = 0; b < 3; ++b ) {
+			for( std::size_t c = 0; c < 3; ++c ) {
+				std::string const suffix = std::to_string( bits[b] ) + "bit." + compressions[c] ;
+				benchmarks::convert( stub + ".gen", stub + ".v12." + suffix + ".bgen", "bgen_v1.2", bits[b], compressions[c] ) ;
+				bgen_files.push_back( std::make_pair( stub + ".v12." + suffix + ".bgen", "bgen v1.2 " + std::to_string( bits[b] ) + "-bit " + compressions[c] )) ;
+			}
+		}
+		benchmarks::convert( stub + ".gen", stub + ".bed", "binary_ped" ) ;
+		benchmarks::write_vcf_file( stub + ".vcf", spec, "GT:GP:DS" ) ;
+
+		Benchmark benchmark( spec.number_of_samples, spec.number_of_variants, repeats ) ;
+		for( std::size_t i = 0; i < bgen_files.size(); ++i ) {
+			benchmark_bgen( benchmark, bgen_files[i].first, bgen_files[i].second ) ;
+		}
+		benchmark_vcf( benchmark, stub + ".vcf", spec.number_of_samples, "GT" ) ;
+		benchmark_vcf( benchmark, stub + ".vcf", spec.number_of_samples, "GP" ) ;
+		benchmark_vcf( benchmark, stub + ".vcf", spec.number_of_samples, "DS" ) ;
+		benchmark_bed( benchmark, stub + ".bed" ) ;
+	}
+	catch( genfile::InputError const& e ) {
+		std::cerr << "!! Error (" << e.what() << "): " << e.format_message() << "\n" ;
+		return 1 ;
+	}
+	return 0 ;
+}
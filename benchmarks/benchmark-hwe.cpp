@@ -0,0 +1,137 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Compare the per-variant cost of the HWE exact test before and after removing the
+// work array, and check that the two implementations agree.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <boost/timer/timer.hpp>
+#include "components/SNPSummaryComponent/SNPHWE.hpp"
+
+namespace reference {
+	// The original implementation by Jan Wigginton, allocating and filling an array of
+	// rare_copies+1 probabilities on every call.
+	double SNPHWE( int obs_hets, int obs_hom1, int obs_hom2 ) {
+		int obs_homc = obs_hom1 < obs_hom2 ? obs_hom2 : obs_hom1 ;
+		int obs_homr = obs_hom1 < obs_hom2 ? obs_hom1 : obs_hom2 ;
+		int rare_copies = 2 * obs_homr + obs_hets ;
+		int genotypes = obs_hets + obs_homc + obs_homr ;
+		double* het_probs = (double*) malloc( (size_t) (rare_copies + 1) * sizeof(double) ) ;
+		for( int i = 0; i <= rare_copies; i++ ) {
+			het_probs[i] = 0.0 ;
+		}
+		int mid = double( rare_copies ) - ( double( rare_copies ) * double( rare_copies ) / (2.0 * double( genotypes ) ) ) ;
+		if( (rare_copies & 1) ^ (mid & 1) ) {
+			mid++ ;
+		}
+		int curr_hets = mid ;
+		int curr_homr = (rare_copies - mid) / 2 ;
+		int curr_homc = genotypes - curr_hets - curr_homr ;
+		het_probs[mid] = 1.0 ;
+		double sum = het_probs[mid] ;
+		for( curr_hets = mid; curr_hets > 1; curr_hets -= 2 ) {
+			het_probs[curr_hets - 2] = het_probs[curr_hets] * curr_hets * (curr_hets - 1.0) / (4.0 * (curr_homr + 1.0) * (curr_homc + 1.0)) ;
+			sum += het_probs[curr_hets - 2] ;
+			curr_homr++ ;
+			curr_homc++ ;
+		}
+		curr_hets = mid ;
+		curr_homr = (rare_copies - mid) / 2 ;
+		curr_homc = genotypes - curr_hets - curr_homr ;
+		for( curr_hets = mid; curr_hets <= rare_copies - 2; curr_hets += 2 ) {
+			het_probs[curr_hets + 2] = het_probs[curr_hets] * 4.0 * curr_homr * curr_homc / ((curr_hets + 2.0) * (curr_hets + 1.0)) ;
+			sum += het_probs[curr_hets + 2] ;
+			curr_homr-- ;
+			curr_homc-- ;
+		}
+		for( int i = 0; i <= rare_copies; i++ ) {
+			het_probs[i] /= sum ;
+		}
+		double p_hwe = 0.0 ;
+		for( int i = 0; i <= rare_copies; i++ ) {
+			if( het_probs[i] > het_probs[obs_hets] ) {
+				continue ;
+			}
+			p_hwe += het_probs[i] ;
+		}
+		p_hwe = p_hwe > 1.0 ? 1.0 : p_hwe ;
+		free( het_probs ) ;
+		return p_hwe ;
+	}
+}
+
+struct Counts {
+	int hets, hom1, hom2 ;
+} ;
+
+// Simulate genotype counts for a set of variants with allele frequencies drawn to
+// give mostly rare variants, with some departure from HWE.
+std::vector< Counts > simulate_counts( int const number_of_samples, std::size_t const number_of_variants ) {
+	std::vector< Counts > result( number_of_variants ) ;
+	std::srand( 1 ) ;
+	for( std::size_t i = 0; i < number_of_variants; ++i ) {
+		double const u = double( std::rand() ) / RAND_MAX ;
+		double const frequency = 0.5 * u * u * u ;
+		double const inbreeding = 0.05 * double( std::rand() ) / RAND_MAX ;
+		double const p_het = 2.0 * frequency * ( 1.0 - frequency ) * ( 1.0 - inbreeding ) ;
+		double const p_hom2 = frequency * frequency + inbreeding * frequency * ( 1.0 - frequency ) ;
+		result[i].hets = int( std::floor( p_het * number_of_samples + 0.5 )) ;
+		result[i].hom2 = int( std::floor( p_hom2 * number_of_samples + 0.5 )) ;
+		result[i].hom1 = number_of_samples - result[i].hets - result[i].hom2 ;
+	}
+	return result ;
+}
+
+template< typename Test >
+double time_test( std::string const& name, Test& test, std::vector< Counts > const& counts, std::vector< double >* results ) {
+	results->resize( counts.size() ) ;
+	boost::timer::cpu_timer timer ;
+	for( std::size_t i = 0; i < counts.size(); ++i ) {
+		(*results)[i] = test( counts[i].hets, counts[i].hom1, counts[i].hom2 ) ;
+	}
+	double const elapsed = timer.elapsed().wall / 1E9 ;
+	std::cerr << std::setw( 24 ) << name << ": "
+		<< std::setw( 10 ) << std::setprecision( 4 ) << ( elapsed * 1E6 / counts.size() ) << "us per variant.\n" ;
+	return elapsed ;
+}
+
+int main( int argc, char** argv ) {
+	std::size_t const number_of_variants = 20000 ;
+	int const sample_sizes[] = { 1000, 10000, 100000, 500000 } ;
+
+	bool all_agree = true ;
+	for( std::size_t s = 0; s < 4; ++s ) {
+		int const N = sample_sizes[s] ;
+		std::vector< Counts > const counts = simulate_counts( N, number_of_variants ) ;
+		std::cerr << "N = " << N << ", " << number_of_variants << " variants:\n" ;
+
+		std::vector< double > expected, uncached, cached ;
+		double (*reference_test)( int, int, int ) = &reference::SNPHWE ;
+		double (*uncached_test)( int, int, int ) = &SNPHWE ;
+		stats::HWEExactTest test ;
+		time_test( "reference", reference_test, counts, &expected ) ;
+		time_test( "SNPHWE", uncached_test, counts, &uncached ) ;
+		time_test( "HWEExactTest (cached)", test, counts, &cached ) ;
+		std::cerr << std::setw( 24 ) << "cache hits" << ": " << test.number_of_cache_hits() << ".\n" ;
+
+		double max_relative_error = 0.0 ;
+		for( std::size_t i = 0; i < counts.size(); ++i ) {
+			double const error = std::max(
+				std::abs( uncached[i] - expected[i] ),
+				std::abs( cached[i] - expected[i] )
+			) / std::max( expected[i], 1E-300 ) ;
+			max_relative_error = std::max( max_relative_error, error ) ;
+		}
+		std::cerr << std::setw( 24 ) << "max relative error" << ": " << max_relative_error << ".\n" ;
+		all_agree = all_agree && ( max_relative_error < 1E-10 ) ;
+	}
+	return all_agree ? 0 : 1 ;
+}
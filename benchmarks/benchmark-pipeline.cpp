@@ -0,0 +1,95 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// End-to-end throughput of qctool on synthetic data: -snp-stats on each input format,
+// and conversion between formats.  Each command is run as a separate qctool process.
+// Usage: benchmark-pipeline <path to qctool> [number of samples] [number of variants] [directory]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+#include <boost/timer/timer.hpp>
+#include "genfile/Error.hpp"
+#include "synthetic_data.hpp"
+
+namespace {
+	struct Command {
+		Command( std::string const& name_, std::string const& arguments_ ):
+			name( name_ ),
+			arguments( arguments_ )
+		{}
+		std::string name ;
+		std::string arguments ;
+	} ;
+}
+
+int main( int argc, char** argv ) {
+	if( argc < 2 ) {
+		std::cerr << "Usage: " << argv[0] << " <path to qctool> [number of samples] [number of variants] [directory]\n" ;
+		return 1 ;
+	}
+	std::string const qctool = argv[1] ;
+	benchmarks::SyntheticDataSpec spec ;
+	spec.number_of_samples = ( argc > 2 ) ? std::atoi( argv[2] ) : 1000 ;
+	spec.number_of_variants = ( argc > 3 ) ? std::atoi( argv[3] ) : 1000 ;
+	std::string const directory = ( argc > 4 ) ? argv[4] : "/tmp/qctool-benchmarks" ;
+
+	try {
+		boost::filesystem::create_directories( directory ) ;
+		std::string const stub = directory + "/synthetic" ;
+
+		std::cerr << "Generating " << spec.number_of_samples << " samples x " << spec.number_of_variants << " variants in \"" << directory << "\"...\n" ;
+		benchmarks::write_gen_file( stub + ".gen", spec ) ;
+		benchmarks::convert( stub + ".gen", stub + ".bgen", "bgen_v1.2", 16, "zlib" ) ;
+		benchmarks::convert( stub + ".gen", stub + ".bed", "binary_ped" ) ;
+		benchmarks::write_vcf_file( stub + ".vcf", spec, "GT:GP" ) ;
+	}
+	catch( genfile::InputError const& e ) {
+		std::cerr << "!! Error (" << e.what() << "): " << e.format_message() << "\n" ;
+		return 1 ;
+	}
+
+	std::string const stub = directory + "/synthetic" ;
+	std::string const out = directory + "/pipeline-output" ;
+	std::vector< Command > commands ;
+	commands.push_back( Command( "snp-stats gen", "-g " + stub + ".gen -snp-stats -osnp " + out + ".txt" )) ;
+	commands.push_back( Command( "snp-stats bgen", "-g " + stub + ".bgen -snp-stats -osnp " + out + ".txt" )) ;
+	commands.push_back( Command( "snp-stats vcf GP", "-g " + stub + ".vcf -vcf-genotype-field GP -snp-stats -osnp " + out + ".txt" )) ;
+	commands.push_back( Command( "snp-stats vcf GT", "-g " + stub + ".vcf -vcf-genotype-field GT -snp-stats -osnp " + out + ".txt" )) ;
+	commands.push_back( Command( "snp-stats bed", "-g " + stub + ".bed -snp-stats -osnp " + out + ".txt" )) ;
+	commands.push_back( Command( "convert gen -> bgen", "-g " + stub + ".gen -og " + out + ".bgen" )) ;
+	commands.push_back( Command( "convert bgen -> vcf", "-g " + stub + ".bgen -og " + out + ".vcf" )) ;
+	commands.push_back( Command( "convert vcf GP -> bgen", "-g " + stub + ".vcf -vcf-genotype-field GP -og " + out + ".bgen" )) ;
+	commands.push_back( Command( "convert bed -> bgen", "-g " + stub + ".bed -og " + out + ".bgen" )) ;
+
+	std::cout << std::setw( 32 ) << std::left << "benchmark" << std::right
+		<< std::setw( 12 ) << "seconds"
+		<< std::setw( 16 ) << "variants/s"
+		<< std::setw( 24 ) << "samples x variants/s"
+		<< "\n" ;
+
+	int result = 0 ;
+	for( std::size_t i = 0; i < commands.size(); ++i ) {
+		std::string const command = qctool + " " + commands[i].arguments + " -force -log " + out + ".log > /dev/null 2>&1" ;
+		boost::timer::cpu_timer timer ;
+		int const status = std::system( command.c_str() ) ;
+		double const elapsed = timer.elapsed().wall / 1E9 ;
+		if( status != 0 ) {
+			std::cerr << "!! Command failed with status " << status << ": " << command << "\n" ;
+			result = 1 ;
+			continue ;
+		}
+		std::cout << std::setw( 32 ) << std::left << commands[i].name << std::right
+			<< std::setw( 12 ) << std::setprecision( 4 ) << elapsed
+			<< std::setw( 16 ) << std::setprecision( 4 ) << ( spec.number_of_variants / elapsed )
+			<< std::setw( 24 ) << std::setprecision( 4 ) << ( spec.number_of_samples * spec.number_of_variants / elapsed )
+			<< "\n" ;
+	}
+	return result ;
+}
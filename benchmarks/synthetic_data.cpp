@@ -0,0 +1,172 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <boost/bind.hpp>
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/SNPDataSink.hpp"
+#include "genfile/BGenFileSNPDataSink.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantEntry.hpp"
+#include "genfile/string_utils.hpp"
+#include "genfile/Error.hpp"
+#include "synthetic_data.hpp"
+
+namespace benchmarks {
+	namespace {
+		struct Simulator {
+			Simulator( SyntheticDataSpec const& spec ):
+				m_spec( spec ),
+				m_rng( spec.seed )
+			{}
+
+			// Uniform on (0,1), using the raw generator output only.
+			double uniform() {
+				return ( double( m_rng() ) + 0.5 ) / 4294967296.0 ;
+			}
+
+			// Simulate three genotype probabilities per sample for the next variant,
+			// storing zeros for missing samples as in GEN files.
+			void next_variant( std::vector< double >* probs ) {
+				probs->resize( 3 * m_spec.number_of_samples ) ;
+				double const u = uniform() ;
+				double const frequency = 0.5 * u * u ;
+				for( std::size_t i = 0; i < m_spec.number_of_samples; ++i ) {
+					double* p = &(*probs)[ 3 * i ] ;
+					p[0] = p[1] = p[2] = 0 ;
+					if( uniform() < 0.01 ) {
+						continue ;
+					}
+					int const genotype = int( uniform() < frequency ) + int( uniform() < frequency ) ;
+					// Most calls are certain; the rest spread up to 30% of their mass over other genotypes.
+					double const error = ( uniform() < 0.8 ) ? 0.0 : std::floor( 150 * uniform() ) / 1000.0 ;
+					for( int g = 0; g < 3; ++g ) {
+						p[g] = ( g == genotype ) ? ( 1.0 - 2.0 * error ) : error ;
+					}
+				}
+			}
+
+		private:
+			SyntheticDataSpec const m_spec ;
+			std::mt19937 m_rng ;
+		} ;
+
+		std::string get_rsid( std::size_t i ) {
+			return "rs" + genfile::string_utils::to_string( i + 1 ) ;
+		}
+
+		uint32_t get_position( std::size_t i ) {
+			return 1000 + 10 * i ;
+		}
+
+		genfile::VariantEntry get_sample_name( std::size_t i ) {
+			return "sample_" + genfile::string_utils::to_string( i + 1 ) ;
+		}
+
+		std::auto_ptr< std::ostream > open_output_file( std::string const& filename ) {
+			std::auto_ptr< std::ostream > result( new std::ofstream( filename.c_str() )) ;
+			if( !*result ) {
+				throw genfile::ResourceNotOpenedError( filename ) ;
+			}
+			*result << std::fixed << std::setprecision( 3 ) ;
+			return result ;
+		}
+	}
+
+	void write_gen_file( std::string const& filename, SyntheticDataSpec const& spec ) {
+		std::auto_ptr< std::ostream > out = open_output_file( filename ) ;
+		Simulator simulator( spec ) ;
+		std::vector< double > probs ;
+		for( std::size_t v = 0; v < spec.number_of_variants; ++v ) {
+			simulator.next_variant( &probs ) ;
+			*out << "SNP" << ( v + 1 ) << " " << get_rsid( v ) << " " << get_position( v ) << " A G" ;
+			for( std::size_t i = 0; i < probs.size(); ++i ) {
+				*out << " " << probs[i] ;
+			}
+			*out << "\n" ;
+		}
+	}
+
+	void write_vcf_file( std::string const& filename, SyntheticDataSpec const& spec, std::string const& fields ) {
+		std::vector< std::string > const elts = genfile::string_utils::split( fields, ":" ) ;
+		std::auto_ptr< std::ostream > out = open_output_file( filename ) ;
+		*out << "##fileformat=VCFv4.2\n"
+			<< "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+			<< "##FORMAT=<ID=GP,Number=G,Type=Float,Description=\"Genotype call probabilities\">\n"
+			<< "##FORMAT=<ID=DS,Number=1,Type=Float,Description=\"Dosage of the alternate allele\">\n"
+			<< "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT" ;
+		for( std::size_t i = 0; i < spec.number_of_samples; ++i ) {
+			*out << "\t" << get_sample_name( i ).as< std::string >() ;
+		}
+		*out << "\n" ;
+
+		Simulator simulator( spec ) ;
+		std::vector< double > probs ;
+		for( std::size_t v = 0; v < spec.number_of_variants; ++v ) {
+			simulator.next_variant( &probs ) ;
+			*out << "01\t" << get_position( v ) << "\t" << get_rsid( v ) << "\tA\tG\t.\t.\t.\t" << fields ;
+			for( std::size_t i = 0; i < spec.number_of_samples; ++i ) {
+				double const* p = &probs[ 3 * i ] ;
+				bool const missing = ( p[0] + p[1] + p[2] ) == 0 ;
+				*out << "\t" ;
+				for( std::size_t k = 0; k < elts.size(); ++k ) {
+					*out << ( k > 0 ? ":" : "" ) ;
+					if( elts[k] == "GT" ) {
+						int const call = ( p[1] > p[0] && p[1] > p[2] ) ? 1 : (( p[2] > p[0] ) ? 2 : 0 ) ;
+						*out << ( missing ? "./." : ( call == 0 ? "0/0" : ( call == 1 ? "0/1" : "1/1" ))) ;
+					} else if( elts[k] == "GP" ) {
+						if( missing ) {
+							*out << "." ;
+						} else {
+							*out << p[0] << "," << p[1] << "," << p[2] ;
+						}
+					} else if( elts[k] == "DS" ) {
+						if( missing ) {
+							*out << "." ;
+						} else {
+							*out << ( p[1] + 2.0 * p[2] ) ;
+						}
+					} else {
+						throw genfile::BadArgumentError(
+							"benchmarks::write_vcf_file()",
+							"fields=\"" + fields + "\"",
+							"Only GT, GP and DS fields are supported."
+						) ;
+					}
+				}
+			}
+			*out << "\n" ;
+		}
+	}
+
+	void convert(
+		std::string const& input_filename,
+		std::string const& output_filename,
+		std::string const& filetype,
+		int number_of_bits,
+		std::string const& compression
+	) {
+		genfile::SNPDataSource::UniquePtr source = genfile::SNPDataSource::create( input_filename ) ;
+		genfile::SNPDataSink::UniquePtr sink = genfile::SNPDataSink::create( output_filename, source->get_metadata(), filetype ) ;
+		if( genfile::BasicBGenFileSNPDataSink* bgen_sink = dynamic_cast< genfile::BasicBGenFileSNPDataSink* >( sink.get() ) ) {
+			bgen_sink->set_number_of_bits( number_of_bits ) ;
+			bgen_sink->set_compression_type( compression ) ;
+		}
+		sink->set_sample_names( source->number_of_samples(), &get_sample_name ) ;
+		genfile::VariantIdentifyingData variant ;
+		while( source->get_snp_identifying_data( &variant )) {
+			genfile::VariantDataReader::UniquePtr reader = source->read_variant_data() ;
+			sink->write_variant_data( variant, *reader ) ;
+		}
+		sink->finalise() ;
+	}
+}
@@ -0,0 +1,50 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef QCTOOL_BENCHMARKS_SYNTHETIC_DATA_HPP
+#define QCTOOL_BENCHMARKS_SYNTHETIC_DATA_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace benchmarks {
+	// Generators for reproducible synthetic genotype data in the formats qctool reads.
+	// Data depends only on the spec: values are drawn from a seeded mt19937 without using
+	// the standard library distributions, whose output differs between implementations.
+	struct SyntheticDataSpec {
+		SyntheticDataSpec():
+			number_of_samples( 1000 ),
+			number_of_variants( 1000 ),
+			seed( 1 )
+		{}
+		std::size_t number_of_samples ;
+		std::size_t number_of_variants ;
+		uint32_t seed ;
+	} ;
+
+	// Write a GEN file with the given number of samples and variants.
+	// Allele frequencies are skewed towards rare variants.  Genotype probabilities put most
+	// of their mass on a genotype simulated under HWE, and about 1% of calls are missing.
+	void write_gen_file( std::string const& filename, SyntheticDataSpec const& spec ) ;
+
+	// Write a VCF file with the same genotypes as write_gen_file(), with the given FORMAT fields.
+	// Fields may be any of GT, GP and DS, separated by colons, e.g. "GT:GP".
+	void write_vcf_file( std::string const& filename, SyntheticDataSpec const& spec, std::string const& fields ) ;
+
+	// Copy all variants from the given file to a new file of the given type, as written by
+	// SNPDataSink (e.g. "bgen_v1.1", "bgen_v1.2" or "binary_ped").  For BGEN files the number of
+	// bits and the compression ("none", "zlib" or "zstd") can be specified.
+	void convert(
+		std::string const& input_filename,
+		std::string const& output_filename,
+		std::string const& filetype,
+		int number_of_bits = 16,
+		std::string const& compression = "zlib"
+	) ;
+}
+
+#endif
@@ -0,0 +1,62 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RELATEDNESS_COMPONENT_BINARY_MATRIX_FORMAT_HPP
+#define RELATEDNESS_COMPONENT_BINARY_MATRIX_FORMAT_HPP
+
+#include <string>
+#include <stdint.h>
+
+namespace pca {
+	// Binary matrix files consist of:
+	// - the 8 bytes "QCMATRIX",
+	// - 32-bit format version, storage, value type, compression, flags, and a reserved zero,
+	// - 64-bit number of rows, number of columns, number of SNPs, and offset of the block index (0 if uncompressed),
+	// - a 32-bit length and that many bytes of free-text metadata,
+	// - a 32-bit count of row ids, then each row id as a 32-bit length and bytes; and the same for column ids,
+	// - padding to a multiple of 8 bytes,
+	// - the data.
+	// Packed lower-triangular storage holds entries (i,0), ..., (i,i) of each row i in turn;
+	// dense storage holds the entries in column-major order.
+	// If the eHasCounts flag is set, a second array of 32-bit non-missingness counts, with the same layout,
+	// follows the values.
+	// Uncompressed data is stored as contiguous arrays so that files can be memory-mapped
+	// and used without parsing.  Compressed data is stored as zlib-compressed blocks of consecutive
+	// entries, listed in the block index at the end of the file: a 64-bit count of blocks, then for each
+	// block the 32-bit array (0 = values, 1 = counts), 32-bit zero, and 64-bit offset of first entry,
+	// number of entries, file offset and compressed size.
+	// All numbers are little-endian.
+	struct BinaryMatrixFormat {
+		enum Storage { ePackedLowerTriangle = 1, eDense = 2 } ;
+		enum ValueType { eFloat64 = 1, eFloat32 = 2 } ;
+		enum Compression { eNoCompression = 0, eZlibCompression = 1 } ;
+		enum Flags { eHasCounts = 1 } ;
+		enum Array { eValues = 0, eCounts = 1 } ;
+		static uint32_t const version = 2 ;
+		static std::size_t const header_size = 64 ;
+		static std::size_t const number_of_snps_offset = 48 ;
+		static std::size_t const index_offset_offset = 56 ;
+
+		// Parse a specification of the form "float64" or "float32", optionally followed by "+zlib".
+		static BinaryMatrixFormat parse( std::string const& spec ) ;
+		// Return true if the file starts with the binary matrix file magic number.
+		static bool is_binary_matrix_file( std::string const& filename ) ;
+		// Return true if the filename indicates binary output, i.e. ends in ".bin".
+		static bool is_binary_matrix_filename( std::string const& filename ) ;
+
+		BinaryMatrixFormat( ValueType value_type_ = eFloat64, Compression compression_ = eNoCompression ):
+			value_type( value_type_ ),
+			compression( compression_ )
+		{}
+
+		std::size_t value_size() const { return ( value_type == eFloat32 ) ? 4 : 8 ; }
+
+		ValueType value_type ;
+		Compression compression ;
+	} ;
+}
+
+#endif
@@ -0,0 +1,77 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RELATEDNESS_COMPONENT_BINARY_MATRIX_READER_HPP
+#define RELATEDNESS_COMPONENT_BINARY_MATRIX_READER_HPP
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <Eigen/Core>
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+
+namespace pca {
+	// Reads a matrix written by BinaryMatrixWriter.
+	// The file is memory-mapped; uncompressed data is accessed in place, while compressed
+	// data is decompressed when the reader is constructed.
+	struct BinaryMatrixReader: public boost::noncopyable {
+	public:
+		typedef std::auto_ptr< BinaryMatrixReader > UniquePtr ;
+		static UniquePtr create( std::string const& filename ) ;
+
+	public:
+		BinaryMatrixReader( std::string const& filename ) ;
+
+		BinaryMatrixFormat::Storage storage() const { return m_storage ; }
+		BinaryMatrixFormat const& format() const { return m_format ; }
+		std::size_t number_of_rows() const { return m_number_of_rows ; }
+		std::size_t number_of_columns() const { return m_number_of_columns ; }
+		std::size_t number_of_snps() const { return m_number_of_snps ; }
+		bool has_counts() const { return m_counts != 0 ; }
+		std::string const& metadata() const { return m_metadata ; }
+		// Row and column ids; these are empty if the file does not store them.
+		std::vector< std::string > const& row_ids() const { return m_row_ids ; }
+		std::vector< std::string > const& column_ids() const { return m_column_ids ; }
+
+		// Return the value or count at (i,j).  For packed storage, (i,j) and (j,i) are the same entry.
+		double value( std::size_t i, std::size_t j ) const ;
+		double count( std::size_t i, std::size_t j ) const ;
+
+		// Fill the given matrix with all values or counts.
+		void get_values( Eigen::MatrixXd* result ) const ;
+		void get_counts( Eigen::MatrixXd* result ) const ;
+
+	private:
+		std::string const m_filename ;
+		boost::iostreams::mapped_file_source m_file ;
+		BinaryMatrixFormat::Storage m_storage ;
+		BinaryMatrixFormat m_format ;
+		std::size_t m_number_of_rows ;
+		std::size_t m_number_of_columns ;
+		std::size_t m_number_of_snps ;
+		std::string m_metadata ;
+		std::vector< std::string > m_row_ids ;
+		std::vector< std::string > m_column_ids ;
+		// Pointers to the start of the value and count arrays, either in the mapped file
+		// or in the decompressed storage below.
+		char const* m_values ;
+		int32_t const* m_counts ;
+		std::vector< char > m_decompressed_values ;
+		std::vector< int32_t > m_decompressed_counts ;
+
+	private:
+		void read_header() ;
+		void read_blocks( uint64_t const index_offset ) ;
+		std::size_t number_of_entries() const ;
+		std::size_t entry_index( std::size_t i, std::size_t j ) const ;
+		double value( std::size_t index ) const ;
+	} ;
+}
+
+#endif
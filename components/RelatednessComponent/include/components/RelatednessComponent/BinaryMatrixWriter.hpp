@@ -0,0 +1,134 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RELATEDNESS_COMPONENT_BINARY_MATRIX_WRITER_HPP
+#define RELATEDNESS_COMPONENT_BINARY_MATRIX_WRITER_HPP
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantEntry.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+
+namespace pca {
+	// Writes a matrix to a file in the format described in BinaryMatrixFormat.hpp.
+	struct BinaryMatrixWriter: public boost::noncopyable {
+	public:
+		typedef std::auto_ptr< BinaryMatrixWriter > UniquePtr ;
+		typedef boost::function< genfile::VariantEntry ( std::size_t ) > GetNames ;
+
+		// Create a writer for a symmetric matrix with non-missingness counts, which is written in tiles.
+		static UniquePtr create_lower_triangle(
+			std::string const& filename,
+			std::size_t const number_of_rows,
+			BinaryMatrixFormat const& format,
+			std::string const& source,
+			std::string const& description,
+			GetNames get_names
+		) ;
+		// Create a writer for a general matrix, which is written with write_matrix().
+		static UniquePtr create_dense(
+			std::string const& filename,
+			std::size_t const number_of_rows,
+			std::size_t const number_of_columns,
+			BinaryMatrixFormat const& format,
+			std::string const& source,
+			std::string const& description,
+			GetNames get_row_names,
+			GetNames get_column_names
+		) ;
+
+	public:
+		BinaryMatrixWriter(
+			std::string const& filename,
+			BinaryMatrixFormat::Storage const storage,
+			std::size_t const number_of_rows,
+			std::size_t const number_of_columns,
+			BinaryMatrixFormat const& format,
+			std::string const& source,
+			std::string const& description,
+			GetNames get_row_names,
+			GetNames get_column_names
+		) ;
+		~BinaryMatrixWriter() ;
+
+		// Write rows of the lower triangle of a symmetric matrix.  Tiles may be written in any order.
+		void write_tile( std::size_t const number_of_snps, LowerTriangularTile const& tile ) ;
+		// Write the lower triangle of the given symmetric matrices of counts and values.
+		void write_lower_triangle( std::size_t const number_of_snps, Eigen::MatrixXd const& counts, Eigen::MatrixXd const& values ) ;
+		// Write a whole matrix in dense storage.
+		void write_matrix( std::size_t const number_of_snps, Eigen::MatrixXd const& matrix ) ;
+		// Finish writing the file.  This is called on destruction if not called explicitly.
+		void close() ;
+
+	private:
+		struct BlockIndexEntry {
+			uint32_t array ;
+			uint64_t first_entry ;
+			uint64_t number_of_entries ;
+			uint64_t file_offset ;
+			uint64_t size ;
+		} ;
+
+		std::string const m_filename ;
+		BinaryMatrixFormat::Storage const m_storage ;
+		std::size_t const m_number_of_rows ;
+		std::size_t const m_number_of_columns ;
+		BinaryMatrixFormat const m_format ;
+		std::ofstream m_stream ;
+		std::size_t m_number_of_snps ;
+		std::streampos m_values_offset ;
+		std::streampos m_counts_offset ;
+		std::vector< BlockIndexEntry > m_block_index ;
+		// Storage for converted and compressed blocks.
+		std::vector< char > m_buffer ;
+		std::vector< unsigned char > m_compressed_buffer ;
+
+	private:
+		std::size_t number_of_entries() const ;
+		void write_header(
+			std::string const& source,
+			std::string const& description,
+			GetNames get_row_names,
+			GetNames get_column_names
+		) ;
+		void write_values( std::size_t const first_entry, double const* values, std::size_t const number_of_entries ) ;
+		void write_counts( std::size_t const first_entry, int const* counts, std::size_t const number_of_entries ) ;
+		void write_block( BinaryMatrixFormat::Array const array, std::size_t const first_entry, std::size_t const number_of_entries ) ;
+	} ;
+
+	// Write the lower triangle of the kinship matrices passed to KinshipCoefficientManager callbacks.
+	void write_matrix_lower_diagonals_in_binary_form(
+		std::string const& filename,
+		BinaryMatrixFormat const& format,
+		std::size_t const number_of_snps,
+		Eigen::MatrixXd const& counts,
+		Eigen::MatrixXd const& values,
+		std::string const& source,
+		std::string const& description,
+		BinaryMatrixWriter::GetNames get_names
+	) ;
+
+	// Write a matrix in dense binary form.
+	void write_matrix_in_binary_form(
+		std::string const& filename,
+		BinaryMatrixFormat const& format,
+		std::size_t const number_of_snps,
+		Eigen::MatrixXd const& matrix,
+		std::string const& source,
+		std::string const& description,
+		BinaryMatrixWriter::GetNames get_row_names,
+		BinaryMatrixWriter::GetNames get_column_names
+	) ;
+}
+
+#endif
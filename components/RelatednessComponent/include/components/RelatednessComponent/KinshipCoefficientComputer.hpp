@@ -8,6 +8,7 @@
 #define COMPONENTS_RELATEDNESS_COMPONENT_KINSHIPCOEFFICIENTCOMPUTATION_HPP
 
 #include <stdint.h>
+#include <fstream>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/signals2.hpp>
 #include "Eigen/Core"
@@ -22,6 +23,7 @@
 #include "appcontext/OptionProcessor.hpp"
 #include "appcontext/FileUtil.hpp"
 #include "components/RelatednessComponent/KinshipCoefficientManager.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
 //#include "components/RelatednessComponent/KinshipCoefficientBlockTask.hpp"
 
 struct KinshipCoefficientComputer: public KinshipCoefficientManager, public genfile::SNPDataSourceProcessor::Callback
@@ -114,6 +116,20 @@ namespace impl {
 		Computation::Matrix const& result() const ;
 		Computation::IntegerMatrix const& nonmissingness() const ;
 		std::string get_summary() const ;
+
+		typedef boost::signals2::signal< void( std::size_t number_of_snps, pca::LowerTriangularTile const& tile ) > TileSignal ;
+		typedef TileSignal::slot_type TileCallback ;
+		// Compute out of core.  The lower triangle of the result is split into bands of rows
+		// so that at most about max_bytes of memory is used at once, and the bands are computed
+		// in one or more passes through the data.  The first pass happens as SNPs are processed; packed
+		// genotypes are written to a temporary file named after temporary_filename_stem for later passes.
+		// Finished tiles are sent to callbacks passed to send_tiles_to(), and result() and nonmissingness() are empty.
+		void set_memory_budget( std::size_t const max_bytes, std::string const& temporary_filename_stem ) ;
+		void send_tiles_to( TileCallback callback ) ;
+		// Callbacks passed here are called once all tiles have been sent, e.g. to close output files.
+		typedef boost::signals2::signal< void() > EndOfTilesSignal ;
+		void send_end_of_tiles_to( EndOfTilesSignal::slot_type callback ) ;
+
 		void begin_processing_snps( std::size_t number_of_samples, genfile::SNPDataSource::Metadata const& ) ;
 		void processed_snp( genfile::VariantIdentifyingData const& id_data, genfile::VariantDataReader::SharedPtr data_reader ) ;
 		void end_processing_snps() ;
@@ -133,6 +149,17 @@ namespace impl {
 		std::size_t m_snp_count ;
 		Computation::Matrix m_result ;
 		Computation::IntegerMatrix m_nonmissingness ;
+		// Out-of-core computation.
+		std::size_t m_memory_budget ;
+		std::string m_temporary_filename_stem ;
+		std::vector< std::pair< std::size_t, std::size_t > > m_tile_rows ;
+		std::size_t m_number_of_tiles_per_pass ;
+		boost::ptr_vector< pca::LowerTriangularTile > m_pass_tiles ;
+		std::vector< std::pair< double, double > > m_block_parameters ;
+		std::string m_spill_filename ;
+		std::auto_ptr< std::ofstream > m_spill_stream ;
+		TileSignal m_tile_signal ;
+		EndOfTilesSignal m_end_of_tiles_signal ;
 	private:
 		void add_snp_to_lookup_table(
 			std::size_t const lookup_snp_index,
@@ -150,6 +177,20 @@ namespace impl {
 			SampleBounds const& sample_bounds,
 			std::vector< uint64_t > const& genotypes
 		) ;
+
+		void clear_lookup_tables() ;
+		void submit_block() ;
+		bool is_out_of_core() const { return m_memory_budget > 0 ; }
+		std::size_t number_of_passes() const ;
+		void compute_tiling( std::size_t const number_of_samples ) ;
+		void begin_pass( std::size_t const pass ) ;
+		void end_pass() ;
+		void spill_block() ;
+		void replay_spilled_blocks() ;
+		void compute_tile(
+			pca::LowerTriangularTile* tile,
+			std::vector< uint64_t > const& genotypes
+		) ;
 	} ;
 }
 
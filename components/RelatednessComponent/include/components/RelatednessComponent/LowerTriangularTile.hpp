@@ -0,0 +1,72 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RELATEDNESS_COMPONENT_LOWER_TRIANGULAR_TILE_HPP
+#define RELATEDNESS_COMPONENT_LOWER_TRIANGULAR_TILE_HPP
+
+#include <vector>
+#include <cassert>
+#include <algorithm>
+
+namespace pca {
+	// A band of rows [begin_row, end_row) of the lower triangle (including the diagonal)
+	// of a symmetric matrix, holding a value and a non-missingness count for each entry.
+	// Entries are packed row by row, so row i holds entries (i,0), ..., (i,i) and
+	// the band occupies a contiguous range of the packed lower triangle of the whole matrix.
+	struct LowerTriangularTile {
+	public:
+		// Offset of row i in the packed lower triangle.
+		static std::size_t row_offset( std::size_t i ) { return ( i * ( i + 1 ) ) / 2 ; }
+
+	public:
+		LowerTriangularTile( std::size_t begin_row, std::size_t end_row ):
+			m_begin_row( begin_row ),
+			m_end_row( end_row ),
+			m_values( row_offset( end_row ) - row_offset( begin_row ), 0.0 ),
+			m_nonmissingness( m_values.size(), 0 )
+		{
+			assert( end_row >= begin_row ) ;
+		}
+
+		std::size_t begin_row() const { return m_begin_row ; }
+		std::size_t end_row() const { return m_end_row ; }
+		// Number of entries in the tile.
+		std::size_t size() const { return m_values.size() ; }
+		// Offset of the tile in the packed lower triangle of the whole matrix.
+		std::size_t offset() const { return row_offset( m_begin_row ) ; }
+
+		void set_zero() {
+			std::fill( m_values.begin(), m_values.end(), 0.0 ) ;
+			std::fill( m_nonmissingness.begin(), m_nonmissingness.end(), 0 ) ;
+		}
+
+		// Access entries by row and column, with begin_row() <= i < end_row() and j <= i.
+		double& value( std::size_t i, std::size_t j ) { return m_values[ index( i, j ) ] ; }
+		double value( std::size_t i, std::size_t j ) const { return m_values[ index( i, j ) ] ; }
+		int& nonmissingness( std::size_t i, std::size_t j ) { return m_nonmissingness[ index( i, j ) ] ; }
+		int nonmissingness( std::size_t i, std::size_t j ) const { return m_nonmissingness[ index( i, j ) ] ; }
+
+		// Access the packed storage.
+		std::vector< double >& values() { return m_values ; }
+		std::vector< double > const& values() const { return m_values ; }
+		std::vector< int >& nonmissingness() { return m_nonmissingness ; }
+		std::vector< int > const& nonmissingness() const { return m_nonmissingness ; }
+
+	private:
+		std::size_t const m_begin_row ;
+		std::size_t const m_end_row ;
+		std::vector< double > m_values ;
+		std::vector< int > m_nonmissingness ;
+
+	private:
+		std::size_t index( std::size_t i, std::size_t j ) const {
+			assert( i >= m_begin_row && i < m_end_row && j <= i ) ;
+			return row_offset( i ) - row_offset( m_begin_row ) + j ;
+		}
+	} ;
+}
+
+#endif
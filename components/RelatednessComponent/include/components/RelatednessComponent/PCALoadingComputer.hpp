@@ -7,9 +7,12 @@
 #ifndef RELATEDNESS_COMPONENT_PCA_LOADING_COMPUTER_HPP
 #define RELATEDNESS_COMPONENT_PCA_LOADING_COMPUTER_HPP
 
+#include <vector>
 #include <Eigen/Core>
 #include "genfile/SNPDataSourceProcessor.hpp"
+#include "worker/Worker.hpp"
 #include "components/RelatednessComponent/KinshipCoefficientManager.hpp"
+#include "components/RelatednessComponent/KinshipCoefficientComputer.hpp"
 
 struct PCALoadingComputer: public genfile::SNPDataSourceProcessor::Callback
 {
@@ -18,7 +21,9 @@ public:
 	typedef Eigen::VectorXd Vector ;
 	typedef std::auto_ptr< PCALoadingComputer > UniquePtr ;
 public:
-	PCALoadingComputer( int number_of_loadings ) ;
+	// Genotypes are buffered and loadings computed for blocks of number_of_snps_per_block variants at a time,
+	// using the worker (if given) to spread each block across threads.
+	PCALoadingComputer( int number_of_loadings, worker::Worker* worker = 0, std::size_t number_of_snps_per_block = 512 ) ;
 	void set_UDUT( std::size_t number_of_snps, Matrix const& udut_decomposition ) ;
 	void set_number_of_loadings( std::size_t n ) ;
 
@@ -40,12 +45,37 @@ private:
 	Eigen::MatrixXd m_U ;
 	int const m_number_of_loadings ;
 	int m_number_of_snps ;
+	// Squares of entries of m_U, used to compute correlations.
+	Eigen::MatrixXd m_U_squared ;
 	Eigen::RowVectorXd m_loading_vectors ;
-	Eigen::VectorXd m_allele_frequencies ;
 	Eigen::VectorXd m_genotype_calls ;
 	Eigen::VectorXd m_non_missingness ;
-	
+
+	worker::Worker* m_worker ;
+	impl::NTaskDispatcher::UniquePtr m_dispatcher ;
+	std::size_t const m_number_of_snps_per_block ;
+	// The number of variants per block, which is limited for large sample counts.
+	std::size_t m_block_capacity ;
+
+	// The current block.  Columns of m_block_genotypes hold standardised genotypes (zero where missing)
+	// and those of m_block_non_missingness hold non-missingness indicators.
+	std::size_t m_block_size ;
+	std::vector< genfile::VariantIdentifyingData > m_block_snps ;
+	Eigen::MatrixXd m_block_genotypes ;
+	Eigen::MatrixXd m_block_non_missingness ;
+	// Per-variant non-missingness count, allele frequency, sum and sum of squares of genotypes.
+	Eigen::MatrixXd m_block_summaries ;
+	std::vector< bool > m_block_included ;
+	// Products of the block with U: X^t U, M^t U, and M^t (U*U).
+	Eigen::MatrixXd m_XtU ;
+	Eigen::MatrixXd m_MtU ;
+	Eigen::MatrixXd m_MtUU ;
+
 	ResultSignal m_result_signal ;
+
+private:
+	void process_block() ;
+	void compute_block_products( int begin_snp, int end_snp ) ;
 } ;
 
 #endif
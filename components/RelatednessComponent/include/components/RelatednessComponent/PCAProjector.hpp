@@ -14,6 +14,8 @@
 #include "genfile/CohortIndividualSource.hpp"
 #include "genfile/SNPDataSourceProcessor.hpp"
 #include "appcontext/UIContext.hpp"
+#include "worker/Worker.hpp"
+#include "components/RelatednessComponent/KinshipCoefficientComputer.hpp"
 
 namespace pca {
 	struct PCAProjector: public genfile::SNPDataSourceProcessor::Callback
@@ -26,15 +28,21 @@ namespace pca {
 		static genfile::VariantEntry get_projection_name( std::size_t i ) ;
 
 	public:
+		// Genotypes are buffered and projected for blocks of number_of_snps_per_block variants at a time,
+		// using the worker (if given) to spread each block across threads.
 		static UniquePtr create(
 			genfile::CohortIndividualSource const& samples,
 			appcontext::UIContext& ui_context,
-			genfile::VariantIdentifyingData::CompareFields const&
+			genfile::VariantIdentifyingData::CompareFields const&,
+			worker::Worker* worker = 0,
+			std::size_t number_of_snps_per_block = 512
 		) ;
 		PCAProjector(
 			genfile::CohortIndividualSource const& samples,
 			appcontext::UIContext& ui_context,
-			genfile::VariantIdentifyingData::CompareFields const&
+			genfile::VariantIdentifyingData::CompareFields const&,
+			worker::Worker* worker,
+			std::size_t number_of_snps_per_block
 		) ;
 		
 		void set_loadings(
@@ -67,6 +75,16 @@ namespace pca {
 		Eigen::VectorXd m_non_missingness ;
 		Eigen::MatrixXd m_projections ;
 		Eigen::VectorXd m_snps_visited_per_sample ;
+
+		worker::Worker* m_worker ;
+		impl::NTaskDispatcher::UniquePtr m_dispatcher ;
+		std::size_t const m_number_of_snps_per_block ;
+		// The number of variants per block, which is limited for large sample counts.
+		std::size_t m_block_capacity ;
+		// The current block: standardised genotypes as columns, and the corresponding loadings as rows.
+		std::size_t m_block_size ;
+		Eigen::MatrixXd m_block_genotypes ;
+		Eigen::MatrixXd m_block_loadings ;
 	
 		// m_visited keeps track of which SNPs have been used in the projection.
 		typedef std::map< genfile::GenomePosition, int > VisitedSnpMap ;
@@ -75,6 +93,8 @@ namespace pca {
 		ResultSignal m_result_signal ;
 		
 		void diagnose_projection() const ;
+		void process_block() ;
+		void accumulate_projections( int begin_sample, int end_sample ) ;
 	} ;
 }
 
@@ -0,0 +1,72 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RELATEDNESS_COMPONENT_SPARSE_MATRIX_WRITER_HPP
+#define RELATEDNESS_COMPONENT_SPARSE_MATRIX_WRITER_HPP
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include "genfile/VariantEntry.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+
+namespace pca {
+	// Writes the off-diagonal entries of a symmetric matrix that are above a threshold.
+	// Output goes to a sqlite table with one row (sample_1, sample_2, pairwise_complete_obs, value) per pair
+	// if the filename starts with "sqlite://" or ends in ".sqlite", and otherwise to a binary file consisting of:
+	// - the 8 bytes "QCSPARSE",
+	// - 32-bit format version and a reserved zero,
+	// - 64-bit number of samples, number of SNPs, and number of records,
+	// - a 32-bit length and that many bytes of free-text metadata,
+	// - a 32-bit count of sample ids, then each id as a 32-bit length and bytes,
+	// - the records, each a 32-bit row index i, 32-bit column index j < i, 32-bit non-missingness count,
+	//   and 64-bit floating-point value.
+	// All numbers are little-endian.
+	// close() must be called once all tiles are written; a writer destroyed without it leaves an incomplete file.
+	struct SparseMatrixWriter: public boost::noncopyable {
+	public:
+		typedef std::auto_ptr< SparseMatrixWriter > UniquePtr ;
+		typedef boost::function< genfile::VariantEntry ( std::size_t ) > GetNames ;
+		static UniquePtr create(
+			std::string const& filename,
+			std::size_t const number_of_samples,
+			double const threshold,
+			GetNames get_names,
+			std::string const& source,
+			std::string const& description
+		) ;
+
+		static uint32_t const version = 1 ;
+		static std::size_t const number_of_snps_offset = 24 ;
+		static std::size_t const record_size = 20 ;
+
+	public:
+		virtual ~SparseMatrixWriter() {}
+		void write_tile( std::size_t const number_of_snps, LowerTriangularTile const& tile ) ;
+		// Finish writing: for sqlite output this indexes the table, and for binary output it records
+		// the number of SNPs and records in the header.
+		virtual void close() = 0 ;
+		std::size_t number_of_pairs_written() const { return m_number_of_pairs_written ; }
+
+	protected:
+		SparseMatrixWriter( double const threshold, GetNames get_names ) ;
+		virtual void begin_tile() {}
+		virtual void write_pair( std::size_t const i, std::size_t const j, int const nonmissingness, double const value ) = 0 ;
+		virtual void end_tile() {}
+		GetNames const& get_names() const { return m_get_names ; }
+		std::size_t number_of_snps() const { return m_number_of_snps ; }
+
+	private:
+		double const m_threshold ;
+		GetNames m_get_names ;
+		std::size_t m_number_of_pairs_written ;
+		std::size_t m_number_of_snps ;
+	} ;
+}
+
+#endif
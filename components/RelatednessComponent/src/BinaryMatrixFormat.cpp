@@ -0,0 +1,47 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include "genfile/Error.hpp"
+#include "genfile/string_utils.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+
+namespace pca {
+	BinaryMatrixFormat BinaryMatrixFormat::parse( std::string const& spec ) {
+		std::vector< std::string > const elts = genfile::string_utils::split( spec, "+" ) ;
+		BinaryMatrixFormat result ;
+		if( elts.size() > 2 ) {
+			throw genfile::BadArgumentError( "pca::BinaryMatrixFormat::parse()", "spec=\"" + spec + "\"", "Expected a value type with optional \"+zlib\"." ) ;
+		}
+		if( elts[0] == "float64" ) {
+			result.value_type = eFloat64 ;
+		} else if( elts[0] == "float32" ) {
+			result.value_type = eFloat32 ;
+		} else {
+			throw genfile::BadArgumentError( "pca::BinaryMatrixFormat::parse()", "spec=\"" + spec + "\"", "Value type must be \"float64\" or \"float32\"." ) ;
+		}
+		if( elts.size() == 2 ) {
+			if( elts[1] != "zlib" ) {
+				throw genfile::BadArgumentError( "pca::BinaryMatrixFormat::parse()", "spec=\"" + spec + "\"", "Compression must be \"zlib\"." ) ;
+			}
+			result.compression = eZlibCompression ;
+		}
+		return result ;
+	}
+
+	bool BinaryMatrixFormat::is_binary_matrix_file( std::string const& filename ) {
+		std::ifstream stream( filename.c_str(), std::ios::binary ) ;
+		char magic[8] ;
+		stream.read( magic, 8 ) ;
+		return stream && std::string( magic, magic + 8 ) == "QCMATRIX" ;
+	}
+
+	bool BinaryMatrixFormat::is_binary_matrix_filename( std::string const& filename ) {
+		return filename.size() > 4 && filename.compare( filename.size() - 4, 4, ".bin" ) == 0 ;
+	}
+}
@@ -0,0 +1,254 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/format.hpp>
+#include "genfile/Error.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/zlib.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+#include "components/RelatednessComponent/BinaryMatrixReader.hpp"
+
+namespace pca {
+	namespace {
+		uint8_t const* read_string( uint8_t const* buffer, uint8_t const* const end, std::string* result ) {
+			uint32_t size = 0 ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &size ) ;
+			if( std::size_t( end - buffer ) < size ) {
+				throw genfile::MalformedInputError( "pca::BinaryMatrixReader", "File is truncated.", 0 ) ;
+			}
+			result->assign( buffer, buffer + size ) ;
+			return buffer + size ;
+		}
+
+		uint8_t const* read_ids( uint8_t const* buffer, uint8_t const* const end, std::size_t const expected, std::vector< std::string >* result ) {
+			uint32_t count = 0 ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &count ) ;
+			if( count != 0 && count != expected ) {
+				throw genfile::MalformedInputError( "pca::BinaryMatrixReader", "Number of ids does not match matrix size.", 0 ) ;
+			}
+			result->resize( count ) ;
+			for( std::size_t i = 0; i < count; ++i ) {
+				if( end - buffer < 4 ) {
+					throw genfile::MalformedInputError( "pca::BinaryMatrixReader", "File is truncated.", 0 ) ;
+				}
+				buffer = read_string( buffer, end, &(*result)[i] ) ;
+			}
+			return buffer ;
+		}
+	}
+
+	BinaryMatrixReader::UniquePtr BinaryMatrixReader::create( std::string const& filename ) {
+		return UniquePtr( new BinaryMatrixReader( filename )) ;
+	}
+
+	BinaryMatrixReader::BinaryMatrixReader( std::string const& filename ):
+		m_filename( filename ),
+		m_values( 0 ),
+		m_counts( 0 )
+	{
+		if( !BinaryMatrixFormat::is_binary_matrix_file( filename ) ) {
+			throw genfile::MalformedInputError( filename, "File is not a binary matrix file.", 0 ) ;
+		}
+		try {
+			m_file.open( filename ) ;
+		}
+		catch( std::ios_base::failure const& ) {
+			throw genfile::ResourceNotOpenedError( filename ) ;
+		}
+		read_header() ;
+	}
+
+	std::size_t BinaryMatrixReader::number_of_entries() const {
+		if( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) {
+			return LowerTriangularTile::row_offset( m_number_of_rows ) ;
+		} else {
+			return m_number_of_rows * m_number_of_columns ;
+		}
+	}
+
+	void BinaryMatrixReader::read_header() {
+		uint8_t const* const begin = reinterpret_cast< uint8_t const* >( m_file.data() ) ;
+		uint8_t const* const end = begin + m_file.size() ;
+		if( m_file.size() < BinaryMatrixFormat::header_size ) {
+			throw genfile::MalformedInputError( m_filename, "File is truncated.", 0 ) ;
+		}
+		uint8_t const* buffer = begin + 8 ;
+		uint32_t version, storage, value_type, compression, flags, reserved ;
+		uint64_t number_of_rows, number_of_columns, number_of_snps, index_offset ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &version ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &storage ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &value_type ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &compression ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &flags ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &reserved ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &number_of_rows ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &number_of_columns ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &number_of_snps ) ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &index_offset ) ;
+
+		if( version != BinaryMatrixFormat::version ) {
+			throw genfile::MalformedInputError(
+				m_filename,
+				( boost::format( "Unsupported binary matrix format version %d." ) % version ).str(),
+				0
+			) ;
+		}
+		if(
+			( storage != BinaryMatrixFormat::ePackedLowerTriangle && storage != BinaryMatrixFormat::eDense )
+			|| ( value_type != BinaryMatrixFormat::eFloat64 && value_type != BinaryMatrixFormat::eFloat32 )
+			|| ( compression != BinaryMatrixFormat::eNoCompression && compression != BinaryMatrixFormat::eZlibCompression )
+			|| ( storage == BinaryMatrixFormat::ePackedLowerTriangle && number_of_rows != number_of_columns )
+		) {
+			throw genfile::MalformedInputError( m_filename, "Unrecognised matrix storage, value type or compression.", 0 ) ;
+		}
+		m_storage = BinaryMatrixFormat::Storage( storage ) ;
+		m_format = BinaryMatrixFormat( BinaryMatrixFormat::ValueType( value_type ), BinaryMatrixFormat::Compression( compression ) ) ;
+		m_number_of_rows = number_of_rows ;
+		m_number_of_columns = number_of_columns ;
+		m_number_of_snps = number_of_snps ;
+
+		buffer = read_string( buffer, end, &m_metadata ) ;
+		buffer = read_ids( buffer, end, m_number_of_rows, &m_row_ids ) ;
+		buffer = read_ids( buffer, end, m_number_of_columns, &m_column_ids ) ;
+		buffer += ( 8 - ( ( buffer - begin ) % 8 )) % 8 ;
+
+		bool const has_counts = ( flags & BinaryMatrixFormat::eHasCounts ) ;
+		std::size_t const values_size = number_of_entries() * m_format.value_size() ;
+		if( m_format.compression == BinaryMatrixFormat::eZlibCompression ) {
+			m_decompressed_values.resize( values_size ) ;
+			if( has_counts ) {
+				m_decompressed_counts.resize( number_of_entries() ) ;
+			}
+			read_blocks( index_offset ) ;
+			m_values = m_decompressed_values.empty() ? 0 : &m_decompressed_values[0] ;
+			m_counts = m_decompressed_counts.empty() ? 0 : &m_decompressed_counts[0] ;
+		} else {
+			std::size_t const counts_size = has_counts ? number_of_entries() * sizeof( int32_t ) : 0 ;
+			std::size_t const padded_values_size = values_size + ( 8 - values_size % 8 ) % 8 ;
+			if( std::size_t( end - buffer ) < padded_values_size + counts_size ) {
+				throw genfile::MalformedInputError( m_filename, "File is truncated.", 0 ) ;
+			}
+			m_values = reinterpret_cast< char const* >( buffer ) ;
+			if( has_counts ) {
+				m_counts = reinterpret_cast< int32_t const* >( buffer + padded_values_size ) ;
+			}
+		}
+	}
+
+	void BinaryMatrixReader::read_blocks( uint64_t const index_offset ) {
+		uint8_t const* const begin = reinterpret_cast< uint8_t const* >( m_file.data() ) ;
+		uint8_t const* const end = begin + m_file.size() ;
+		if( index_offset == 0 || index_offset + 8 > m_file.size() ) {
+			throw genfile::MalformedInputError( m_filename, "File has no block index; was it closed properly?", 0 ) ;
+		}
+		uint8_t const* buffer = begin + index_offset ;
+		uint64_t number_of_blocks ;
+		buffer = genfile::read_little_endian_integer( buffer, end, &number_of_blocks ) ;
+		if( uint64_t( end - buffer ) < number_of_blocks * 40 ) {
+			throw genfile::MalformedInputError( m_filename, "Block index is truncated.", 0 ) ;
+		}
+		std::vector< char > values ;
+		std::vector< int32_t > counts ;
+		for( std::size_t i = 0; i < number_of_blocks; ++i ) {
+			uint32_t array, reserved ;
+			uint64_t first_entry, count, file_offset, size ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &array ) ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &reserved ) ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &first_entry ) ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &count ) ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &file_offset ) ;
+			buffer = genfile::read_little_endian_integer( buffer, end, &size ) ;
+			if( file_offset + size > m_file.size() || first_entry + count > number_of_entries() ) {
+				throw genfile::MalformedInputError( m_filename, ( boost::format( "Block %d is out of range." ) % i ).str(), 0 ) ;
+			}
+			if( array == BinaryMatrixFormat::eValues ) {
+				std::size_t const value_size = m_format.value_size() ;
+				values.resize( count * value_size ) ;
+				genfile::zlib_uncompress( begin + file_offset, begin + file_offset + size, &values ) ;
+				std::copy( values.begin(), values.end(), m_decompressed_values.begin() + first_entry * value_size ) ;
+			} else if( array == BinaryMatrixFormat::eCounts && !m_decompressed_counts.empty() ) {
+				counts.resize( count ) ;
+				genfile::zlib_uncompress( begin + file_offset, begin + file_offset + size, &counts ) ;
+				std::copy( counts.begin(), counts.end(), m_decompressed_counts.begin() + first_entry ) ;
+			} else {
+				throw genfile::MalformedInputError( m_filename, ( boost::format( "Block %d has unrecognised array." ) % i ).str(), 0 ) ;
+			}
+		}
+	}
+
+	std::size_t BinaryMatrixReader::entry_index( std::size_t i, std::size_t j ) const {
+		assert( i < m_number_of_rows && j < m_number_of_columns ) ;
+		if( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) {
+			if( j > i ) {
+				std::swap( i, j ) ;
+			}
+			return LowerTriangularTile::row_offset( i ) + j ;
+		} else {
+			return j * m_number_of_rows + i ;
+		}
+	}
+
+	// As elsewhere, this assumes the host is little-endian.
+	double BinaryMatrixReader::value( std::size_t index ) const {
+		if( m_format.value_type == BinaryMatrixFormat::eFloat32 ) {
+			return reinterpret_cast< float const* >( m_values )[ index ] ;
+		} else {
+			return reinterpret_cast< double const* >( m_values )[ index ] ;
+		}
+	}
+
+	double BinaryMatrixReader::value( std::size_t i, std::size_t j ) const {
+		return value( entry_index( i, j ) ) ;
+	}
+
+	double BinaryMatrixReader::count( std::size_t i, std::size_t j ) const {
+		assert( m_counts ) ;
+		return m_counts[ entry_index( i, j ) ] ;
+	}
+
+	void BinaryMatrixReader::get_values( Eigen::MatrixXd* result ) const {
+		assert( result ) ;
+		result->resize( m_number_of_rows, m_number_of_columns ) ;
+		if( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) {
+			for( std::size_t i = 0, index = 0; i < m_number_of_rows; ++i ) {
+				for( std::size_t j = 0; j <= i; ++j, ++index ) {
+					(*result)( i, j ) = (*result)( j, i ) = value( index ) ;
+				}
+			}
+		} else {
+			std::size_t const N = number_of_entries() ;
+			for( std::size_t index = 0; index < N; ++index ) {
+				result->data()[ index ] = value( index ) ;
+			}
+		}
+	}
+
+	void BinaryMatrixReader::get_counts( Eigen::MatrixXd* result ) const {
+		assert( result ) ;
+		if( !m_counts ) {
+			throw genfile::BadArgumentError( "pca::BinaryMatrixReader::get_counts()", "filename=\"" + m_filename + "\"", "File has no counts." ) ;
+		}
+		result->resize( m_number_of_rows, m_number_of_columns ) ;
+		if( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) {
+			for( std::size_t i = 0, index = 0; i < m_number_of_rows; ++i ) {
+				for( std::size_t j = 0; j <= i; ++j, ++index ) {
+					(*result)( i, j ) = (*result)( j, i ) = m_counts[ index ] ;
+				}
+			}
+		} else {
+			std::size_t const N = number_of_entries() ;
+			for( std::size_t index = 0; index < N; ++index ) {
+				result->data()[ index ] = m_counts[ index ] ;
+			}
+		}
+	}
+}
@@ -0,0 +1,321 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include "genfile/Error.hpp"
+#include "genfile/CohortIndividualSource.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/string_utils.hpp"
+#include "genfile/zlib.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+#include "components/RelatednessComponent/BinaryMatrixWriter.hpp"
+#include "components/RelatednessComponent/write_matrix.hpp"
+
+namespace pca {
+	namespace {
+		// Maximum number of entries in each compressed block.
+		std::size_t const max_block_size = 1024 * 1024 ;
+		// zlib compression level; higher levels are much slower for little gain on this data.
+		int const compression_level = 6 ;
+
+		void write_string( std::ostream& stream, std::string const& value ) {
+			genfile::write_little_endian_integer( stream, uint32_t( value.size() ) ) ;
+			stream.write( value.data(), value.size() ) ;
+		}
+
+		void write_names( std::ostream& stream, std::size_t const count, BinaryMatrixWriter::GetNames get_names ) {
+			if( get_names ) {
+				genfile::write_little_endian_integer( stream, uint32_t( count ) ) ;
+				for( std::size_t i = 0; i < count; ++i ) {
+					write_string( stream, genfile::string_utils::to_string( get_names( i ) ) ) ;
+				}
+			} else {
+				genfile::write_little_endian_integer( stream, uint32_t( 0 ) ) ;
+			}
+		}
+
+		void pad_to_multiple_of_8( std::ostream& stream ) {
+			std::size_t const padding = ( 8 - ( std::streamoff( stream.tellp() ) % 8 )) % 8 ;
+			stream.write( "\0\0\0\0\0\0\0", padding ) ;
+		}
+	}
+
+	BinaryMatrixWriter::UniquePtr BinaryMatrixWriter::create_lower_triangle(
+		std::string const& filename,
+		std::size_t const number_of_rows,
+		BinaryMatrixFormat const& format,
+		std::string const& source,
+		std::string const& description,
+		GetNames get_names
+	) {
+		return UniquePtr(
+			new BinaryMatrixWriter(
+				filename, BinaryMatrixFormat::ePackedLowerTriangle,
+				number_of_rows, number_of_rows, format,
+				source, description, get_names, get_names
+			)
+		) ;
+	}
+
+	BinaryMatrixWriter::UniquePtr BinaryMatrixWriter::create_dense(
+		std::string const& filename,
+		std::size_t const number_of_rows,
+		std::size_t const number_of_columns,
+		BinaryMatrixFormat const& format,
+		std::string const& source,
+		std::string const& description,
+		GetNames get_row_names,
+		GetNames get_column_names
+	) {
+		return UniquePtr(
+			new BinaryMatrixWriter(
+				filename, BinaryMatrixFormat::eDense,
+				number_of_rows, number_of_columns, format,
+				source, description, get_row_names, get_column_names
+			)
+		) ;
+	}
+
+	BinaryMatrixWriter::BinaryMatrixWriter(
+		std::string const& filename,
+		BinaryMatrixFormat::Storage const storage,
+		std::size_t const number_of_rows,
+		std::size_t const number_of_columns,
+		BinaryMatrixFormat const& format,
+		std::string const& source,
+		std::string const& description,
+		GetNames get_row_names,
+		GetNames get_column_names
+	):
+		m_filename( filename ),
+		m_storage( storage ),
+		m_number_of_rows( number_of_rows ),
+		m_number_of_columns( number_of_columns ),
+		m_format( format ),
+		m_stream( filename.c_str(), std::ios::binary | std::ios::trunc ),
+		m_number_of_snps( 0 )
+	{
+		if( !m_stream.is_open() ) {
+			throw genfile::ResourceNotOpenedError( filename ) ;
+		}
+		assert( m_storage == BinaryMatrixFormat::eDense || m_number_of_rows == m_number_of_columns ) ;
+		write_header( source, description, get_row_names, get_column_names ) ;
+	}
+
+	BinaryMatrixWriter::~BinaryMatrixWriter() {
+		if( m_stream.is_open() ) {
+			close() ;
+		}
+	}
+
+	std::size_t BinaryMatrixWriter::number_of_entries() const {
+		if( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) {
+			return LowerTriangularTile::row_offset( m_number_of_rows ) ;
+		} else {
+			return m_number_of_rows * m_number_of_columns ;
+		}
+	}
+
+	void BinaryMatrixWriter::write_header(
+		std::string const& source,
+		std::string const& description,
+		GetNames get_row_names,
+		GetNames get_column_names
+	) {
+		bool const has_counts = ( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) ;
+		m_stream.write( "QCMATRIX", 8 ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( BinaryMatrixFormat::version ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( m_storage ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( m_format.value_type ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( m_format.compression ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( has_counts ? BinaryMatrixFormat::eHasCounts : 0 ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint32_t( 0 ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint64_t( m_number_of_rows ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint64_t( m_number_of_columns ) ) ;
+		assert( m_stream.tellp() == std::streampos( BinaryMatrixFormat::number_of_snps_offset ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint64_t( 0 ) ) ;
+		genfile::write_little_endian_integer( m_stream, uint64_t( 0 ) ) ;
+		assert( m_stream.tellp() == std::streampos( BinaryMatrixFormat::header_size ) ) ;
+		write_string( m_stream, get_metadata( source, description ) ) ;
+		write_names( m_stream, m_number_of_rows, get_row_names ) ;
+		write_names( m_stream, m_number_of_columns, get_column_names ) ;
+		pad_to_multiple_of_8( m_stream ) ;
+		m_values_offset = m_stream.tellp() ;
+		std::size_t const values_size = number_of_entries() * m_format.value_size() ;
+		m_counts_offset = m_values_offset + std::streamoff( values_size + ( 8 - values_size % 8 ) % 8 ) ;
+		if( !m_stream ) {
+			throw genfile::OutputError( m_filename ) ;
+		}
+	}
+
+	void BinaryMatrixWriter::write_tile( std::size_t const number_of_snps, LowerTriangularTile const& tile ) {
+		assert( m_storage == BinaryMatrixFormat::ePackedLowerTriangle ) ;
+		assert( tile.end_row() <= m_number_of_rows ) ;
+		m_number_of_snps = number_of_snps ;
+		if( tile.size() == 0 ) {
+			return ;
+		}
+		write_values( tile.offset(), &tile.values()[0], tile.size() ) ;
+		write_counts( tile.offset(), &tile.nonmissingness()[0], tile.size() ) ;
+	}
+
+	void BinaryMatrixWriter::write_lower_triangle(
+		std::size_t const number_of_snps,
+		Eigen::MatrixXd const& counts,
+		Eigen::MatrixXd const& values
+	) {
+		assert( values.rows() == int( m_number_of_rows ) && values.cols() == int( m_number_of_rows ) ) ;
+		assert( counts.rows() == values.rows() && counts.cols() == values.cols() ) ;
+		// Write in tiles of about max_block_size entries.
+		for( std::size_t begin = 0; begin < m_number_of_rows; ) {
+			std::size_t end = begin + 1 ;
+			while( end < m_number_of_rows && LowerTriangularTile::row_offset( end + 1 ) - LowerTriangularTile::row_offset( begin ) <= max_block_size ) {
+				++end ;
+			}
+			LowerTriangularTile tile( begin, end ) ;
+			for( std::size_t i = begin; i < end; ++i ) {
+				for( std::size_t j = 0; j <= i; ++j ) {
+					tile.value( i, j ) = values( i, j ) ;
+					tile.nonmissingness( i, j ) = counts( i, j ) ;
+				}
+			}
+			write_tile( number_of_snps, tile ) ;
+			begin = end ;
+		}
+	}
+
+	void BinaryMatrixWriter::write_matrix( std::size_t const number_of_snps, Eigen::MatrixXd const& matrix ) {
+		assert( m_storage == BinaryMatrixFormat::eDense ) ;
+		assert( matrix.rows() == int( m_number_of_rows ) && matrix.cols() == int( m_number_of_columns ) ) ;
+		m_number_of_snps = number_of_snps ;
+		std::size_t const N = number_of_entries() ;
+		for( std::size_t begin = 0; begin < N; begin += max_block_size ) {
+			write_values( begin, matrix.data() + begin, std::min( max_block_size, N - begin ) ) ;
+		}
+	}
+
+	void BinaryMatrixWriter::write_values( std::size_t const first_entry, double const* values, std::size_t const number_of_entries ) {
+		if( m_format.value_type == BinaryMatrixFormat::eFloat32 ) {
+			m_buffer.resize( number_of_entries * sizeof( float ) ) ;
+			float* buffer = reinterpret_cast< float* >( &m_buffer[0] ) ;
+			std::copy( values, values + number_of_entries, buffer ) ;
+		} else {
+			m_buffer.assign(
+				reinterpret_cast< char const* >( values ),
+				reinterpret_cast< char const* >( values + number_of_entries )
+			) ;
+		}
+		write_block( BinaryMatrixFormat::eValues, first_entry, number_of_entries ) ;
+	}
+
+	void BinaryMatrixWriter::write_counts( std::size_t const first_entry, int const* counts, std::size_t const number_of_entries ) {
+		m_buffer.resize( number_of_entries * sizeof( int32_t ) ) ;
+		int32_t* buffer = reinterpret_cast< int32_t* >( &m_buffer[0] ) ;
+		std::copy( counts, counts + number_of_entries, buffer ) ;
+		write_block( BinaryMatrixFormat::eCounts, first_entry, number_of_entries ) ;
+	}
+
+	// Write the contents of m_buffer.
+	// This assumes the host is little-endian, as do the other binary formats.
+	void BinaryMatrixWriter::write_block( BinaryMatrixFormat::Array const array, std::size_t const first_entry, std::size_t const number_of_entries ) {
+		std::size_t const entry_size = ( array == BinaryMatrixFormat::eValues ) ? m_format.value_size() : sizeof( int32_t ) ;
+		assert( m_buffer.size() == number_of_entries * entry_size ) ;
+		if( m_format.compression == BinaryMatrixFormat::eZlibCompression ) {
+			genfile::zlib_compress(
+				reinterpret_cast< unsigned char const* >( &m_buffer[0] ),
+				reinterpret_cast< unsigned char const* >( &m_buffer[0] + m_buffer.size() ),
+				&m_compressed_buffer,
+				0,
+				compression_level
+			) ;
+			m_stream.seekp( 0, std::ios::end ) ;
+			BlockIndexEntry entry ;
+			entry.array = array ;
+			entry.first_entry = first_entry ;
+			entry.number_of_entries = number_of_entries ;
+			entry.file_offset = std::streamoff( m_stream.tellp() ) ;
+			entry.size = m_compressed_buffer.size() ;
+			m_stream.write( reinterpret_cast< char const* >( &m_compressed_buffer[0] ), m_compressed_buffer.size() ) ;
+			m_block_index.push_back( entry ) ;
+		} else {
+			std::streampos const base = ( array == BinaryMatrixFormat::eValues ) ? m_values_offset : m_counts_offset ;
+			m_stream.seekp( base + std::streamoff( first_entry * entry_size )) ;
+			m_stream.write( &m_buffer[0], m_buffer.size() ) ;
+		}
+		if( !m_stream ) {
+			throw genfile::OutputError( m_filename ) ;
+		}
+	}
+
+	void BinaryMatrixWriter::close() {
+		uint64_t index_offset = 0 ;
+		if( m_format.compression == BinaryMatrixFormat::eZlibCompression ) {
+			m_stream.seekp( 0, std::ios::end ) ;
+			pad_to_multiple_of_8( m_stream ) ;
+			index_offset = std::streamoff( m_stream.tellp() ) ;
+			genfile::write_little_endian_integer( m_stream, uint64_t( m_block_index.size() ) ) ;
+			for( std::size_t i = 0; i < m_block_index.size(); ++i ) {
+				BlockIndexEntry const& entry = m_block_index[i] ;
+				genfile::write_little_endian_integer( m_stream, entry.array ) ;
+				genfile::write_little_endian_integer( m_stream, uint32_t( 0 ) ) ;
+				genfile::write_little_endian_integer( m_stream, entry.first_entry ) ;
+				genfile::write_little_endian_integer( m_stream, entry.number_of_entries ) ;
+				genfile::write_little_endian_integer( m_stream, entry.file_offset ) ;
+				genfile::write_little_endian_integer( m_stream, entry.size ) ;
+			}
+		} else {
+			// Make sure the file has its full size even if the last entries were not written.
+			std::streampos const end = ( m_storage == BinaryMatrixFormat::ePackedLowerTriangle )
+				? m_counts_offset + std::streamoff( number_of_entries() * sizeof( int32_t ) )
+				: m_counts_offset ;
+			m_stream.seekp( 0, std::ios::end ) ;
+			if( m_stream.tellp() < end ) {
+				m_stream.seekp( end - std::streamoff( 1 ) ) ;
+				m_stream.put( '\0' ) ;
+			}
+		}
+		m_stream.seekp( BinaryMatrixFormat::number_of_snps_offset ) ;
+		genfile::write_little_endian_integer( m_stream, uint64_t( m_number_of_snps ) ) ;
+		genfile::write_little_endian_integer( m_stream, index_offset ) ;
+		m_stream.close() ;
+	}
+
+	void write_matrix_lower_diagonals_in_binary_form(
+		std::string const& filename,
+		BinaryMatrixFormat const& format,
+		std::size_t const number_of_snps,
+		Eigen::MatrixXd const& counts,
+		Eigen::MatrixXd const& values,
+		std::string const& source,
+		std::string const& description,
+		BinaryMatrixWriter::GetNames get_names
+	) {
+		BinaryMatrixWriter::create_lower_triangle(
+			filename, values.rows(), format, source, description, get_names
+		)->write_lower_triangle( number_of_snps, counts, values ) ;
+	}
+
+	void write_matrix_in_binary_form(
+		std::string const& filename,
+		BinaryMatrixFormat const& format,
+		std::size_t const number_of_snps,
+		Eigen::MatrixXd const& matrix,
+		std::string const& source,
+		std::string const& description,
+		BinaryMatrixWriter::GetNames get_row_names,
+		BinaryMatrixWriter::GetNames get_column_names
+	) {
+		BinaryMatrixWriter::create_dense(
+			filename, matrix.rows(), matrix.cols(), format, source, description, get_row_names, get_column_names
+		)->write_matrix( number_of_snps, matrix ) ;
+	}
+}
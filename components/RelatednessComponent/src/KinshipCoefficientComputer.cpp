@@ -6,12 +6,14 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <boost/ptr_container/ptr_deque.hpp>
 #include <boost/function.hpp>
 #include <boost/timer/timer.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/filesystem.hpp>
 #include "unistd.h"
 #include "config/config.hpp"
 #if HAVE_CBLAS
@@ -25,6 +27,7 @@
 #include "genfile/SNPDataSourceProcessor.hpp"
 #include "genfile/SingleSNPGenotypeProbabilities.hpp"
 #include "genfile/vcf/get_set_eigen.hpp"
+#include "genfile/DecodedVariantData.hpp"
 #include "statfile/BuiltInTypeStatSink.hpp"
 #include "statfile/BuiltInTypeStatSource.hpp"
 #include "worker/Task.hpp"
@@ -34,6 +37,7 @@
 #include "components/RelatednessComponent/KinshipCoefficientComputer.hpp"
 #include "components/RelatednessComponent/PCAComputer.hpp"
 #include "components/RelatednessComponent/mean_centre_genotypes.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
 
 #define USING_BOOST_THREADPOOL 0
 #if USING_BOOST_THREADPOOL
@@ -205,7 +209,9 @@ namespace impl {
 		m_call_threshhold( 0.9 ),
 		m_allele_frequency_threshhold( 0.001 ),
 		m_number_of_snps_per_chunk( number_of_snps_per_chunk ),
-		m_number_of_snps_per_computation( 4 * number_of_snps_per_chunk )
+		m_number_of_snps_per_computation( 4 * number_of_snps_per_chunk ),
+		m_memory_budget( 0 ),
+		m_number_of_tiles_per_pass( 1 )
 	{
 		// We allocate lookup tables exactly once, here.
 		// We follow, roughly, the scheme in plink 1.9 of having four lookup tables.
@@ -218,6 +224,19 @@ namespace impl {
 		m_nonmissingness_lookup_tables.resize( 4, std::vector< int >( 1 << ( m_number_of_snps_per_chunk * 4 ), 0.0 ) ) ;
 	}
 
+	void NormaliseGenotypesAndComputeXXtFast::set_memory_budget( std::size_t const max_bytes, std::string const& temporary_filename_stem ) {
+		m_memory_budget = max_bytes ;
+		m_temporary_filename_stem = temporary_filename_stem ;
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::send_tiles_to( TileCallback callback ) {
+		m_tile_signal.connect( callback ) ;
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::send_end_of_tiles_to( EndOfTilesSignal::slot_type callback ) {
+		m_end_of_tiles_signal.connect( callback ) ;
+	}
+
 	NormaliseGenotypesAndComputeXXtFast::Matrix const& NormaliseGenotypesAndComputeXXtFast::result() const {
 		return m_result ;
 	}
@@ -250,25 +269,143 @@ namespace impl {
 		std::size_t number_of_samples,
 		genfile::SNPDataSource::Metadata const&
 	) {
-		m_result.resize( number_of_samples, number_of_samples ) ;
-		m_result.setZero() ;
-		m_nonmissingness.resize( number_of_samples, number_of_samples ) ;
-		m_nonmissingness.setZero() ;
 		std::size_t numberOfTasks = m_worker->get_number_of_worker_threads() ;
+		if( is_out_of_core() ) {
+			m_result.resize( 0, 0 ) ;
+			m_nonmissingness.resize( 0, 0 ) ;
+			m_number_of_tiles_per_pass = numberOfTasks ;
+			compute_tiling( number_of_samples ) ;
+			begin_pass( 0 ) ;
+			if( number_of_passes() > 1 ) {
+				m_spill_filename = boost::filesystem::unique_path( m_temporary_filename_stem + ".tmp%%%%-%%%%-%%%%-%%%%" ).string() ;
+				m_spill_stream.reset( new std::ofstream( m_spill_filename.c_str(), std::ios::binary | std::ios::trunc ) ) ;
+				if( !m_spill_stream->is_open() ) {
+					throw genfile::ResourceNotOpenedError( m_spill_filename ) ;
+				}
+			}
+		} else {
+			m_result.resize( number_of_samples, number_of_samples ) ;
+			m_result.setZero() ;
+			m_nonmissingness.resize( number_of_samples, number_of_samples ) ;
+			m_nonmissingness.setZero() ;
 #if 0
-		m_matrix_tiling = get_matrix_lower_diagonal_vertical_strip_tiling( number_of_samples, 1 ) ;
+			m_matrix_tiling = get_matrix_lower_diagonal_vertical_strip_tiling( number_of_samples, 1 ) ;
 #else
-		m_matrix_tiling = get_matrix_lower_diagonal_tiling(
-			number_of_samples,
-			numberOfTasks
-		) ;
+			m_matrix_tiling = get_matrix_lower_diagonal_tiling(
+				number_of_samples,
+				numberOfTasks
+			) ;
 #endif
-		m_dispatcher->set_number_of_tasks( m_matrix_tiling.size() ) ;
+			m_dispatcher->set_number_of_tasks( m_matrix_tiling.size() ) ;
+		}
 		m_combined_genotypes.resize( number_of_samples, 0 ) ;
 		m_per_snp_genotypes.resize( number_of_samples, 0 ) ;
 		m_snp_count = 0 ;
 	}
 
+	// Split the lower triangle into bands of rows, each small enough that one pass worth
+	// of bands fits in the memory budget.
+	void NormaliseGenotypesAndComputeXXtFast::compute_tiling( std::size_t const number_of_samples ) {
+		// Memory needed besides the tiles: genotypes and lookup tables.
+		std::size_t const fixed_memory = 2 * number_of_samples * sizeof( uint64_t )
+			+ m_lookup_tables.size() * m_lookup_tables[0].size() * ( sizeof( double ) + sizeof( int ) ) ;
+		std::size_t const bytes_per_entry = sizeof( double ) + sizeof( int ) ;
+		if( m_memory_budget <= fixed_memory ) {
+			throw genfile::BadArgumentError(
+				"impl::NormaliseGenotypesAndComputeXXtFast::compute_tiling()",
+				( boost::format( "max_bytes=%d" ) % m_memory_budget ).str(),
+				( boost::format( "At least %d bytes are needed for %d samples." ) % fixed_memory % number_of_samples ).str()
+			) ;
+		}
+		std::size_t const max_entries_per_tile = std::max(
+			std::size_t( 1 ),
+			( m_memory_budget - fixed_memory ) / ( bytes_per_entry * m_number_of_tiles_per_pass )
+		) ;
+		m_tile_rows.clear() ;
+		for( std::size_t begin = 0; begin < number_of_samples; ) {
+			// Each tile holds at least one row.
+			std::size_t end = begin + 1 ;
+			while(
+				end < number_of_samples
+				&& ( pca::LowerTriangularTile::row_offset( end + 1 ) - pca::LowerTriangularTile::row_offset( begin )) <= max_entries_per_tile
+			) {
+				++end ;
+			}
+			m_tile_rows.push_back( std::make_pair( begin, end ) ) ;
+			begin = end ;
+		}
+	}
+
+	std::size_t NormaliseGenotypesAndComputeXXtFast::number_of_passes() const {
+		return ( m_tile_rows.size() + m_number_of_tiles_per_pass - 1 ) / m_number_of_tiles_per_pass ;
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::begin_pass( std::size_t const pass ) {
+		m_dispatcher->wait_until_complete() ;
+		m_pass_tiles.clear() ;
+		std::size_t const begin = pass * m_number_of_tiles_per_pass ;
+		std::size_t const end = std::min( begin + m_number_of_tiles_per_pass, m_tile_rows.size() ) ;
+		for( std::size_t i = begin; i < end; ++i ) {
+			m_pass_tiles.push_back( new pca::LowerTriangularTile( m_tile_rows[i].first, m_tile_rows[i].second ) ) ;
+		}
+		m_dispatcher->set_number_of_tasks( m_pass_tiles.size() ) ;
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::end_pass() {
+		m_dispatcher->wait_until_complete() ;
+		for( std::size_t tile_i = 0; tile_i < m_pass_tiles.size(); ++tile_i ) {
+			pca::LowerTriangularTile& tile = m_pass_tiles[ tile_i ] ;
+			for( std::size_t k = 0; k < tile.size(); ++k ) {
+				tile.values()[k] /= tile.nonmissingness()[k] ;
+			}
+			m_tile_signal( m_snp_count, tile ) ;
+		}
+		m_pass_tiles.clear() ;
+	}
+
+	// Packed genotypes of each block of SNPs are written as:
+	// the number of SNPs, the mean and standard deviation of each SNP, and the packed genotype of each sample.
+	void NormaliseGenotypesAndComputeXXtFast::spill_block() {
+		assert( m_spill_stream.get() ) ;
+		uint32_t const number_of_snps = m_block_parameters.size() ;
+		m_spill_stream->write( reinterpret_cast< char const* >( &number_of_snps ), sizeof( uint32_t ) ) ;
+		m_spill_stream->write( reinterpret_cast< char const* >( &m_block_parameters[0] ), number_of_snps * sizeof( std::pair< double, double > ) ) ;
+		m_spill_stream->write( reinterpret_cast< char const* >( &m_combined_genotypes[0] ), m_combined_genotypes.size() * sizeof( uint64_t ) ) ;
+		if( !*m_spill_stream ) {
+			throw genfile::OutputError( m_spill_filename ) ;
+		}
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::replay_spilled_blocks() {
+		std::ifstream spill( m_spill_filename.c_str(), std::ios::binary ) ;
+		if( !spill.is_open() ) {
+			throw genfile::ResourceNotOpenedError( m_spill_filename ) ;
+		}
+		uint32_t number_of_snps = 0 ;
+		while( spill.read( reinterpret_cast< char* >( &number_of_snps ), sizeof( uint32_t ) ) ) {
+			assert( number_of_snps > 0 && number_of_snps <= m_number_of_snps_per_computation ) ;
+			m_dispatcher->wait_until_complete() ;
+			m_block_parameters.resize( number_of_snps ) ;
+			spill.read( reinterpret_cast< char* >( &m_block_parameters[0] ), number_of_snps * sizeof( std::pair< double, double > ) ) ;
+			spill.read( reinterpret_cast< char* >( &m_combined_genotypes[0] ), m_combined_genotypes.size() * sizeof( uint64_t ) ) ;
+			if( !spill ) {
+				throw genfile::MalformedInputError( m_spill_filename, 0 ) ;
+			}
+			clear_lookup_tables() ;
+			for( std::size_t i = 0; i < number_of_snps; ++i ) {
+				std::size_t const lookup_table_index = i / m_number_of_snps_per_chunk ;
+				add_snp_to_lookup_table(
+					i % m_number_of_snps_per_chunk,
+					m_block_parameters[i].first, m_block_parameters[i].second,
+					&m_lookup_tables[ lookup_table_index ],
+					&m_nonmissingness_lookup_tables[ lookup_table_index ]
+				) ;
+			}
+			submit_tasks( m_combined_genotypes ) ;
+		}
+		m_dispatcher->wait_until_complete() ;
+	}
+
 	namespace impl {
 		template< typename T >
 		double add( T a, T b ) {
@@ -300,14 +437,10 @@ namespace impl {
 	) {
 		// std::vector< std::size_t > m_genotypes
 		// std::vector< int >
-		m_per_snp_genotypes.assign( m_result.rows(), 0 ) ;
-
 		// I find it simplest here to encode genotypes as
 		// 0 (missing), 1 (AA homozygote), 2 (heterozygote), 3 (BB homozygote).
-		data_reader->get(
-			":genotypes:",
-			genfile::vcf::get_threshholded_calls( m_per_snp_genotypes, m_call_threshhold, 0, 1, 2, 3 )
-		) ;
+		data_reader->decoded().hard_calls( m_call_threshhold ).get( &m_per_snp_genotypes, 0, 1, 2, 3 ) ;
+		assert( m_per_snp_genotypes.size() == m_combined_genotypes.size() ) ;
 
 		// compute allele frequency
 		double allele2_count = 0.0 ;
@@ -336,11 +469,8 @@ namespace impl {
 			if( lookup_snp_index == 0 ) {
 				m_dispatcher->wait_until_complete() ;
 				std::copy( m_per_snp_genotypes.begin(), m_per_snp_genotypes.end(), m_combined_genotypes.begin() ) ;
-				// Clear the lookup tables
-				for( std::size_t i = 0; i < m_lookup_tables.size(); ++i ) {
-					std::fill( m_lookup_tables[i].begin(), m_lookup_tables[i].end(), 0.0 ) ;
-					std::fill( m_nonmissingness_lookup_tables[i].begin(), m_nonmissingness_lookup_tables[i].end(), 0.0 ) ;
-				}
+				clear_lookup_tables() ;
+				m_block_parameters.clear() ;
 			} else {
 				// We allow 4 bits per genotype, although each genotype takes up only the lower two bits.
 				// This allows us to encode pairs of genotypes in consecutive pairs of bits
@@ -363,6 +493,7 @@ namespace impl {
 				&m_lookup_tables[ lookup_table_index ],
 				&m_nonmissingness_lookup_tables[ lookup_table_index ]
 			) ;
+			m_block_parameters.push_back( std::make_pair( mean, sd ) ) ;
 
 			++m_snp_count ;
 #if DEBUG_KINSHIP_COEFFICIENT_COMPUTER
@@ -380,11 +511,25 @@ namespace impl {
 #if DEBUG_KINSHIP_COEFFICIENT_COMPUTER
 			std::cerr << "NormaliseGenotypesAndComputeXXtFast::processed_snp(): submitting tasks...\n" ;
 #endif
-				submit_tasks( m_combined_genotypes ) ;
+				submit_block() ;
 			}
 		}
 	}
 
+	void NormaliseGenotypesAndComputeXXtFast::clear_lookup_tables() {
+		for( std::size_t i = 0; i < m_lookup_tables.size(); ++i ) {
+			std::fill( m_lookup_tables[i].begin(), m_lookup_tables[i].end(), 0.0 ) ;
+			std::fill( m_nonmissingness_lookup_tables[i].begin(), m_nonmissingness_lookup_tables[i].end(), 0.0 ) ;
+		}
+	}
+
+	void NormaliseGenotypesAndComputeXXtFast::submit_block() {
+		if( m_spill_stream.get() ) {
+			spill_block() ;
+		}
+		submit_tasks( m_combined_genotypes ) ;
+	}
+
 	void NormaliseGenotypesAndComputeXXtFast::add_snp_to_lookup_table(
 		std::size_t const snp_lookup_index,
 		double const mean,
@@ -452,6 +597,20 @@ namespace impl {
 	void NormaliseGenotypesAndComputeXXtFast::submit_tasks(
 		std::vector< uint64_t > const& genotypes
 	) {
+		if( is_out_of_core() ) {
+			for( std::size_t tile_i = 0; tile_i < m_pass_tiles.size(); ++tile_i ) {
+				m_dispatcher->submit_task(
+					tile_i,
+					boost::bind(
+						&NormaliseGenotypesAndComputeXXtFast::compute_tile,
+						this,
+						&m_pass_tiles[ tile_i ],
+						boost::cref( genotypes )
+					)
+				) ;
+			}
+			return ;
+		}
 		for( std::size_t tile_i = 0; tile_i < m_matrix_tiling.size(); ++tile_i ) {
 	#if 1
 			m_dispatcher->submit_task(
@@ -471,9 +630,23 @@ namespace impl {
 
 	void NormaliseGenotypesAndComputeXXtFast::end_processing_snps() {
 		if( m_snp_count % m_number_of_snps_per_computation > 0 ) {
-			submit_tasks( m_combined_genotypes ) ;
+			submit_block() ;
 		}
 		m_dispatcher->wait_until_complete() ;
+		if( is_out_of_core() ) {
+			end_pass() ;
+			if( m_spill_stream.get() ) {
+				m_spill_stream.reset() ;
+				for( std::size_t pass = 1; pass < number_of_passes(); ++pass ) {
+					begin_pass( pass ) ;
+					replay_spilled_blocks() ;
+					end_pass() ;
+				}
+				boost::filesystem::remove( m_spill_filename ) ;
+			}
+			m_end_of_tiles_signal() ;
+			return ;
+		}
 		std::cerr << "snp count is: " << m_snp_count << ".\n" ;
 		std::cerr << "non-missingness array is:\n" << m_nonmissingness.block(0,0,10,10) << ".\n" ;
 		m_result.array() /= m_nonmissingness.array().cast< double >() ;
@@ -504,6 +677,32 @@ namespace impl {
 			}
 		}
 	}
+
+	void NormaliseGenotypesAndComputeXXtFast::compute_tile(
+		pca::LowerTriangularTile* tile,
+		std::vector< uint64_t > const& genotypes
+	) {
+		// Rows are stored contiguously, so put the column index in the inner loop.
+		for( std::size_t i = tile->begin_row(); i < tile->end_row(); ++i ) {
+			double* values = &tile->value( i, 0 ) ;
+			int* nonmissingness = &tile->nonmissingness( i, 0 ) ;
+			for( std::size_t j = 0; j <= i; ++j ) {
+				uint64_t const combined_genotype = ( genotypes[i] << 2 ) + genotypes[j] ;
+				std::size_t const lookup_index0 = combined_genotype & 0xFFFF ;
+				std::size_t const lookup_index1 = ( combined_genotype >> 16 ) & 0xFFFF ;
+				std::size_t const lookup_index2 = ( combined_genotype >> 32 ) & 0xFFFF ;
+				std::size_t const lookup_index3 = ( combined_genotype >> 48 ) & 0xFFFF ;
+				values[j] += m_lookup_tables[0][ lookup_index0 ] ;
+				values[j] += m_lookup_tables[1][ lookup_index1 ] ;
+				values[j] += m_lookup_tables[2][ lookup_index2 ] ;
+				values[j] += m_lookup_tables[3][ lookup_index3 ] ;
+				nonmissingness[j] += m_nonmissingness_lookup_tables[0][ lookup_index0 ] ;
+				nonmissingness[j] += m_nonmissingness_lookup_tables[1][ lookup_index1 ] ;
+				nonmissingness[j] += m_nonmissingness_lookup_tables[2][ lookup_index2 ] ;
+				nonmissingness[j] += m_nonmissingness_lookup_tables[3][ lookup_index3 ] ;
+			}
+		}
+	}
 }
 
 KinshipCoefficientComputer::KinshipCoefficientComputer(
@@ -536,13 +735,14 @@ void KinshipCoefficientComputer::end_processing_snps() {
 		+ "\nNumber of samples: "
 		+ genfile::string_utils::to_string( m_samples.get_number_of_individuals() )
 	;
-#if 1
-	send_results(
-		m_computation->number_of_snps_included(),
-		m_computation->nonmissingness().cast< double >(),
-		m_computation->result().cast< double >(),
-		"KinshipCoefficientComputer",
-		description
-	) ;
-	#endif
+	// In out-of-core mode the computation sends its results itself, tile by tile.
+	if( m_computation->result().size() > 0 ) {
+		send_results(
+			m_computation->number_of_snps_included(),
+			m_computation->nonmissingness().cast< double >(),
+			m_computation->result().cast< double >(),
+			"KinshipCoefficientComputer",
+			description
+		) ;
+	}
 }
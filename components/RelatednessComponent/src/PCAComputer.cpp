@@ -24,6 +24,7 @@
 #include "components/RelatednessComponent/LapackEigenDecomposition.hpp"
 #include "components/RelatednessComponent/names.hpp"
 #include "components/RelatednessComponent/write_matrix_to_stream.hpp"
+#include "components/RelatednessComponent/BinaryMatrixReader.hpp"
 
 PCAComputer::PCAComputer(
 	appcontext::OptionProcessor const& options,
@@ -191,6 +192,51 @@ void PCAComputer::load_long_form_matrix(
 	}
 }
 
+// Load a matrix written by BinaryMatrixWriter, matching its rows to samples by ID_1.
+void PCAComputer::load_binary_matrix(
+	genfile::CohortIndividualSource const& samples,
+	std::string const& filename,
+	Eigen::MatrixXd* matrix,
+	std::size_t* number_of_snps,
+	appcontext::UIContext& ui_context
+) {
+	pca::BinaryMatrixReader::UniquePtr reader = pca::BinaryMatrixReader::create( filename ) ;
+	std::size_t const N = samples.get_number_of_individuals() ;
+	std::vector< std::string > const& ids = reader->row_ids() ;
+	if( reader->number_of_columns() != reader->number_of_rows() || ids.size() != reader->number_of_rows() ) {
+		throw genfile::BadArgumentError( "PCAComputer::load_binary_matrix()", "filename=\"" + filename + "\"", "Expected a square matrix with sample ids." ) ;
+	}
+
+	std::map< std::string, std::size_t > ids_to_rows ;
+	for( std::size_t i = 0; i < ids.size(); ++i ) {
+		ids_to_rows[ ids[i] ] = i ;
+	}
+	std::vector< std::size_t > rows( N ) ;
+	std::size_t missing = 0 ;
+	for( std::size_t sample_i = 0; sample_i < N; ++sample_i ) {
+		std::string const sample = samples.get_entry( sample_i, "ID_1" ).as< std::string >() ;
+		std::map< std::string, std::size_t >::const_iterator where = ids_to_rows.find( sample ) ;
+		if( where == ids_to_rows.end() ) {
+			if( missing++ < 20 ) {
+				ui_context.logger() << "PCAComputer::load_binary_matrix(): sample " << sample << " seems unrepresented in \"" << filename << "\".\n" ;
+			}
+		} else {
+			rows[ sample_i ] = where->second ;
+		}
+	}
+	if( missing > 0 ) {
+		throw genfile::BadArgumentError( "PCAComputer::load_binary_matrix()", "filename=\"" + filename + "\"", "not every sample was represented in the matrix." ) ;
+	}
+
+	matrix->resize( N, N ) ;
+	for( std::size_t j = 0; j < N; ++j ) {
+		for( std::size_t i = j; i < N; ++i ) {
+			(*matrix)( i, j ) = (*matrix)( j, i ) = reader->value( rows[i], rows[j] ) ;
+		}
+	}
+	*number_of_snps = reader->number_of_snps() ;
+}
+
 void PCAComputer::load_matrix_metadata(
 	genfile::CohortIndividualSource const& samples,
 	statfile::BuiltInTypeStatSource& source,
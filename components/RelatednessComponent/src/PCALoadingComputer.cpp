@@ -17,6 +17,7 @@
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/VariantDataReader.hpp"
 #include "genfile/vcf/get_set_eigen.hpp"
+#include "genfile/DecodedVariantData.hpp"
 #include "appcontext/get_current_time_as_string.hpp"
 #include "components/RelatednessComponent/PCALoadingComputer.hpp"
 #include "components/RelatednessComponent/LapackEigenDecomposition.hpp"
@@ -25,37 +26,9 @@
 // #define DEBUG_PCA_LOADING_COMPUTER 1
 
 namespace {
-	template< typename Vector1, typename Vector2, typename NonMissingVector >
-	double compute_correlation( Vector1 const& v1, Vector2 const& v2, NonMissingVector const& non_missingness_indicator ) {
-		assert( v1.size() == v2.size() ) ;
-		double non_missingness = non_missingness_indicator.sum() ;
-		double mean1 = 0.0 ;
-		double mean2 = 0.0 ;
-		for( int i = 0; i < v1.size(); ++i ) {
-			if( non_missingness_indicator( i )) {
-				mean1 += v1(i) / non_missingness ;
-				mean2 += v2(i) / non_missingness ;
-			}
-		}
+	// Blocks are limited to this many entries (256Mb of doubles) per buffered matrix.
+	std::size_t const max_block_entries = 32 * 1024 * 1024 ;
 
-		double covariance = 0.0 ;
-		double variance1 = 0.0 ;
-		double variance2 = 0.0 ;
-		for( int i = 0; i < v1.size(); ++i ) {
-			if( non_missingness_indicator( i )) {
-				covariance += ( v1(i) - mean1 ) * ( v2(i) - mean2 ) ;
-				variance1 += ( v1(i) - mean1 ) * ( v1(i) - mean1 ) ;
-				variance2 += ( v2(i) - mean2 ) * ( v2(i) - mean2 ) ;
-			}
-		}
-		
-		// We should divide the covariance by N-1 and also
-		// divide each variance by the same quantity.
-		// But this washes out in the ratio.
-		
-		return covariance / std::sqrt( variance1 * variance2 ) ;
-	}
-	
 	std::string eigenvector_column_names( std::size_t N, std::string const& string1, std::string const& string2, std::size_t i ) {
 		if( i < N ) {
 			return string1 + genfile::string_utils::to_string( i+1 ) ;
@@ -66,10 +39,20 @@ namespace {
 	}
 }
 
-PCALoadingComputer::PCALoadingComputer( int number_of_loadings ):
+PCALoadingComputer::PCALoadingComputer( int number_of_loadings, worker::Worker* worker, std::size_t number_of_snps_per_block ):
 	m_number_of_loadings( number_of_loadings ),
-	m_number_of_snps( 1 )
-{}
+	m_number_of_snps( 1 ),
+	m_worker( worker ),
+	m_number_of_snps_per_block( number_of_snps_per_block ),
+	m_block_capacity( 0 ),
+	m_block_size( 0 )
+{
+	assert( m_number_of_snps_per_block > 0 ) ;
+	if( m_worker && m_worker->get_number_of_worker_threads() > 1 ) {
+		m_dispatcher.reset( new impl::NTaskDispatcher( m_worker ) ) ;
+		m_dispatcher->set_number_of_tasks( m_worker->get_number_of_worker_threads() ) ;
+	}
+}
 
 void PCALoadingComputer::set_UDUT( std::size_t number_of_snps, Matrix const& udut ) {
 	assert( udut.cols() == udut.rows() + 1 ) ;
@@ -77,6 +60,7 @@ void PCALoadingComputer::set_UDUT( std::size_t number_of_snps, Matrix const& udu
 	m_D = udut.block( 0, 0, n, 1 ) ;
 	m_sqrt_D_inverse = 1 / m_D.array().sqrt() ;
 	m_U = udut.block( 0, 1, udut.rows(), n ) ;
+	m_U_squared = m_U.array().square() ;
 	m_number_of_snps = number_of_snps ;
 }
 
@@ -84,95 +68,149 @@ void PCALoadingComputer::begin_processing_snps( std::size_t number_of_samples, g
 	assert( number_of_samples = std::size_t( m_U.rows() )) ;
 	m_genotype_calls.resize( number_of_samples ) ;
 	m_non_missingness.resize( number_of_samples ) ;
+	m_block_capacity = std::max< std::size_t >( 1, std::min( m_number_of_snps_per_block, max_block_entries / std::max< std::size_t >( number_of_samples, 1 ) )) ;
+	m_block_snps.resize( m_block_capacity ) ;
+	m_block_genotypes.resize( number_of_samples, m_block_capacity ) ;
+	m_block_non_missingness.resize( number_of_samples, m_block_capacity ) ;
+	m_block_summaries.resize( m_block_capacity, 4 ) ;
+	m_block_included.resize( m_block_capacity ) ;
+	m_block_size = 0 ;
 }
 
 void PCALoadingComputer::processed_snp( genfile::VariantIdentifyingData const& snp, genfile::VariantDataReader& data_reader ) {
-	data_reader.get(
-		":genotypes:",
-		genfile::vcf::get_threshholded_calls( m_genotype_calls, m_non_missingness, 0.9, 0, 0, 1, 2 )
-	) ;
+	data_reader.decoded().hard_calls( 0.9 ).get( &m_genotype_calls, &m_non_missingness, 0, 0, 1, 2 ) ;
 	assert( m_genotype_calls.size() == m_U.rows() ) ;
 	assert( m_non_missingness.size() == m_U.rows() ) ;
-	// setup the storage
-	m_loading_vectors.resize( 2 * m_D.rows() ) ;
-	m_loading_vectors.setConstant( std::numeric_limits< double >::quiet_NaN() ) ;
-	double const allele_frequency = m_genotype_calls.sum() / ( 2.0 * m_non_missingness.sum() ) ;
-	if( m_non_missingness.sum() > 0 && allele_frequency > 0.001 ) {
-		//std::cerr << "pre-mean genotypes are: " << m_genotype_calls.head( 20 ).transpose() << "...\n" ;
+	double const non_missingness = m_non_missingness.sum() ;
+	double const allele_frequency = m_genotype_calls.sum() / ( 2.0 * non_missingness ) ;
+	bool const included = ( non_missingness > 0 && allele_frequency > 0.001 ) ;
+	if( included ) {
 		pca::mean_centre_genotypes( &m_genotype_calls, m_non_missingness, allele_frequency ) ;
 		m_genotype_calls /= std::sqrt( 2.0 * allele_frequency * ( 1.0 - allele_frequency ) ) ;
+	} else {
+		m_genotype_calls.setZero() ;
+	}
 
 #if DEBUG_PCA_LOADING_COMPUTER
-		//std::cerr << "                    SNP: " << snp << ", allele frequency = " << allele_frequency << ".\n" ;
-		//std::cerr << std::resetiosflags( std::ios::floatfield ) << std::setprecision( 5 ) ;
-		//std::cerr << "pre-scale genotypes are: " << m_genotype_calls.head( 20 ).transpose() << "...\n" ;
-		std::cerr << "          genotypes are: " << m_genotype_calls.head( 20 ).transpose() << "...\n" ;
-		std::cerr << "     non-missingness is: " << m_non_missingness.head( 20 ).transpose() << "...\n" ;
-		std::cerr << "                   U is: " << m_U.block(0,0,10,10) << "...\n" ;
-		std::cerr << "                   D is: " << m_D << "...\n" ;
+	std::cerr << "                    SNP: " << snp << ", allele frequency = " << allele_frequency << ".\n" ;
+	std::cerr << "          genotypes are: " << m_genotype_calls.head( 20 ).transpose() << "...\n" ;
+	std::cerr << "     non-missingness is: " << m_non_missingness.head( 20 ).transpose() << "...\n" ;
 #endif // DEBUG_PCA_LOADING_COMPUTER
-	
-
-		//
-		// Let X  be the L\times n matrix (L SNPs, n samples) of (mean-centred, scaled) genotypes.  We want
-		// to compute the row of the matrix S of unit eigenvectors of the variance-covariance matrix
-		// (1/L) X X^t that corresponds to the current SNP.
-		// The matrix S is given by
-		//               
-		//       S = (1/√L) X U D^{-½}
-		//
-		// where
-		//       (1/L) X^t X = U D U^t
-		// is the eigenvalue decomposition of (1/L) X^t X that we are passed in via set_UDUT (and L is the number of SNPs).
-		//
-		// This is true since then
-		//
-		// S^t S = D^{-½} U^t (1/L) X^t X U D^{-½} = id
-		//
-		// (so columns of S are orthogonal) while
-		//
-		// (1/L X X^t) S = (1/L√L) X X^t X U D^{-½}
-		//           = (1/√L) X U D U^t U D^{-½}
-		//           = (1/√L) X U D^½
-		//           = SD
-		//
-		// (so columns of S are eigenvectors with eigenvalues given by D.)
-		//
-#if 0
-		m_loading_vectors.segment( 0, m_U.cols() ) =
-			( m_genotype_calls.transpose() * m_U ) * m_D.array().sqrt().matrix().asDiagonal()
-			/ ( ( m_D.transpose().array() * m_number_of_snps ).sqrt() ) ;
-#else
-		m_loading_vectors.segment( 0, m_U.cols() ) =
-			( m_genotype_calls.transpose() * m_U ) * m_sqrt_D_inverse.asDiagonal() ;
-		m_loading_vectors /= std::sqrt( m_number_of_snps ) ;
-#endif
-		// We also wish to compute the correlation between the SNP and the PCA component.
-		// With S as above, the PCA components are the projections of columns of X onto columns of S.
-		// If we want samples to correspond to columns, this is
-		//   S^t X 
-		// which can be re-written
-		//   sqrt(L) U D^{1/2}
-		// i.e. we may as well compute the correlation with columns of U.
-		if( m_non_missingness.sum() > 10 ) {
-			for( int i = 0; i < m_U.cols(); ++i ) {
-				m_loading_vectors( m_U.cols() + i ) = compute_correlation( m_genotype_calls, m_U.col( i ), m_non_missingness ) ;
+
+	std::size_t const i = m_block_size++ ;
+	m_block_snps[i] = snp ;
+	m_block_genotypes.col(i) = m_genotype_calls ;
+	m_block_non_missingness.col(i) = m_non_missingness ;
+	m_block_summaries( i, 0 ) = non_missingness ;
+	m_block_summaries( i, 1 ) = allele_frequency ;
+	m_block_summaries( i, 2 ) = m_genotype_calls.sum() ;
+	m_block_summaries( i, 3 ) = m_genotype_calls.squaredNorm() ;
+	m_block_included[i] = included ;
+
+	if( m_block_size == m_block_capacity ) {
+		process_block() ;
+	}
+}
+
+void PCALoadingComputer::compute_block_products( int begin_snp, int end_snp ) {
+	int const n = end_snp - begin_snp ;
+	m_XtU.middleRows( begin_snp, n ).noalias() = m_block_genotypes.middleCols( begin_snp, n ).transpose() * m_U ;
+	m_MtU.middleRows( begin_snp, n ).noalias() = m_block_non_missingness.middleCols( begin_snp, n ).transpose() * m_U ;
+	m_MtUU.middleRows( begin_snp, n ).noalias() = m_block_non_missingness.middleCols( begin_snp, n ).transpose() * m_U_squared ;
+}
+
+void PCALoadingComputer::process_block() {
+	int const block_size = m_block_size ;
+	int const K = m_U.cols() ;
+	m_XtU.resize( block_size, K ) ;
+	m_MtU.resize( block_size, K ) ;
+	m_MtUU.resize( block_size, K ) ;
+	if( m_dispatcher.get() ) {
+		// Each task computes the products for a range of variants.
+		std::size_t const number_of_tasks = m_dispatcher->number_of_tasks() ;
+		for( std::size_t task_i = 0; task_i < number_of_tasks; ++task_i ) {
+			int const begin = ( task_i * block_size ) / number_of_tasks ;
+			int const end = (( task_i + 1 ) * block_size ) / number_of_tasks ;
+			if( end > begin ) {
+				m_dispatcher->submit_task(
+					task_i,
+					boost::bind( &PCALoadingComputer::compute_block_products, this, begin, end )
+				) ;
+			}
+		}
+		m_dispatcher->wait_until_complete() ;
+	} else {
+		compute_block_products( 0, block_size ) ;
+	}
+
+	m_loading_vectors.resize( 2 * K ) ;
+	for( int i = 0; i < block_size; ++i ) {
+		m_loading_vectors.setConstant( std::numeric_limits< double >::quiet_NaN() ) ;
+		double const non_missingness = m_block_summaries( i, 0 ) ;
+		if( m_block_included[i] ) {
+			//
+			// Let X  be the L\times n matrix (L SNPs, n samples) of (mean-centred, scaled) genotypes.  We want
+			// to compute the row of the matrix S of unit eigenvectors of the variance-covariance matrix
+			// (1/L) X X^t that corresponds to the current SNP.
+			// The matrix S is given by
+			//               
+			//       S = (1/√L) X U D^{-½}
+			//
+			// where
+			//       (1/L) X^t X = U D U^t
+			// is the eigenvalue decomposition of (1/L) X^t X that we are passed in via set_UDUT (and L is the number of SNPs).
+			//
+			// This is true since then
+			//
+			// S^t S = D^{-½} U^t (1/L) X^t X U D^{-½} = id
+			//
+			// (so columns of S are orthogonal) while
+			//
+			// (1/L X X^t) S = (1/L√L) X X^t X U D^{-½}
+			//           = (1/√L) X U D U^t U D^{-½}
+			//           = (1/√L) X U D^½
+			//           = SD
+			//
+			// (so columns of S are eigenvectors with eigenvalues given by D.)
+			// Rows of X U for the variants in this block are the rows of m_XtU.
+			//
+			m_loading_vectors.segment( 0, K ) =
+				m_XtU.row( i ) * m_sqrt_D_inverse.asDiagonal() / std::sqrt( m_number_of_snps ) ;
+
+			// We also wish to compute the correlation between the SNP and the PCA component.
+			// With S as above, the PCA components are the projections of columns of X onto columns of S.
+			// If we want samples to correspond to columns, this is
+			//   S^t X 
+			// which can be re-written
+			//   sqrt(L) U D^{1/2}
+			// i.e. we may as well compute the correlation with columns of U.
+			// The correlation is computed over non-missing samples, from sums of products over those samples;
+			// genotypes are zero for missing samples so sums over X need no masking.
+			if( non_missingness > 10 ) {
+				double const sum = m_block_summaries( i, 2 ) ;
+				double const variance1 = m_block_summaries( i, 3 ) - sum * sum / non_missingness ;
+				for( int k = 0; k < K; ++k ) {
+					double const covariance = m_XtU( i, k ) - sum * m_MtU( i, k ) / non_missingness ;
+					double const variance2 = m_MtUU( i, k ) - m_MtU( i, k ) * m_MtU( i, k ) / non_missingness ;
+					m_loading_vectors( K + k ) = covariance / std::sqrt( variance1 * variance2 ) ;
+				}
 			}
 		}
+		send_results(
+			m_block_snps[i],
+			non_missingness,
+			m_block_summaries( i, 1 ),
+			m_loading_vectors,
+			boost::bind(
+				&eigenvector_column_names,
+				K,
+				"eigenvector_",
+				"correlation_",
+				_1
+			)
+		) ;
 	}
-	send_results(
-		snp,
-		m_non_missingness.sum(),
-		allele_frequency,
-		m_loading_vectors,
-		boost::bind(
-			&eigenvector_column_names,
-			m_U.cols(),
-			"eigenvector_",
-			"correlation_",
-			_1
-		)
-	) ;
+	m_block_size = 0 ;
 }
 
 void PCALoadingComputer::send_results_to( ResultCallback callback ) {
@@ -192,7 +230,11 @@ std::string PCALoadingComputer::get_metadata() const {
 		+ "where X is the LxN matrix of genotypes at L SNPs and N samples (normalised across rows.)" ;
 }
 
-void PCALoadingComputer::end_processing_snps() {}
+void PCALoadingComputer::end_processing_snps() {
+	if( m_block_size > 0 ) {
+		process_block() ;
+	}
+}
 
 
 
@@ -12,6 +12,7 @@
 #include "genfile/string_utils.hpp"
 #include "genfile/Error.hpp"
 #include "genfile/vcf/get_set_eigen.hpp"
+#include "genfile/DecodedVariantData.hpp"
 #include "components/RelatednessComponent/PCAProjector.hpp"
 #include "components/RelatednessComponent/PCAComputer.hpp"
 #include "components/RelatednessComponent/mean_centre_genotypes.hpp"
@@ -21,23 +22,42 @@
 // #define DEBUG_PCA_PROJECTOR 1
 
 namespace pca {
+	namespace {
+		// Blocks are limited to this many entries (256Mb of doubles).
+		std::size_t const max_block_entries = 32 * 1024 * 1024 ;
+	}
+
 	PCAProjector::UniquePtr PCAProjector::create(
 		genfile::CohortIndividualSource const& samples,
 		appcontext::UIContext& ui_context,
-		genfile::VariantIdentifyingData::CompareFields const& comparer
+		genfile::VariantIdentifyingData::CompareFields const& comparer,
+		worker::Worker* worker,
+		std::size_t number_of_snps_per_block
 	) {
-		return PCAProjector::UniquePtr( new PCAProjector( samples, ui_context, comparer )) ;
+		return PCAProjector::UniquePtr( new PCAProjector( samples, ui_context, comparer, worker, number_of_snps_per_block )) ;
 	}
 	
 	PCAProjector::PCAProjector(
 		genfile::CohortIndividualSource const& samples,
 		appcontext::UIContext& ui_context,
-		genfile::VariantIdentifyingData::CompareFields const& comparer
+		genfile::VariantIdentifyingData::CompareFields const& comparer,
+		worker::Worker* worker,
+		std::size_t number_of_snps_per_block
 	):
 		m_samples( samples ),
 	 	m_ui_context( ui_context ),
-		m_snps( comparer )
-	{}
+		m_snps( comparer ),
+		m_worker( worker ),
+		m_number_of_snps_per_block( number_of_snps_per_block ),
+		m_block_capacity( 0 ),
+		m_block_size( 0 )
+	{
+		assert( m_number_of_snps_per_block > 0 ) ;
+		if( m_worker && m_worker->get_number_of_worker_threads() > 1 ) {
+			m_dispatcher.reset( new impl::NTaskDispatcher( m_worker ) ) ;
+			m_dispatcher->set_number_of_tasks( m_worker->get_number_of_worker_threads() ) ;
+		}
+	}
 
 	void PCAProjector::set_loadings(
 		std::vector< genfile::VariantIdentifyingData > const& snps,
@@ -88,15 +108,16 @@ namespace pca {
 		m_projections.setZero( number_of_samples, m_loadings.cols() ) ;
 		m_snps_visited_per_sample = Eigen::VectorXd::Zero( number_of_samples ) ;
 		m_total_snps_visited = 0 ;
+		m_block_capacity = std::max< std::size_t >( 1, std::min( m_number_of_snps_per_block, max_block_entries / std::max< std::size_t >( number_of_samples, 1 ) )) ;
+		m_block_genotypes.resize( number_of_samples, m_block_capacity ) ;
+		m_block_loadings.resize( m_block_capacity, m_loadings.cols() ) ;
+		m_block_size = 0 ;
 	}
 
 	void PCAProjector::processed_snp( genfile::VariantIdentifyingData const& snp, genfile::VariantDataReader& data_reader ) {
 		SnpMap::const_iterator where = m_snps.find( snp ) ;
 		if( where != m_snps.end() && ( m_loadings.row( where->second ).sum() == m_loadings.row( where->second ).sum() ) ) {
-			data_reader.get(
-				":genotypes:",
-				genfile::vcf::get_threshholded_calls( m_genotype_calls, m_non_missingness, 0.9, 0, 0, 1, 2 )
-			) ;
+			data_reader.decoded().hard_calls( 0.9 ).get( &m_genotype_calls, &m_non_missingness, 0, 0, 1, 2 ) ;
 			assert( m_genotype_calls.size() == m_projections.rows() ) ;
 			assert( m_non_missingness.size() == m_genotype_calls.size() ) ;
 			double const allele_frequency = m_frequencies( where->second ) ;
@@ -114,27 +135,64 @@ namespace pca {
 				std::cerr << "non-missingness is: " << m_non_missingness.transpose().head( 20 ) << "...\n" ;
 #endif
 				
-				//
-				// We have loadings for C components as columns of m_loadings.
-				// We have calls for N samples as entries of m_genotype_calls
-				// We wish to get a matrix with samples as rows and projections as columns.
-				// We therefore compute a Kronecker product of the column vectors of genotype calls
-				// with the row vector of loadings for that SNP.
-				//
-				m_projections += m_genotype_calls * m_loadings.row( where->second ) ;
+				// Add the genotypes and loadings to the current block; see process_block().
+				m_block_genotypes.col( m_block_size ) = m_genotype_calls ;
+				m_block_loadings.row( m_block_size ) = m_loadings.row( where->second ) ;
 				m_snps_visited_per_sample += m_non_missingness ;
 				++m_visited[ snp.get_position() ] ;
 				++m_total_snps_visited ;
+				if( ++m_block_size == m_block_capacity ) {
+					process_block() ;
+				}
+			}
+		}
+	}
+
+	void PCAProjector::accumulate_projections( int begin_sample, int end_sample ) {
+		int const n = end_sample - begin_sample ;
+		m_projections.middleRows( begin_sample, n ).noalias()
+			+= m_block_genotypes.block( begin_sample, 0, n, m_block_size ) * m_block_loadings.topRows( m_block_size ) ;
+	}
 
-				// sanity check we are not getting NaNs...
-				// (It's more helpful to abort because at least that shows you where the
-				// error is.  A file of NAs is not very helpful in this regard).
-				assert( m_projections.sum() == m_projections.sum() ) ;
+	void PCAProjector::process_block() {
+		//
+		// We have loadings for C components as columns of m_loadings.
+		// We have calls for N samples as columns of m_block_genotypes, one per SNP in the block,
+		// and the loadings for those SNPs as rows of m_block_loadings.
+		// We wish to get a matrix with samples as rows and projections as columns.
+		// This is the sum over SNPs of the Kronecker product of the column vector of genotype calls
+		// with the row vector of loadings for that SNP, i.e. the matrix product of the two.
+		// Samples are split between tasks.
+		//
+		int const number_of_samples = m_projections.rows() ;
+		if( m_dispatcher.get() ) {
+			std::size_t const number_of_tasks = m_dispatcher->number_of_tasks() ;
+			for( std::size_t task_i = 0; task_i < number_of_tasks; ++task_i ) {
+				int const begin = ( task_i * number_of_samples ) / number_of_tasks ;
+				int const end = (( task_i + 1 ) * number_of_samples ) / number_of_tasks ;
+				if( end > begin ) {
+					m_dispatcher->submit_task(
+						task_i,
+						boost::bind( &PCAProjector::accumulate_projections, this, begin, end )
+					) ;
+				}
 			}
+			m_dispatcher->wait_until_complete() ;
+		} else {
+			accumulate_projections( 0, number_of_samples ) ;
 		}
+		m_block_size = 0 ;
+
+		// sanity check we are not getting NaNs...
+		// (It's more helpful to abort because at least that shows you where the
+		// error is.  A file of NAs is not very helpful in this regard).
+		assert( m_projections.sum() == m_projections.sum() ) ;
 	}
 
 	void PCAProjector::end_processing_snps() {
+		if( m_block_size > 0 ) {
+			process_block() ;
+		}
 		diagnose_projection() ;
 		using genfile::string_utils::to_string ;
 		
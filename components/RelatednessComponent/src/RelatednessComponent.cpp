@@ -24,20 +24,26 @@
 #include "components/RelatednessComponent/PCAProjector.hpp"
 #include "components/RelatednessComponent/names.hpp"
 #include "components/RelatednessComponent/write_matrix.hpp"
+#include "components/RelatednessComponent/BinaryMatrixWriter.hpp"
+#include "components/RelatednessComponent/SparseMatrixWriter.hpp"
 
 void RelatednessComponent::declare_options( appcontext::OptionProcessor& options ) {
 	options.declare_group( "Kinship options" ) ;
 	options[ "-kinship" ]
-		.set_description( "Perform kinship computation using threshholded genotype calls." )
+		.set_description( "Perform kinship computation using threshholded genotype calls. "
+			"The matrix is written in binary form (see -binary-matrix-format) if the filename ends in .bin, "
+			"and in long form otherwise." )
 		.set_takes_single_value() ;
 	options[ "-load-kinship" ]
-		.set_description( "Load a previously-computed kinship matrix from the specified file." )
+		.set_description( "Load a previously-computed kinship matrix from the specified file, "
+			"which may be in long form or in binary form." )
 		.set_takes_single_value() ;
 	options[ "-load-UDUT" ]
 		.set_description( "Load a previously-computed eigenvalue decomposition of a relatedness matrix." )
 		.set_takes_single_value() ;
 	options[ "-UDUT" ]
-		.set_description( "Compute the UDUT decomposition of the matrix passed to -load-kinship, and save it in the specified file." )
+		.set_description( "Compute the UDUT decomposition of the matrix passed to -load-kinship, and save it in the specified file. "
+			"The decomposition is written in binary form if the filename ends in .bin." )
 		.set_takes_single_value() ;
 	options[ "-PCs" ]
 		.set_description(
@@ -63,9 +69,35 @@ void RelatednessComponent::declare_options( appcontext::OptionProcessor& options
 		.set_takes_single_value()
 		.set_default_value( "lookup-table" )
 	;
+	options[ "-kinship-memory" ]
+		.set_description( "Compute the kinship matrix out of core, using about the specified number of megabytes of memory. "
+			"The matrix is computed in tiles in one or more passes through the data, and is written to the file given to -kinship "
+			"in binary form." )
+		.set_takes_single_value()
+		.set_default_value( 4096 )
+	;
+	options[ "-kinship-threshold" ]
+		.set_description( "Compute the kinship matrix out of core as for -kinship-memory, but write only pairs of samples "
+			"whose kinship exceeds the specified value. "
+			"Output goes to a sqlite table named \"Relatedness\" if the filename given to -kinship ends in .sqlite, "
+			"and otherwise to a binary file of (sample index, sample index, count, value) records (see SparseMatrixWriter.hpp)." )
+		.set_takes_single_value()
+	;
+
+	options[ "-binary-matrix-format" ]
+		.set_description( "Format of values in binary matrix output files. "
+			"This must be \"float64\" or \"float32\", optionally followed by \"+zlib\" to compress the data. "
+			"Uncompressed files can be memory-mapped when loaded." )
+		.set_takes_single_value()
+		.set_default_value( "float64" )
+	;
 
 	options.option_implies_option( "-kinship", "-s" ) ;
 	options.option_implies_option( "-kinship-method", "-kinship" ) ;
+	options.option_implies_option( "-kinship-memory", "-kinship" ) ;
+	options.option_excludes_option( "-kinship-memory", "-PCs" ) ;
+	options.option_implies_option( "-kinship-threshold", "-kinship" ) ;
+	options.option_excludes_option( "-kinship-threshold", "-PCs" ) ;
 	options.option_implies_option( "-load-kinship", "-s" ) ;
 	options.option_implies_option( "-UDUT", "-PCs" ) ;
 	options.option_implies_option( "-PCs", "-UDUT" ) ;
@@ -125,6 +157,7 @@ void RelatednessComponent::setup(
 		&m_samples,
 		_1
 	) ;
+	pca::BinaryMatrixFormat const binary_format = pca::BinaryMatrixFormat::parse( m_options.get< std::string >( "-binary-matrix-format" ) ) ;
 
 	if( m_options.check( "-PCs" ) ) {
 		if( !storage ) {
@@ -142,18 +175,29 @@ void RelatednessComponent::setup(
 			) ;
 		}
 		pca_computer = PCAComputer::SharedPtr( new PCAComputer( m_options, m_samples, m_ui_context ) ) ;
-		pca_computer->send_UDUT_to(
-			boost::bind(
-				&pca::write_matrix,
-				m_options.get< std::string >( "-UDUT" ),
-				_3, "qctool:PCAComputer" ,_1, _4, _5
-			)
-		) ;
+		std::string const& UDUT_filename = m_options.get< std::string >( "-UDUT" ) ;
+		if( pca::BinaryMatrixFormat::is_binary_matrix_filename( UDUT_filename )) {
+			pca_computer->send_UDUT_to(
+				boost::bind(
+					&pca::write_matrix_in_binary_form,
+					UDUT_filename, binary_format,
+					_2, _3, "qctool:PCAComputer", _1, _4, _5
+				)
+			) ;
+		} else {
+			pca_computer->send_UDUT_to(
+				boost::bind(
+					&pca::write_matrix,
+					UDUT_filename,
+					_3, "qctool:PCAComputer" ,_1, _4, _5
+				)
+			) ;
+		}
 		pca_computer->send_PCs_to( storage ) ;
 	}
 
 	if( m_options.check( "-loadings" )) {
-		PCALoadingComputer::UniquePtr loading_computer( new PCALoadingComputer( m_options.get< int >( "-PCs" ) ) ) ;
+		PCALoadingComputer::UniquePtr loading_computer( new PCALoadingComputer( m_options.get< int >( "-PCs" ), m_worker ) ) ;
 		if( pca_computer.get() ) {
 			pca_computer->send_UDUT_to( boost::bind( &PCALoadingComputer::set_UDUT, loading_computer.get(), _2, _3 ) ) ;
 		} else if( m_options.check( "-load-UDUT" )) {
@@ -189,12 +233,54 @@ void RelatednessComponent::setup(
 	if( m_options.check( "-kinship" )) {
 		KinshipCoefficientComputer::Computation::UniquePtr computation ;
 		std::string const& method = m_options.get< std::string >( "-kinship-method" ) ;
+		std::string const& filename = m_options.get< std::string >( "-kinship" ) ;
 		if( method == "lookup-table" ) {
-			computation.reset(
-				impl::NormaliseGenotypesAndComputeXXtFast::create(
-					m_worker, 4
-				).release()
+			std::auto_ptr< impl::NormaliseGenotypesAndComputeXXtFast > fast_computation(
+				new impl::NormaliseGenotypesAndComputeXXtFast( m_worker, 4 )
 			) ;
+			if( m_options.check( "-kinship-memory" ) || m_options.check( "-kinship-threshold" )) {
+				fast_computation->set_memory_budget(
+					m_options.get< std::size_t >( "-kinship-memory" ) * 1024 * 1024,
+					filename
+				) ;
+				std::string const description = "Number of samples: " + genfile::string_utils::to_string( m_samples.get_number_of_individuals() ) ;
+				if( m_options.check( "-kinship-threshold" )) {
+					boost::shared_ptr< pca::SparseMatrixWriter > writer(
+						pca::SparseMatrixWriter::create(
+							filename,
+							m_samples.get_number_of_individuals(),
+							m_options.get< double >( "-kinship-threshold" ),
+							get_ids,
+							"KinshipCoefficientComputer",
+							description + "\nThreshold: " + m_options.get< std::string >( "-kinship-threshold" )
+						).release()
+					) ;
+					fast_computation->send_tiles_to(
+						boost::bind( &pca::SparseMatrixWriter::write_tile, writer, _1, _2 )
+					) ;
+					fast_computation->send_end_of_tiles_to(
+						boost::bind( &pca::SparseMatrixWriter::close, writer )
+					) ;
+				} else {
+					boost::shared_ptr< pca::BinaryMatrixWriter > writer(
+						pca::BinaryMatrixWriter::create_lower_triangle(
+							filename,
+							m_samples.get_number_of_individuals(),
+							binary_format,
+							"KinshipCoefficientComputer",
+							description,
+							get_ids
+						).release()
+					) ;
+					fast_computation->send_tiles_to(
+						boost::bind( &pca::BinaryMatrixWriter::write_tile, writer, _1, _2 )
+					) ;
+					fast_computation->send_end_of_tiles_to(
+						boost::bind( &pca::BinaryMatrixWriter::close, writer )
+					) ;
+				}
+			}
+			computation.reset( fast_computation.release() ) ;
 		} else {
 			throw genfile::BadArgumentError(
 				"RelatednessComponent::setup()",
@@ -213,14 +299,27 @@ void RelatednessComponent::setup(
 				computation
 			)
 		) ;
-		result->send_results_to(
-			boost::bind(
-				&pca::write_matrix_lower_diagonals_in_long_form,
-				m_options.get< std::string >( "-kinship" ),
-				_2, _3, _4, _5,
-				get_ids, get_ids
-			)
-		) ;
+		if( m_options.check( "-kinship-memory" ) || m_options.check( "-kinship-threshold" )) {
+			// Tiles are written as they are computed.
+		} else if( pca::BinaryMatrixFormat::is_binary_matrix_filename( filename )) {
+			result->send_results_to(
+				boost::bind(
+					&pca::write_matrix_lower_diagonals_in_binary_form,
+					filename, binary_format,
+					_1, _2, _3, _4, _5,
+					get_ids
+				)
+			) ;
+		} else {
+			result->send_results_to(
+				boost::bind(
+					&pca::write_matrix_lower_diagonals_in_long_form,
+					filename,
+					_2, _3, _4, _5,
+					get_ids, get_ids
+				)
+			) ;
+		}
 		if( pca_computer ) {
 			result->send_results_to(
 				boost::bind(
@@ -238,13 +337,12 @@ void RelatednessComponent::setup(
 		assert( !m_options.check( "-kinship" ) ) ;
 		Eigen::MatrixXd relatednessMatrix ;
 		std::size_t number_of_snps ;
-		PCAComputer::load_long_form_matrix(
-			m_samples,
-			m_options.get< std::string >( "-load-kinship" ),
-			&relatednessMatrix,
-			&number_of_snps,
-			m_ui_context
-		) ;
+		std::string const& filename = m_options.get< std::string >( "-load-kinship" ) ;
+		if( pca::BinaryMatrixFormat::is_binary_matrix_file( filename )) {
+			PCAComputer::load_binary_matrix( m_samples, filename, &relatednessMatrix, &number_of_snps, m_ui_context ) ;
+		} else {
+			PCAComputer::load_long_form_matrix( m_samples, filename, &relatednessMatrix, &number_of_snps, m_ui_context ) ;
+		}
 		pca_computer->compute( relatednessMatrix, number_of_snps, m_options.get< std::string >( "-load-kinship" ) ) ;
 	}
 
@@ -256,7 +354,8 @@ void RelatednessComponent::setup(
 		pca::PCAProjector::UniquePtr projector = pca::PCAProjector::create(
 			m_samples,
 			m_ui_context,
-			genfile::VariantIdentifyingData::CompareFields( match_fields )
+			genfile::VariantIdentifyingData::CompareFields( match_fields ),
+			m_worker
 		) ;
 		projector->send_results_to(
 			boost::bind(
@@ -0,0 +1,220 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include "genfile/VariantEntry.hpp"
+#include "genfile/CohortIndividualSource.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/string_utils.hpp"
+#include "genfile/Error.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/db/Connection.hpp"
+#include "genfile/db/SQLStatement.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/SparseMatrixWriter.hpp"
+#include "components/RelatednessComponent/write_matrix.hpp"
+
+namespace pca {
+	namespace {
+		struct FlatFileSparseMatrixWriter: public SparseMatrixWriter {
+			FlatFileSparseMatrixWriter(
+				std::string const& filename,
+				std::size_t const number_of_samples,
+				double const threshold,
+				GetNames get_names,
+				std::string const& source,
+				std::string const& description
+			):
+				SparseMatrixWriter( threshold, get_names ),
+				m_filename( filename ),
+				m_stream( filename.c_str(), std::ios::binary | std::ios::trunc ),
+				m_number_of_records( 0 )
+			{
+				if( !m_stream.is_open() ) {
+					throw genfile::ResourceNotOpenedError( m_filename ) ;
+				}
+				m_stream.write( "QCSPARSE", 8 ) ;
+				genfile::write_little_endian_integer( m_stream, SparseMatrixWriter::version ) ;
+				genfile::write_little_endian_integer( m_stream, uint32_t( 0 ) ) ;
+				genfile::write_little_endian_integer( m_stream, uint64_t( number_of_samples ) ) ;
+				// The number of SNPs and records are filled in by close().
+				genfile::write_little_endian_integer( m_stream, uint64_t( 0 ) ) ;
+				genfile::write_little_endian_integer( m_stream, uint64_t( 0 ) ) ;
+				write_string( get_metadata( source, description ) ) ;
+				genfile::write_little_endian_integer( m_stream, uint32_t( number_of_samples ) ) ;
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					write_string( genfile::string_utils::to_string( get_names( i ) ) ) ;
+				}
+				if( !m_stream ) {
+					throw genfile::OutputError( m_filename ) ;
+				}
+			}
+
+			void close() {
+				m_stream.seekp( SparseMatrixWriter::number_of_snps_offset ) ;
+				genfile::write_little_endian_integer( m_stream, uint64_t( number_of_snps() ) ) ;
+				genfile::write_little_endian_integer( m_stream, uint64_t( m_number_of_records ) ) ;
+				m_stream.close() ;
+				if( !m_stream ) {
+					throw genfile::OutputError( m_filename ) ;
+				}
+			}
+
+		protected:
+			void begin_tile() {
+				m_buffer.clear() ;
+			}
+
+			void write_pair( std::size_t const i, std::size_t const j, int const nonmissingness, double const value ) {
+				std::size_t const offset = m_buffer.size() ;
+				m_buffer.resize( offset + SparseMatrixWriter::record_size ) ;
+				uint8_t* buffer = &m_buffer[ offset ] ;
+				uint8_t* const end = buffer + SparseMatrixWriter::record_size ;
+				buffer = genfile::write_little_endian_integer( buffer, end, uint32_t( i ) ) ;
+				buffer = genfile::write_little_endian_integer( buffer, end, uint32_t( j ) ) ;
+				buffer = genfile::write_little_endian_integer( buffer, end, int32_t( nonmissingness ) ) ;
+				// This assumes the host is little-endian, as do the other binary formats.
+				std::memcpy( buffer, &value, sizeof( double ) ) ;
+				++m_number_of_records ;
+			}
+
+			void end_tile() {
+				if( m_buffer.size() > 0 ) {
+					m_stream.write( reinterpret_cast< char const* >( &m_buffer[0] ), m_buffer.size() ) ;
+					if( !m_stream ) {
+						throw genfile::OutputError( m_filename ) ;
+					}
+				}
+			}
+
+		private:
+			std::string const m_filename ;
+			std::ofstream m_stream ;
+			std::size_t m_number_of_records ;
+			std::vector< uint8_t > m_buffer ;
+
+		private:
+			void write_string( std::string const& value ) {
+				genfile::write_little_endian_integer( m_stream, uint32_t( value.size() ) ) ;
+				m_stream.write( value.data(), value.size() ) ;
+			}
+		} ;
+
+		struct SQLiteSparseMatrixWriter: public SparseMatrixWriter {
+			SQLiteSparseMatrixWriter(
+				std::string const& filename,
+				double const threshold,
+				GetNames get_names,
+				std::string const& source,
+				std::string const& description
+			):
+				SparseMatrixWriter( threshold, get_names ),
+				m_connection( genfile::db::Connection::create( filename )),
+				m_last_i( 0 )
+			{
+				m_connection->run_statement(
+					"CREATE TABLE IF NOT EXISTS Relatedness ( "
+					"sample_1 TEXT NOT NULL, sample_2 TEXT NOT NULL, pairwise_complete_obs INTEGER, value FLOAT"
+					" )"
+				) ;
+				m_connection->run_statement(
+					"CREATE TABLE IF NOT EXISTS RelatednessMetadata ( description TEXT )"
+				) ;
+				m_connection->get_statement( "INSERT INTO RelatednessMetadata VALUES( ? )" )
+					->bind( 1, get_metadata( source, description ) )
+					.step() ;
+				m_insert_statement = m_connection->get_statement( "INSERT INTO Relatedness VALUES( ?, ?, ?, ? )" ) ;
+			}
+
+			// Indexing the table is left to close(), so that it can report errors.
+			void close() {
+				m_insert_statement.reset() ;
+				m_connection->run_statement( "CREATE INDEX IF NOT EXISTS RelatednessSample1Index ON Relatedness( sample_1 )" ) ;
+				m_connection->run_statement( "CREATE INDEX IF NOT EXISTS RelatednessSample2Index ON Relatedness( sample_2 )" ) ;
+			}
+
+		protected:
+			void begin_tile() {
+				m_transaction = m_connection->open_transaction( 7200 ) ;
+				m_name_i = genfile::VariantEntry() ;
+			}
+
+			void write_pair( std::size_t const i, std::size_t const j, int const nonmissingness, double const value ) {
+				if( m_name_i.is_missing() || i != m_last_i ) {
+					m_name_i = get_names()( i ) ;
+					m_last_i = i ;
+				}
+				m_insert_statement
+					->bind( 1, m_name_i )
+					.bind( 2, get_names()( j ) )
+					.bind( 3, int32_t( nonmissingness ) )
+					.bind( 4, value )
+					.step() ;
+				m_insert_statement->reset() ;
+			}
+
+			void end_tile() {
+				m_transaction.reset() ;
+			}
+
+		private:
+			genfile::db::Connection::UniquePtr m_connection ;
+			genfile::db::Connection::StatementPtr m_insert_statement ;
+			genfile::db::Connection::ScopedTransactionPtr m_transaction ;
+			// Name of the sample in the current row, which is looked up once per row.
+			genfile::VariantEntry m_name_i ;
+			std::size_t m_last_i ;
+		} ;
+	}
+
+	SparseMatrixWriter::UniquePtr SparseMatrixWriter::create(
+		std::string const& filename,
+		std::size_t const number_of_samples,
+		double const threshold,
+		GetNames get_names,
+		std::string const& source,
+		std::string const& description
+	) {
+		using genfile::string_utils::to_lower ;
+		UniquePtr result ;
+		if( filename.size() >= 9 && filename.substr( 0, 9 ) == "sqlite://" ) {
+			result.reset( new SQLiteSparseMatrixWriter( filename.substr( 9 ), threshold, get_names, source, description )) ;
+		} else if( filename.size() >= 7 && to_lower( filename.substr( filename.size() - 7 ) ) == ".sqlite" ) {
+			result.reset( new SQLiteSparseMatrixWriter( filename, threshold, get_names, source, description )) ;
+		} else {
+			result.reset( new FlatFileSparseMatrixWriter( filename, number_of_samples, threshold, get_names, source, description )) ;
+		}
+		return result ;
+	}
+
+	SparseMatrixWriter::SparseMatrixWriter( double const threshold, GetNames get_names ):
+		m_threshold( threshold ),
+		m_get_names( get_names ),
+		m_number_of_pairs_written( 0 ),
+		m_number_of_snps( 0 )
+	{
+		assert( m_get_names ) ;
+	}
+
+	void SparseMatrixWriter::write_tile( std::size_t const number_of_snps, LowerTriangularTile const& tile ) {
+		m_number_of_snps = number_of_snps ;
+		begin_tile() ;
+		for( std::size_t i = tile.begin_row(); i < tile.end_row(); ++i ) {
+			for( std::size_t j = 0; j < i; ++j ) {
+				double const value = tile.value( i, j ) ;
+				if( value > m_threshold ) {
+					write_pair( i, j, tile.nonmissingness( i, j ), value ) ;
+					++m_number_of_pairs_written ;
+				}
+			}
+		}
+		end_tile() ;
+	}
+}
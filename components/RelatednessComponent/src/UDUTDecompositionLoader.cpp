@@ -12,6 +12,8 @@
 #include "genfile/Error.hpp"
 #include "statfile/BuiltInTypeStatSource.hpp"
 #include "components/RelatednessComponent/UDUTDecompositionLoader.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+#include "components/RelatednessComponent/BinaryMatrixReader.hpp"
 
 namespace relatedness {
 	UDUTDecompositionLoader::UDUTDecompositionLoader( genfile::CohortIndividualSource const& samples ):
@@ -25,7 +27,11 @@ namespace relatedness {
 	void UDUTDecompositionLoader::load_matrix( std::string const& filename ) const {
 		Eigen::MatrixXd matrix ;
 		std::size_t number_of_snps = 0;
-		load_matrix_impl( filename, &matrix, &number_of_snps ) ;
+		if( pca::BinaryMatrixFormat::is_binary_matrix_file( filename )) {
+			load_binary_matrix_impl( filename, &matrix, &number_of_snps ) ;
+		} else {
+			load_matrix_impl( filename, &matrix, &number_of_snps ) ;
+		}
 		m_result_signal( matrix, m_samples.get_number_of_individuals(), number_of_snps ) ;
 	}
 
@@ -75,4 +81,38 @@ namespace relatedness {
 		}
 		
 	}
+
+	void UDUTDecompositionLoader::load_binary_matrix_impl( std::string const& filename, Eigen::MatrixXd* matrix, std::size_t* number_of_snps ) const {
+		assert( matrix ) ;
+		assert( number_of_snps ) ;
+		using namespace genfile::string_utils ;
+		pca::BinaryMatrixReader::UniquePtr reader = pca::BinaryMatrixReader::create( filename ) ;
+		std::size_t const number_of_samples = m_samples.get_number_of_individuals() ;
+		if( reader->number_of_rows() != number_of_samples ) {
+			throw genfile::MismatchError(
+				"UDUTDecompositionLoader::load_matrix()",
+				filename,
+				"number of samples: " + to_string( reader->number_of_rows() ),
+				"expected number: " + to_string( number_of_samples )
+			) ;
+		}
+		if( reader->number_of_columns() != number_of_samples + 1 ) {
+			throw genfile::MalformedInputError( filename, 0, std::min( reader->number_of_columns(), number_of_samples + 1 )) ;
+		}
+		// Make sure the samples come in the same order as in the sample file.
+		std::vector< std::string > const& ids = reader->row_ids() ;
+		for( std::size_t i = 0; i < ids.size(); ++i ) {
+			std::string const sample = m_samples.get_entry( i, "ID_1" ).as< std::string >() ;
+			if( ids[i] != sample ) {
+				throw genfile::MismatchError(
+					"UDUTDecompositionLoader::load_matrix()",
+					filename,
+					"sample " + to_string( i + 1 ) + ": " + ids[i],
+					"expected sample: " + sample
+				) ;
+			}
+		}
+		reader->get_values( matrix ) ;
+		*number_of_snps = reader->number_of_snps() ;
+	}
 }
@@ -0,0 +1,310 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <Eigen/Core>
+#include "genfile/Error.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/CategoricalCohortIndividualSource.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "appcontext/CmdLineUIContext.hpp"
+#include "components/RelatednessComponent/BinaryMatrixFormat.hpp"
+#include "components/RelatednessComponent/BinaryMatrixWriter.hpp"
+#include "components/RelatednessComponent/BinaryMatrixReader.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/PCAComputer.hpp"
+#include "components/RelatednessComponent/UDUTDecompositionLoader.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_binary_matrix )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	std::size_t const N = 7 ;
+	char const* formats[] = { "float64", "float32", "float64+zlib", "float32+zlib" } ;
+
+	std::string get_sample_id( std::size_t i ) {
+		return "sample_" + genfile::string_utils::to_string( i ) ;
+	}
+
+	genfile::VariantEntry get_name( std::vector< std::string > const* names, std::size_t i ) {
+		return (*names)[i] ;
+	}
+
+	std::vector< std::string > get_ids( std::size_t n ) {
+		std::vector< std::string > result ;
+		for( std::size_t i = 0; i < n; ++i ) {
+			result.push_back( get_sample_id( i )) ;
+		}
+		return result ;
+	}
+
+	std::string sample_file( std::vector< std::string > const& ids ) {
+		std::ostringstream result ;
+		result << "ID_1 ID_2 missing\n0 0 0\n" ;
+		for( std::size_t i = 0; i < ids.size(); ++i ) {
+			result << ids[i] << " " << ids[i] << " 0\n" ;
+		}
+		return result.str() ;
+	}
+
+	Matrix random_matrix( std::size_t rows, std::size_t cols, unsigned int seed ) {
+		std::mt19937 generator( seed ) ;
+		std::normal_distribution< double > normal ;
+		Matrix result( rows, cols ) ;
+		for( std::size_t j = 0; j < cols; ++j ) {
+			for( std::size_t i = 0; i < rows; ++i ) {
+				result( i, j ) = normal( generator ) ;
+			}
+		}
+		return result ;
+	}
+
+	Matrix symmetrise( Matrix const& matrix ) {
+		return matrix.selfadjointView< Eigen::Lower >() ;
+	}
+
+	// The value stored for x in the given format.
+	double stored( pca::BinaryMatrixFormat const& format, double x ) {
+		return ( format.value_type == pca::BinaryMatrixFormat::eFloat32 ) ? double( float( x )) : x ;
+	}
+
+	void check_values( pca::BinaryMatrixReader const& reader, Matrix const& expected ) {
+		BOOST_REQUIRE_EQUAL( reader.number_of_rows(), expected.rows() ) ;
+		BOOST_REQUIRE_EQUAL( reader.number_of_columns(), expected.cols() ) ;
+		Matrix values ;
+		reader.get_values( &values ) ;
+		BOOST_REQUIRE_EQUAL( values.rows(), expected.rows() ) ;
+		BOOST_REQUIRE_EQUAL( values.cols(), expected.cols() ) ;
+		for( int i = 0; i < expected.rows(); ++i ) {
+			for( int j = 0; j < expected.cols(); ++j ) {
+				double const x = stored( reader.format(), expected( i, j )) ;
+				BOOST_CHECK_EQUAL( values( i, j ), x ) ;
+				BOOST_CHECK_EQUAL( reader.value( i, j ), x ) ;
+			}
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_packed_lower_triangle ) {
+	std::vector< std::string > const ids = get_ids( N ) ;
+	Matrix const values = symmetrise( random_matrix( N, N, 1 )) ;
+	Matrix counts = symmetrise( ( random_matrix( N, N, 2 ).array().abs() * 10 ).floor().matrix() ) ;
+
+	for( std::size_t f = 0; f < 4; ++f ) {
+		pca::BinaryMatrixFormat const format = pca::BinaryMatrixFormat::parse( formats[f] ) ;
+		// Written as whole matrices, and in tiles out of order.
+		std::string const filenames[2] = {
+			genfile::create_temporary_filename() + ".bin",
+			genfile::create_temporary_filename() + ".bin"
+		} ;
+		pca::write_matrix_lower_diagonals_in_binary_form(
+			filenames[0], format, 100, counts, values, "test", "A kinship matrix", boost::bind( &get_name, &ids, _1 )
+		) ;
+		{
+			pca::BinaryMatrixWriter::UniquePtr writer = pca::BinaryMatrixWriter::create_lower_triangle(
+				filenames[1], N, format, "test", "A kinship matrix", boost::bind( &get_name, &ids, _1 )
+			) ;
+			std::size_t const boundaries[3] = { 0, 3, N } ;
+			for( int t = 1; t >= 0; --t ) {
+				pca::LowerTriangularTile tile( boundaries[t], boundaries[t+1] ) ;
+				for( std::size_t i = tile.begin_row(); i < tile.end_row(); ++i ) {
+					for( std::size_t j = 0; j <= i; ++j ) {
+						tile.value( i, j ) = values( i, j ) ;
+						tile.nonmissingness( i, j ) = counts( i, j ) ;
+					}
+				}
+				writer->write_tile( 100, tile ) ;
+			}
+			writer->close() ;
+		}
+
+		for( std::size_t k = 0; k < 2; ++k ) {
+			BOOST_CHECK( pca::BinaryMatrixFormat::is_binary_matrix_file( filenames[k] )) ;
+			pca::BinaryMatrixReader::UniquePtr reader = pca::BinaryMatrixReader::create( filenames[k] ) ;
+			BOOST_CHECK_EQUAL( reader->storage(), pca::BinaryMatrixFormat::ePackedLowerTriangle ) ;
+			BOOST_CHECK_EQUAL( reader->format().value_type, format.value_type ) ;
+			BOOST_CHECK_EQUAL( reader->format().compression, format.compression ) ;
+			BOOST_CHECK_EQUAL( reader->number_of_snps(), 100 ) ;
+			BOOST_CHECK( reader->metadata().find( "A kinship matrix" ) != std::string::npos ) ;
+			BOOST_CHECK( reader->row_ids() == ids ) ;
+			BOOST_CHECK( reader->column_ids() == ids ) ;
+			check_values( *reader, values ) ;
+			BOOST_REQUIRE( reader->has_counts() ) ;
+			Matrix read_counts ;
+			reader->get_counts( &read_counts ) ;
+			BOOST_CHECK( read_counts == counts ) ;
+			for( std::size_t i = 0; i < N; ++i ) {
+				for( std::size_t j = 0; j < N; ++j ) {
+					BOOST_CHECK_EQUAL( reader->count( i, j ), counts( i, j )) ;
+				}
+			}
+			boost::filesystem::remove( filenames[k] ) ;
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_dense ) {
+	std::vector< std::string > const row_ids = get_ids( N ) ;
+	std::vector< std::string > column_ids ;
+	for( std::size_t j = 0; j < N + 2; ++j ) {
+		column_ids.push_back( "column_" + genfile::string_utils::to_string( j )) ;
+	}
+	Matrix const values = random_matrix( N, N + 2, 3 ) ;
+
+	for( std::size_t f = 0; f < 4; ++f ) {
+		pca::BinaryMatrixFormat const format = pca::BinaryMatrixFormat::parse( formats[f] ) ;
+		std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+		pca::write_matrix_in_binary_form(
+			filename, format, 50, values, "test", "A dense matrix",
+			boost::bind( &get_name, &row_ids, _1 ),
+			boost::bind( &get_name, &column_ids, _1 )
+		) ;
+		pca::BinaryMatrixReader::UniquePtr reader = pca::BinaryMatrixReader::create( filename ) ;
+		BOOST_CHECK_EQUAL( reader->storage(), pca::BinaryMatrixFormat::eDense ) ;
+		BOOST_CHECK_EQUAL( reader->number_of_snps(), 50 ) ;
+		BOOST_CHECK( !reader->has_counts() ) ;
+		BOOST_CHECK( reader->row_ids() == row_ids ) ;
+		BOOST_CHECK( reader->column_ids() == column_ids ) ;
+		check_values( *reader, values ) ;
+		boost::filesystem::remove( filename ) ;
+	}
+
+	// Names are optional.
+	{
+		std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+		pca::write_matrix_in_binary_form(
+			filename, pca::BinaryMatrixFormat(), 50, values, "test", "A dense matrix",
+			pca::BinaryMatrixWriter::GetNames(), pca::BinaryMatrixWriter::GetNames()
+		) ;
+		pca::BinaryMatrixReader::UniquePtr reader = pca::BinaryMatrixReader::create( filename ) ;
+		BOOST_CHECK_EQUAL( reader->row_ids().size(), 0 ) ;
+		BOOST_CHECK_EQUAL( reader->column_ids().size(), 0 ) ;
+		check_values( *reader, values ) ;
+		boost::filesystem::remove( filename ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_load_kinship_remaps_samples ) {
+	appcontext::CmdLineUIContext ui_context ;
+	// The matrix holds samples in a different order from the sample file.
+	std::size_t const order[N] = { 3, 0, 6, 1, 5, 2, 4 } ;
+	std::vector< std::string > file_ids ;
+	for( std::size_t i = 0; i < N; ++i ) {
+		file_ids.push_back( get_sample_id( order[i] )) ;
+	}
+	Matrix const file_values = symmetrise( random_matrix( N, N, 4 )) ;
+	Matrix const counts = Matrix::Constant( N, N, 10 ) ;
+
+	std::istringstream sample_stream( sample_file( get_ids( N ))) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_stream ) ;
+
+	for( std::size_t f = 0; f < 4; ++f ) {
+		pca::BinaryMatrixFormat const format = pca::BinaryMatrixFormat::parse( formats[f] ) ;
+		std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+		pca::write_matrix_lower_diagonals_in_binary_form(
+			filename, format, 20, counts, file_values, "test", "A kinship matrix", boost::bind( &get_name, &file_ids, _1 )
+		) ;
+		Matrix loaded ;
+		std::size_t number_of_snps = 0 ;
+		PCAComputer::load_binary_matrix( samples, filename, &loaded, &number_of_snps, ui_context ) ;
+		BOOST_CHECK_EQUAL( number_of_snps, 20 ) ;
+		BOOST_REQUIRE_EQUAL( loaded.rows(), N ) ;
+		BOOST_REQUIRE_EQUAL( loaded.cols(), N ) ;
+		for( std::size_t i = 0; i < N; ++i ) {
+			for( std::size_t j = 0; j < N; ++j ) {
+				BOOST_CHECK_EQUAL( loaded( order[i], order[j] ), stored( format, file_values( i, j ))) ;
+			}
+		}
+		boost::filesystem::remove( filename ) ;
+	}
+
+	// Samples missing from the matrix are an error.
+	{
+		std::vector< std::string > ids = get_ids( N + 1 ) ;
+		std::istringstream sample_stream( sample_file( ids )) ;
+		genfile::CategoricalCohortIndividualSource const more_samples( sample_stream ) ;
+		std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+		pca::write_matrix_lower_diagonals_in_binary_form(
+			filename, pca::BinaryMatrixFormat(), 20, counts, file_values, "test", "A kinship matrix", boost::bind( &get_name, &file_ids, _1 )
+		) ;
+		Matrix loaded ;
+		std::size_t number_of_snps = 0 ;
+		BOOST_CHECK_THROW(
+			PCAComputer::load_binary_matrix( more_samples, filename, &loaded, &number_of_snps, ui_context ),
+			genfile::BadArgumentError
+		) ;
+		boost::filesystem::remove( filename ) ;
+	}
+}
+
+namespace {
+	void store_UDUT( Matrix* result, std::size_t* number_of_snps, Matrix const& UDUT, std::size_t, std::size_t snps ) {
+		*result = UDUT ;
+		*number_of_snps = snps ;
+	}
+}
+
+AUTO_TEST_CASE( test_load_UDUT ) {
+	std::vector< std::string > const ids = get_ids( N ) ;
+	std::istringstream sample_stream( sample_file( ids )) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_stream ) ;
+	Matrix const UDUT = random_matrix( N, N + 1, 5 ) ;
+	std::vector< std::string > column_ids( N + 1, "v" ) ;
+
+	// With row ids as PCAComputer's callers may write them, and without.
+	std::vector< std::string > const no_ids ;
+	std::vector< std::string > const* row_ids[2] = { &ids, &no_ids } ;
+	for( std::size_t f = 0; f < 4; ++f ) {
+		for( std::size_t k = 0; k < 2; ++k ) {
+			pca::BinaryMatrixFormat const format = pca::BinaryMatrixFormat::parse( formats[f] ) ;
+			std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+			pca::write_matrix_in_binary_form(
+				filename, format, 30, UDUT, "test", "A decomposition",
+				row_ids[k]->empty() ? pca::BinaryMatrixWriter::GetNames() : pca::BinaryMatrixWriter::GetNames( boost::bind( &get_name, row_ids[k], _1 )),
+				boost::bind( &get_name, &column_ids, _1 )
+			) ;
+			relatedness::UDUTDecompositionLoader loader( samples ) ;
+			Matrix loaded ;
+			std::size_t number_of_snps = 0 ;
+			loader.send_UDUT_to( boost::bind( &store_UDUT, &loaded, &number_of_snps, _1, _2, _3 )) ;
+			loader.load_matrix( filename ) ;
+			BOOST_CHECK_EQUAL( number_of_snps, 30 ) ;
+			BOOST_REQUIRE_EQUAL( loaded.rows(), N ) ;
+			BOOST_REQUIRE_EQUAL( loaded.cols(), N + 1 ) ;
+			for( std::size_t i = 0; i < N; ++i ) {
+				for( std::size_t j = 0; j < N + 1; ++j ) {
+					BOOST_CHECK_EQUAL( loaded( i, j ), stored( format, UDUT( i, j ))) ;
+				}
+			}
+			boost::filesystem::remove( filename ) ;
+		}
+	}
+
+	// Rows for samples in a different order are rejected.
+	{
+		std::vector< std::string > reordered( ids ) ;
+		std::swap( reordered[0], reordered[1] ) ;
+		std::string const filename = genfile::create_temporary_filename() + ".bin" ;
+		pca::write_matrix_in_binary_form(
+			filename, pca::BinaryMatrixFormat(), 30, UDUT, "test", "A decomposition",
+			boost::bind( &get_name, &reordered, _1 ),
+			boost::bind( &get_name, &column_ids, _1 )
+		) ;
+		relatedness::UDUTDecompositionLoader loader( samples ) ;
+		BOOST_CHECK_THROW( loader.load_matrix( filename ), genfile::MismatchError ) ;
+		boost::filesystem::remove( filename ) ;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
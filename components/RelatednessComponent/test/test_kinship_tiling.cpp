@@ -0,0 +1,170 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <random>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "worker/SynchronousWorker.hpp"
+#include "worker/QueuedMultiThreadedWorker.hpp"
+#include "components/RelatednessComponent/KinshipCoefficientComputer.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_kinship_tiling )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	std::size_t const number_of_samples = 40 ;
+	// Not a multiple of the 16 SNPs computed at once, so the last block is partial.
+	std::size_t const number_of_variants = 70 ;
+
+	// Hard-called genotypes, with some missing; sample 0 is missing throughout, so its kinship is NaN.
+	std::vector< Matrix > simulate() {
+		std::mt19937 generator( 99 ) ;
+		std::uniform_real_distribution< double > uniform ;
+		std::vector< Matrix > result( number_of_variants, Matrix::Zero( number_of_samples, 3 )) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			double const frequency = 0.1 + 0.8 * uniform( generator ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				int const g = ( uniform( generator ) < frequency ) + ( uniform( generator ) < frequency ) ;
+				if(( i + 3 * v ) % 11 != 0 && i != 0 ) {
+					result[v]( i, g ) = 1 ;
+				}
+			}
+		}
+		return result ;
+	}
+
+	struct TestReader: public genfile::VariantDataReader {
+		TestReader( Matrix const& genotypes ):
+			m_genotypes( genotypes )
+		{}
+
+		TestReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			setter.initialise( m_genotypes.rows(), 2 ) ;
+			for( int i = 0; i < m_genotypes.rows(); ++i ) {
+				if( setter.set_sample( i )) {
+					setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					for( int g = 0; g < 3; ++g ) {
+						setter.set_value( g, m_genotypes( i, g )) ;
+					}
+				}
+			}
+			setter.finalise() ;
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const { return spec == ":genotypes:" ; }
+		void get_supported_specs( SpecSetter setter ) const { setter( ":genotypes:", "Float" ) ; }
+		std::size_t get_number_of_samples() const { return m_genotypes.rows() ; }
+
+	private:
+		Matrix const& m_genotypes ;
+	} ;
+
+	void process( impl::NormaliseGenotypesAndComputeXXtFast* computation, std::vector< Matrix > const& genotypes ) {
+		computation->begin_processing_snps( number_of_samples, genfile::SNPDataSource::Metadata() ) ;
+		for( std::size_t v = 0; v < genotypes.size(); ++v ) {
+			computation->processed_snp(
+				genfile::VariantIdentifyingData( "rs" + genfile::string_utils::to_string( v ) ),
+				genfile::VariantDataReader::SharedPtr( new TestReader( genotypes[v] ))
+			) ;
+		}
+		computation->end_processing_snps() ;
+	}
+
+	struct Tiles {
+		Tiles():
+			values( Matrix::Constant( number_of_samples, number_of_samples, -1000 )),
+			nonmissingness( Matrix::Constant( number_of_samples, number_of_samples, -1 ))
+		{}
+		Matrix values ;
+		Matrix nonmissingness ;
+		std::vector< std::pair< std::size_t, std::size_t > > rows ;
+		std::size_t number_of_snps ;
+	} ;
+
+	void store_tile( Tiles* tiles, std::size_t number_of_snps, pca::LowerTriangularTile const& tile ) {
+		tiles->rows.push_back( std::make_pair( tile.begin_row(), tile.end_row() )) ;
+		tiles->number_of_snps = number_of_snps ;
+		for( std::size_t i = tile.begin_row(); i < tile.end_row(); ++i ) {
+			for( std::size_t j = 0; j <= i; ++j ) {
+				tiles->values( i, j ) = tile.value( i, j ) ;
+				tiles->nonmissingness( i, j ) = tile.nonmissingness( i, j ) ;
+			}
+		}
+	}
+
+	bool equal( double a, double b ) {
+		return ( a == b ) || ( a != a && b != b ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_tiled_kinship_matches_dense ) {
+	std::vector< Matrix > const genotypes = simulate() ;
+	std::size_t const entries = pca::LowerTriangularTile::row_offset( number_of_samples ) ;
+	// Memory used besides the tiles: genotypes and four lookup tables of 2^16 entries.
+	std::size_t const fixed_memory = 2 * number_of_samples * sizeof( uint64_t ) + 4 * 65536 * ( sizeof( double ) + sizeof( int )) ;
+
+	worker::SynchronousWorker synchronous_worker ;
+	worker::QueuedMultiThreadedWorker threaded_worker( 2 ) ;
+	worker::Worker* workers[2] = { &synchronous_worker, &threaded_worker } ;
+
+	for( std::size_t w = 0; w < 2; ++w ) {
+		impl::NormaliseGenotypesAndComputeXXtFast dense( workers[w], 4 ) ;
+		process( &dense, genotypes ) ;
+		Matrix const& expected_values = dense.result() ;
+		Eigen::MatrixXi const& expected_nonmissingness = dense.nonmissingness() ;
+		BOOST_REQUIRE_EQUAL( expected_values.rows(), number_of_samples ) ;
+
+		// Budgets allowing about a fifth of the matrix at once, forcing several passes over spilled
+		// genotypes; the smallest holds just one row per tile.
+		std::size_t const budgets[3] = { fixed_memory + 1, fixed_memory + entries * 12 / 5, fixed_memory + entries * 12 * 2 } ;
+		for( std::size_t b = 0; b < 3; ++b ) {
+			// Spilled genotypes go in a fresh directory, so we can check they are removed.
+			boost::filesystem::path const directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path() ;
+			boost::filesystem::create_directory( directory ) ;
+			std::string const stem = ( directory / "kinship" ).string() ;
+			impl::NormaliseGenotypesAndComputeXXtFast tiled( workers[w], 4 ) ;
+			tiled.set_memory_budget( budgets[b], stem ) ;
+			Tiles tiles ;
+			tiled.send_tiles_to( boost::bind( &store_tile, &tiles, _1, _2 )) ;
+			process( &tiled, genotypes ) ;
+
+			BOOST_CHECK_EQUAL( tiled.result().size(), 0 ) ;
+			BOOST_CHECK_EQUAL( tiles.number_of_snps, dense.number_of_snps_included() ) ;
+			// Tiles cover each row exactly once.
+			std::vector< int > covered( number_of_samples, 0 ) ;
+			for( std::size_t t = 0; t < tiles.rows.size(); ++t ) {
+				for( std::size_t i = tiles.rows[t].first; i < tiles.rows[t].second; ++i ) {
+					++covered[i] ;
+				}
+			}
+			BOOST_CHECK( covered == std::vector< int >( number_of_samples, 1 )) ;
+			if( b < 2 ) {
+				BOOST_CHECK_GT( tiles.rows.size(), workers[w]->get_number_of_worker_threads() ) ;
+			}
+
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				for( std::size_t j = 0; j <= i; ++j ) {
+					BOOST_CHECK_EQUAL( tiles.nonmissingness( i, j ), expected_nonmissingness( i, j )) ;
+					BOOST_CHECK( equal( tiles.values( i, j ), expected_values( i, j ))) ;
+				}
+			}
+			BOOST_CHECK( boost::filesystem::is_empty( directory )) ;
+			boost::filesystem::remove_all( directory ) ;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,288 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <limits>
+#include <boost/bind.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/CategoricalCohortIndividualSource.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "appcontext/CmdLineUIContext.hpp"
+#include "worker/QueuedMultiThreadedWorker.hpp"
+#include "components/RelatednessComponent/PCALoadingComputer.hpp"
+#include "components/RelatednessComponent/PCAProjector.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_pca_blocking )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	typedef Eigen::VectorXd Vector ;
+	double const NA = std::numeric_limits< double >::quiet_NaN() ;
+	std::size_t const number_of_samples = 30 ;
+	// Not a multiple of the block size used below, so the last block is partial.
+	std::size_t const number_of_variants = 37 ;
+	std::size_t const number_of_components = 3 ;
+	std::size_t const block_size = 8 ;
+
+	// Hard-called genotypes with some missing; variant 5 is monomorphic.
+	struct Data {
+		Data():
+			genotypes( number_of_variants, Matrix::Zero( number_of_samples, 3 ))
+		{
+			std::mt19937 generator( 17 ) ;
+			std::uniform_real_distribution< double > uniform ;
+			for( std::size_t v = 0; v < number_of_variants; ++v ) {
+				double const frequency = ( v == 5 ) ? 0 : ( 0.05 + 0.9 * uniform( generator )) ;
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					int const g = ( uniform( generator ) < frequency ) + ( uniform( generator ) < frequency ) ;
+					if(( i + 2 * v ) % 7 != 0 ) {
+						genotypes[v]( i, g ) = 1 ;
+					}
+				}
+			}
+			udut = Matrix::Zero( number_of_samples, number_of_samples + 1 ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				udut( i, 0 ) = 0.5 + uniform( generator ) ;
+				for( std::size_t j = 1; j <= number_of_samples; ++j ) {
+					udut( i, j ) = uniform( generator ) - 0.5 ;
+				}
+			}
+		}
+
+		std::vector< Matrix > genotypes ;
+		Matrix udut ;
+	} ;
+
+	struct TestReader: public genfile::VariantDataReader {
+		TestReader( Matrix const& genotypes ):
+			m_genotypes( genotypes )
+		{}
+
+		TestReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			setter.initialise( m_genotypes.rows(), 2 ) ;
+			for( int i = 0; i < m_genotypes.rows(); ++i ) {
+				if( setter.set_sample( i )) {
+					setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					for( int g = 0; g < 3; ++g ) {
+						setter.set_value( g, m_genotypes( i, g )) ;
+					}
+				}
+			}
+			setter.finalise() ;
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const { return spec == ":genotypes:" ; }
+		void get_supported_specs( SpecSetter setter ) const { setter( ":genotypes:", "Float" ) ; }
+		std::size_t get_number_of_samples() const { return m_genotypes.rows() ; }
+
+	private:
+		Matrix const& m_genotypes ;
+	} ;
+
+	genfile::VariantIdentifyingData get_variant( std::size_t v ) {
+		return genfile::VariantIdentifyingData(
+			"rs" + genfile::string_utils::to_string( v ),
+			genfile::GenomePosition( genfile::Chromosome( "1" ), 1000 + v ),
+			"A", "G"
+		) ;
+	}
+
+	// Genotype calls and non-missingness of one variant.
+	void get_calls( Matrix const& genotypes, Vector* calls, Vector* non_missingness ) {
+		calls->resize( number_of_samples ) ;
+		non_missingness->resize( number_of_samples ) ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			(*non_missingness)(i) = genotypes.row(i).sum() ;
+			(*calls)(i) = genotypes( i, 1 ) + 2 * genotypes( i, 2 ) ;
+		}
+	}
+
+	// Standardised genotypes, zero where missing.
+	Vector standardise( Vector const& calls, Vector const& non_missingness, double frequency ) {
+		return ( calls.array() - 2 * frequency ).matrix().cwiseProduct( non_missingness ) / std::sqrt( 2 * frequency * ( 1 - frequency )) ;
+	}
+
+	// Pearson correlation of x and y over samples where mask is nonzero.
+	double correlation( Vector const& x, Vector const& y, Vector const& mask ) {
+		double const n = mask.sum() ;
+		double const mean_x = x.cwiseProduct( mask ).sum() / n ;
+		double const mean_y = y.cwiseProduct( mask ).sum() / n ;
+		Vector const dx = ( x.array() - mean_x ).matrix().cwiseProduct( mask ) ;
+		Vector const dy = ( y.array() - mean_y ).matrix().cwiseProduct( mask ) ;
+		return dx.dot( dy ) / std::sqrt( dx.squaredNorm() * dy.squaredNorm() ) ;
+	}
+
+	struct Loadings {
+		std::vector< std::string > snps ;
+		std::vector< double > counts ;
+		std::vector< double > frequencies ;
+		std::vector< Vector > values ;
+	} ;
+
+	void store_loading(
+		Loadings* loadings,
+		genfile::VariantIdentifyingData const& snp,
+		double const count,
+		double const frequency,
+		Vector const& values,
+		PCALoadingComputer::GetNames
+	) {
+		loadings->snps.push_back( snp.get_primary_id() ) ;
+		loadings->counts.push_back( count ) ;
+		loadings->frequencies.push_back( frequency ) ;
+		loadings->values.push_back( values ) ;
+	}
+
+	void store_projections( Matrix* result, std::string, Matrix const& projections, pca::PCAProjector::GetNames, pca::PCAProjector::GetNames ) {
+		*result = projections ;
+	}
+
+	bool close( double a, double b ) {
+		if( a != a || b != b ) {
+			return ( a != a ) && ( b != b ) ;
+		}
+		return std::abs( a - b ) <= 1e-10 * std::max( 1.0, std::abs( b )) ;
+	}
+}
+
+AUTO_TEST_CASE( test_blocked_loadings_match_per_snp ) {
+	Data const data ;
+	Vector const D = data.udut.col( 0 ).head( number_of_components ) ;
+	Matrix const U = data.udut.block( 0, 1, number_of_samples, number_of_components ) ;
+
+	// Expected loadings and correlations, computed one variant at a time.
+	Loadings expected ;
+	for( std::size_t v = 0; v < number_of_variants; ++v ) {
+		Vector calls, non_missingness ;
+		get_calls( data.genotypes[v], &calls, &non_missingness ) ;
+		double const count = non_missingness.sum() ;
+		double const frequency = calls.sum() / ( 2 * count ) ;
+		Vector values = Vector::Constant( 2 * number_of_components, NA ) ;
+		if( frequency > 0.001 ) {
+			Vector const x = standardise( calls, non_missingness, frequency ) ;
+			values.head( number_of_components ) = ( x.transpose() * U ).transpose().cwiseQuotient( D.cwiseSqrt() ) / std::sqrt( double( number_of_variants )) ;
+			for( std::size_t k = 0; k < number_of_components; ++k ) {
+				values( number_of_components + k ) = correlation( x, U.col(k), non_missingness ) ;
+			}
+		}
+		expected.snps.push_back( get_variant( v ).get_primary_id() ) ;
+		expected.counts.push_back( count ) ;
+		expected.frequencies.push_back( frequency ) ;
+		expected.values.push_back( values ) ;
+	}
+	BOOST_REQUIRE( expected.values[5]( 0 ) != expected.values[5]( 0 ) ) ;
+
+	// Unthreaded with one variant per block, and threaded with a partial final block.
+	worker::QueuedMultiThreadedWorker threaded_worker( 3 ) ;
+	worker::Worker* workers[2] = { 0, &threaded_worker } ;
+	std::size_t const block_sizes[2] = { 1, block_size } ;
+	for( std::size_t t = 0; t < 2; ++t ) {
+		PCALoadingComputer computer( number_of_components, workers[t], block_sizes[t] ) ;
+		computer.set_UDUT( number_of_variants, data.udut ) ;
+		Loadings loadings ;
+		computer.send_results_to( boost::bind( &store_loading, &loadings, _1, _2, _3, _4, _5 )) ;
+		computer.begin_processing_snps( number_of_samples, genfile::SNPDataSource::Metadata() ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			TestReader reader( data.genotypes[v] ) ;
+			computer.processed_snp( get_variant( v ), reader ) ;
+		}
+		computer.end_processing_snps() ;
+
+		BOOST_REQUIRE_EQUAL( loadings.snps.size(), number_of_variants ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			BOOST_CHECK_EQUAL( loadings.snps[v], expected.snps[v] ) ;
+			BOOST_CHECK_EQUAL( loadings.counts[v], expected.counts[v] ) ;
+			BOOST_CHECK( close( loadings.frequencies[v], expected.frequencies[v] )) ;
+			BOOST_REQUIRE_EQUAL( loadings.values[v].size(), 2 * number_of_components ) ;
+			for( std::size_t k = 0; k < 2 * number_of_components; ++k ) {
+				BOOST_CHECK( close( loadings.values[v]( k ), expected.values[v]( k ))) ;
+			}
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_blocked_projections_match_per_snp ) {
+	Data const data ;
+	appcontext::CmdLineUIContext ui_context ;
+	std::ostringstream sample_file ;
+	sample_file << "ID_1 ID_2 missing\n0 0 0\n" ;
+	for( std::size_t i = 0; i < number_of_samples; ++i ) {
+		sample_file << "sample_" << i << " sample_" << i << " 0\n" ;
+	}
+	std::istringstream sample_stream( sample_file.str() ) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_stream ) ;
+
+	// Loadings for all variants, with frequencies that exclude variant 5 and NaN loadings for variant 9.
+	std::mt19937 generator( 23 ) ;
+	std::uniform_real_distribution< double > uniform ;
+	std::vector< genfile::VariantIdentifyingData > snps ;
+	Vector counts( number_of_variants ) ;
+	Vector frequencies( number_of_variants ) ;
+	Matrix loadings( number_of_variants, number_of_components ) ;
+	for( std::size_t v = 0; v < number_of_variants; ++v ) {
+		snps.push_back( get_variant( v )) ;
+		counts(v) = number_of_samples ;
+		frequencies(v) = ( v == 5 ) ? 0 : ( 0.1 + 0.8 * uniform( generator )) ;
+		for( std::size_t k = 0; k < number_of_components; ++k ) {
+			loadings( v, k ) = ( v == 9 ) ? NA : ( uniform( generator ) - 0.5 ) ;
+		}
+	}
+	std::vector< std::string > names ;
+	for( std::size_t k = 0; k < number_of_components; ++k ) {
+		names.push_back( "PC" + genfile::string_utils::to_string( k + 1 )) ;
+	}
+
+	// Expected projections, accumulated one variant at a time.
+	Matrix expected = Matrix::Zero( number_of_samples, number_of_components ) ;
+	Vector visited = Vector::Zero( number_of_samples ) ;
+	for( std::size_t v = 0; v < number_of_variants; ++v ) {
+		if( v != 5 && v != 9 ) {
+			Vector calls, non_missingness ;
+			get_calls( data.genotypes[v], &calls, &non_missingness ) ;
+			expected += standardise( calls, non_missingness, frequencies(v) ) * loadings.row(v) ;
+			visited += non_missingness ;
+		}
+	}
+	for( std::size_t k = 0; k < number_of_components; ++k ) {
+		expected.col(k).array() /= visited.array().sqrt() ;
+	}
+
+	worker::QueuedMultiThreadedWorker threaded_worker( 3 ) ;
+	worker::Worker* workers[2] = { 0, &threaded_worker } ;
+	std::size_t const block_sizes[2] = { 1, block_size } ;
+	for( std::size_t t = 0; t < 2; ++t ) {
+		pca::PCAProjector::UniquePtr projector = pca::PCAProjector::create(
+			samples, ui_context, genfile::VariantIdentifyingData::CompareFields( "position,alleles" ), workers[t], block_sizes[t]
+		) ;
+		projector->set_loadings( snps, counts, frequencies, loadings, names ) ;
+		Matrix projections ;
+		projector->send_results_to( boost::bind( &store_projections, &projections, _1, _2, _3, _4 )) ;
+		projector->begin_processing_snps( number_of_samples, genfile::SNPDataSource::Metadata() ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			TestReader reader( data.genotypes[v] ) ;
+			projector->processed_snp( get_variant( v ), reader ) ;
+		}
+		projector->end_processing_snps() ;
+
+		BOOST_REQUIRE_EQUAL( projections.rows(), number_of_samples ) ;
+		BOOST_REQUIRE_EQUAL( projections.cols(), number_of_components ) ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			for( std::size_t k = 0; k < number_of_components; ++k ) {
+				BOOST_CHECK( close( projections( i, k ), expected( i, k ))) ;
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,200 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <set>
+#include <fstream>
+#include <cstring>
+#include <random>
+#include <boost/bind.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <Eigen/Core>
+#include "genfile/FileUtils.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "genfile/db/Connection.hpp"
+#include "genfile/db/SQLStatement.hpp"
+#include "components/RelatednessComponent/LowerTriangularTile.hpp"
+#include "components/RelatednessComponent/SparseMatrixWriter.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_sparse_matrix_writer )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	std::size_t const N = 12 ;
+	double const threshold = 0.5 ;
+	// A record (i, j, count, value).
+	typedef boost::tuple< uint32_t, uint32_t, int32_t, double > Record ;
+
+	genfile::VariantEntry get_name( std::size_t i ) {
+		return "sample_" + genfile::string_utils::to_string( i ) ;
+	}
+
+	Matrix random_matrix( unsigned int seed ) {
+		std::mt19937 generator( seed ) ;
+		std::uniform_real_distribution< double > uniform ;
+		Matrix result( N, N ) ;
+		for( std::size_t i = 0; i < N; ++i ) {
+			for( std::size_t j = 0; j < N; ++j ) {
+				result( i, j ) = uniform( generator ) ;
+			}
+		}
+		return result ;
+	}
+
+	// Write the matrix as three tiles, out of order, and close the writer if asked.
+	std::size_t write( std::string const& filename, Matrix const& values, Matrix const& counts, bool close ) {
+		pca::SparseMatrixWriter::UniquePtr writer = pca::SparseMatrixWriter::create(
+			filename, N, threshold, &get_name, "test", "A sparse matrix"
+		) ;
+		std::size_t const boundaries[4] = { 0, 5, 9, N } ;
+		std::size_t const order[3] = { 1, 0, 2 } ;
+		for( std::size_t t = 0; t < 3; ++t ) {
+			pca::LowerTriangularTile tile( boundaries[ order[t] ], boundaries[ order[t] + 1 ] ) ;
+			for( std::size_t i = tile.begin_row(); i < tile.end_row(); ++i ) {
+				for( std::size_t j = 0; j <= i; ++j ) {
+					tile.value( i, j ) = values( i, j ) ;
+					tile.nonmissingness( i, j ) = counts( i, j ) ;
+				}
+			}
+			writer->write_tile( 33, tile ) ;
+		}
+		if( close ) {
+			writer->close() ;
+		}
+		return writer->number_of_pairs_written() ;
+	}
+
+	std::set< Record > expected_records( Matrix const& values, Matrix const& counts ) {
+		std::set< Record > result ;
+		for( std::size_t i = 0; i < N; ++i ) {
+			for( std::size_t j = 0; j < i; ++j ) {
+				if( values( i, j ) > threshold ) {
+					result.insert( Record( i, j, counts( i, j ), values( i, j ))) ;
+				}
+			}
+		}
+		return result ;
+	}
+
+	std::string read_string( std::istream& stream ) {
+		uint32_t size = 0 ;
+		genfile::read_little_endian_integer( stream, &size ) ;
+		std::vector< char > buffer( size ) ;
+		stream.read( &buffer[0], size ) ;
+		return std::string( buffer.begin(), buffer.end() ) ;
+	}
+
+	std::vector< std::string > get_index_names( genfile::db::Connection& connection ) {
+		std::vector< std::string > result ;
+		genfile::db::Connection::StatementPtr statement = connection.get_statement(
+			"SELECT name FROM sqlite_master WHERE type == 'index' AND tbl_name == 'Relatedness' ORDER BY name"
+		) ;
+		while( statement->step() ) {
+			result.push_back( statement->get_column< std::string >( 0 )) ;
+		}
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_binary_records ) {
+	Matrix const values = random_matrix( 1 ) ;
+	Matrix const counts = ( random_matrix( 2 ) * 100 ).array().floor().matrix() ;
+	std::set< Record > const expected = expected_records( values, counts ) ;
+	BOOST_REQUIRE( expected.size() > 0 ) ;
+
+	std::string const filename = genfile::create_temporary_filename() ;
+	BOOST_CHECK_EQUAL( write( filename, values, counts, true ), expected.size() ) ;
+
+	std::ifstream stream( filename.c_str(), std::ios::binary ) ;
+	char magic[8] ;
+	stream.read( magic, 8 ) ;
+	BOOST_CHECK_EQUAL( std::string( magic, magic + 8 ), "QCSPARSE" ) ;
+	uint32_t version = 0, reserved = 1 ;
+	uint64_t number_of_samples = 0, number_of_snps = 0, number_of_records = 0 ;
+	genfile::read_little_endian_integer( stream, &version ) ;
+	genfile::read_little_endian_integer( stream, &reserved ) ;
+	genfile::read_little_endian_integer( stream, &number_of_samples ) ;
+	genfile::read_little_endian_integer( stream, &number_of_snps ) ;
+	genfile::read_little_endian_integer( stream, &number_of_records ) ;
+	BOOST_CHECK_EQUAL( version, uint32_t( pca::SparseMatrixWriter::version )) ;
+	BOOST_CHECK_EQUAL( reserved, 0 ) ;
+	BOOST_CHECK_EQUAL( number_of_samples, N ) ;
+	BOOST_CHECK_EQUAL( number_of_snps, 33 ) ;
+	BOOST_CHECK_EQUAL( number_of_records, expected.size() ) ;
+	BOOST_CHECK( read_string( stream ).find( "A sparse matrix" ) != std::string::npos ) ;
+	uint32_t number_of_ids = 0 ;
+	genfile::read_little_endian_integer( stream, &number_of_ids ) ;
+	BOOST_REQUIRE_EQUAL( number_of_ids, N ) ;
+	for( std::size_t i = 0; i < N; ++i ) {
+		BOOST_CHECK_EQUAL( read_string( stream ), get_name( i ).as< std::string >() ) ;
+	}
+
+	std::set< Record > records ;
+	char buffer[ pca::SparseMatrixWriter::record_size ] ;
+	while( stream.read( buffer, pca::SparseMatrixWriter::record_size )) {
+		uint8_t const* p = reinterpret_cast< uint8_t const* >( buffer ) ;
+		uint8_t const* const end = p + pca::SparseMatrixWriter::record_size ;
+		Record record ;
+		p = genfile::read_little_endian_integer( p, end, &record.get<0>() ) ;
+		p = genfile::read_little_endian_integer( p, end, &record.get<1>() ) ;
+		p = genfile::read_little_endian_integer( p, end, &record.get<2>() ) ;
+		std::memcpy( &record.get<3>(), p, sizeof( double )) ;
+		records.insert( record ) ;
+	}
+	BOOST_CHECK_EQUAL( stream.gcount(), 0 ) ;
+	BOOST_CHECK( records == expected ) ;
+	boost::filesystem::remove( filename ) ;
+}
+
+AUTO_TEST_CASE( test_sqlite ) {
+	Matrix const values = random_matrix( 3 ) ;
+	Matrix const counts = ( random_matrix( 4 ) * 100 ).array().floor().matrix() ;
+	std::set< Record > const expected = expected_records( values, counts ) ;
+
+	// The table is indexed only when the writer is closed.
+	for( int close = 0; close < 2; ++close ) {
+		std::string const filename = genfile::create_temporary_filename() + ".sqlite" ;
+		BOOST_CHECK_EQUAL( write( filename, values, counts, close ), expected.size() ) ;
+
+		genfile::db::Connection::UniquePtr connection = genfile::db::Connection::create( filename ) ;
+		std::set< Record > records ;
+		genfile::db::Connection::StatementPtr statement = connection->get_statement(
+			"SELECT sample_1, sample_2, pairwise_complete_obs, value FROM Relatedness"
+		) ;
+		while( statement->step() ) {
+			std::string const sample_1 = statement->get_column< std::string >( 0 ) ;
+			std::string const sample_2 = statement->get_column< std::string >( 1 ) ;
+			records.insert(
+				Record(
+					genfile::string_utils::to_repr< uint32_t >( sample_1.substr( 7 )),
+					genfile::string_utils::to_repr< uint32_t >( sample_2.substr( 7 )),
+					statement->get_column< int >( 2 ),
+					statement->get_column< double >( 3 )
+				)
+			) ;
+		}
+		statement.reset() ;
+		BOOST_CHECK( records == expected ) ;
+
+		std::vector< std::string > const indices = get_index_names( *connection ) ;
+		if( close ) {
+			BOOST_REQUIRE_EQUAL( indices.size(), 2 ) ;
+			BOOST_CHECK_EQUAL( indices[0], "RelatednessSample1Index" ) ;
+			BOOST_CHECK_EQUAL( indices[1], "RelatednessSample2Index" ) ;
+		} else {
+			BOOST_CHECK_EQUAL( indices.size(), 0 ) ;
+		}
+		connection.reset() ;
+		boost::filesystem::remove( filename ) ;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,11 +10,21 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
 #include "genfile/CohortIndividualSource.hpp"
 #include "appcontext/OptionProcessor.hpp"
+#include "metro/SampleRange.hpp"
+#include "metro/concurrency/threadpool.hpp"
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
 
 namespace stats {
+	// Test for association between additive genotype dosage and a binary phenotype,
+	// using logistic regression with covariates.
+	// The null model (covariates only) is fit once.  Variants are then processed in blocks:
+	// score statistics for a whole block are computed as matrix products against the null model
+	// residuals, and the full model is fit by maximum likelihood only for variants whose score test
+	// P-value is below the refit threshold.  Blocks are split across the threads of a pool, if requested.
 	struct AssociationTest: public SNPSummaryComputation {
 		typedef Eigen::VectorXd Vector ;
 		typedef Eigen::MatrixXd Matrix ;
@@ -27,7 +37,66 @@ namespace stats {
 			appcontext::OptionProcessor const& options
 		) ;
 
+		AssociationTest(
+			std::string const& phenotype_name,
+			std::vector< std::string > const& covariate_names,
+			genfile::CohortIndividualSource const& samples,
+			std::size_t block_size,
+			double refit_threshold,
+			std::size_t number_of_threads
+		) ;
+
+		void operator()( VariantIdentifyingData const&, Genotypes const&, Ploidy const&, genfile::VariantDataReader&, ResultCallback ) ;
+		std::size_t block_size() const { return m_block_size ; }
+		void flush() ;
+		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
+
+	public:
+		// Results for one variant.
+		struct Result {
+			double score_beta ;
+			double score_se ;
+			double score_pvalue ;
+			bool refit ;
+			bool converged ;
+			double beta ;
+			double se ;
+			double pvalue ;
+		} ;
+
+	private:
+		std::string const m_phenotype_name ;
+		std::vector< std::string > const m_covariate_names ;
+		std::size_t const m_number_of_samples ;
+		std::size_t const m_block_size ;
+		double const m_refit_threshold ;
+		std::size_t const m_number_of_threads ;
+		// Threads used to test each block, or null if only one thread is used.
+		metro::concurrency::threadpool::UniquePtr m_pool ;
+
+		// Outcome (two columns, control and case) and covariates for all samples.
+		Matrix m_outcome ;
+		Matrix m_covariates ;
+		std::vector< std::string > m_covariate_column_names ;
+		// Samples with nonmissing phenotype and covariates, as ranges and as a list of indices.
+		std::vector< metro::SampleRange > m_included_ranges ;
+		std::vector< int > m_included_samples ;
+
+		// Null model fit, restricted to included samples.
+		Vector m_null_parameters ;
+		Matrix m_null_design ;
+		Vector m_null_residuals ;
+		Vector m_null_weights ;
+		Eigen::LLT< Matrix > m_null_information ;
+
+		// Dosages of variants in the current block (included samples x variants), with NaN for missing values.
+		Matrix m_dosages ;
+		std::vector< ResultCallback > m_callbacks ;
+
 	private:
+		void fit_null_model( genfile::CohortIndividualSource const& samples ) ;
+		void test( int begin, int end, std::vector< Result >* results ) const ;
+		void refit( Vector const& dosage, Result* result ) const ;
 	} ;
 }
 
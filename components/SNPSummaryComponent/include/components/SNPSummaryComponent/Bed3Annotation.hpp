@@ -11,8 +11,10 @@
 #include <map>
 #include <deque>
 #include <boost/function.hpp>
+#include <boost/optional.hpp>
 #include <boost/icl/interval_set.hpp>
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
+#include "components/SNPSummaryComponent/GenomeIntervalIndex.hpp"
 #include "genfile/Chromosome.hpp"
 #include "genfile/VariantEntry.hpp"
 #include "genfile/wildcard.hpp"
@@ -24,6 +26,8 @@ namespace stats {
 	// Filenames of BED files are passed in using the add_annotation() function.
 	// This class translates between BED style 0-based, half-open coordinates
 	// and the 1-based coordinates used in qctool implicitly.
+	// Intervals are flattened into a GenomeIntervalIndex per annotation, so that a stream of
+	// position-sorted variants is annotated by moving a cursor forwards through each index.
 	struct Bed3Annotation: public SNPSummaryComputation
 	{
 	public:
@@ -41,6 +45,10 @@ namespace stats {
 		typedef std::map< std::string, Annotation > AnnotationMap ;
 		AnnotationMap m_annotations ;
 		std::vector< std::string > m_annotation_names ;
+		// Entry i holds the intervals of the ith named annotation.
+		std::vector< GenomeIntervalIndex > m_indices ;
+		std::vector< GenomeIntervalIndex::Cursor > m_cursors ;
+		boost::optional< genfile::Chromosome > m_chromosome ;
 	} ;
 }
 
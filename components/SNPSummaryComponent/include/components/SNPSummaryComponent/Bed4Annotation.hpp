@@ -11,8 +11,10 @@
 #include <map>
 #include <deque>
 #include <boost/function.hpp>
+#include <boost/optional.hpp>
 #include <boost/icl/interval_map.hpp>
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
+#include "components/SNPSummaryComponent/GenomeIntervalIndex.hpp"
 #include "genfile/Chromosome.hpp"
 #include "genfile/VariantEntry.hpp"
 #include "genfile/wildcard.hpp"
@@ -24,6 +26,8 @@ namespace stats {
 	// Filenames of BED files are passed in using the add_annotation() function.
 	// This class translates between BED style 0-based, half-open coordinates
 	// and the 1-based coordinates used in qctool implicitly.
+	// As for Bed3Annotation, lookups use a GenomeIntervalIndex per annotation; here each indexed
+	// interval refers to the comma-separated list of values that apply to it.
 	struct Bed4Annotation: public SNPSummaryComputation
 	{
 	public:
@@ -42,6 +46,11 @@ namespace stats {
 		typedef std::map< std::string, Annotation > AnnotationMap ;
 		AnnotationMap m_annotations ;
 		std::vector< std::string > m_annotation_names ;
+		// Entry i holds the intervals of the ith named annotation, and the values they refer to.
+		std::vector< GenomeIntervalIndex > m_indices ;
+		std::vector< std::vector< std::string > > m_values ;
+		std::vector< GenomeIntervalIndex::Cursor > m_cursors ;
+		boost::optional< genfile::Chromosome > m_chromosome ;
 	} ;
 }
 
@@ -11,24 +11,36 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <deque>
+#include <exception>
+#include <iosfwd>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <Eigen/Core>
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/VariantEntry.hpp"
 #include "genfile/VariantDataReader.hpp"
+#include "metro/concurrency/threadpool.hpp"
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
 
 namespace stats {
+	// Fit a multivariate t distribution to the intensities of each genotype cluster by EM.
+	// If number_of_threads > 0, fits are run asynchronously on a thread pool: each variant's
+	// intensities and genotypes are copied into a task, and results are reported in variant order
+	// when flush() is called, which happens at least once per block_size() variants.
 	struct ClusterFitComputation: public SNPSummaryComputation {
 		typedef std::auto_ptr< ClusterFitComputation > UniquePtr ;
 		ClusterFitComputation(
 			double nu,
 			double regularisationVariance = 0.5,
 			double regularisationWeight = 10,
-			double call_threshhold = 0.9
+			double call_threshhold = 0.9,
+			std::size_t number_of_threads = 0
 		) ;
+		~ClusterFitComputation() ;
 		void operator()( VariantIdentifyingData const&, Genotypes const&, Ploidy const&, genfile::VariantDataReader&, ResultCallback ) ;
+		std::size_t block_size() const { return m_block_size ; }
+		void flush() ;
 		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
 		void set_scale( std::string const& scale ) ;
 	private:
@@ -41,8 +53,29 @@ namespace stats {
 		Eigen::MatrixXd const m_regularisingSigma ;
 		double const m_regularisingWeight ;
 		typedef Eigen::MatrixXd IntensityMatrix ;
-		IntensityMatrix m_intensities ;
-		IntensityMatrix m_nonmissingness ;
+
+		// Data and results for the fit at one variant.
+		struct Task {
+			VariantIdentifyingData snp ;
+			Genotypes genotypes ;
+			IntensityMatrix intensities ;
+			IntensityMatrix nonmissingness ;
+			ResultCallback callback ;
+			std::vector< std::pair< std::string, genfile::VariantEntry > > results ;
+			std::string warnings ;
+			std::exception_ptr error ;
+		} ;
+
+		std::size_t const m_block_size ;
+		metro::concurrency::threadpool::UniquePtr m_pool ;
+		// A deque so that references held by running tasks remain valid as tasks are added.
+		std::deque< Task > m_tasks ;
+
+	private:
+		void fit( Task* task ) const ;
+		void fit_clusters( Task& task, std::ostream& warnings, ResultCallback callback ) const ;
+		static void store_result( Task* task, std::string const& name, genfile::VariantEntry const& value ) ;
+		void report( Task const& task ) const ;
 	} ;
 }
 
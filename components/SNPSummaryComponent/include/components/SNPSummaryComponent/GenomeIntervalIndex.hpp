@@ -0,0 +1,71 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef QCTOOL_SNP_SUMMARY_COMPONENT_GENOME_INTERVAL_INDEX_HPP
+#define QCTOOL_SNP_SUMMARY_COMPONENT_GENOME_INTERVAL_INDEX_HPP
+
+#include <map>
+#include <vector>
+#include <limits>
+#include <utility>
+#include "genfile/Chromosome.hpp"
+#include "genfile/GenomePosition.hpp"
+
+namespace stats {
+	// A set of disjoint intervals on the genome, each carrying a value, stored as a flat
+	// sorted array per chromosome.
+	// Lookups go through a Cursor which remembers where the last lookup ended.  For a stream of
+	// positions sorted within each chromosome the cursor moves forwards only, so each lookup takes
+	// amortised constant time; positions out of order are handled by binary search.
+	struct GenomeIntervalIndex {
+	public:
+		typedef genfile::Position Position ;
+		static std::size_t const npos = std::numeric_limits< std::size_t >::max() ;
+
+		struct Cursor {
+			Cursor(): m_begin( 0 ), m_end( 0 ), m_index( 0 ), m_last_position( 0 ) {}
+		private:
+			friend struct GenomeIntervalIndex ;
+			std::size_t m_begin ;
+			std::size_t m_end ;
+			std::size_t m_index ;
+			Position m_last_position ;
+		} ;
+
+	public:
+		GenomeIntervalIndex() ;
+
+		// Add the interval of positions [start, end) with the given value.
+		// Intervals must be added in order of position within each chromosome and must not overlap;
+		// intervals of each chromosome must be added contiguously.
+		void add( genfile::Chromosome const& chromosome, Position start, Position end, std::size_t value ) ;
+		void clear() ;
+
+		std::size_t size() const { return m_intervals.size() ; }
+
+		// Point the cursor at the start of the given chromosome.
+		// This must be called before looking up positions on a different chromosome.
+		void seek( genfile::Chromosome const& chromosome, Cursor* cursor ) const ;
+		// Return the value of the interval containing the given position on the cursor's chromosome,
+		// or npos if there is none.
+		std::size_t find( Position position, Cursor* cursor ) const ;
+
+	private:
+		struct Interval {
+			Position start ;
+			Position end ;
+			std::size_t value ;
+		} ;
+		std::vector< Interval > m_intervals ;
+		typedef std::map< genfile::Chromosome, std::pair< std::size_t, std::size_t > > ChromosomeRanges ;
+		ChromosomeRanges m_chromosome_ranges ;
+
+	private:
+		std::size_t upper_bound( Position position, std::size_t begin, std::size_t end ) const ;
+	} ;
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include "metro/likelihood/Multinomial.hpp"
 #include "components/SNPSummaryComponent/SNPHWE.hpp"
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
+#include "components/SNPSummaryComponent/StratifiedGenotypeSums.hpp"
 
 namespace stats {
 	struct HWEComputation: public stats::SNPSummaryComputation
@@ -23,6 +24,16 @@ namespace stats {
 		HWEComputation() ;
 	
 		void operator()( VariantIdentifyingData const& snp, Genotypes const& genotypes, Ploidy const& ploidy, genfile::VariantDataReader&, ResultCallback callback ) ;
+		bool can_compute_by_stratum() const { return true ; }
+		void compute_by_stratum(
+			VariantIdentifyingData const& snp,
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			genfile::VariantDataReader&,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata,
+			StratifiedResultCallback callback
+		) ;
 		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
 
 	private:
@@ -30,11 +41,18 @@ namespace stats {
 		void autosomal_exact_test( VariantIdentifyingData const& snp, Eigen::VectorXd const& genotype_counts, ResultCallback callback ) ;
 		void autosomal_multinomial_test( VariantIdentifyingData const& snp, Eigen::VectorXd const& genotype_counts, ResultCallback callback ) ;
 		void X_chromosome_test( VariantIdentifyingData const& snp, Genotypes const& genotypes, Ploidy const& ploidy, ResultCallback callback ) ;
+		// genotype_counts has a row of male and a row of female call counts.
+		void X_chromosome_test( VariantIdentifyingData const& snp, Eigen::MatrixXd const& genotype_counts, ResultCallback callback ) ;
+		// Add the call of sample i, if any, to the given row of counts.
+		void count_call( Genotypes const& genotypes, int const i, Eigen::MatrixXd* counts, int const row ) const ;
 
 	private:
 		double const m_threshhold ;
 		boost::math::chi_squared_distribution< double > m_chi_squared_1df ;	
 		boost::math::chi_squared_distribution< double > m_chi_squared_2df ;	
+		HWEExactTest m_exact_test ;
+		StratifiedGenotypeSums m_sums ;
+		Eigen::MatrixXd m_stratified_call_counts ;
 	} ;	
 }
 
@@ -9,6 +9,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <Eigen/Core>
@@ -18,6 +19,7 @@
 #include "appcontext/OptionProcessor.hpp"
 #include "metro/SampleRange.hpp"
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
+#include "components/SNPSummaryComponent/StratifiedGenotypeSums.hpp"
 
 namespace stats {
 	namespace impl {
@@ -26,6 +28,7 @@ namespace stats {
 			typedef SNPSummaryComputation::VariantIdentifyingData VariantIdentifyingData ;
 			typedef SNPSummaryComputation::Genotypes Genotypes ;
 			typedef SNPSummaryComputation::Ploidy Ploidy ;
+			typedef SNPSummaryComputation::SampleStrata SampleStrata ;
 
 		public:
 			InfoComputation() ;
@@ -43,12 +46,31 @@ namespace stats {
 				std::vector< metro::SampleRange > const& included_samples 
 			) ;
 		
+			// Compute info for each stratum of samples, in two sweeps over the samples.
+			void compute_by_stratum(
+				VariantIdentifyingData const& snp,
+				Genotypes const& genotypes,
+				Ploidy const& ploidy,
+				SampleStrata const& sample_strata,
+				std::size_t number_of_strata
+			) ;
+
 			double info() const { return m_info ;}
 			double impute_info() const { return m_impute_info ;}
+			// Results of compute_by_stratum().
+			double info( std::size_t stratum ) const { return m_stratum_info[ stratum ] ;}
+			double impute_info( std::size_t stratum ) const { return m_stratum_impute_info[ stratum ] ;}
 
 		private:
 			double m_info ;
 			double m_impute_info ;
+			std::vector< double > m_stratum_info ;
+			std::vector< double > m_stratum_impute_info ;
+			// Per-stratum working storage for compute_by_stratum().
+			StratifiedGenotypeSums m_sums ;
+			std::vector< double > m_theta ;
+			std::vector< double > m_autosomal_theta ;
+			Eigen::MatrixXd m_info_terms ;
 			Eigen::VectorXd m_diploid_fallback_distribution ;
 			Eigen::VectorXd m_haploid_fallback_distribution ;
 			Eigen::VectorXd const m_diploid_levels ;
@@ -61,6 +83,12 @@ namespace stats {
 				Ploidy const& ploidy,
 				std::vector< metro::SampleRange > const& included_samples 
 			) ;
+			void compute_by_stratum_impl(
+				Genotypes const& genotypes,
+				Ploidy const& ploidy,
+				SampleStrata const& sample_strata,
+				std::size_t number_of_strata
+			) ;
 		} ;
 	}
 
@@ -72,6 +100,16 @@ namespace stats {
 			genfile::VariantDataReader&,
 			ResultCallback callback
 		) ;
+		bool can_compute_by_stratum() const { return true ; }
+		void compute_by_stratum(
+			VariantIdentifyingData const& snp,
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			genfile::VariantDataReader&,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata,
+			StratifiedResultCallback callback
+		) ;
 		
 		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
 		
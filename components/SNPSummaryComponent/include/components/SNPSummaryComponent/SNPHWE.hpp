@@ -9,7 +9,34 @@
 #define QCTOOL_SNP_SUMMARY_COMPONENT_SNPHWE_HPP
 
 #include <cmath>
+#include <cstddef>
+#include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
 
 double SNPHWE(int obs_hets, int obs_hom1, int obs_hom2) ;
 
+namespace stats {
+	// Exact test of Hardy-Weinberg equilibrium (Wigginton et al 2005), computing the same
+	// p-value as SNPHWE() but without allocating.  The heterozygote distribution is walked twice
+	// from its midpoint, first to find the probability of the observed configuration and then
+	// outwards to accumulate the p-value.  Since the distribution is log-concave, each outward
+	// walk stops once a geometric bound on the remaining tail can no longer affect the result
+	// at double precision.
+	// Results are memoised by genotype counts, which pays off for the many rare variants that
+	// share the same counts.  Objects are not thread-safe; use one per thread.
+	struct HWEExactTest {
+	public:
+		HWEExactTest( std::size_t max_cache_size = 100000 ) ;
+		double operator()( int obs_hets, int obs_hom1, int obs_hom2 ) ;
+
+		std::size_t number_of_cache_hits() const { return m_number_of_cache_hits ; }
+
+	private:
+		typedef boost::unordered_map< boost::uint64_t, double > Cache ;
+		std::size_t const m_max_cache_size ;
+		Cache m_cache ;
+		std::size_t m_number_of_cache_hits ;
+	} ;
+}
+
 #endif
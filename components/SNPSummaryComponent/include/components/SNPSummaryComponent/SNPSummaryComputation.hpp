@@ -9,6 +9,8 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <cassert>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <Eigen/Core>
@@ -42,6 +44,44 @@ namespace stats {
 			ResultCallback
 		) = 0 ;
 		virtual void end_processing_snps( PerSampleResultCallback ) {}
+
+		// Computations that process variants in blocks return the number of variants per block here.
+		// They may defer reporting results for a variant until flush() is called.  The manager calls
+		// flush() after each block of variants and before end_processing_snps(), and callbacks passed
+		// to operator() remain valid until then.
+		virtual std::size_t block_size() const { return 1 ; }
+		virtual void flush() {}
+
+		// Computations that can summarise several strata of samples in one sweep over the samples
+		// override the following two methods.
+		// sample_strata[i] is the stratum (0, ..., number_of_strata-1) of sample i, or -1 if sample i is in no stratum.
+		// Results for stratum s are reported as callback( s, name, value ).
+		typedef std::vector< int > SampleStrata ;
+		typedef boost::function< void ( std::size_t stratum, std::string const& value_name, genfile::VariantEntry const& value ) > StratifiedResultCallback ;
+		virtual bool can_compute_by_stratum() const { return false ; }
+		virtual void compute_by_stratum(
+			VariantIdentifyingData const&,
+			Genotypes const&,
+			Ploidy const&,
+			genfile::VariantDataReader&,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata,
+			StratifiedResultCallback
+		) { assert(0) ; }
+
+		// Adapts a StratifiedResultCallback to report results for a single stratum.
+		struct StratumResultCallback {
+			StratumResultCallback( StratifiedResultCallback const& callback, std::size_t stratum ):
+				m_callback( &callback ),
+				m_stratum( stratum )
+			{}
+			void operator()( std::string const& value_name, genfile::VariantEntry const& value ) const {
+				(*m_callback)( m_stratum, value_name, value ) ;
+			}
+		private:
+			StratifiedResultCallback const* m_callback ;
+			std::size_t m_stratum ;
+		} ;
 	} ;
 }
 
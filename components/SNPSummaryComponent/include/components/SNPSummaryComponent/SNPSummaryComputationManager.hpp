@@ -8,6 +8,8 @@
 #define QCTOOL_SNP_SUMMARY_COMPUTATION_MANAGER_HPP
 
 #include <string>
+#include <vector>
+#include <utility>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <boost/signals2/signal.hpp>
@@ -74,7 +76,24 @@ namespace stats {
 		SNPSummaryComputation::Genotypes m_genotypes ;
 		SNPSummaryComputation::Ploidy m_ploidy ;
 
+		// Results held back until a block of variants is complete, if any computation works in blocks.
+		// Values are held in one slot per computation, plus a final slot for the manager's own comments,
+		// so they are output in the same order as they would be if reported directly.
+		struct PendingResults {
+			typedef std::vector< std::pair< std::string, genfile::VariantEntry > > Values ;
+			PendingResults( genfile::VariantIdentifyingData const& snp_, std::size_t number_of_slots ):
+				snp( snp_ ),
+				values( number_of_slots )
+			{}
+			genfile::VariantIdentifyingData snp ;
+			std::vector< Values > values ;
+		} ;
+		std::size_t m_block_size ;
+		std::vector< PendingResults > m_pending ;
+
 	private:
+		void store_pending_result( std::size_t index, std::size_t slot, std::string const& value_name, genfile::VariantEntry const& value ) ;
+		void flush_pending_results() ;
 		std::vector< char > get_sexes( genfile::CohortIndividualSource const& samples, std::string const& sex_column_name ) const ;
 		std::map< char, std::vector< int > > get_samples_by_sex( std::vector< char > const& sex ) const ;
 
@@ -0,0 +1,55 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef QCTOOL_SNP_SUMMARY_COMPONENT_STRATIFIED_GENOTYPE_SUMS_HPP
+#define QCTOOL_SNP_SUMMARY_COMPONENT_STRATIFIED_GENOTYPE_SUMS_HPP
+
+#include <vector>
+#include <Eigen/Core>
+#include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
+
+namespace stats {
+	// Sums of genotype probabilities over the samples in each stratum, broken down by ploidy,
+	// computed in one sweep over the samples.  These are the sufficient statistics for the
+	// per-stratum allele frequency, missingness and autosomal HWE summaries.
+	// Storage is reused between variants.
+	struct StratifiedGenotypeSums {
+	public:
+		typedef SNPSummaryComputation::Genotypes Genotypes ;
+		typedef SNPSummaryComputation::Ploidy Ploidy ;
+		typedef SNPSummaryComputation::SampleStrata SampleStrata ;
+		enum PloidyClass { eUnknownPloidy = 0, eHaploid = 1, eDiploid = 2, eOtherPloidy = 3 } ;
+		enum { eNumberOfPloidyClasses = 4 } ;
+
+	public:
+		void compute( Genotypes const& genotypes, Ploidy const& ploidy, SampleStrata const& sample_strata, std::size_t number_of_strata ) ;
+
+		std::size_t number_of_strata() const { return m_number_of_samples.size() / eNumberOfPloidyClasses ; }
+		// Number of samples in the stratum with the given ploidy class.
+		std::size_t number_of_samples( std::size_t stratum, PloidyClass ploidy_class ) const {
+			return m_number_of_samples[ stratum * eNumberOfPloidyClasses + ploidy_class ] ;
+		}
+		std::size_t number_of_samples( std::size_t stratum ) const ;
+		// Sum of genotype probabilities g (0, 1 or 2) over samples in the stratum with the given ploidy class.
+		double genotype( std::size_t stratum, PloidyClass ploidy_class, int g ) const {
+			return m_sums( stratum * eNumberOfPloidyClasses + ploidy_class, g ) ;
+		}
+		// As above, summed over all ploidy classes.
+		double genotype( std::size_t stratum, int g ) const ;
+		// Sum of all genotype probabilities of samples in the stratum with the given ploidy class.
+		double total( std::size_t stratum, PloidyClass ploidy_class ) const {
+			return m_sums( stratum * eNumberOfPloidyClasses + ploidy_class, 3 ) ;
+		}
+		double total( std::size_t stratum ) const ;
+
+	private:
+		// Row ( stratum * eNumberOfPloidyClasses + class ) holds sums of genotypes 0, 1, 2, and of all genotypes.
+		Eigen::MatrixXd m_sums ;
+		std::vector< std::size_t > m_number_of_samples ;
+	} ;
+}
+
+#endif
@@ -10,21 +10,47 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <boost/unordered_map.hpp>
 #include <Eigen/Core>
 #include "genfile/CohortIndividualSource.hpp"
 #include "genfile/VariantEntry.hpp"
 #include "components/SNPSummaryComponent/SNPSummaryComputation.hpp"
 
 namespace stats {
+	// Runs a computation separately on each stratum of samples, suffixing result names with
+	// "[<stratification name>=<level>]".
+	// Computations that support it summarise all strata in one sweep over the samples; others are
+	// run on a copy of the genotypes of each stratum, with a data reader restricted to that stratum.
+	// Computations that defer results (see SNPSummaryComputation::block_size()) are flushed by the
+	// manager through this class as usual.
 	struct StratifyingSNPSummaryComputation: public SNPSummaryComputation {
 		typedef std::map< genfile::VariantEntry, std::vector< int > > StrataMembers ;
 		StratifyingSNPSummaryComputation( SNPSummaryComputation::UniquePtr computation, std::string const& stratification_name, StrataMembers const& strata_members ) ;
 		void operator()( VariantIdentifyingData const&, Genotypes const&, Ploidy const&, genfile::VariantDataReader&, ResultCallback ) ;
+		std::size_t block_size() const { return m_computation->block_size() ; }
+		void flush() { m_computation->flush() ; }
 		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
 	private:
 		SNPSummaryComputation::UniquePtr m_computation ;
 		std::string const m_stratification_name ;
 		StrataMembers m_strata_members ;
+		// Name suffix for each stratum, in the order of m_strata_members.
+		std::vector< std::string > m_stratum_suffixes ;
+		// Stratum of each sample, or -1, and the index of each sample within its stratum;
+		// built when the number of samples is known.
+		SampleStrata m_sample_strata ;
+		std::vector< int > m_index_in_stratum ;
+		// Suffixed names for each value name reported so far, indexed by stratum.
+		typedef boost::unordered_map< std::string, std::vector< std::string > > ColumnNames ;
+		ColumnNames m_column_names ;
+		// Storage for the genotypes of one stratum, used for computations that can't compute by stratum.
+		Genotypes m_stratum_genotypes ;
+		Ploidy m_stratum_ploidy ;
+
+	private:
+		void compute_strata( std::size_t number_of_samples ) ;
+		std::string const& get_column_name( std::size_t stratum, std::string const& value_name ) ;
+		void report_result( ResultCallback const& callback, std::size_t stratum, std::string const& value_name, genfile::VariantEntry const& value ) ;
 	} ;
 }
 
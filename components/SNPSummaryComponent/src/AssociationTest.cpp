@@ -0,0 +1,435 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/math/distributions/chi_squared.hpp>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include "genfile/Error.hpp"
+#include "genfile/CohortIndividualSource.hpp"
+#include "genfile/CrossCohortCovariateValueMapping.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "metro/constants.hpp"
+#include "metro/fit_model.hpp"
+#include "metro/CholeskyStepper.hpp"
+#include "metro/regression/Design.hpp"
+#include "metro/regression/Logistic.hpp"
+#include "metro/concurrency/threadpool.hpp"
+#include "components/SNPSummaryComponent/AssociationTest.hpp"
+
+// #define DEBUG_ASSOCIATION_TEST 1
+
+namespace {
+	double const NA = std::numeric_limits< double >::quiet_NaN() ;
+	double const tolerance = 0.001 ;
+	int const max_iterations = 100 ;
+
+	double extract_mapped_continuous_value(
+		std::size_t sample_index,
+		genfile::CohortIndividualSource const& samples,
+		std::size_t column_index,
+		genfile::CrossCohortCovariateValueMapping const& mapping
+	) {
+		double value = metro::NA ;
+		genfile::VariantEntry entry = samples.get_entry( sample_index, column_index ) ;
+		if( !entry.is_missing() ) {
+			value = mapping.get_mapped_value( entry ).as< double >() ;
+		}
+		return value ;
+	}
+
+	int extract_mapped_categorical_value(
+		std::size_t sample_index,
+		genfile::CohortIndividualSource const& samples,
+		std::size_t column_index,
+		genfile::CrossCohortCovariateValueMapping const& mapping
+	) {
+		int value = -1 ;
+		genfile::VariantEntry entry = samples.get_entry( sample_index, column_index ) ;
+		if( !entry.is_missing() ) {
+			value = mapping.get_mapped_value( entry ).as< int >() ;
+		}
+		return value ;
+	}
+
+	std::string get_unmapped_level(
+		genfile::CrossCohortCovariateValueMapping const& mapping,
+		int level
+	) {
+		genfile::VariantEntry entry = mapping.get_unmapped_value( level ) ;
+		return entry.as< std::string >() ;
+	}
+
+	// Return the ranges of samples for which the given vector is not NaN.
+	std::vector< metro::SampleRange > compute_nonmissing_ranges( Eigen::VectorXd const& values ) {
+		std::vector< metro::SampleRange > result ;
+		int begin = 0 ;
+		for( int i = 0; i <= values.size(); ++i ) {
+			if( i == values.size() || values(i) != values(i) ) {
+				if( i > begin ) {
+					result.push_back( metro::SampleRange( begin, i )) ;
+				}
+				begin = i + 1 ;
+			}
+		}
+		return result ;
+	}
+
+	genfile::VariantEntry value_or_missing( double value ) {
+		return ( value == value ) ? genfile::VariantEntry( value ) : genfile::VariantEntry() ;
+	}
+
+	double chi_squared_pvalue( double statistic ) {
+		if( statistic != statistic ) {
+			return NA ;
+		}
+		boost::math::chi_squared_distribution< double > chi_squared( 1.0 ) ;
+		return boost::math::cdf( boost::math::complement( chi_squared, statistic )) ;
+	}
+}
+
+namespace stats {
+	AssociationTest::UniquePtr AssociationTest::create(
+		std::string const& type,
+		std::string const& phenotype_name,
+		std::vector< std::string > const& covariate_names,
+		genfile::CohortIndividualSource const& samples,
+		appcontext::OptionProcessor const& options
+	) {
+		if( type != "logistic" ) {
+			throw genfile::BadArgumentError(
+				"stats::AssociationTest::create()",
+				"type=\"" + type + "\"",
+				"Only \"logistic\" association tests are supported."
+			) ;
+		}
+		return UniquePtr(
+			new AssociationTest(
+				phenotype_name,
+				covariate_names,
+				samples,
+				options.get_value< std::size_t >( "-association-block-size" ),
+				options.get_value< double >( "-association-refit-threshold" ),
+				options.get_value< std::size_t >( "-threads" )
+			)
+		) ;
+	}
+
+	AssociationTest::AssociationTest(
+		std::string const& phenotype_name,
+		std::vector< std::string > const& covariate_names,
+		genfile::CohortIndividualSource const& samples,
+		std::size_t block_size,
+		double refit_threshold,
+		std::size_t number_of_threads
+	):
+		m_phenotype_name( phenotype_name ),
+		m_covariate_names( covariate_names ),
+		m_number_of_samples( samples.get_number_of_individuals() ),
+		m_block_size( std::max( block_size, std::size_t( 1 ) )),
+		m_refit_threshold( refit_threshold ),
+		m_number_of_threads( number_of_threads )
+	{
+		if( m_number_of_threads > 1 ) {
+			m_pool = metro::concurrency::threadpool::create( m_number_of_threads ) ;
+		}
+		fit_null_model( samples ) ;
+		m_dosages.resize( m_included_samples.size(), m_block_size ) ;
+		m_callbacks.reserve( m_block_size ) ;
+	}
+
+	void AssociationTest::fit_null_model( genfile::CohortIndividualSource const& samples ) {
+		using metro::regression::Design ;
+		using metro::regression::Logistic ;
+		genfile::CohortIndividualSource::ColumnSpec const spec = samples.get_column_spec() ;
+		if( !spec.check_for_column( m_phenotype_name ) || !spec[ m_phenotype_name ].is_discrete() ) {
+			throw genfile::BadArgumentError(
+				"stats::AssociationTest::fit_null_model()",
+				"phenotype=\"" + m_phenotype_name + "\"",
+				"Expected \"" + m_phenotype_name + "\" to be a binary phenotype (type B in the sample file)."
+			) ;
+		}
+
+		// Outcome is coded as two columns, for controls and cases.
+		Vector phenotype = Vector::Constant( m_number_of_samples, NA ) ;
+		m_outcome = Matrix::Zero( m_number_of_samples, 2 ) ;
+		for( std::size_t i = 0; i < m_number_of_samples; ++i ) {
+			genfile::VariantEntry const entry = samples.get_entry( i, m_phenotype_name ) ;
+			if( !entry.is_missing() ) {
+				int const value = entry.as< int >() ;
+				if( value != 0 && value != 1 ) {
+					throw genfile::BadArgumentError(
+						"stats::AssociationTest::fit_null_model()",
+						"phenotype=\"" + m_phenotype_name + "\"",
+						( boost::format( "Sample %d has phenotype value %d; expected 0 or 1." ) % (i+1) % value ).str()
+					) ;
+				}
+				phenotype(i) = value ;
+				m_outcome( i, value ) = 1 ;
+			}
+		}
+		std::vector< std::string > outcome_names ;
+		outcome_names.push_back( m_phenotype_name + "=0" ) ;
+		outcome_names.push_back( m_phenotype_name + "=1" ) ;
+
+		Design::UniquePtr design = Design::create(
+			m_outcome, compute_nonmissing_ranges( phenotype ), outcome_names,
+			std::vector< std::string >()
+		) ;
+
+		for( std::size_t i = 0; i < m_covariate_names.size(); ++i ) {
+			std::string const& name = m_covariate_names[i] ;
+			if( !spec.check_for_column( name )) {
+				throw genfile::BadArgumentError(
+					"stats::AssociationTest::fit_null_model()",
+					"covariate=\"" + name + "\"",
+					"No column named \"" + name + "\" was found in the sample file."
+				) ;
+			}
+			genfile::CohortIndividualSource::SingleColumnSpec const column_spec = spec[ name ] ;
+			genfile::CrossCohortCovariateValueMapping::UniquePtr mapping
+				= genfile::CrossCohortCovariateValueMapping::create( column_spec, true ) ;
+			mapping->add_source( samples ) ;
+			if( mapping->get_number_of_distinct_mapped_values() == 0 ) {
+				throw genfile::BadArgumentError(
+					"stats::AssociationTest::fit_null_model()",
+					"covariate=\"" + name + "\"",
+					"Covariate \"" + name + "\" has no non-missing levels in this set of samples."
+				) ;
+			}
+			if( column_spec.is_discrete() ) {
+				design->add_discrete_covariate(
+					name,
+					boost::bind( &extract_mapped_categorical_value, _1, boost::cref( samples ), spec.find_column( name ), boost::cref( *mapping ) ),
+					boost::bind( &get_unmapped_level, boost::cref( *mapping ), _1 ),
+					mapping->get_number_of_distinct_mapped_values()
+				) ;
+			} else {
+				design->add_single_covariate(
+					name,
+					boost::bind( &extract_mapped_continuous_value, _1, boost::cref( samples ), spec.find_column( name ), boost::cref( *mapping ) )
+				) ;
+			}
+		}
+
+		// The null model has no predictors, so a single level with probability one.
+		design->set_predictors(
+			Matrix::Zero( 1, 0 ),
+			Matrix::Ones( m_number_of_samples, 1 ),
+			std::vector< metro::SampleRange >( 1, metro::SampleRange( 0, m_number_of_samples ))
+		) ;
+
+		m_included_ranges = design->nonmissing_samples() ;
+		m_included_samples.clear() ;
+		for( std::size_t i = 0; i < m_included_ranges.size(); ++i ) {
+			for( int j = m_included_ranges[i].begin(); j < m_included_ranges[i].end(); ++j ) {
+				m_included_samples.push_back( j ) ;
+			}
+		}
+		if( m_included_samples.size() == 0 ) {
+			throw genfile::BadArgumentError(
+				"stats::AssociationTest::fit_null_model()",
+				"phenotype=\"" + m_phenotype_name + "\"",
+				"No samples have non-missing phenotype and covariate values."
+			) ;
+		}
+
+		Matrix const& design_matrix = design->matrix() ;
+		m_covariates = design_matrix.rightCols( design_matrix.cols() - 1 ) ;
+		m_covariate_column_names.assign( design->design_matrix_column_names().begin() + 1, design->design_matrix_column_names().end() ) ;
+
+		Logistic ll( *design ) ;
+		metro::CholeskyStepper stepper( tolerance, max_iterations ) ;
+		std::pair< bool, int > const fit = metro::fit_model(
+			ll, "null", Vector::Zero( ll.number_of_parameters() ), stepper, 0
+		) ;
+		if( !fit.first ) {
+			throw genfile::OperationFailedError(
+				"stats::AssociationTest::fit_null_model()",
+				"phenotype=\"" + m_phenotype_name + "\"",
+				"fit null model (the model did not converge)"
+			) ;
+		}
+		m_null_parameters = ll.parameters() ;
+
+		// Compute the quantities the score test needs, restricted to included samples.
+		int const N = m_included_samples.size() ;
+		m_null_design.resize( N, design_matrix.cols() ) ;
+		m_null_residuals.resize( N ) ;
+		m_null_weights.resize( N ) ;
+		for( int i = 0; i < N; ++i ) {
+			int const sample_i = m_included_samples[i] ;
+			m_null_design.row(i) = design_matrix.row( sample_i ) ;
+			double const mu = 1.0 / ( 1.0 + std::exp( -design_matrix.row( sample_i ).dot( m_null_parameters ))) ;
+			m_null_residuals(i) = m_outcome( sample_i, 1 ) - mu ;
+			m_null_weights(i) = mu * ( 1.0 - mu ) ;
+		}
+		m_null_information.compute( m_null_design.transpose() * m_null_weights.asDiagonal() * m_null_design ) ;
+
+#if DEBUG_ASSOCIATION_TEST
+		std::cerr << "AssociationTest::fit_null_model(): null parameters: " << m_null_parameters.transpose() << ".\n" ;
+#endif
+	}
+
+	void AssociationTest::operator()(
+		VariantIdentifyingData const&,
+		Genotypes const& genotypes,
+		Ploidy const&,
+		genfile::VariantDataReader&,
+		ResultCallback callback
+	) {
+		assert( m_callbacks.size() < m_block_size ) ;
+		int const column = m_callbacks.size() ;
+		for( std::size_t i = 0; i < m_included_samples.size(); ++i ) {
+			int const sample_i = m_included_samples[i] ;
+			double const sum = genotypes.row( sample_i ).sum() ;
+			m_dosages( i, column ) = ( sum > 0 ) ? (( genotypes( sample_i, 1 ) + 2.0 * genotypes( sample_i, 2 )) / sum ) : NA ;
+		}
+		m_callbacks.push_back( callback ) ;
+		if( m_callbacks.size() == m_block_size ) {
+			flush() ;
+		}
+	}
+
+	void AssociationTest::flush() {
+		int const number_of_variants = m_callbacks.size() ;
+		if( number_of_variants == 0 ) {
+			return ;
+		}
+		std::vector< Result > results( number_of_variants ) ;
+		int const number_of_tasks = m_pool.get() ? std::min( int( m_pool->number_of_threads() ), number_of_variants ) : 1 ;
+		if( number_of_tasks > 1 ) {
+			int const chunk_size = ( number_of_variants + number_of_tasks - 1 ) / number_of_tasks ;
+			for( int begin = 0; begin < number_of_variants; begin += chunk_size ) {
+				int const end = std::min( begin + chunk_size, number_of_variants ) ;
+				m_pool->schedule( [this,begin,end,&results]() { this->test( begin, end, &results ) ; } ) ;
+			}
+			m_pool->wait() ;
+		} else {
+			test( 0, number_of_variants, &results ) ;
+		}
+
+		for( int j = 0; j < number_of_variants; ++j ) {
+			Result const& result = results[j] ;
+			ResultCallback const& callback = m_callbacks[j] ;
+			callback( "add_score_beta", value_or_missing( result.score_beta )) ;
+			callback( "add_score_se", value_or_missing( result.score_se )) ;
+			callback( "add_score_pvalue", value_or_missing( result.score_pvalue )) ;
+			callback( "add_beta", value_or_missing( result.beta )) ;
+			callback( "add_se", value_or_missing( result.se )) ;
+			callback( "add_pvalue", value_or_missing( result.pvalue )) ;
+			callback( "add_converged", result.refit ? genfile::VariantEntry( int( result.converged )) : genfile::VariantEntry() ) ;
+		}
+		m_callbacks.clear() ;
+	}
+
+	// Compute score tests for variants [begin, end) of the current block, and refit those that pass the threshold.
+	// With null model fitted values μ, weights W = μ(1-μ), residuals r = y - μ and null design matrix X,
+	// the score for dosage g is U = gᵗr and its variance is V = gᵗWg - gᵗWX(XᵗWX)⁻¹XᵗWg.
+	void AssociationTest::test( int begin, int end, std::vector< Result >* results ) const {
+		int const N = m_dosages.rows() ;
+		int const B = end - begin ;
+		// Mean-impute missing dosages.
+		Matrix G = m_dosages.middleCols( begin, B ) ;
+		for( int j = 0; j < B; ++j ) {
+			double sum = 0 ;
+			int count = 0 ;
+			for( int i = 0; i < N; ++i ) {
+				if( G(i,j) == G(i,j) ) {
+					sum += G(i,j) ;
+					++count ;
+				}
+			}
+			double const mean = ( count > 0 ) ? ( sum / count ) : 0 ;
+			for( int i = 0; i < N; ++i ) {
+				if( G(i,j) != G(i,j) ) {
+					G(i,j) = mean ;
+				}
+			}
+		}
+
+		Matrix const WG = m_null_weights.asDiagonal() * G ;
+		Vector const U = G.transpose() * m_null_residuals ;
+		Matrix const Z = m_null_information.matrixL().solve( m_null_design.transpose() * WG ) ;
+		Vector const V = G.cwiseProduct( WG ).colwise().sum().transpose() - Z.colwise().squaredNorm().transpose() ;
+
+		for( int j = 0; j < B; ++j ) {
+			Result& result = (*results)[ begin + j ] ;
+			result.refit = false ;
+			result.converged = false ;
+			result.beta = result.se = result.pvalue = NA ;
+			// Monomorphic variants, or variants collinear with covariates, have no information.
+			if( V(j) > 1E-8 * N ) {
+				result.score_beta = U(j) / V(j) ;
+				result.score_se = 1.0 / std::sqrt( V(j) ) ;
+				result.score_pvalue = chi_squared_pvalue( U(j) * U(j) / V(j) ) ;
+				if( result.score_pvalue < m_refit_threshold ) {
+					refit( m_dosages.col( begin + j ), &result ) ;
+				}
+			} else {
+				result.score_beta = result.score_se = result.score_pvalue = NA ;
+			}
+		}
+	}
+
+	// Fit the full model, in which samples with missing dosage are excluded, by maximum likelihood.
+	void AssociationTest::refit( Vector const& dosage, Result* result ) const {
+		using metro::regression::Design ;
+		using metro::regression::Logistic ;
+		Vector predictor = Vector::Constant( m_number_of_samples, NA ) ;
+		for( std::size_t i = 0; i < m_included_samples.size(); ++i ) {
+			predictor( m_included_samples[i] ) = dosage(i) ;
+		}
+		std::vector< metro::SampleRange > const nonmissing_predictor = compute_nonmissing_ranges( predictor ) ;
+		predictor = predictor.unaryExpr( []( double x ) { return ( x == x ) ? x : 0.0 ; } ) ;
+
+		std::vector< std::string > outcome_names ;
+		outcome_names.push_back( m_phenotype_name + "=0" ) ;
+		outcome_names.push_back( m_phenotype_name + "=1" ) ;
+		Design::UniquePtr design = Design::create(
+			m_outcome, m_included_ranges, outcome_names,
+			m_covariates, m_included_ranges, m_covariate_column_names,
+			std::vector< std::string >( 1, "add" )
+		) ;
+		design->set_predictors( predictor, nonmissing_predictor ) ;
+
+		Logistic ll( *design ) ;
+		// Start from the null model estimates, with zero effect of the predictor.
+		Vector start = Vector::Zero( ll.number_of_parameters() ) ;
+		start(0) = m_null_parameters(0) ;
+		start.tail( m_null_parameters.size() - 1 ) = m_null_parameters.tail( m_null_parameters.size() - 1 ) ;
+		metro::CholeskyStepper stepper( tolerance, max_iterations ) ;
+		std::pair< bool, int > const fit = metro::fit_model( ll, "add", start, stepper, 0 ) ;
+
+		result->refit = true ;
+		result->converged = fit.first ;
+		if( fit.first ) {
+			Eigen::LDLT< Matrix > solver( -ll.get_value_of_second_derivative() ) ;
+			Vector const variance = solver.solve( Matrix::Identity( start.size(), start.size() )).diagonal() ;
+			result->beta = ll.parameters()(1) ;
+			result->se = std::sqrt( variance(1) ) ;
+			result->pvalue = chi_squared_pvalue( ( result->beta * result->beta ) / variance(1) ) ;
+		}
+	}
+
+	std::string AssociationTest::get_summary( std::string const& prefix, std::size_t column_width ) const {
+		using genfile::string_utils::to_string ;
+		std::string result = prefix + "AssociationTest: logistic score test for \"" + m_phenotype_name + "\" in blocks of "
+			+ to_string( m_block_size ) + " variants, with refit for P < " + to_string( m_refit_threshold ) ;
+		if( m_covariate_names.size() > 0 ) {
+			result += ", covariates: " + genfile::string_utils::join( m_covariate_names, " " ) ;
+		}
+		result += " (" + to_string( m_included_samples.size() ) + " of " + to_string( m_number_of_samples ) + " samples included)" ;
+		return result ;
+	}
+}
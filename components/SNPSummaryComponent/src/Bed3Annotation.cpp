@@ -7,6 +7,7 @@
 #include <utility>
 #include <map>
 #include <deque>
+#include <algorithm>
 #include <boost/icl/interval_set.hpp>
 #include <boost/function.hpp>
 #include <boost/format.hpp>
@@ -47,19 +48,32 @@ namespace stats {
 			uint32_t end( to_repr< uint32_t >( elts[2] ) ) ;
 		
 			// Bed file is 0-based, right-open.
-			// We store annotations as 1-based, closed intervals.
-			// Therefore add 1 to start coord.
+			// We store annotations as 1-based, right-open intervals.
+			// Therefore add 1 to both coords.
 			Annotation::interval_type interval(
-				genfile::GenomePosition( chromosome, start + 1 - left_margin_bp ),
+				genfile::GenomePosition( chromosome, ( start + 1 > uint32_t( left_margin_bp ) ) ? ( start + 1 - left_margin_bp ) : 0 ),
 				genfile::GenomePosition( chromosome, end + 1 + right_margin_bp )
 			) ;
 			AnnotationMap::iterator where = m_annotations.find( name ) ;
 			if( where == m_annotations.end() ) {
 				m_annotation_names.push_back( name ) ;
+				m_indices.push_back( GenomeIntervalIndex() ) ;
+				m_cursors.push_back( GenomeIntervalIndex::Cursor() ) ;
 			}
 			m_annotations[ name ].insert( interval ) ;
 			std::getline( *in, line ) ;
 		}
+
+		// Rebuild the flat index for this annotation.
+		std::size_t const index = std::find( m_annotation_names.begin(), m_annotation_names.end(), name ) - m_annotation_names.begin() ;
+		assert( index < m_indices.size() ) ;
+		GenomeIntervalIndex& intervals = m_indices[ index ] ;
+		intervals.clear() ;
+		Annotation const& annotation = m_annotations[ name ] ;
+		for( Annotation::const_iterator i = annotation.begin(); i != annotation.end(); ++i ) {
+			intervals.add( i->lower().chromosome(), i->lower().position(), i->upper().position(), 1 ) ;
+		}
+		m_chromosome.reset() ;
 	}
 
 	void Bed3Annotation::operator()(
@@ -69,10 +83,15 @@ namespace stats {
 		genfile::VariantDataReader&,
 		ResultCallback callback
 	) {
-		for( std::size_t i = 0; i < m_annotation_names.size(); ++i ) {
-			AnnotationMap::const_iterator ai = m_annotations.find( m_annotation_names[i] ) ;
-			assert( ai != m_annotations.end() ) ;
-			int64_t const result = boost::icl::contains( ai->second, variant.get_position() ) ? 1 : 0 ;
+		genfile::GenomePosition const& position = variant.get_position() ;
+		if( !m_chromosome || *m_chromosome != position.chromosome() ) {
+			m_chromosome = position.chromosome() ;
+			for( std::size_t i = 0; i < m_indices.size(); ++i ) {
+				m_indices[i].seek( *m_chromosome, &m_cursors[i] ) ;
+			}
+		}
+		for( std::size_t i = 0; i < m_indices.size(); ++i ) {
+			int64_t const result = ( m_indices[i].find( position.position(), &m_cursors[i] ) == GenomeIntervalIndex::npos ) ? 0 : 1 ;
 			callback( m_annotation_names[i], result ) ;
 		}
 	}
@@ -7,6 +7,7 @@
 #include <utility>
 #include <map>
 #include <deque>
+#include <algorithm>
 #include <boost/icl/interval_set.hpp>
 #include <boost/function.hpp>
 #include <boost/format.hpp>
@@ -57,20 +58,43 @@ namespace stats {
 			values.insert( elts[3] ) ;
 
 			// Bed file is 0-based, right-open.
-			// We store annotations as 1-based, closed intervals.
-			// Therefore add 1 to start coord.
+			// We store annotations as 1-based, right-open intervals.
+			// Therefore add 1 to both coords.
 			Annotation::interval_type interval(
-				genfile::GenomePosition( chromosome, start + 1 - left_margin_bp ),
+				genfile::GenomePosition( chromosome, ( start + 1 > uint32_t( left_margin_bp ) ) ? ( start + 1 - left_margin_bp ) : 0 ),
 				genfile::GenomePosition( chromosome, end + 1 + right_margin_bp )
 			) ;
 			AnnotationMap::iterator where = m_annotations.find( name ) ;
 			if( where == m_annotations.end() ) {
 				m_annotation_names.push_back( name ) ;
+				m_indices.push_back( GenomeIntervalIndex() ) ;
+				m_values.push_back( std::vector< std::string >() ) ;
+				m_cursors.push_back( GenomeIntervalIndex::Cursor() ) ;
 			}
 			m_annotations[ name ].add( std::make_pair( interval, values ) ) ;
 			std::getline( *in, line ) ;
 			++lineCount ;
 		}
+
+		// Rebuild the flat index for this annotation.
+		// The interval map has already split overlapping intervals into segments holding all their values.
+		std::size_t const index = std::find( m_annotation_names.begin(), m_annotation_names.end(), name ) - m_annotation_names.begin() ;
+		assert( index < m_indices.size() ) ;
+		GenomeIntervalIndex& intervals = m_indices[ index ] ;
+		std::vector< std::string >& segment_values = m_values[ index ] ;
+		intervals.clear() ;
+		segment_values.clear() ;
+		Annotation const& annotation = m_annotations[ name ] ;
+		for( Annotation::const_iterator i = annotation.begin(); i != annotation.end(); ++i ) {
+			std::string value ;
+			Payload::const_iterator pi = i->second.begin(), pi_end = i->second.end() ;
+			for( std::size_t c = 0; pi != pi_end; ++pi, ++c ) {
+				value += (c>0?",":"" ) + *pi ;
+			}
+			intervals.add( i->first.lower().chromosome(), i->first.lower().position(), i->first.upper().position(), segment_values.size() ) ;
+			segment_values.push_back( value ) ;
+		}
+		m_chromosome.reset() ;
 	}
 
 	void Bed4Annotation::operator()(
@@ -80,21 +104,19 @@ namespace stats {
 		genfile::VariantDataReader&,
 		ResultCallback callback
 	) {
-		for( std::size_t i = 0; i < m_annotation_names.size(); ++i ) {
-			AnnotationMap::const_iterator ai = m_annotations.find( m_annotation_names[i] ) ;
-			assert( ai != m_annotations.end() ) ;
-			Annotation const& a = ai->second ;
-			Annotation::const_iterator ri = a.find( variant.get_position() ) ;
-			if( ri == a.end() ) {
+		genfile::GenomePosition const& position = variant.get_position() ;
+		if( !m_chromosome || *m_chromosome != position.chromosome() ) {
+			m_chromosome = position.chromosome() ;
+			for( std::size_t i = 0; i < m_indices.size(); ++i ) {
+				m_indices[i].seek( *m_chromosome, &m_cursors[i] ) ;
+			}
+		}
+		for( std::size_t i = 0; i < m_indices.size(); ++i ) {
+			std::size_t const value_index = m_indices[i].find( position.position(), &m_cursors[i] ) ;
+			if( value_index == GenomeIntervalIndex::npos ) {
 				callback( m_annotation_names[i], genfile::MissingValue() ) ;
 			} else {
-				std::string value ;
-				Payload::const_iterator pi = ri->second.begin(), pi_end = ri->second.end() ;
-			
-				for( std::size_t c = 0; pi != pi_end; ++pi, ++c ) {
-					value += (c>0?",":"" ) + *pi ;
-				}
-				callback( m_annotation_names[i], value ) ;
+				callback( m_annotation_names[i], m_values[i][ value_index ] ) ;
 			}
 		}
 	}
@@ -6,6 +6,7 @@
 
 #include <utility>
 #include <string>
+#include <sstream>
 #include <boost/bind.hpp>
 #include <Eigen/Core>
 #include "genfile/VariantIdentifyingData.hpp"
@@ -27,7 +28,8 @@ namespace stats {
 		double nu,
 		double regularisationVariance,
 		double regularisationWeight,
-		double call_threshhold
+		double call_threshhold,
+		std::size_t number_of_threads
 	):
 		m_call_threshhold( call_threshhold ),
 		m_nu( nu ),
@@ -35,8 +37,20 @@ namespace stats {
 		m_xAxisName( "X" ),
 		m_yAxisName( "Y" ),
 		m_regularisingSigma( regularisationVariance * Eigen::MatrixXd::Identity( 2, 2 ) ),
-		m_regularisingWeight( regularisationWeight )
-	{}
+		m_regularisingWeight( regularisationWeight ),
+		m_block_size( number_of_threads > 0 ? 16 * number_of_threads : 1 )
+	{
+		if( number_of_threads > 0 ) {
+			m_pool = metro::concurrency::threadpool::create( number_of_threads ) ;
+		}
+	}
+
+	ClusterFitComputation::~ClusterFitComputation() {
+		// Tasks refer to m_tasks, so must finish before it is destroyed.
+		if( m_pool.get() ) {
+			m_pool->wait() ;
+		}
+	}
 
 	namespace {
 		metro::DataSubset compute_data_subset( std::size_t N, boost::function< bool( std::size_t ) > predicate ) {
@@ -118,24 +132,84 @@ namespace stats {
 		}
 		
 		int const N = genotypes.rows() ;
-		
+
+		m_tasks.push_back( Task() ) ;
+		Task& task = m_tasks.back() ;
+		task.snp = snp ;
+		task.genotypes = genotypes ;
+		task.callback = callback ;
 		{
-			m_intensities.setZero() ;
-			m_nonmissingness.setZero() ;
-			genfile::vcf::MatrixSetter< IntensityMatrix > intensity_setter( m_intensities, m_nonmissingness ) ;
+			task.intensities.setZero( N, 2 ) ;
+			task.nonmissingness.setZero( N, 2 ) ;
+			genfile::vcf::MatrixSetter< IntensityMatrix > intensity_setter( task.intensities, task.nonmissingness ) ;
 			data_reader.get( "XY", intensity_setter ) ;
-			assert( m_intensities.rows() == N ) ;
-			assert( m_intensities.cols() == 2 ) ;
-			assert( m_nonmissingness.rows() == N ) ;
-			assert( m_nonmissingness.cols() == 2 ) ;
+			assert( task.intensities.rows() == N ) ;
+			assert( task.intensities.cols() == 2 ) ;
+			assert( task.nonmissingness.rows() == N ) ;
+			assert( task.nonmissingness.cols() == 2 ) ;
 		}
-	
+
+		if( m_pool.get() ) {
+			m_pool->schedule( [this,&task]() { this->fit( &task ) ; } ) ;
+			if( m_tasks.size() >= m_block_size ) {
+				flush() ;
+			}
+		} else {
+			fit( &task ) ;
+			flush() ;
+		}
+	}
+
+	void ClusterFitComputation::flush() {
+		if( m_pool.get() ) {
+			m_pool->wait() ;
+		}
+		// Report in variant order.  If a fit failed, report the error once all tasks are cleared up.
+		std::exception_ptr error ;
+		for( std::size_t i = 0; i < m_tasks.size(); ++i ) {
+			if( m_tasks[i].error && !error ) {
+				error = m_tasks[i].error ;
+			}
+			report( m_tasks[i] ) ;
+		}
+		m_tasks.clear() ;
+		if( error ) {
+			std::rethrow_exception( error ) ;
+		}
+	}
+
+	void ClusterFitComputation::report( Task const& task ) const {
+		std::cerr << task.warnings ;
+		for( std::size_t i = 0; i < task.results.size(); ++i ) {
+			task.callback( task.results[i].first, task.results[i].second ) ;
+		}
+	}
+
+	void ClusterFitComputation::store_result( Task* task, std::string const& name, genfile::VariantEntry const& value ) {
+		task->results.push_back( std::make_pair( name, value )) ;
+	}
+
+	// Fit clusters for one variant.  This runs on a worker thread if there is a thread pool,
+	// so it touches only the task and const members.
+	void ClusterFitComputation::fit( Task* task ) const {
+		try {
+			std::ostringstream warnings ;
+			fit_clusters( *task, warnings, boost::bind( &ClusterFitComputation::store_result, task, _1, _2 )) ;
+			task->warnings = warnings.str() ;
+		} catch( ... ) {
+			task->error = std::current_exception() ;
+		}
+	}
+
+	void ClusterFitComputation::fit_clusters( Task& task, std::ostream& warnings, ResultCallback callback ) const {
+		int const N = task.genotypes.rows() ;
+
 #if DEBUG_CLUSTERFITCOMPUTATION
-		std::cerr << "At " << snp << ":\n"
+		std::cerr << "At " << task.snp << ":\n"
 			<< "genotypes =\n"
-			<< genotypes.block( 0, 0, 10, 3 )
+			<< task.genotypes.block( 0, 0, 10, 3 )
 			<< "\n, intensities =\n"
-			<< m_intensities.block( 0, 0, 10, 2 )
+			<< task.intensities.block( 0, 0, 10, 2 )
 			<< ".\n" ;
 #endif
 
@@ -147,9 +221,9 @@ namespace stats {
 				1, 1,
 				-1, 1
 			;
-			m_intensities *= transform ;
-			m_intensities.col(0).array() /= m_intensities.col(1).array() ;
-			m_intensities.col(1).array() = m_intensities.col(1).array().log() ;
+			task.intensities *= transform ;
+			task.intensities.col(0).array() /= task.intensities.col(1).array() ;
+			task.intensities.col(1).array() = task.intensities.col(1).array().log() ;
 		} else {
 			assert(0) ;
 		}
@@ -162,7 +236,7 @@ namespace stats {
 		Eigen::VectorXd genotypeLLs = Eigen::VectorXd::Zero( 3 ) ;
 		metro::DataSubset const nonMissingIntensitiesSubset = compute_data_subset(
 			N,
-			boost::bind( &nonmissing_intensities, _1, m_nonmissingness )
+			boost::bind( &nonmissing_intensities, _1, task.nonmissingness )
 		) ;
 		
 		// We also compute the log-likelihood P( intensities | clusters ) on the set of samples that have genotypes
@@ -172,14 +246,14 @@ namespace stats {
 		// might indicate a badly clustered SNP.
 		metro::DataSubset nonMissingGenotypesAndIntensitySubset ;
 
-		metro::likelihood::Mixture< double, Eigen::VectorXd, Eigen::MatrixXd > mixture( m_intensities ) ;
+		metro::likelihood::Mixture< double, Eigen::VectorXd, Eigen::MatrixXd > mixture( task.intensities ) ;
 
 		int numberOfClusters = 0 ;
 
 		callback( "clustering-scale", m_scale ) ;
 		
 #if DEBUG_CLUSTERFITCOMPUTATION
-				std::cerr << "snp: " << snp << ".\n" ;
+				std::cerr << "snp: " << task.snp << ".\n" ;
 #endif
 
 		for( int g = 0; g < 3; ++g ) {
@@ -188,7 +262,7 @@ namespace stats {
 				N,
 				boost::bind(
 					&nonmissing_genotypes_and_intensities,
-					_1, g, genotypes, m_nonmissingness, m_call_threshhold
+					_1, g, task.genotypes, task.nonmissingness, m_call_threshhold
 				)
 			) ;
 			
@@ -196,7 +270,7 @@ namespace stats {
 			callback( stub + ":count", genfile::VariantEntry::Integer( subset.size() ) ) ;
 			
 			typedef metro::likelihood::MultivariateT< double, Eigen::VectorXd, Eigen::MatrixXd > Cluster ;
-			Cluster::UniquePtr cluster( new Cluster( m_intensities, m_nu ) ) ;
+			Cluster::UniquePtr cluster( new Cluster( task.intensities, m_nu ) ) ;
 			metro::ValueStabilisesStoppingCondition stoppingCondition( 0.01, 100 ) ;
 			
 			if( cluster->estimate_by_em( subset, stoppingCondition, m_regularisingSigma, m_regularisingWeight ) ) {
@@ -227,7 +301,7 @@ namespace stats {
 				std::cerr << "!! No convergence.\n" ;
 #endif
 				if( subset.size() > 0 ) {
-					std::cerr << "!! For SNP " << snp << ", cluster " << g << " has size " << subset.size() << " but distribution did not converge.\n" ;
+					warnings << "!! For SNP " << task.snp << ", cluster " << g << " has size " << subset.size() << " but distribution did not converge.\n" ;
 				}
 				genfile::MissingValue const NA = genfile::MissingValue();
 				callback( stub + ":nu", NA ) ;
@@ -244,10 +318,10 @@ namespace stats {
 		// Now output the loglikelihoods under a model conditional on genotype...
 		callback( "number-of-clusters", numberOfClusters ) ;
 		callback( "informative-sample-count", genfile::VariantEntry::Integer( nonMissingGenotypesAndIntensitySubset.size() ) ) ;
-		callback( "total-sample-count", genfile::VariantEntry::Integer( genotypes.rows() )) ;
+		callback( "total-sample-count", genfile::VariantEntry::Integer( task.genotypes.rows() )) ;
 		callback( "ll-given-genotype",  genotypeLLs.sum() ) ;
 		// And under equal-weighted mixtures...
-		mixture.set_data( m_intensities ) ;
+		mixture.set_data( task.intensities ) ;
 		mixture.evaluate_at( mixture.parameters(), nonMissingGenotypesAndIntensitySubset ) ;
 		double const mixtureLL = mixture.get_value_of_function() ;
 #if DEBUG_CLUSTERFITCOMPUTATION
@@ -256,7 +330,7 @@ namespace stats {
 		std::cerr << "non-missing intensities subset count = " << nonMissingIntensitiesSubset.size() << "\n" ;
 		std::cerr << "Mixture parameters = " << mixture.parameters().transpose() << ".\n" ;
 		std::cerr << "mixtureLL = " << mixtureLL << ".\n" ;
-		Eigen::VectorXd terms( m_intensities.rows() ) ;
+		Eigen::VectorXd terms( task.intensities.rows() ) ;
 		mixture.get_terms_of_function( terms ) ;
 		std::cerr << "terms = " << terms.transpose() << ".\n" ;
 #endif
@@ -0,0 +1,95 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <map>
+#include <vector>
+#include <cassert>
+#include "genfile/Chromosome.hpp"
+#include "genfile/GenomePosition.hpp"
+#include "components/SNPSummaryComponent/GenomeIntervalIndex.hpp"
+
+namespace stats {
+	namespace {
+		// Number of intervals to step over before switching to binary search.
+		std::size_t const max_linear_steps = 8 ;
+	}
+
+	GenomeIntervalIndex::GenomeIntervalIndex() {}
+
+	void GenomeIntervalIndex::add( genfile::Chromosome const& chromosome, Position start, Position end, std::size_t value ) {
+		if( start >= end ) {
+			return ;
+		}
+		ChromosomeRanges::iterator where = m_chromosome_ranges.find( chromosome ) ;
+		if( where == m_chromosome_ranges.end() ) {
+			where = m_chromosome_ranges.insert( std::make_pair( chromosome, std::make_pair( m_intervals.size(), m_intervals.size() ))).first ;
+		}
+		assert( where->second.second == m_intervals.size() ) ;
+		assert( where->second.first == where->second.second || m_intervals.back().end <= start ) ;
+		Interval interval ;
+		interval.start = start ;
+		interval.end = end ;
+		interval.value = value ;
+		m_intervals.push_back( interval ) ;
+		where->second.second = m_intervals.size() ;
+	}
+
+	void GenomeIntervalIndex::clear() {
+		m_intervals.clear() ;
+		m_chromosome_ranges.clear() ;
+	}
+
+	void GenomeIntervalIndex::seek( genfile::Chromosome const& chromosome, Cursor* cursor ) const {
+		assert( cursor ) ;
+		ChromosomeRanges::const_iterator where = m_chromosome_ranges.find( chromosome ) ;
+		if( where == m_chromosome_ranges.end() ) {
+			cursor->m_begin = cursor->m_end = 0 ;
+		} else {
+			cursor->m_begin = where->second.first ;
+			cursor->m_end = where->second.second ;
+		}
+		cursor->m_index = cursor->m_begin ;
+		cursor->m_last_position = 0 ;
+	}
+
+	std::size_t GenomeIntervalIndex::find( Position position, Cursor* cursor ) const {
+		assert( cursor ) ;
+		std::size_t index = cursor->m_index ;
+		std::size_t const end = cursor->m_end ;
+		if( position < cursor->m_last_position ) {
+			// Out of order; search from the start of the chromosome.
+			index = upper_bound( position, cursor->m_begin, end ) ;
+		} else {
+			// Move forward past intervals ending at or before this position.
+			std::size_t steps = 0 ;
+			for( ; index < end && m_intervals[ index ].end <= position; ++index ) {
+				if( ++steps == max_linear_steps ) {
+					index = upper_bound( position, index, end ) ;
+					break ;
+				}
+			}
+		}
+		cursor->m_index = index ;
+		cursor->m_last_position = position ;
+		if( index < end && m_intervals[ index ].start <= position ) {
+			return m_intervals[ index ].value ;
+		}
+		return npos ;
+	}
+
+	// Return the index of the first interval in [begin, end) ending after the given position.
+	std::size_t GenomeIntervalIndex::upper_bound( Position position, std::size_t begin, std::size_t end ) const {
+		while( begin < end ) {
+			std::size_t const mid = begin + ( end - begin ) / 2 ;
+			if( m_intervals[ mid ].end <= position ) {
+				begin = mid + 1 ;
+			} else {
+				end = mid ;
+			}
+		}
+		return begin ;
+	}
+}
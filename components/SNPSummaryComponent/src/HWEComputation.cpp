@@ -43,6 +43,52 @@ namespace stats {
 		}
 	}
 
+	void HWEComputation::compute_by_stratum(
+		VariantIdentifyingData const& snp,
+		Genotypes const& genotypes,
+		Ploidy const& ploidy,
+		genfile::VariantDataReader&,
+		SampleStrata const& sample_strata,
+		std::size_t number_of_strata,
+		StratifiedResultCallback callback
+	) {
+		if( snp.number_of_alleles() != 2 ) {
+			return ;
+		}
+		if( snp.get_position().chromosome().is_sex_determining() ) {
+			// Count calls in all strata in one sweep; rows 2s and 2s+1 are the males and females of stratum s.
+			m_stratified_call_counts.setZero( 2 * number_of_strata, 3 ) ;
+			for( int i = 0; i < genotypes.rows(); ++i ) {
+				int const stratum = sample_strata[i] ;
+				if( stratum >= 0 && ( ploidy(i) == 1 || ploidy(i) == 2 )) {
+					count_call( genotypes, i, &m_stratified_call_counts, 2 * stratum + ploidy(i) - 1 ) ;
+				}
+			}
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				X_chromosome_test( snp, m_stratified_call_counts.block( 2 * s, 0, 2, 3 ), StratumResultCallback( callback, s ) ) ;
+			}
+		} else {
+			m_sums.compute( genotypes, ploidy, sample_strata, number_of_strata ) ;
+			Eigen::VectorXd genotype_counts = Eigen::VectorXd::Zero( 3 ) ;
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				for( int g = 0; g < 3; ++g ) {
+					genotype_counts( g ) = std::floor( m_sums.genotype( s, g ) + 0.5 ) ;
+				}
+				autosomal_exact_test( snp, genotype_counts, StratumResultCallback( callback, s ) ) ;
+				autosomal_multinomial_test( snp, genotype_counts, StratumResultCallback( callback, s ) ) ;
+			}
+		}
+	}
+
+	void HWEComputation::count_call( Genotypes const& genotypes, int const i, Eigen::MatrixXd* counts, int const row ) const {
+		for( int g = 0; g < 3; ++g ) {
+			if( genotypes( i, g ) > m_threshhold ) {
+				++(*counts)( row, g ) ;
+				break ;
+			}
+		}
+	}
+
 	std::string HWEComputation::get_summary( std::string const& prefix, std::size_t column_width ) const { return prefix + "HWEComputation" ; }
 
 	void HWEComputation::autosomal_test( VariantIdentifyingData const& snp, Genotypes const& genotypes, ResultCallback callback ) {
@@ -56,7 +102,7 @@ namespace stats {
 
 	void HWEComputation::autosomal_exact_test( VariantIdentifyingData const& snp, Eigen::VectorXd const& genotype_counts, ResultCallback callback ) {
 		if( genotype_counts.array().maxCoeff() > 0.5 ) {
-			double HWE_pvalue = SNPHWE( genotype_counts(1), genotype_counts(0), genotype_counts(2) ) ;
+			double HWE_pvalue = m_exact_test( genotype_counts(1), genotype_counts(0), genotype_counts(2) ) ;
 			callback( "HW_exact_p_value", HWE_pvalue ) ;
 		}
 		else {
@@ -116,6 +162,15 @@ namespace stats {
 		//
 		// Note: males will be called as 0/1 on the X and Y chromosomes.
 		Eigen::MatrixXd genotype_counts = Eigen::MatrixXd::Zero( 2, 3 ) ; // first row is males, second row is females.  Last column will be zero for males.
+		for( int i = 0; i < genotypes.rows(); ++i ) {
+			if( ploidy(i) == 1 || ploidy(i) == 2 ) {
+				count_call( genotypes, i, &genotype_counts, ploidy(i) - 1 ) ;
+			}
+		}
+		X_chromosome_test( snp, genotype_counts, callback ) ;
+	}
+
+	void HWEComputation::X_chromosome_test( VariantIdentifyingData const& snp, Eigen::MatrixXd const& genotype_counts, ResultCallback callback ) {
 		Eigen::MatrixXd allele_counts = Eigen::MatrixXd::Zero( 2, 2 ) ; // first row is males, second row is females.
 
 		typedef Eigen::VectorXd Vector ;
@@ -123,17 +178,6 @@ namespace stats {
 		int const HAPLOID = 0 ;
 		int const DIPLOID = 1 ;
 
-		for( int i = 0; i < genotypes.rows(); ++i ) {
-			if( ploidy(i) == 1 || ploidy(i) == 2 ) {
-				int const index = ploidy(i) - 1 ;
-				for( int g = 0; g < 3; ++g ) {
-					if( genotypes( i, g ) > m_threshhold ) {
-						++genotype_counts( index, g ) ;
-						break ;
-					}
-				}
-			}
-		}
 		for( int g = 0; g < 2; ++g ) {
 			allele_counts( 0, g ) = genotype_counts( 0, g ) ;
 			allele_counts( 1, g ) = genotype_counts( 1, 1 ) + 2.0 * genotype_counts( 1, 2.0 * g ) ;
@@ -198,7 +242,7 @@ namespace stats {
 			using boost::math::complement ;
 
 			if( genotype_counts.row( DIPLOID ).array().maxCoeff() > 0.5 ) {
-				double exact_HWE_pvalue = SNPHWE( genotype_counts( DIPLOID, 1 ), genotype_counts( DIPLOID, 0 ), genotype_counts( DIPLOID, 2 ) ) ;
+				double exact_HWE_pvalue = m_exact_test( genotype_counts( DIPLOID, 1 ), genotype_counts( DIPLOID, 0 ), genotype_counts( DIPLOID, 2 ) ) ;
 				callback( "HW_females_exact_pvalue", exact_HWE_pvalue ) ;
 			} else {
 				callback( "HW_females_exact_pvalue", genfile::MissingValue() ) ;
@@ -6,6 +6,8 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <limits>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
 #include <Eigen/Core>
@@ -28,6 +30,22 @@ namespace stats {
 		callback( "impute_info", m_computation.impute_info() ) ;
 	}
 	
+	void InfoComputation::compute_by_stratum(
+		VariantIdentifyingData const& snp,
+		Genotypes const& genotypes,
+		Ploidy const& ploidy,
+		genfile::VariantDataReader&,
+		SampleStrata const& sample_strata,
+		std::size_t number_of_strata,
+		StratifiedResultCallback callback
+	) {
+		m_computation.compute_by_stratum( snp, genotypes, ploidy, sample_strata, number_of_strata ) ;
+		for( std::size_t s = 0; s < number_of_strata; ++s ) {
+			callback( s, "info", m_computation.info( s ) ) ;
+			callback( s, "impute_info", m_computation.impute_info( s ) ) ;
+		}
+	}
+
 	std::string InfoComputation::get_summary( std::string const& prefix, std::size_t column_width ) const {
 		return prefix + "InfoComputation" ;
 	}
@@ -60,7 +78,22 @@ namespace stats {
 				}
 				return result ;
 			}
-	
+
+			// Variance of the distribution of a haploid sample, with missing probability mass
+			// filled from the fallback, as in compute_sum_of_variances().
+			double compute_haploid_variance( double const g0, double const g1, double const f1 ) {
+				double const p1 = g1 + ( 1 - g0 - g1 ) * f1 ;
+				return p1 - p1 * p1 ;
+			}
+
+			// As above for a diploid sample.
+			double compute_diploid_variance( double const g0, double const g1, double const g2, double const f1, double const f2 ) {
+				double const c = 1 - g0 - g1 - g2 ;
+				double const p1 = g1 + c * f1 ;
+				double const p2 = g2 + c * f2 ;
+				double const mean = p1 + 2.0 * p2 ;
+				return ( p1 + 4.0 * p2 ) - mean * mean ;
+			}
 		}
 		
 		InfoComputation::InfoComputation():
@@ -193,5 +226,78 @@ namespace stats {
 			m_impute_info = impute_info ;
 		}
 
+		void InfoComputation::compute_by_stratum(
+			VariantIdentifyingData const& snp,
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata
+		) {
+			m_stratum_info.assign( number_of_strata, std::numeric_limits< double >::quiet_NaN() ) ;
+			m_stratum_impute_info.assign( number_of_strata, std::numeric_limits< double >::quiet_NaN() ) ;
+
+			// we don't compute for multiallelics currently
+			if( snp.number_of_alleles() == 2 ) {
+				compute_by_stratum_impl( genotypes, ploidy, sample_strata, number_of_strata ) ;
+			}
+		}
+
+		// This computes the same quantities as compute_impl() for each stratum.
+		// The first sweep (in m_sums) gives the per-stratum allele frequencies,
+		// which the second sweep needs to fill in missing probability mass.
+		void InfoComputation::compute_by_stratum_impl(
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata
+		) {
+			typedef StratifiedGenotypeSums Sums ;
+			assert( genotypes.cols() == 3 ) ;
+			m_sums.compute( genotypes, ploidy, sample_strata, number_of_strata ) ;
+			m_theta.resize( number_of_strata ) ;
+			m_autosomal_theta.resize( number_of_strata ) ;
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				double const b_allele_count = m_sums.genotype( s, Sums::eHaploid, 1 )
+					+ m_sums.genotype( s, Sums::eDiploid, 1 ) + 2.0 * m_sums.genotype( s, Sums::eDiploid, 2 ) ;
+				double const total_allele_count = m_sums.total( s, Sums::eHaploid ) + 2.0 * m_sums.total( s, Sums::eDiploid ) ;
+				m_theta[s] = b_allele_count / total_allele_count ;
+				m_autosomal_theta[s] = ( m_sums.genotype( s, 1 ) + 2.0 * m_sums.genotype( s, 2 )) / ( 2.0 * m_sums.total( s ) ) ;
+			}
+
+			// Columns are the haploid, diploid and impute info terms.
+			m_info_terms.setZero( number_of_strata, 3 ) ;
+			for( int i = 0; i < genotypes.rows(); ++i ) {
+				int const s = sample_strata[i] ;
+				if( s < 0 ) {
+					continue ;
+				}
+				double const theta = m_theta[s] ;
+				double const g0 = genotypes( i, 0 ) ;
+				double const g1 = genotypes( i, 1 ) ;
+				double const g2 = genotypes( i, 2 ) ;
+				if( ploidy(i) == 1 ) {
+					m_info_terms( s, 0 ) += compute_haploid_variance( g0, g1, theta ) ;
+				} else if( ploidy(i) == 2 ) {
+					m_info_terms( s, 1 ) += compute_diploid_variance( g0, g1, g2, 2.0 * theta * ( 1 - theta ), theta * theta ) ;
+				}
+				m_info_terms( s, 2 ) += compute_diploid_variance( g0, g1, g2, 0.0, 0.0 ) ;
+			}
+
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				double const theta = m_theta[s] ;
+				double const autosomal_theta = m_autosomal_theta[s] ;
+				double const haploid_info_term = -m_info_terms( s, 0 ) / ( theta * ( 1 - theta ) ) ;
+				double const diploid_info_term = -m_info_terms( s, 1 ) / ( 2.0 * theta * ( 1 - theta ) ) ;
+				double const impute_info_term = -m_info_terms( s, 2 ) / ( 2.0 * autosomal_theta * ( 1 - autosomal_theta ) ) ;
+				double const number_of_info_samples = m_sums.number_of_samples( s, Sums::eHaploid ) + m_sums.number_of_samples( s, Sums::eDiploid ) ;
+				double const total_probability = m_sums.total( s ) ;
+				if( number_of_info_samples > 0 ) {
+					m_stratum_info[s] = 1.0 + ( haploid_info_term + diploid_info_term ) / number_of_info_samples ;
+				}
+				if( total_probability > 0 ) {
+					m_stratum_impute_info[s] = 1.0 + impute_info_term / total_probability ;
+				}
+			}
+		}
 	}
 }
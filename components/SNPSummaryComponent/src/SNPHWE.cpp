@@ -6,20 +6,119 @@
 
 /*
 // This code implements an exact SNP test of Hardy-Weinberg Equilibrium as described in
-// Wigginton, JE, Cutler, DJ, and Abecasis, GR (2005) A Note on Exact Tests of 
-// Hardy-Weinberg Equilibrium. American Journal of Human Genetics. 76: 000 - 000  
+// Wigginton, JE, Cutler, DJ, and Abecasis, GR (2005) A Note on Exact Tests of
+// Hardy-Weinberg Equilibrium. American Journal of Human Genetics. 76: 000 - 000
 //
 // Written by Jan Wigginton
+// Modified to walk the heterozygote distribution without a work array and to stop
+// once the remaining tails are negligible.
 */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <limits>
+#include <algorithm>
+#include "genfile/Error.hpp"
+#include "genfile/string_utils.hpp"
 #include "components/SNPSummaryComponent/SNPHWE.hpp"
 
+namespace {
+	// Probability of the configuration with obs_hets heterozygotes, relative to that of
+	// the configuration with mid heterozygotes, computed by the same recursion as the
+	// original implementation so that comparisons between terms agree exactly.
+	double relative_probability_of_observed( int const obs_hets, int const mid, int const rare_copies, int const genotypes ) {
+		double result = 1.0 ;
+		int curr_hets = mid ;
+		int curr_homr = (rare_copies - mid) / 2 ;
+		int curr_homc = genotypes - curr_hets - curr_homr ;
+		for( ; curr_hets > obs_hets; curr_hets -= 2 ) {
+			result *= curr_hets * (curr_hets - 1.0) / (4.0 * (curr_homr + 1.0) * (curr_homc + 1.0)) ;
+			++curr_homr ;
+			++curr_homc ;
+		}
+		for( ; curr_hets < obs_hets; curr_hets += 2 ) {
+			result *= 4.0 * curr_homr * curr_homc / ((curr_hets + 2.0) * (curr_hets + 1.0)) ;
+			--curr_homr ;
+			--curr_homc ;
+		}
+		return result ;
+	}
+
+	// Stop walking a tail once the remaining terms cannot change the result.
+	// Past the mode the ratio of successive terms is below one and, by log-concavity, does not
+	// increase further out, so the remaining mass is at most term * ratio / ( 1 - ratio ).
+	bool tail_is_negligible( double const term, double const ratio, double const numerator ) {
+		double const epsilon = std::numeric_limits< double >::epsilon() ;
+		return ( term == 0.0 ) || ( ratio < 1.0 && ( term * ratio / ( 1.0 - ratio ) ) <= epsilon * numerator ) ;
+	}
+
+	double hwe_exact_pvalue( int const obs_hets, int const obs_homr, int const obs_homc ) {
+		int const rare_copies = 2 * obs_homr + obs_hets ;
+		int const genotypes   = obs_hets + obs_homc + obs_homr ;
+
+		/* start at midpoint */
+		int mid = double( rare_copies ) - ( double( rare_copies ) * double( rare_copies ) / (2.0 * double( genotypes ) ) ) ;
+
+		/* check to ensure that midpoint and rare alleles have same parity */
+		if ((rare_copies & 1) ^ (mid & 1))
+			mid++ ;
+
+		double const p_obs = relative_probability_of_observed( obs_hets, mid, rare_copies, genotypes ) ;
+
+		// The observed term is always counted, so it is a lower bound for the numerator.
+		double sum = 1.0 ;
+		double numerator = ( 1.0 <= p_obs ) ? 1.0 : 0.0 ;
+		double const numerator_bound = p_obs ;
+
+		{
+			double term = 1.0 ;
+			int curr_hets = mid ;
+			int curr_homr = (rare_copies - mid) / 2 ;
+			int curr_homc = genotypes - curr_hets - curr_homr ;
+			for( ; curr_hets > 1; curr_hets -= 2 ) {
+				double const ratio = curr_hets * (curr_hets - 1.0) / (4.0 * (curr_homr + 1.0) * (curr_homc + 1.0)) ;
+				term *= ratio ;
+				sum += term ;
+				if( term <= p_obs ) {
+					numerator += term ;
+				}
+				if( curr_hets - 2 < obs_hets && tail_is_negligible( term, ratio, std::max( numerator, numerator_bound ))) {
+					break ;
+				}
+				++curr_homr ;
+				++curr_homc ;
+			}
+		}
+
+		{
+			double term = 1.0 ;
+			int curr_hets = mid ;
+			int curr_homr = (rare_copies - mid) / 2 ;
+			int curr_homc = genotypes - curr_hets - curr_homr ;
+			for( ; curr_hets <= rare_copies - 2; curr_hets += 2 ) {
+				double const ratio = 4.0 * curr_homr * curr_homc / ((curr_hets + 2.0) * (curr_hets + 1.0)) ;
+				term *= ratio ;
+				sum += term ;
+				if( term <= p_obs ) {
+					numerator += term ;
+				}
+				if( curr_hets + 2 > obs_hets && tail_is_negligible( term, ratio, std::max( numerator, numerator_bound ))) {
+					break ;
+				}
+				--curr_homr ;
+				--curr_homc ;
+			}
+		}
+
+		double p_hwe = numerator / sum ;
+		return p_hwe > 1.0 ? 1.0 : p_hwe ;
+	}
+}
+
 double SNPHWE(int obs_hets, int obs_hom1, int obs_hom2)
    {
-   if (obs_hom1 < 0 || obs_hom2 < 0 || obs_hets < 0) 
+   if (obs_hom1 < 0 || obs_hom2 < 0 || obs_hets < 0)
       {
       printf("FATAL ERROR - SNP-HWE: Current genotype configuration (%d  %d %d ) includes a"
              " negative count", obs_hets, obs_hom1, obs_hom2);
@@ -29,86 +128,52 @@ double SNPHWE(int obs_hets, int obs_hom1, int obs_hom2)
    int obs_homc = obs_hom1 < obs_hom2 ? obs_hom2 : obs_hom1;
    int obs_homr = obs_hom1 < obs_hom2 ? obs_hom1 : obs_hom2;
 
-   int rare_copies = 2 * obs_homr + obs_hets;
-   int genotypes   = obs_hets + obs_homc + obs_homr;
-
-   double * het_probs = (double *) malloc((size_t) (rare_copies + 1) * sizeof(double));
-   if (het_probs == NULL) 
-      {
-      printf("FATAL ERROR - SNP-HWE: Unable to allocate array for heterozygote probabilities" );
-      exit(EXIT_FAILURE);
-      }
-   
-   int i;
-   for (i = 0; i <= rare_copies; i++)
-      het_probs[i] = 0.0;
-
-   /* start at midpoint */
-   int mid = double( rare_copies ) - ( double( rare_copies ) * double( rare_copies ) / (2.0 * double( genotypes ) ) ) ;
-
-   /* check to ensure that midpoint and rare alleles have same parity */
-   if ((rare_copies & 1) ^ (mid & 1))
-      mid++;
-
-   int curr_hets = mid;
-   int curr_homr = (rare_copies - mid) / 2;
-   int curr_homc = genotypes - curr_hets - curr_homr;
-
-   het_probs[mid] = 1.0;
-   double sum = het_probs[mid];
-   for (curr_hets = mid; curr_hets > 1; curr_hets -= 2)
-      {
-      het_probs[curr_hets - 2] = het_probs[curr_hets] * curr_hets * (curr_hets - 1.0)
-                               / (4.0 * (curr_homr + 1.0) * (curr_homc + 1.0));
-      sum += het_probs[curr_hets - 2];
-
-      /* 2 fewer heterozygotes for next iteration -> add one rare, one common homozygote */
-      curr_homr++;
-      curr_homc++;
-      }
-
-   curr_hets = mid;
-   curr_homr = (rare_copies - mid) / 2;
-   curr_homc = genotypes - curr_hets - curr_homr;
-   for (curr_hets = mid; curr_hets <= rare_copies - 2; curr_hets += 2)
-      {
-      het_probs[curr_hets + 2] = het_probs[curr_hets] * 4.0 * curr_homr * curr_homc
-                            /((curr_hets + 2.0) * (curr_hets + 1.0));
-      sum += het_probs[curr_hets + 2];
-
-      /* add 2 heterozygotes for next iteration -> subtract one rare, one common homozygote */
-      curr_homr--;
-      curr_homc--;
-      }
-
-   for (i = 0; i <= rare_copies; i++)
-      het_probs[i] /= sum;
-
-   /* alternate p-value calculation for p_hi/p_lo
-   double p_hi = het_probs[obs_hets];
-   for (i = obs_hets + 1; i <= rare_copies; i++)
-     p_hi += het_probs[i];
-   
-   double p_lo = het_probs[obs_hets];
-   for (i = obs_hets - 1; i >= 0; i--)
-      p_lo += het_probs[i];
-
-   
-   double p_hi_lo = p_hi < p_lo ? 2.0 * p_hi : 2.0 * p_lo;
-   */
-
-   double p_hwe = 0.0;
-   /*  p-value calculation for p_hwe  */
-   for (i = 0; i <= rare_copies; i++)
-      {
-      if (het_probs[i] > het_probs[obs_hets])
-         continue;
-      p_hwe += het_probs[i];
-      }
-   
-   p_hwe = p_hwe > 1.0 ? 1.0 : p_hwe;
-
-   free(het_probs);
+   return hwe_exact_pvalue( obs_hets, obs_homr, obs_homc ) ;
+}
 
-   return p_hwe;
+namespace stats {
+	namespace {
+		int const cache_key_bits = 21 ;
+		boost::uint64_t const max_cacheable_count = ( boost::uint64_t( 1 ) << cache_key_bits ) - 1 ;
+	}
+
+	HWEExactTest::HWEExactTest( std::size_t max_cache_size ):
+		m_max_cache_size( max_cache_size ),
+		m_number_of_cache_hits( 0 )
+	{}
+
+	double HWEExactTest::operator()( int obs_hets, int obs_hom1, int obs_hom2 ) {
+		if( obs_hom1 < 0 || obs_hom2 < 0 || obs_hets < 0 ) {
+			throw genfile::BadArgumentError(
+				"stats::HWEExactTest::operator()",
+				"obs_hets=" + genfile::string_utils::to_string( obs_hets )
+				+ ", obs_hom1=" + genfile::string_utils::to_string( obs_hom1 )
+				+ ", obs_hom2=" + genfile::string_utils::to_string( obs_hom2 ),
+				"Genotype counts must be nonnegative."
+			) ;
+		}
+		int const obs_homc = obs_hom1 < obs_hom2 ? obs_hom2 : obs_hom1 ;
+		int const obs_homr = obs_hom1 < obs_hom2 ? obs_hom1 : obs_hom2 ;
+
+		if( m_max_cache_size == 0 || boost::uint64_t( obs_homc ) > max_cacheable_count || boost::uint64_t( obs_hets ) > max_cacheable_count ) {
+			return hwe_exact_pvalue( obs_hets, obs_homr, obs_homc ) ;
+		}
+
+		boost::uint64_t const key
+			= ( boost::uint64_t( obs_hets ) << ( 2 * cache_key_bits ) )
+			| ( boost::uint64_t( obs_homr ) << cache_key_bits )
+			| boost::uint64_t( obs_homc ) ;
+
+		Cache::const_iterator where = m_cache.find( key ) ;
+		if( where != m_cache.end() ) {
+			++m_number_of_cache_hits ;
+			return where->second ;
+		}
+		if( m_cache.size() >= m_max_cache_size ) {
+			m_cache.clear() ;
+		}
+		double const result = hwe_exact_pvalue( obs_hets, obs_homr, obs_homc ) ;
+		m_cache.insert( std::make_pair( key, result )) ;
+		return result ;
+	}
 }
@@ -74,6 +74,28 @@ void SNPSummaryComponent::declare_options( appcontext::OptionProcessor& options
 			" Currently a test for differential missingness is performed." )
 		.set_takes_single_value() ;
 	
+	options.declare_group( "Association test options" ) ;
+	options[ "-association-test" ]
+		.set_description( "Test for association between genotype and the given binary phenotype (type B in the sample file),"
+			" using logistic regression on additive genotype dosage.  A score test is computed for every variant,"
+			" and the full model is fit by maximum likelihood for variants with score test P-value below the value of"
+			" -association-refit-threshold." )
+		.set_takes_single_value() ;
+	options[ "-association-covariates" ]
+		.set_description( "Specify covariates (columns of the sample file) to include in the association test." )
+		.set_takes_values_until_next_option() ;
+	options[ "-association-block-size" ]
+		.set_description( "Specify the number of variants to compute association score tests for at once." )
+		.set_takes_single_value()
+		.set_default_value( 64 ) ;
+	options[ "-association-refit-threshold" ]
+		.set_description( "Specify the score test P-value below which the full association model is fit." )
+		.set_takes_single_value()
+		.set_default_value( 0.001 ) ;
+	options.option_implies_option( "-association-covariates", "-association-test" ) ;
+	options.option_implies_option( "-association-block-size", "-association-test" ) ;
+	options.option_implies_option( "-association-refit-threshold", "-association-test" ) ;
+
 	options.declare_group( "Annotation options" ) ;
 	options[ "-annotate-sequence" ]
 		.set_description( "Specify a FASTA-formatted file containing reference alleles to annotate variants with."
@@ -121,6 +143,8 @@ void SNPSummaryComponent::declare_options( appcontext::OptionProcessor& options
 	options.option_implies_option( "-stratify", "-s" ) ;
 	options.option_implies_option( "-differential", "-s" ) ;
 	options.option_implies_option( "-differential", "-osnp" ) ;
+	options.option_implies_option( "-association-test", "-s" ) ;
+	options.option_implies_option( "-association-test", "-osnp" ) ;
 }
 
 bool SNPSummaryComponent::is_needed( appcontext::OptionProcessor const& options ) {
@@ -133,6 +157,7 @@ bool SNPSummaryComponent::is_needed( appcontext::OptionProcessor const& options
 		|| options.check( "-annotate-genetic-map" )
 		|| options.check( "-annotate-bed3" )
 		|| options.check( "-annotate-bed4" )
+		|| options.check( "-association-test" )
 	;
 }
 
@@ -267,7 +292,8 @@ void SNPSummaryComponent::add_computations( stats::SNPSummaryComputationManager&
 		double regularisationCount = genfile::string_utils::to_repr< double >( params[2] ) ;
 		stats::ClusterFitComputation::UniquePtr computation(
 			new stats::ClusterFitComputation(
-				nu, regularisationVariance, regularisationCount
+				nu, regularisationVariance, regularisationCount, 0.9,
+				m_options.get_value< std::size_t >( "-threads" )
 			)
 		) ;
 		computation->set_scale( m_options.get< std::string >( "-fit-cluster-scale" )) ;
@@ -359,6 +385,24 @@ void SNPSummaryComponent::add_computations( stats::SNPSummaryComputationManager&
 		manager.stratify_by( strata, variable ) ;
 	}
 	
+	// The association test is not stratified, so is added after stratify_by().
+	if( m_options.check( "-association-test" )) {
+		std::vector< std::string > covariates ;
+		if( m_options.check( "-association-covariates" )) {
+			covariates = m_options.get_values< std::string >( "-association-covariates" ) ;
+		}
+		manager.add_computation(
+			"association_test",
+			stats::AssociationTest::create(
+				"logistic",
+				m_options.get< std::string >( "-association-test" ),
+				covariates,
+				m_samples,
+				m_options
+			)
+		) ;
+	}
+
 	if( m_options.check( "-annotate-sequence" )) {
 		appcontext::UIContext::ProgressContext progress = m_ui_context.get_progress_context( "Loading reference sequence" ) ;
 		std::vector< std::string > const elts = m_options.get_values< std::string >( "-annotate-sequence" ) ;
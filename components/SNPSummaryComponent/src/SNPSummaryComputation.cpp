@@ -19,6 +19,7 @@
 #include "components/SNPSummaryComponent/IntensitySummaryComputation.hpp"
 #include "components/SNPSummaryComponent/ClusterFitComputation.hpp"
 #include "components/SNPSummaryComponent/InfoComputation.hpp"
+#include "components/SNPSummaryComponent/StratifiedGenotypeSums.hpp"
 
 // #define DEBUG_SNP_SUMMARY_COMPUTATION 1
 
@@ -168,6 +169,31 @@ namespace stats {
 			}
 		}
 		
+		bool can_compute_by_stratum() const { return true ; }
+
+		void compute_by_stratum(
+			VariantIdentifyingData const& snp,
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			genfile::VariantDataReader&,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata,
+			StratifiedResultCallback callback
+		) {
+			if( snp.number_of_alleles() == 2 ) {
+				m_sums.compute( genotypes, ploidy, sample_strata, number_of_strata ) ;
+				for( std::size_t s = 0; s < number_of_strata; ++s ) {
+					// When all samples are diploid this agrees with compute_autosomal_frequency().
+					double const a_allele_count = m_sums.genotype( s, StratifiedGenotypeSums::eHaploid, 0 )
+						+ ( 2.0 * m_sums.genotype( s, StratifiedGenotypeSums::eDiploid, 0 ) ) + m_sums.genotype( s, StratifiedGenotypeSums::eDiploid, 1 ) ;
+					double const b_allele_count = m_sums.genotype( s, StratifiedGenotypeSums::eHaploid, 1 )
+						+ ( 2.0 * m_sums.genotype( s, StratifiedGenotypeSums::eDiploid, 2 ) ) + m_sums.genotype( s, StratifiedGenotypeSums::eDiploid, 1 ) ;
+					double const total_allele_count = m_sums.total( s, StratifiedGenotypeSums::eHaploid ) + 2.0 * m_sums.total( s, StratifiedGenotypeSums::eDiploid ) ;
+					report( snp, a_allele_count, b_allele_count, total_allele_count, StratumResultCallback( callback, s ) ) ;
+				}
+			}
+		}
+
 		void compute_sex_chromosome_frequency(
 			VariantIdentifyingData const& snp,
 			Genotypes const& genotypes,
@@ -191,46 +217,31 @@ namespace stats {
 				+ ( ( 2.0 * diploid_genotypes.col(0).sum() ) + diploid_genotypes.col(1).sum() ) ;
 			double const b_allele_count = haploid_genotypes.col(1).sum()
 				+ ( ( 2.0 * diploid_genotypes.col(2).sum() ) + diploid_genotypes.col(1).sum() ) ;
+			double const total_allele_count = ( haploid_genotypes.sum() + 2.0 * diploid_genotypes.sum() ) ;
 
-			if( m_compute_counts ) {
-				callback( "alleleA_count", a_allele_count ) ;
-				callback( "alleleB_count", b_allele_count ) ;
-			}
-
-			if( m_compute_frequencies ) {
-				double const total_allele_count = ( haploid_genotypes.sum() + 2.0 * diploid_genotypes.sum() ) ;
-				double const a_allele_freq = a_allele_count / total_allele_count ;
-				double const b_allele_freq = b_allele_count / total_allele_count ;
-
-				callback( "alleleA_frequency", a_allele_freq ) ;
-				callback( "alleleB_frequency", b_allele_freq ) ;
-
-				if( a_allele_freq < b_allele_freq ) {
-					callback( "minor_allele_frequency", a_allele_freq ) ;
-					callback( "minor_allele", snp.get_allele(0) ) ;
-					callback( "major_allele", snp.get_allele(1) ) ;
-				}
-				else if( a_allele_freq > b_allele_freq ) {
-					callback( "minor_allele_frequency", b_allele_freq ) ;
-					callback( "minor_allele", snp.get_allele(1) ) ;
-					callback( "major_allele", snp.get_allele(0) ) ;
-				} else {
-					callback( "minor_allele_frequency", a_allele_freq ) ;
-				}
-			}
+			report( snp, a_allele_count, b_allele_count, total_allele_count, callback ) ;
 		}
 
 		void compute_autosomal_frequency( VariantIdentifyingData const& snp, Genotypes const& genotypes, ResultCallback callback ) {
 			double const a_allele_count = ( 2.0 * genotypes.col(0).sum() ) + genotypes.col(1).sum() ;
 			double const b_allele_count = ( 2.0 * genotypes.col(2).sum() ) + genotypes.col(1).sum() ;
+			double const total_allele_count = ( 2.0 * genotypes.sum() ) ;
+			report( snp, a_allele_count, b_allele_count, total_allele_count, callback ) ;
+		}
 
+		void report(
+			VariantIdentifyingData const& snp,
+			double const a_allele_count,
+			double const b_allele_count,
+			double const total_allele_count,
+			ResultCallback callback
+		) const {
 			if( m_compute_counts ) {
 				callback( "alleleA_count", a_allele_count ) ;
 				callback( "alleleB_count", b_allele_count ) ;
 			}
 			
 			if( m_compute_frequencies ) {
-				double const total_allele_count = ( 2.0 * genotypes.sum() ) ;
 				double const a_allele_freq = a_allele_count / total_allele_count ;
 				double const b_allele_freq = b_allele_count / total_allele_count ;
 
@@ -258,6 +269,7 @@ namespace stats {
 	private:
 		bool const m_compute_counts ;
 		bool const m_compute_frequencies ;
+		StratifiedGenotypeSums m_sums ;
 	} ;
 
 	// What proportion of the mass on a genotype is due to high-confidence calls?
@@ -358,14 +370,63 @@ namespace stats {
 			callback( "AA", counts[ 2 ]( 0 ) ) ;
 			callback( "AB", counts[ 2 ]( 1 ) ) ;
 			callback( "BB", counts[ 2 ]( 2 ) ) ;
-			callback( "NULL", null_counts[ 'm' ] + null_counts[ 'f' ] ) ;
+			callback( "NULL", null_counts[ 1 ] + null_counts[ 2 ] ) ;
 			callback( "unknown_ploidy", counts[ -1 ].sum() + null_counts[ -1 ] ) ;
 			assert( counts[ 1 ]( 2 ) == 0 ) ;
 		}
 		
+		bool can_compute_by_stratum() const { return true ; }
+
+		void compute_by_stratum(
+			VariantIdentifyingData const& snp,
+			Genotypes const& genotypes,
+			Ploidy const& ploidy,
+			genfile::VariantDataReader&,
+			SampleStrata const& sample_strata,
+			std::size_t number_of_strata,
+			StratifiedResultCallback callback
+		) {
+			typedef StratifiedGenotypeSums Sums ;
+			m_sums.compute( genotypes, ploidy, sample_strata, number_of_strata ) ;
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				StratumResultCallback stratum_callback( callback, s ) ;
+				std::size_t const N = m_sums.number_of_samples( s ) ;
+				double const missingness = double( N ) - m_sums.total( s ) ;
+				stratum_callback( "missing_proportion", missingness / double( N ) ) ;
+				if( m_sums.number_of_samples( s, Sums::eDiploid ) == N ) {
+					stratum_callback( "A", 0 ) ;
+					stratum_callback( "B", 0 ) ;
+					if( snp.number_of_alleles() == 2 ) {
+						stratum_callback( "AA", m_sums.genotype( s, Sums::eDiploid, 0 ) ) ;
+						stratum_callback( "AB", m_sums.genotype( s, Sums::eDiploid, 1 ) ) ;
+						stratum_callback( "BB", m_sums.genotype( s, Sums::eDiploid, 2 ) ) ;
+					}
+					stratum_callback( "NULL", missingness ) ;
+				} else {
+					stratum_callback( "A", m_sums.genotype( s, Sums::eHaploid, 0 ) ) ;
+					stratum_callback( "B", m_sums.genotype( s, Sums::eHaploid, 1 ) ) ;
+					stratum_callback( "AA", m_sums.genotype( s, Sums::eDiploid, 0 ) ) ;
+					stratum_callback( "AB", m_sums.genotype( s, Sums::eDiploid, 1 ) ) ;
+					stratum_callback( "BB", m_sums.genotype( s, Sums::eDiploid, 2 ) ) ;
+					stratum_callback(
+						"NULL",
+						( double( m_sums.number_of_samples( s, Sums::eHaploid ) ) - m_sums.total( s, Sums::eHaploid ) )
+						+ ( double( m_sums.number_of_samples( s, Sums::eDiploid ) ) - m_sums.total( s, Sums::eDiploid ) )
+					) ;
+					stratum_callback(
+						"unknown_ploidy",
+						m_sums.total( s, Sums::eUnknownPloidy )
+						+ ( double( m_sums.number_of_samples( s, Sums::eUnknownPloidy ) ) - m_sums.total( s, Sums::eUnknownPloidy ) )
+					) ;
+				}
+				stratum_callback( "total", genfile::VariantEntry::Integer( N )) ;
+			}
+		}
+		
 		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const { return prefix + "MissingnessComputation" ; }
 	private:
 		double const m_call_threshhold ;
+		StratifiedGenotypeSums m_sums ;
 	} ;
 
 	SNPSummaryComputation::UniquePtr SNPSummaryComputation::create(
@@ -5,6 +5,7 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include <vector>
+#include <algorithm>
 #include <boost/foreach.hpp>
 #define foreach BOOST_FOREACH
 #include <boost/function.hpp>
@@ -27,7 +28,8 @@ namespace stats {
 		std::string const& sex_column_name
 	):
 		m_samples( samples ),
-		m_haploid_coding_column( -1 )
+		m_haploid_coding_column( -1 ),
+		m_block_size( 1 )
 	{}
 
 	std::vector< char > SNPSummaryComputationManager::get_sexes( genfile::CohortIndividualSource const& samples, std::string const& sex_column_name ) const {
@@ -91,9 +93,12 @@ namespace stats {
 	void SNPSummaryComputationManager::begin_processing_snps( std::size_t number_of_samples, genfile::SNPDataSource::Metadata const& ) {
 		m_snp_index = 0 ;
 		m_genotypes.resize( number_of_samples, 3 ) ;
+		m_block_size = 1 ;
+		m_pending.clear() ;
 		Computations::iterator i = m_computations.begin(), end_i = m_computations.end() ;
 		for( ; i != end_i; ++i ) {
 			i->second->begin_processing_snps( number_of_samples ) ;
+			m_block_size = std::max( m_block_size, i->second->block_size() ) ;
 		}
 	}
 
@@ -170,6 +175,17 @@ namespace stats {
 		genfile::VariantIdentifyingData const& snp,
 		genfile::VariantDataReader& data_reader
 	) {
+		typedef boost::function< void ( std::string const& value_name, genfile::VariantEntry const& value ) > Callback ;
+		// With deferred results, each computation gets its own slot and the last slot is for comments.
+		std::size_t const slot = m_computations.size() ;
+		Callback callback ;
+		if( m_block_size > 1 ) {
+			m_pending.push_back( PendingResults( snp, slot + 1 )) ;
+			callback = boost::bind( &SNPSummaryComputationManager::store_pending_result, this, m_pending.size() - 1, slot, _1, _2 ) ;
+		} else {
+			callback = boost::bind( boost::ref( m_result_signal ), snp, _1, _2 ) ;
+		}
+
 		try {
 			GPSetter setter( &m_genotypes, &m_ploidy ) ;
 			data_reader.get( ":genotypes:", genfile::to_GP_unphased( setter )) ;
@@ -178,31 +194,58 @@ namespace stats {
 			std::cerr << "SNPSummaryComputationManager::processed_snp(): ploidy = " << m_ploidy.transpose() << "...\n" ;
 	#endif
 
-			boost::function< void ( std::string const& value_name, genfile::VariantEntry const& value ) > callback
-				= boost::bind( boost::ref( m_result_signal ), snp, _1, _2 ) ;
-
 			Computations::iterator i = m_computations.begin(), end_i = m_computations.end() ;
-			for( ; i != end_i; ++i ) {
+			for( std::size_t computation_i = 0; i != end_i; ++i, ++computation_i ) {
 				i->second->operator()(
 					snp,
 					m_genotypes,
 					m_ploidy,
 					data_reader,
-					callback
+					( m_block_size > 1 )
+						? Callback( boost::bind( &SNPSummaryComputationManager::store_pending_result, this, m_pending.size() - 1, computation_i, _1, _2 ))
+						: callback
 				) ;
 			}
 
 			if( snp.number_of_alleles() != 2 ) {
-				m_result_signal( snp, "comment", "non-biallelic" ) ;
+				callback( "comment", "non-biallelic" ) ;
 			}
 		}
 		catch( genfile::MalformedInputError const& e ) {
-			m_result_signal( snp, "comment", "!! Error reading data for variant " + genfile::string_utils::to_string( snp ) + ": " + e.format_message() ) ;
+			callback( "comment", "!! Error reading data for variant " + genfile::string_utils::to_string( snp ) + ": " + e.format_message() ) ;
 		}
 		++m_snp_index ;
+		if( m_pending.size() >= m_block_size ) {
+			flush_pending_results() ;
+		}
+	}
+
+	void SNPSummaryComputationManager::store_pending_result( std::size_t index, std::size_t slot, std::string const& value_name, genfile::VariantEntry const& value ) {
+		assert( index < m_pending.size() ) ;
+		assert( slot < m_pending[ index ].values.size() ) ;
+		m_pending[ index ].values[ slot ].push_back( std::make_pair( value_name, value )) ;
+	}
+
+	// Let computations report deferred results, then pass on all results in variant order.
+	void SNPSummaryComputationManager::flush_pending_results() {
+		Computations::iterator i = m_computations.begin(), end_i = m_computations.end() ;
+		for( ; i != end_i; ++i ) {
+			i->second->flush() ;
+		}
+		for( std::size_t snp_i = 0; snp_i < m_pending.size(); ++snp_i ) {
+			PendingResults const& pending = m_pending[ snp_i ] ;
+			for( std::size_t slot = 0; slot < pending.values.size(); ++slot ) {
+				PendingResults::Values const& values = pending.values[ slot ] ;
+				for( std::size_t j = 0; j < values.size(); ++j ) {
+					m_result_signal( pending.snp, values[j].first, values[j].second ) ;
+				}
+			}
+		}
+		m_pending.clear() ;
 	}
 
 	void SNPSummaryComputationManager::end_processing_snps() {
+		flush_pending_results() ;
 		Computations::iterator i = m_computations.begin(), end_i = m_computations.end() ;
 		for( ; i != end_i; ++i ) {
 			i->second->end_processing_snps(
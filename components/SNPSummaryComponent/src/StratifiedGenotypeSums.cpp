@@ -0,0 +1,66 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <algorithm>
+#include <Eigen/Core>
+#include "components/SNPSummaryComponent/StratifiedGenotypeSums.hpp"
+
+namespace stats {
+	namespace {
+		StratifiedGenotypeSums::PloidyClass get_ploidy_class( int const ploidy ) {
+			switch( ploidy ) {
+				case -1: return StratifiedGenotypeSums::eUnknownPloidy ; break ;
+				case 1: return StratifiedGenotypeSums::eHaploid ; break ;
+				case 2: return StratifiedGenotypeSums::eDiploid ; break ;
+				default: return StratifiedGenotypeSums::eOtherPloidy ; break ;
+			}
+		}
+	}
+
+	void StratifiedGenotypeSums::compute(
+		Genotypes const& genotypes,
+		Ploidy const& ploidy,
+		SampleStrata const& sample_strata,
+		std::size_t number_of_strata
+	) {
+		assert( ploidy.size() == genotypes.rows() ) ;
+		assert( sample_strata.size() == std::size_t( genotypes.rows() ) ) ;
+		std::size_t const N = number_of_strata * eNumberOfPloidyClasses ;
+		m_sums.setZero( N, 4 ) ;
+		m_number_of_samples.assign( N, 0 ) ;
+		int const number_of_genotypes = std::min( int( genotypes.cols() ), 3 ) ;
+		for( int i = 0; i < genotypes.rows(); ++i ) {
+			int const stratum = sample_strata[i] ;
+			if( stratum < 0 ) {
+				continue ;
+			}
+			assert( std::size_t( stratum ) < number_of_strata ) ;
+			std::size_t const row = stratum * eNumberOfPloidyClasses + get_ploidy_class( ploidy(i) ) ;
+			for( int g = 0; g < number_of_genotypes; ++g ) {
+				m_sums( row, g ) += genotypes( i, g ) ;
+			}
+			m_sums( row, 3 ) += genotypes.row( i ).sum() ;
+			++m_number_of_samples[ row ] ;
+		}
+	}
+
+	std::size_t StratifiedGenotypeSums::number_of_samples( std::size_t stratum ) const {
+		std::size_t result = 0 ;
+		for( int c = 0; c < eNumberOfPloidyClasses; ++c ) {
+			result += m_number_of_samples[ stratum * eNumberOfPloidyClasses + c ] ;
+		}
+		return result ;
+	}
+
+	double StratifiedGenotypeSums::genotype( std::size_t stratum, int g ) const {
+		return m_sums.block( stratum * eNumberOfPloidyClasses, g, eNumberOfPloidyClasses, 1 ).sum() ;
+	}
+
+	double StratifiedGenotypeSums::total( std::size_t stratum ) const {
+		return m_sums.block( stratum * eNumberOfPloidyClasses, 3, eNumberOfPloidyClasses, 1 ).sum() ;
+	}
+}
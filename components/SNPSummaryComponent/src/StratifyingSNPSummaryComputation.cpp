@@ -6,48 +6,127 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <boost/bind.hpp>
 #include "genfile/CohortIndividualSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/string_utils/string_utils.hpp"
 #include "components/SNPSummaryComponent/StratifyingSNPSummaryComputation.hpp"
 
+namespace {
+	// Presents the data of the samples in one stratum, numbered by their index within the stratum.
+	struct StratumVariantDataReader: public genfile::VariantDataReader {
+		StratumVariantDataReader(
+			genfile::VariantDataReader& reader,
+			std::vector< int > const& sample_strata,
+			std::vector< int > const& index_in_stratum,
+			int stratum,
+			std::size_t stratum_size
+		):
+			m_reader( reader ),
+			m_sample_strata( sample_strata ),
+			m_index_in_stratum( index_in_stratum ),
+			m_stratum( stratum ),
+			m_stratum_size( stratum_size )
+		{}
+
+		StratumVariantDataReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			StratumSetter stratum_setter( setter, *this ) ;
+			m_reader.get( spec, stratum_setter ) ;
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const { return m_reader.supports( spec ) ; }
+		void get_supported_specs( SpecSetter setter ) const { m_reader.get_supported_specs( setter ) ; }
+		std::size_t get_number_of_samples() const { return m_stratum_size ; }
+
+	private:
+		// Passes on values for samples in the stratum.  Values for other samples are ignored,
+		// even if the reader sets them after set_sample() returns false.
+		struct StratumSetter: public PerSampleSetter {
+			StratumSetter( PerSampleSetter& setter, StratumVariantDataReader const& reader ):
+				m_setter( setter ),
+				m_reader( reader ),
+				m_included( false )
+			{}
+			void initialise( std::size_t, std::size_t number_of_alleles ) {
+				m_setter.initialise( m_reader.m_stratum_size, number_of_alleles ) ;
+			}
+			bool set_sample( std::size_t i ) {
+				assert( i < m_reader.m_sample_strata.size() ) ;
+				m_included = ( m_reader.m_sample_strata[i] == m_reader.m_stratum ) && m_setter.set_sample( m_reader.m_index_in_stratum[i] ) ;
+				return m_included ;
+			}
+			void set_number_of_entries( uint32_t ploidy, std::size_t n, OrderType const order_type, ValueType const value_type ) {
+				if( m_included ) {
+					m_setter.set_number_of_entries( ploidy, n, order_type, value_type ) ;
+				}
+			}
+			void set_value( std::size_t i, MissingValue const value ) { if( m_included ) { m_setter.set_value( i, value ) ; } }
+			void set_value( std::size_t i, std::string& value ) { if( m_included ) { m_setter.set_value( i, value ) ; } }
+			void set_value( std::size_t i, Integer const value ) { if( m_included ) { m_setter.set_value( i, value ) ; } }
+			void set_value( std::size_t i, double const value ) { if( m_included ) { m_setter.set_value( i, value ) ; } }
+			void finalise() { m_setter.finalise() ; }
+		private:
+			PerSampleSetter& m_setter ;
+			StratumVariantDataReader const& m_reader ;
+			bool m_included ;
+		} ;
+
+	private:
+		genfile::VariantDataReader& m_reader ;
+		std::vector< int > const& m_sample_strata ;
+		std::vector< int > const& m_index_in_stratum ;
+		int const m_stratum ;
+		std::size_t const m_stratum_size ;
+	} ;
+}
+
 namespace stats {
 	StratifyingSNPSummaryComputation::StratifyingSNPSummaryComputation( SNPSummaryComputation::UniquePtr computation, std::string const& stratification_name, StrataMembers const& strata_members ):
 	 	m_computation( computation ),
 		m_stratification_name( stratification_name ),
 		m_strata_members( strata_members )
-	{}
+	{
+		for( StrataMembers::const_iterator strata_i = m_strata_members.begin(); strata_i != m_strata_members.end(); ++strata_i ) {
+			m_stratum_suffixes.push_back( "[" + m_stratification_name + "=" + genfile::string_utils::to_string( strata_i->first ) + "]" ) ;
+		}
+	}
 
-	namespace impl {
-		struct NameMungingSNPComputationCallback {
-			NameMungingSNPComputationCallback( SNPSummaryComputation::ResultCallback callback, std::string const& prefix, std::string const& suffix ):
-				m_callback( callback ),
-				m_prefix( prefix ),
-				m_suffix( suffix )
-			{
-				assert( m_callback ) ;
+	void StratifyingSNPSummaryComputation::compute_strata( std::size_t number_of_samples ) {
+		m_sample_strata.assign( number_of_samples, -1 ) ;
+		m_index_in_stratum.assign( number_of_samples, -1 ) ;
+		int stratum = 0 ;
+		for( StrataMembers::const_iterator strata_i = m_strata_members.begin(); strata_i != m_strata_members.end(); ++strata_i, ++stratum ) {
+			std::vector< int > const& members = strata_i->second ;
+			for( std::size_t i = 0; i < members.size(); ++i ) {
+				assert( members[i] >= 0 && std::size_t( members[i] ) < number_of_samples ) ;
+				assert( m_sample_strata[ members[i] ] == -1 ) ;
+				m_sample_strata[ members[i] ] = stratum ;
+				m_index_in_stratum[ members[i] ] = i ;
 			}
+		}
+	}
 
-			NameMungingSNPComputationCallback( NameMungingSNPComputationCallback const& other ):
-				m_callback( other.m_callback ),
-				m_prefix( other.m_prefix ),
-				m_suffix( other.m_suffix )
-			{}
-
-			NameMungingSNPComputationCallback& operator=( NameMungingSNPComputationCallback const& other ) {
-				m_callback = other.m_callback ;
-				m_prefix = other.m_prefix ;
-				m_suffix = other.m_suffix ;
-				return *this ;
-			}
-		
-			void operator()( std::string const& value_name, genfile::VariantEntry const& value ) const {
-				m_callback( m_prefix + value_name + m_suffix, value ) ;
+	std::string const& StratifyingSNPSummaryComputation::get_column_name( std::size_t stratum, std::string const& value_name ) {
+		ColumnNames::iterator where = m_column_names.find( value_name ) ;
+		if( where == m_column_names.end() ) {
+			std::vector< std::string > names( m_stratum_suffixes.size() ) ;
+			for( std::size_t i = 0; i < m_stratum_suffixes.size(); ++i ) {
+				names[i] = value_name + m_stratum_suffixes[i] ;
 			}
-		
-		private:
-			SNPSummaryComputation::ResultCallback m_callback ;
-			std::string m_prefix ;
-			std::string m_suffix ;
-		} ;
+			where = m_column_names.insert( std::make_pair( value_name, names ) ).first ;
+		}
+		return where->second[ stratum ] ;
+	}
+
+	void StratifyingSNPSummaryComputation::report_result(
+		ResultCallback const& callback,
+		std::size_t stratum,
+		std::string const& value_name,
+		genfile::VariantEntry const& value
+	) {
+		callback( get_column_name( stratum, value_name ), value ) ;
 	}
 
 	void StratifyingSNPSummaryComputation::operator()(
@@ -57,22 +136,35 @@ namespace stats {
 		genfile::VariantDataReader& data_reader,
 		ResultCallback callback
 	) {
-		for( StrataMembers::const_iterator strata_i = m_strata_members.begin(); strata_i != m_strata_members.end(); ++strata_i ) {
-			std::vector< int > const& members = strata_i->second ;
-			Genotypes strata_genotypes = Genotypes::Constant( members.size(), genotypes.cols(), 0 ) ;
-			Ploidy strata_ploidy = Ploidy::Zero( members.size() ) ;
-			for( std::size_t i = 0; i < members.size(); ++i ) {
-				strata_genotypes.row( i ) = genotypes.row( members[i] ) ;
-				strata_ploidy(i) = ploidy( members[i] ) ;
-			}
-		
-			m_computation->operator()(
-				snp,
-				strata_genotypes,
-				strata_ploidy,
-				data_reader,
-				impl::NameMungingSNPComputationCallback( callback, "", "[" + m_stratification_name + "=" + genfile::string_utils::to_string( strata_i->first ) + "]" )
+		if( m_sample_strata.size() != std::size_t( genotypes.rows() ) ) {
+			compute_strata( genotypes.rows() ) ;
+		}
+		// Computations may hold on to result callbacks until flush(), so these hold the callback by value.
+		if( m_computation->can_compute_by_stratum() ) {
+			m_computation->compute_by_stratum(
+				snp, genotypes, ploidy, data_reader,
+				m_sample_strata, m_strata_members.size(),
+				boost::bind( &StratifyingSNPSummaryComputation::report_result, this, callback, _1, _2, _3 )
 			) ;
+		} else {
+			std::size_t stratum = 0 ;
+			for( StrataMembers::const_iterator strata_i = m_strata_members.begin(); strata_i != m_strata_members.end(); ++strata_i, ++stratum ) {
+				std::vector< int > const& members = strata_i->second ;
+				m_stratum_genotypes.resize( members.size(), genotypes.cols() ) ;
+				m_stratum_ploidy.resize( members.size() ) ;
+				for( std::size_t i = 0; i < members.size(); ++i ) {
+					m_stratum_genotypes.row( i ) = genotypes.row( members[i] ) ;
+					m_stratum_ploidy(i) = ploidy( members[i] ) ;
+				}
+				StratumVariantDataReader stratum_reader( data_reader, m_sample_strata, m_index_in_stratum, stratum, members.size() ) ;
+				m_computation->operator()(
+					snp,
+					m_stratum_genotypes,
+					m_stratum_ploidy,
+					stratum_reader,
+					boost::bind( &StratifyingSNPSummaryComputation::report_result, this, callback, stratum, _1, _2 )
+				) ;
+			}
 		}
 	}
 
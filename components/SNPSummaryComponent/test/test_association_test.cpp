@@ -0,0 +1,421 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/math/distributions/chi_squared.hpp>
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include "genfile/Error.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/CategoricalCohortIndividualSource.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "metro/SampleRange.hpp"
+#include "metro/fit_model.hpp"
+#include "metro/CholeskyStepper.hpp"
+#include "metro/regression/Design.hpp"
+#include "metro/regression/Logistic.hpp"
+#include "components/SNPSummaryComponent/AssociationTest.hpp"
+#include "components/SNPSummaryComponent/SNPSummaryComputationManager.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_association_test )
+
+namespace {
+	typedef Eigen::VectorXd Vector ;
+	typedef Eigen::MatrixXd Matrix ;
+	double const NA = std::numeric_limits< double >::quiet_NaN() ;
+	std::size_t const number_of_samples = 300 ;
+	std::size_t const number_of_variants = 6 ;
+
+	// Simulated data: a continuous covariate, genotypes at several variants with some missing
+	// and some uncertain calls, and a binary phenotype associated with the covariate and the first variant.
+	// Variant 4 is monomorphic.  One sample has missing phenotype and one has a missing covariate.
+	struct Data {
+		Data():
+			covariate( number_of_samples ),
+			phenotype( number_of_samples ),
+			genotypes( number_of_variants, Matrix::Zero( number_of_samples, 3 ))
+		{
+			std::mt19937 generator( 12345 ) ;
+			std::normal_distribution< double > normal ;
+			std::uniform_real_distribution< double > uniform ;
+			double const frequencies[ number_of_variants ] = { 0.3, 0.1, 0.5, 0.2, 0.0, 0.4 } ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				covariate(i) = normal( generator ) ;
+				for( std::size_t v = 0; v < number_of_variants; ++v ) {
+					int const g = ( uniform( generator ) < frequencies[v] ) + ( uniform( generator ) < frequencies[v] ) ;
+					if( i % 17 == v ) {
+						// Missing genotype.
+					} else if( i % 5 == 0 && v != 4 ) {
+						genotypes[v].row(i) << 0.2, 0.5, 0.3 ;
+					} else {
+						genotypes[v]( i, g ) = 1 ;
+					}
+				}
+				double const dosage = genotypes[0]( i, 1 ) + 2.0 * genotypes[0]( i, 2 ) ;
+				double const linear_predictor = -0.5 + 0.7 * covariate(i) + 1.5 * dosage ;
+				phenotype(i) = ( uniform( generator ) < 1.0 / ( 1.0 + std::exp( -linear_predictor ))) ;
+			}
+			phenotype(7) = NA ;
+			covariate(11) = NA ;
+		}
+
+		std::string sample_file() const {
+			std::ostringstream result ;
+			result << "ID_1 ID_2 missing pheno cov\n0 0 0 B C\n" ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				result << "sample_" << i << " sample_" << i << " 0 " ;
+				if( phenotype(i) == phenotype(i) ) {
+					result << int( phenotype(i) ) ;
+				} else {
+					result << "NA" ;
+				}
+				result << " " ;
+				if( covariate(i) == covariate(i) ) {
+					result << std::setprecision( 17 ) << covariate(i) ;
+				} else {
+					result << "NA" ;
+				}
+				result << "\n" ;
+			}
+			return result.str() ;
+		}
+
+		Vector covariate ;
+		Vector phenotype ;
+		std::vector< Matrix > genotypes ;
+	} ;
+
+	// Reader giving the genotypes of one simulated variant, or failing to read.
+	struct TestReader: public genfile::VariantDataReader {
+		TestReader( Matrix const& genotypes, bool fail = false ):
+			m_genotypes( genotypes ),
+			m_fail( fail )
+		{}
+
+		TestReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			if( m_fail ) {
+				throw genfile::MalformedInputError( "TestReader", 0 ) ;
+			}
+			setter.initialise( m_genotypes.rows(), 2 ) ;
+			for( int i = 0; i < m_genotypes.rows(); ++i ) {
+				if( setter.set_sample( i )) {
+					setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					for( int g = 0; g < 3; ++g ) {
+						setter.set_value( g, m_genotypes( i, g )) ;
+					}
+				}
+			}
+			setter.finalise() ;
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const { return spec == ":genotypes:" ; }
+		void get_supported_specs( SpecSetter setter ) const { setter( ":genotypes:", "Float" ) ; }
+		std::size_t get_number_of_samples() const { return m_genotypes.rows() ; }
+
+	private:
+		Matrix const& m_genotypes ;
+		bool const m_fail ;
+	} ;
+
+	genfile::VariantIdentifyingData get_variant( std::size_t v ) {
+		return genfile::VariantIdentifyingData(
+			"rs" + genfile::string_utils::to_string( v ),
+			genfile::GenomePosition( genfile::Chromosome( "1" ), 1000 + v ),
+			"A", "G"
+		) ;
+	}
+
+	typedef std::map< std::string, genfile::VariantEntry > Results ;
+
+	void store_result( Results* results, std::string const& name, genfile::VariantEntry const& value ) {
+		(*results)[ name ] = value ;
+	}
+
+	// Run the test on all variants and return the results for each.
+	std::vector< Results > run_test(
+		Data const& data,
+		genfile::CohortIndividualSource const& samples,
+		std::size_t block_size,
+		double refit_threshold,
+		std::size_t number_of_threads
+	) {
+		stats::AssociationTest test( "pheno", std::vector< std::string >( 1, "cov" ), samples, block_size, refit_threshold, number_of_threads ) ;
+		BOOST_CHECK_EQUAL( test.block_size(), block_size ) ;
+		std::vector< Results > results( number_of_variants ) ;
+		Eigen::VectorXi const ploidy = Eigen::VectorXi::Constant( number_of_samples, 2 ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			TestReader reader( data.genotypes[v] ) ;
+			test( get_variant( v ), data.genotypes[v], ploidy, reader, boost::bind( &store_result, &results[v], _1, _2 )) ;
+		}
+		test.flush() ;
+		return results ;
+	}
+
+	double chi_squared_pvalue( double statistic ) {
+		boost::math::chi_squared_distribution< double > chi_squared( 1.0 ) ;
+		return boost::math::cdf( boost::math::complement( chi_squared, statistic )) ;
+	}
+
+	std::vector< metro::SampleRange > compute_nonmissing_ranges( Vector const& values ) {
+		std::vector< metro::SampleRange > result ;
+		int begin = 0 ;
+		for( int i = 0; i <= values.size(); ++i ) {
+			if( i == values.size() || values(i) != values(i) ) {
+				if( i > begin ) {
+					result.push_back( metro::SampleRange( begin, i )) ;
+				}
+				begin = i + 1 ;
+			}
+		}
+		return result ;
+	}
+
+	// Score test and maximum likelihood fit of one variant, computed directly from metro::regression::Logistic.
+	struct Expected {
+		double score_beta ;
+		double score_se ;
+		double score_pvalue ;
+		double beta ;
+		double se ;
+		double pvalue ;
+	} ;
+
+	struct ExpectedComputation {
+		ExpectedComputation( Data const& data ):
+			m_data( data ),
+			m_outcome( Matrix::Zero( number_of_samples, 2 )),
+			m_covariates( number_of_samples, 1 ),
+			m_outcome_names( 2 )
+		{
+			Vector included( number_of_samples ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				bool const missing = ( data.phenotype(i) != data.phenotype(i) ) || ( data.covariate(i) != data.covariate(i) ) ;
+				included(i) = missing ? NA : 0.0 ;
+				if( !missing ) {
+					m_outcome( i, int( data.phenotype(i) )) = 1 ;
+				}
+				m_covariates( i, 0 ) = missing ? 0.0 : data.covariate(i) ;
+			}
+			m_included = compute_nonmissing_ranges( included ) ;
+			m_outcome_names[0] = "pheno=0" ;
+			m_outcome_names[1] = "pheno=1" ;
+
+			metro::regression::Design::UniquePtr design = create_design( std::vector< std::string >() ) ;
+			design->set_predictors(
+				Matrix::Zero( 1, 0 ),
+				Matrix::Ones( number_of_samples, 1 ),
+				std::vector< metro::SampleRange >( 1, metro::SampleRange( 0, number_of_samples ))
+			) ;
+			metro::regression::Logistic ll( *design ) ;
+			metro::CholeskyStepper stepper( 0.001, 100 ) ;
+			BOOST_CHECK( metro::fit_model( ll, "null", Vector::Zero( ll.number_of_parameters() ), stepper, 0 ).first ) ;
+			m_null_parameters = ll.parameters() ;
+		}
+
+		Expected compute( std::size_t v ) const {
+			Expected result ;
+			Vector dosage( number_of_samples ) ;
+			double sum = 0 ;
+			int count = 0 ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				Eigen::RowVectorXd const& g = m_data.genotypes[v].row(i) ;
+				dosage(i) = ( g.sum() > 0 ) ? ( g(1) + 2.0 * g(2) ) : NA ;
+				if( dosage(i) == dosage(i) && is_included(i) ) {
+					sum += dosage(i) ;
+					++count ;
+				}
+			}
+			Vector start = Vector::Zero( m_null_parameters.size() + 1 ) ;
+			start(0) = m_null_parameters(0) ;
+			start.tail( m_null_parameters.size() - 1 ) = m_null_parameters.tail( m_null_parameters.size() - 1 ) ;
+
+			// The score test imputes missing dosages by the mean.
+			{
+				Vector imputed = dosage.unaryExpr( [sum,count]( double x ) { return ( x == x ) ? x : ( sum / count ) ; } ) ;
+				metro::regression::Design::UniquePtr design = create_design( std::vector< std::string >( 1, "add" )) ;
+				design->set_predictors( imputed, std::vector< metro::SampleRange >( 1, metro::SampleRange( 0, number_of_samples ))) ;
+				metro::regression::Logistic ll( *design ) ;
+				ll.evaluate_at( start ) ;
+				double const U = ll.get_value_of_first_derivative()(1) ;
+				// The variance of the score is the inverse of the predictor's entry in the inverse information.
+				Matrix const inverse_information = ( -ll.get_value_of_second_derivative() ).inverse() ;
+				double const V = 1.0 / inverse_information( 1, 1 ) ;
+				result.score_beta = U / V ;
+				result.score_se = 1.0 / std::sqrt( V ) ;
+				result.score_pvalue = chi_squared_pvalue( U * U / V ) ;
+			}
+
+			// The full model excludes samples with missing dosage.
+			{
+				std::vector< metro::SampleRange > const nonmissing = compute_nonmissing_ranges( dosage ) ;
+				Vector predictor = dosage.unaryExpr( []( double x ) { return ( x == x ) ? x : 0.0 ; } ) ;
+				metro::regression::Design::UniquePtr design = create_design( std::vector< std::string >( 1, "add" )) ;
+				design->set_predictors( predictor, nonmissing ) ;
+				metro::regression::Logistic ll( *design ) ;
+				metro::CholeskyStepper stepper( 0.001, 100 ) ;
+				BOOST_CHECK( metro::fit_model( ll, "add", start, stepper, 0 ).first ) ;
+				Matrix const variance = ( -ll.get_value_of_second_derivative() ).inverse() ;
+				result.beta = ll.parameters()(1) ;
+				result.se = std::sqrt( variance( 1, 1 )) ;
+				result.pvalue = chi_squared_pvalue( result.beta * result.beta / variance( 1, 1 )) ;
+			}
+			return result ;
+		}
+
+	private:
+		Data const& m_data ;
+		Matrix m_outcome ;
+		Matrix m_covariates ;
+		std::vector< std::string > m_outcome_names ;
+		std::vector< metro::SampleRange > m_included ;
+		Vector m_null_parameters ;
+
+		metro::regression::Design::UniquePtr create_design( std::vector< std::string > const& predictor_names ) const {
+			return metro::regression::Design::create(
+				m_outcome, m_included, m_outcome_names,
+				m_covariates, m_included, std::vector< std::string >( 1, "cov" ),
+				predictor_names
+			) ;
+		}
+
+		bool is_included( std::size_t i ) const {
+			for( std::size_t j = 0; j < m_included.size(); ++j ) {
+				if( int( i ) >= m_included[j].begin() && int( i ) < m_included[j].end() ) {
+					return true ;
+				}
+			}
+			return false ;
+		}
+	} ;
+
+	void check_close( Results const& results, std::string const& name, double expected ) {
+		Results::const_iterator where = results.find( name ) ;
+		BOOST_REQUIRE( where != results.end() ) ;
+		BOOST_REQUIRE( !where->second.is_missing() ) ;
+		BOOST_CHECK_CLOSE( where->second.as< double >(), expected, 0.0001 ) ;
+	}
+
+	void check_missing( Results const& results, std::string const& name ) {
+		Results::const_iterator where = results.find( name ) ;
+		BOOST_REQUIRE( where != results.end() ) ;
+		BOOST_CHECK( where->second.is_missing() ) ;
+	}
+
+	typedef std::vector< std::pair< std::string, std::string > > ResultLog ;
+
+	void log_result( ResultLog* log, Results* results, genfile::VariantIdentifyingData const& snp, std::string const& name, genfile::VariantEntry const& value ) {
+		log->push_back( std::make_pair( snp.get_primary_id(), name )) ;
+		results[ genfile::string_utils::to_repr< std::size_t >( std::string( snp.get_primary_id() ).substr( 2 )) ][ name ] = value ;
+	}
+}
+
+AUTO_TEST_CASE( test_association_against_logistic_regression ) {
+	Data const data ;
+	std::istringstream sample_file( data.sample_file() ) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_file ) ;
+	ExpectedComputation const expected_computation( data ) ;
+
+	// Blocks of one variant, and blocks that split the variants unevenly, with and without threads.
+	std::size_t const block_sizes[] = { 1, 4, 64 } ;
+	std::size_t const threads[] = { 0, 3 } ;
+	for( std::size_t b = 0; b < 3; ++b ) {
+		for( std::size_t t = 0; t < 2; ++t ) {
+			// With a refit threshold of 1, all variants with a score test are refit.
+			std::vector< Results > const results = run_test( data, samples, block_sizes[b], 1.0, threads[t] ) ;
+			for( std::size_t v = 0; v < number_of_variants; ++v ) {
+				if( v == 4 ) {
+					// Monomorphic variants have no information.
+					check_missing( results[v], "add_score_beta" ) ;
+					check_missing( results[v], "add_beta" ) ;
+					check_missing( results[v], "add_converged" ) ;
+					continue ;
+				}
+				Expected const expected = expected_computation.compute( v ) ;
+				check_close( results[v], "add_score_beta", expected.score_beta ) ;
+				check_close( results[v], "add_score_se", expected.score_se ) ;
+				check_close( results[v], "add_score_pvalue", expected.score_pvalue ) ;
+				check_close( results[v], "add_beta", expected.beta ) ;
+				check_close( results[v], "add_se", expected.se ) ;
+				check_close( results[v], "add_pvalue", expected.pvalue ) ;
+				BOOST_CHECK_EQUAL( results[v].find( "add_converged" )->second, genfile::VariantEntry( 1 )) ;
+			}
+			// The first variant is truly associated.
+			BOOST_CHECK_LT( results[0].find( "add_score_pvalue" )->second.as< double >(), 0.001 ) ;
+		}
+	}
+
+	// With a refit threshold of zero, no variant is refit.
+	{
+		std::vector< Results > const results = run_test( data, samples, 4, 0.0, 0 ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			if( v != 4 ) {
+				check_close( results[v], "add_score_beta", expected_computation.compute( v ).score_beta ) ;
+			}
+			check_missing( results[v], "add_beta" ) ;
+			check_missing( results[v], "add_converged" ) ;
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_manager_output_order ) {
+	Data const data ;
+	std::istringstream sample_file( data.sample_file() ) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_file ) ;
+	std::vector< Results > const expected = run_test( data, samples, 1, 1.0, 0 ) ;
+
+	// Reading variant 2 fails.  Results must still come out in variant order, with each variant's
+	// results matching those computed for it alone.
+	std::size_t const block_sizes[] = { 2, 3, 64 } ;
+	for( std::size_t b = 0; b < 3; ++b ) {
+		stats::SNPSummaryComputationManager manager( samples, "sex" ) ;
+		manager.add_computation(
+			"association",
+			stats::SNPSummaryComputation::UniquePtr(
+				new stats::AssociationTest( "pheno", std::vector< std::string >( 1, "cov" ), samples, block_sizes[b], 1.0, 2 )
+			)
+		) ;
+		ResultLog log ;
+		std::vector< Results > results( number_of_variants ) ;
+		manager.add_result_callback( boost::bind( &log_result, &log, &results[0], _1, _2, _3 )) ;
+
+		manager.begin_processing_snps( number_of_samples, genfile::SNPDataSource::Metadata() ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			TestReader reader( data.genotypes[v], v == 2 ) ;
+			manager.processed_snp( get_variant( v ), reader ) ;
+		}
+		manager.end_processing_snps() ;
+
+		BOOST_REQUIRE( log.size() > 0 ) ;
+		for( std::size_t i = 1; i < log.size(); ++i ) {
+			BOOST_CHECK_LE( log[i-1].first, log[i].first ) ;
+		}
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			if( v == 2 ) {
+				BOOST_CHECK_EQUAL( results[v].size(), 1 ) ;
+				BOOST_CHECK( results[v].find( "comment" ) != results[v].end() ) ;
+			} else {
+				BOOST_CHECK_EQUAL( results[v].size(), expected[v].size() ) ;
+				for( Results::const_iterator i = expected[v].begin(); i != expected[v].end(); ++i ) {
+					BOOST_CHECK_EQUAL( results[v][ i->first ], i->second ) ;
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <boost/bind.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "components/SNPSummaryComponent/HWEComputation.hpp"
+#include "components/SNPSummaryComponent/InfoComputation.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_compute_by_stratum )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	std::size_t const number_of_samples = 200 ;
+	std::size_t const number_of_strata = 3 ;
+	char const* const chromosomes[] = { "1", "X", "2", "X" } ;
+	std::size_t const number_of_variants = 4 ;
+
+	// Neither computation reads any data from the reader.
+	struct NullReader: public genfile::VariantDataReader {
+		NullReader& get( std::string const& spec, PerSampleSetter& setter ) { assert(0) ; return *this ; }
+		bool supports( std::string const& spec ) const { return false ; }
+		void get_supported_specs( SpecSetter setter ) const {}
+		std::size_t get_number_of_samples() const { return number_of_samples ; }
+	} ;
+
+	// Genotype probabilities with frequencies differing between strata.  Most are confident calls,
+	// some are uncertain and some missing.  On the X chromosome, odd-numbered samples are haploid.
+	struct Data {
+		Data( std::size_t v, std::vector< int > const& sample_strata ):
+			snp( "rs" + genfile::string_utils::to_string( v ), genfile::GenomePosition( genfile::Chromosome( chromosomes[v] ), 1000 ), "A", "G" ),
+			genotypes( Matrix::Zero( number_of_samples, 3 )),
+			ploidy( Eigen::VectorXi::Constant( number_of_samples, 2 ))
+		{
+			std::mt19937 generator( 101 + v ) ;
+			std::uniform_real_distribution< double > uniform ;
+			bool const x_chromosome = snp.get_position().chromosome().is_sex_determining() ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				double const frequency = 0.1 + 0.25 * ( sample_strata[i] + 1 ) ;
+				if( x_chromosome && i % 2 == 1 ) {
+					ploidy(i) = 1 ;
+				}
+				int g = ( uniform( generator ) < frequency ) ;
+				if( ploidy(i) == 2 ) {
+					g += ( uniform( generator ) < frequency ) ;
+				}
+				double const u = uniform( generator ) ;
+				if( u < 0.1 ) {
+					// missing
+				} else if( u < 0.3 ) {
+					double const p = 0.5 + 0.3 * uniform( generator ) ;
+					genotypes( i, g ) = p ;
+					genotypes( i, ( g + 1 ) % ( ploidy(i) + 1 )) = ( 1 - p ) * 0.9 ;
+				} else {
+					genotypes( i, g ) = 1 ;
+				}
+			}
+		}
+
+		genfile::VariantIdentifyingData const snp ;
+		Matrix genotypes ;
+		Eigen::VectorXi ploidy ;
+	} ;
+
+	typedef std::map< std::string, genfile::VariantEntry > Results ;
+
+	void store_result( Results* results, std::string const& name, genfile::VariantEntry const& value ) {
+		(*results)[ name ] = value ;
+	}
+
+	void store_stratified_result( std::vector< Results >* results, std::size_t stratum, std::string const& name, genfile::VariantEntry const& value ) {
+		(*results)[ stratum ][ name ] = value ;
+	}
+
+	bool close( genfile::VariantEntry const& a, genfile::VariantEntry const& b ) {
+		if( a.is_double() && b.is_double() ) {
+			double const x = a.as< double >() ;
+			double const y = b.as< double >() ;
+			if( x != x || y != y ) {
+				return ( x != x ) && ( y != y ) ;
+			}
+			return std::abs( x - y ) <= 1e-10 * std::max( 1.0, std::abs( y )) ;
+		}
+		return a == b ;
+	}
+
+	// Check that computing all strata in one sweep gives the same results as computing each stratum's
+	// samples separately.
+	void check_strata( stats::SNPSummaryComputation& computation ) {
+		BOOST_REQUIRE( computation.can_compute_by_stratum() ) ;
+		// Interleaved strata of different sizes; every seventh sample is in no stratum.
+		std::vector< int > sample_strata( number_of_samples ) ;
+		std::vector< std::vector< int > > members( number_of_strata ) ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			sample_strata[i] = ( i % 7 == 6 ) ? -1 : int(( i * i ) % number_of_strata ) ;
+			if( sample_strata[i] >= 0 ) {
+				members[ sample_strata[i] ].push_back( i ) ;
+			}
+		}
+
+		NullReader reader ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			Data const data( v, sample_strata ) ;
+			std::vector< Results > results( number_of_strata ) ;
+			computation.compute_by_stratum(
+				data.snp, data.genotypes, data.ploidy, reader, sample_strata, number_of_strata,
+				boost::bind( &store_stratified_result, &results, _1, _2, _3 )
+			) ;
+			for( std::size_t s = 0; s < number_of_strata; ++s ) {
+				Matrix genotypes( members[s].size(), 3 ) ;
+				Eigen::VectorXi ploidy( members[s].size() ) ;
+				for( std::size_t i = 0; i < members[s].size(); ++i ) {
+					genotypes.row(i) = data.genotypes.row( members[s][i] ) ;
+					ploidy(i) = data.ploidy( members[s][i] ) ;
+				}
+				Results expected ;
+				computation( data.snp, genotypes, ploidy, reader, boost::bind( &store_result, &expected, _1, _2 )) ;
+				BOOST_REQUIRE( expected.size() > 0 ) ;
+				BOOST_CHECK_EQUAL( results[s].size(), expected.size() ) ;
+				for( Results::const_iterator i = expected.begin(); i != expected.end(); ++i ) {
+					Results::const_iterator where = results[s].find( i->first ) ;
+					BOOST_REQUIRE( where != results[s].end() ) ;
+					BOOST_CHECK_MESSAGE( close( where->second, i->second ), data.snp << ": " << i->first << "[" << s << "]: " << where->second << " != " << i->second ) ;
+				}
+			}
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_hwe_by_stratum ) {
+	stats::HWEComputation computation ;
+	check_strata( computation ) ;
+}
+
+AUTO_TEST_CASE( test_info_by_stratum ) {
+	stats::InfoComputation computation ;
+	check_strata( computation ) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
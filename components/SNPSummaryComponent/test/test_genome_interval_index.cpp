@@ -0,0 +1,233 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <Eigen/Core>
+#include "genfile/Chromosome.hpp"
+#include "genfile/GenomePosition.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/FileUtils.hpp"
+#include "components/SNPSummaryComponent/GenomeIntervalIndex.hpp"
+#include "components/SNPSummaryComponent/Bed3Annotation.hpp"
+#include "components/SNPSummaryComponent/Bed4Annotation.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_genome_interval_index )
+
+namespace {
+	typedef stats::GenomeIntervalIndex Index ;
+	typedef Index::Position Position ;
+
+	struct Interval {
+		Interval( std::string const& chromosome_, Position start_, Position end_, std::size_t value_ ):
+			chromosome( chromosome_ ), start( start_ ), end( end_ ), value( value_ )
+		{}
+		std::string chromosome ;
+		Position start ;
+		Position end ;
+		std::size_t value ;
+	} ;
+
+	// Many short intervals with gaps of varying length on chromosome 1, so that lookups step over
+	// more intervals than are searched linearly; a few on chromosome 2; none on chromosome 3.
+	std::vector< Interval > get_intervals() {
+		std::vector< Interval > result ;
+		Position start = 5 ;
+		for( std::size_t i = 0; i < 200; ++i ) {
+			Position const end = start + 1 + ( i % 4 ) ;
+			result.push_back( Interval( "1", start, end, i )) ;
+			// Some intervals are adjacent.
+			start = end + (( i % 5 == 0 ) ? 0 : ( 1 + ( i % 7 ))) ;
+		}
+		result.push_back( Interval( "2", 0, 3, 1000 )) ;
+		result.push_back( Interval( "2", 100, 200, 1001 )) ;
+		return result ;
+	}
+
+	// The value of the interval containing the given position, found by brute force.
+	std::size_t expected_value( std::vector< Interval > const& intervals, std::string const& chromosome, Position position ) {
+		for( std::size_t i = 0; i < intervals.size(); ++i ) {
+			if( intervals[i].chromosome == chromosome && intervals[i].start <= position && position < intervals[i].end ) {
+				return intervals[i].value ;
+			}
+		}
+		return Index::npos ;
+	}
+
+	struct Fixture {
+		Fixture():
+			intervals( get_intervals() )
+		{
+			for( std::size_t i = 0; i < intervals.size(); ++i ) {
+				index.add( genfile::Chromosome( intervals[i].chromosome ), intervals[i].start, intervals[i].end, intervals[i].value ) ;
+			}
+		}
+
+		// Look up the positions on the chromosome using one cursor, checking each result.
+		void check( std::string const& chromosome, std::vector< Position > const& positions, Index::Cursor* cursor ) const {
+			for( std::size_t i = 0; i < positions.size(); ++i ) {
+				BOOST_CHECK_EQUAL( index.find( positions[i], cursor ), expected_value( intervals, chromosome, positions[i] )) ;
+			}
+		}
+
+		std::vector< Interval > const intervals ;
+		Index index ;
+	} ;
+
+	std::vector< Position > range( Position begin, Position end, Position step = 1 ) {
+		std::vector< Position > result ;
+		for( Position position = begin; position < end; position += step ) {
+			result.push_back( position ) ;
+		}
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_sorted_queries ) {
+	Fixture const fixture ;
+	BOOST_CHECK_EQUAL( fixture.index.size(), fixture.intervals.size() ) ;
+	Position const end = fixture.intervals[199].end + 10 ;
+	Index::Cursor cursor ;
+	fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+	fixture.check( "1", range( 0, end ), &cursor ) ;
+	// Repeated positions, as for multiallelic variants.
+	fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+	std::vector< Position > positions ;
+	for( Position position = 0; position < end; position += 3 ) {
+		positions.push_back( position ) ;
+		positions.push_back( position ) ;
+	}
+	fixture.check( "1", positions, &cursor ) ;
+}
+
+AUTO_TEST_CASE( test_long_jumps ) {
+	Fixture const fixture ;
+	Position const end = fixture.intervals[199].end + 10 ;
+	// Steps over many intervals at once, forcing the fallback to binary search, mixed with short steps.
+	Position const steps[] = { 37, 101, 250 } ;
+	for( std::size_t i = 0; i < 3; ++i ) {
+		Index::Cursor cursor ;
+		fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+		std::vector< Position > positions ;
+		for( Position position = 0; position < end; position += steps[i] ) {
+			positions.push_back( position ) ;
+			positions.push_back( position + 1 ) ;
+			positions.push_back( position + 2 ) ;
+		}
+		fixture.check( "1", positions, &cursor ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_unsorted_queries ) {
+	Fixture const fixture ;
+	Position const end = fixture.intervals[199].end + 10 ;
+	// Reverse order.
+	{
+		std::vector< Position > positions = range( 0, end ) ;
+		std::reverse( positions.begin(), positions.end() ) ;
+		Index::Cursor cursor ;
+		fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+		fixture.check( "1", positions, &cursor ) ;
+	}
+	// Random order.
+	{
+		std::vector< Position > positions = range( 0, end ) ;
+		std::mt19937 generator( 7 ) ;
+		std::shuffle( positions.begin(), positions.end(), generator ) ;
+		Index::Cursor cursor ;
+		fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+		fixture.check( "1", positions, &cursor ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_chromosome_changes ) {
+	Fixture const fixture ;
+	Index::Cursor cursor ;
+	// Chromosome 2 lies after chromosome 1 in the index, and starts at position 0.
+	fixture.index.seek( genfile::Chromosome( "2" ), &cursor ) ;
+	fixture.check( "2", range( 0, 250 ), &cursor ) ;
+	// Moving back to chromosome 1 must not find chromosome 2's intervals, and vice versa.
+	fixture.index.seek( genfile::Chromosome( "1" ), &cursor ) ;
+	fixture.check( "1", range( 0, 250 ), &cursor ) ;
+	fixture.index.seek( genfile::Chromosome( "2" ), &cursor ) ;
+	fixture.check( "2", range( 150, 250 ), &cursor ) ;
+	fixture.check( "2", range( 0, 10 ), &cursor ) ;
+	// Chromosomes without intervals find nothing.
+	fixture.index.seek( genfile::Chromosome( "3" ), &cursor ) ;
+	fixture.check( "3", range( 0, 250 ), &cursor ) ;
+	// Cursors are independent.
+	Index::Cursor other ;
+	fixture.index.seek( genfile::Chromosome( "1" ), &other ) ;
+	fixture.index.seek( genfile::Chromosome( "2" ), &cursor ) ;
+	BOOST_CHECK_EQUAL( fixture.index.find( 150, &cursor ), 1001 ) ;
+	BOOST_CHECK_EQUAL( fixture.index.find( 5, &other ), 0 ) ;
+	BOOST_CHECK_EQUAL( fixture.index.find( 1, &cursor ), 1000 ) ;
+}
+
+namespace {
+	struct NullReader: public genfile::VariantDataReader {
+		NullReader& get( std::string const& spec, PerSampleSetter& setter ) { assert(0) ; return *this ; }
+		bool supports( std::string const& spec ) const { return false ; }
+		void get_supported_specs( SpecSetter setter ) const {}
+		std::size_t get_number_of_samples() const { return 0 ; }
+	} ;
+
+	void store_result( std::map< std::string, genfile::VariantEntry >* results, std::string const& name, genfile::VariantEntry const& value ) {
+		(*results)[ name ] = value ;
+	}
+
+	std::map< std::string, genfile::VariantEntry > annotate( stats::SNPSummaryComputation& computation, Position position ) {
+		NullReader reader ;
+		std::map< std::string, genfile::VariantEntry > result ;
+		computation(
+			genfile::VariantIdentifyingData( "rs1", genfile::GenomePosition( genfile::Chromosome( "1" ), position ), "A", "G" ),
+			Eigen::MatrixXd(), Eigen::VectorXi(), reader,
+			boost::bind( &store_result, &result, _1, _2 )
+		) ;
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_bed_margin_clamped_at_zero ) {
+	// The first interval starts closer to position zero than the left margin.
+	std::string const filename = genfile::create_temporary_filename() + ".bed" ;
+	{
+		std::ofstream bed( filename.c_str() ) ;
+		bed << "1\t3\t10\tfirst\n1\t100\t110\tsecond\n" ;
+	}
+	int const left_margin = 10 ;
+	int const right_margin = 2 ;
+	stats::Bed3Annotation bed3 ;
+	bed3.add_annotation( "in_bed", filename, left_margin, right_margin ) ;
+	stats::Bed4Annotation bed4 ;
+	bed4.add_annotation( "bed_name", filename, left_margin, right_margin ) ;
+
+	// In 1-based coordinates the intervals with margins cover [0, 13) and [91, 113).
+	for( Position position = 0; position < 130; ++position ) {
+		bool const first = ( position < 13 ) ;
+		bool const second = ( position >= 91 && position < 113 ) ;
+		BOOST_CHECK_EQUAL( annotate( bed3, position )[ "in_bed" ], genfile::VariantEntry( int64_t(( first || second ) ? 1 : 0 ))) ;
+		genfile::VariantEntry const name = annotate( bed4, position )[ "bed_name" ] ;
+		if( first ) {
+			BOOST_CHECK_EQUAL( name, genfile::VariantEntry( "first" )) ;
+		} else if( second ) {
+			BOOST_CHECK_EQUAL( name, genfile::VariantEntry( "second" )) ;
+		} else {
+			BOOST_CHECK( name.is_missing() ) ;
+		}
+	}
+	boost::filesystem::remove( filename ) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,207 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <map>
+#include <sstream>
+#include <random>
+#include <limits>
+#include <boost/bind.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/CategoricalCohortIndividualSource.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+#include "components/SNPSummaryComponent/ClusterFitComputation.hpp"
+#include "components/SNPSummaryComponent/SNPSummaryComputationManager.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_stratified_computation )
+
+namespace {
+	typedef Eigen::MatrixXd Matrix ;
+	double const NA = std::numeric_limits< double >::quiet_NaN() ;
+	std::size_t const number_of_samples = 90 ;
+	// More than one block of ClusterFitComputation with two threads, with a partial final block.
+	std::size_t const number_of_variants = 45 ;
+
+	// Hard-called genotypes and XY intensities clustered by genotype, with some missing intensities.
+	struct Data {
+		Data():
+			genotypes( number_of_variants, Matrix::Zero( number_of_samples, 3 )),
+			intensities( number_of_variants, Matrix::Zero( number_of_samples, 2 ))
+		{
+			std::mt19937 generator( 4321 ) ;
+			std::normal_distribution< double > normal ;
+			std::uniform_real_distribution< double > uniform ;
+			double const centres[3][2] = { { 1.0, 0.1 }, { 0.6, 0.6 }, { 0.1, 1.0 } } ;
+			for( std::size_t v = 0; v < number_of_variants; ++v ) {
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					int const g = ( uniform( generator ) < 0.4 ) + ( uniform( generator ) < 0.4 ) ;
+					genotypes[v]( i, g ) = 1 ;
+					for( int j = 0; j < 2; ++j ) {
+						intensities[v]( i, j ) = ( ( i + v ) % 23 == 0 ) ? NA : ( centres[g][j] + 0.05 * normal( generator )) ;
+					}
+				}
+			}
+		}
+
+		std::vector< Matrix > genotypes ;
+		std::vector< Matrix > intensities ;
+	} ;
+
+	// Reader giving the genotypes and intensities of one simulated variant.
+	struct TestReader: public genfile::VariantDataReader {
+		TestReader( Matrix const& genotypes, Matrix const& intensities ):
+			m_genotypes( genotypes ),
+			m_intensities( intensities )
+		{}
+
+		TestReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			bool const xy = ( spec == "XY" ) ;
+			Matrix const& values = xy ? m_intensities : m_genotypes ;
+			setter.initialise( values.rows(), 2 ) ;
+			for( int i = 0; i < values.rows(); ++i ) {
+				if( setter.set_sample( i )) {
+					if( xy ) {
+						setter.set_number_of_entries( 2, 2, genfile::ePerAllele, genfile::eDosage ) ;
+					} else {
+						setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					}
+					for( int j = 0; j < values.cols(); ++j ) {
+						if( values( i, j ) == values( i, j ) ) {
+							setter.set_value( j, values( i, j )) ;
+						} else {
+							setter.set_value( j, genfile::MissingValue() ) ;
+						}
+					}
+				}
+			}
+			setter.finalise() ;
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const { return spec == ":genotypes:" || spec == "XY" ; }
+		void get_supported_specs( SpecSetter setter ) const {
+			setter( ":genotypes:", "Float" ) ;
+			setter( "XY", "Float" ) ;
+		}
+		std::size_t get_number_of_samples() const { return m_genotypes.rows() ; }
+
+	private:
+		Matrix const& m_genotypes ;
+		Matrix const& m_intensities ;
+	} ;
+
+	genfile::VariantIdentifyingData get_variant( std::size_t v ) {
+		return genfile::VariantIdentifyingData(
+			"rs" + genfile::string_utils::to_string( v ),
+			genfile::GenomePosition( genfile::Chromosome( "1" ), 1000 + v ),
+			"A", "G"
+		) ;
+	}
+
+	std::string sample_file() {
+		std::ostringstream result ;
+		result << "ID_1 ID_2 missing\n0 0 0\n" ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			result << "sample_" << i << " sample_" << i << " 0\n" ;
+		}
+		return result.str() ;
+	}
+
+	typedef std::map< std::string, genfile::VariantEntry > Results ;
+
+	void store_result( Results* results, std::string const& suffix, std::string const& name, genfile::VariantEntry const& value ) {
+		(*results)[ name + suffix ] = value ;
+	}
+
+	void log_result( std::vector< std::string >* order, std::vector< Results >* results, genfile::VariantIdentifyingData const& snp, std::string const& name, genfile::VariantEntry const& value ) {
+		std::size_t const v = genfile::string_utils::to_repr< std::size_t >( std::string( snp.get_primary_id() ).substr( 2 )) ;
+		order->push_back( snp.get_primary_id() ) ;
+		(*results)[v][ name ] = value ;
+	}
+
+	bool equal( genfile::VariantEntry const& a, genfile::VariantEntry const& b ) {
+		if( a.is_double() && b.is_double() && a.as< double >() != a.as< double >() ) {
+			return b.as< double >() != b.as< double >() ;
+		}
+		return a == b ;
+	}
+}
+
+AUTO_TEST_CASE( test_threaded_cluster_fit_by_stratum ) {
+	Data const data ;
+	std::istringstream sample_stream( sample_file() ) ;
+	genfile::CategoricalCohortIndividualSource const samples( sample_stream ) ;
+
+	// Two interleaved strata; every fifth sample is in neither.
+	stats::SNPSummaryComputationManager::StrataMembers strata ;
+	for( std::size_t i = 0; i < number_of_samples; ++i ) {
+		if( i % 5 != 4 ) {
+			strata[ genfile::VariantEntry( ( i % 2 ) ? "b" : "a" ) ].push_back( i ) ;
+		}
+	}
+
+	// Expected results: each stratum's data fitted on its own, without threads.
+	std::vector< Results > expected( number_of_variants ) ;
+	for( stats::SNPSummaryComputationManager::StrataMembers::const_iterator stratum_i = strata.begin(); stratum_i != strata.end(); ++stratum_i ) {
+		std::vector< int > const& members = stratum_i->second ;
+		std::string const suffix = "[group=" + stratum_i->first.as< std::string >() + "]" ;
+		stats::ClusterFitComputation computation( 20 ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			Matrix genotypes( members.size(), 3 ) ;
+			Matrix intensities( members.size(), 2 ) ;
+			Eigen::VectorXi const ploidy = Eigen::VectorXi::Constant( members.size(), 2 ) ;
+			for( std::size_t i = 0; i < members.size(); ++i ) {
+				genotypes.row(i) = data.genotypes[v].row( members[i] ) ;
+				intensities.row(i) = data.intensities[v].row( members[i] ) ;
+			}
+			TestReader reader( genotypes, intensities ) ;
+			computation( get_variant( v ), genotypes, ploidy, reader, boost::bind( &store_result, &expected[v], suffix, _1, _2 )) ;
+		}
+	}
+
+	std::size_t const threads[] = { 0, 2 } ;
+	for( std::size_t t = 0; t < 2; ++t ) {
+		stats::SNPSummaryComputationManager manager( samples, "sex" ) ;
+		manager.add_computation(
+			"cluster-fit",
+			stats::SNPSummaryComputation::UniquePtr( new stats::ClusterFitComputation( 20, 0.5, 10, 0.9, threads[t] ))
+		) ;
+		manager.stratify_by( strata, "group" ) ;
+		std::vector< std::string > order ;
+		std::vector< Results > results( number_of_variants ) ;
+		manager.add_result_callback( boost::bind( &log_result, &order, &results, _1, _2, _3 )) ;
+
+		manager.begin_processing_snps( number_of_samples, genfile::SNPDataSource::Metadata() ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			TestReader reader( data.genotypes[v], data.intensities[v] ) ;
+			manager.processed_snp( get_variant( v ), reader ) ;
+		}
+		manager.end_processing_snps() ;
+
+		// Results for all variants, including those in the final partial block, come out in order.
+		for( std::size_t i = 1; i < order.size(); ++i ) {
+			BOOST_CHECK_LE(
+				genfile::string_utils::to_repr< std::size_t >( order[i-1].substr( 2 )),
+				genfile::string_utils::to_repr< std::size_t >( order[i].substr( 2 ))
+			) ;
+		}
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			BOOST_REQUIRE( expected[v].size() > 0 ) ;
+			BOOST_CHECK_EQUAL( results[v].size(), expected[v].size() ) ;
+			for( Results::const_iterator i = expected[v].begin(); i != expected[v].end(); ++i ) {
+				Results::const_iterator where = results[v].find( i->first ) ;
+				BOOST_REQUIRE( where != results[v].end() ) ;
+				BOOST_CHECK( equal( where->second, i->second )) ;
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 #include "genfile/SNPDataSourceProcessor.hpp"
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/vcf/get_set_eigen.hpp"
+#include "genfile/DecodedVariantData.hpp"
 #include "appcontext/OptionProcessor.hpp"
 #include "appcontext/UIContext.hpp"
 #include "components/SampleSummaryComponent/SampleSummaryComputation.hpp"
@@ -36,10 +37,7 @@ void SampleSummaryComputationManager::begin_processing_snps( std::size_t number_
 }
 
 void SampleSummaryComputationManager::processed_snp( genfile::VariantIdentifyingData const& snp, genfile::VariantDataReader& data_reader ) {
-	{
-		genfile::vcf::GenotypeSetter< Eigen::MatrixBase< SampleSummaryComputation::Genotypes > > setter( m_genotypes ) ;
-		data_reader.get( ":genotypes:", setter ) ;
-	}
+	SampleSummaryComputation::Genotypes const& genotypes = data_reader.decoded().genotype_probabilities() ;
 	Computations::iterator i = m_computations.begin(), end_i = m_computations.end() ;
 	for( ; i != end_i; ++i ) {
 		genfile::Chromosome chr( i->first.second ) ;
@@ -51,7 +49,7 @@ void SampleSummaryComputationManager::processed_snp( genfile::VariantIdentifying
 		) {
 			i->second->accumulate(
 				snp,
-				m_genotypes,
+				genotypes,
 				data_reader
 			) ;
 		}
@@ -4,21 +4,132 @@
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
-
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+#include "config/config.hpp"
+#if HAVE_CBLAS
+	#include "cblas.h"
+#endif
 #include "fputils/floating_point_utils.hpp"
 #include "fputils/log_space_matrix_multiply.hpp"
 
 namespace fputils {
+	namespace {
+		double const infinity = std::numeric_limits< double >::infinity() ;
+
+		// Tile size for the blocked product.  Three 64x64 tiles of doubles fit in a 128Kb L2 cache.
+		std::size_t const block_size = 64 ;
+
+		// Entries of the scaled linear-space product smaller than this may have lost precision
+		// through underflow, and are recomputed directly in log space.
+		double const minimum_scaled_entry = 1E-280 ;
+
+		// Compute result = left * right, where left is I x K, right is K x J, and all are stored row-major.
+		void linear_space_matrix_multiply(
+			double const* left, double const* right, double* result,
+			std::size_t const I, std::size_t const J, std::size_t const K
+		) {
+#if HAVE_CBLAS
+			cblas_dgemm(
+				CblasRowMajor, CblasNoTrans, CblasNoTrans,
+				I, J, K,
+				1.0, left, K,
+				right, J,
+				0.0, result, J
+			) ;
+#else
+			std::fill( result, result + I * J, 0.0 ) ;
+			for( std::size_t i0 = 0; i0 < I; i0 += block_size ) {
+				std::size_t const i1 = std::min( i0 + block_size, I ) ;
+				for( std::size_t k0 = 0; k0 < K; k0 += block_size ) {
+					std::size_t const k1 = std::min( k0 + block_size, K ) ;
+					for( std::size_t j0 = 0; j0 < J; j0 += block_size ) {
+						std::size_t const j1 = std::min( j0 + block_size, J ) ;
+						for( std::size_t i = i0; i < i1; ++i ) {
+							double* result_row = result + i * J ;
+							for( std::size_t k = k0; k < k1; ++k ) {
+								double const l = left[ i * K + k ] ;
+								double const* right_row = right + k * J ;
+								// innermost loop is contiguous, so can be vectorised.
+								for( std::size_t j = j0; j < j1; ++j ) {
+									result_row[j] += l * right_row[j] ;
+								}
+							}
+						}
+					}
+				}
+			}
+#endif
+		}
+	}
+
+	// We compute the product as
+	//
+	//   result(i,j) = a_i + b_j + log( sum_k exp( left(i,k) - a_i ) exp( right(k,j) - b_j ) )
+	//
+	// where a_i and b_j are the row maxima of left and column maxima of right.  The scaled matrices
+	// have entries in [0,1], so the inner sum is a standard linear-space product with no risk of overflow.
+	// If the largest terms of a row and column do not coincide, an entry of that product can underflow;
+	// such entries, and those involving infinite maxima, are recomputed directly by log_sum_exp().
 	Matrix log_space_matrix_multiply( Matrix const& left, Matrix const& right ) {
 		assert( left.size2() == right.size1() ) ;
-		Matrix result( left.size1(), right.size2() ) ;
-		for( std::size_t i = 0; i < result.size1(); ++i ) {
-			for( std::size_t j = 0; j < result.size2(); ++j ) {
-				std::vector< double > entries( left.size2() ) ;
-				for( std::size_t k = 0; k < left.size2(); ++k ) {
-					entries[k] = left(i, k) + right( k, j ) ;
+		std::size_t const I = left.size1() ;
+		std::size_t const J = right.size2() ;
+		std::size_t const K = left.size2() ;
+		Matrix result( I, J ) ;
+
+		std::vector< double > row_max( I, -infinity ) ;
+		std::vector< double > column_max( J, -infinity ) ;
+		for( std::size_t i = 0; i < I; ++i ) {
+			for( std::size_t k = 0; k < K; ++k ) {
+				row_max[i] = std::max( row_max[i], left( i, k )) ;
+			}
+		}
+		for( std::size_t k = 0; k < K; ++k ) {
+			for( std::size_t j = 0; j < J; ++j ) {
+				column_max[j] = std::max( column_max[j], right( k, j )) ;
+			}
+		}
+
+		// Rescale into linear space.  Rows or columns with non-finite maxima are zeroed
+		// here and handled by the direct computation below.
+		std::vector< double > scaled_left( I * K ) ;
+		std::vector< double > scaled_right( K * J ) ;
+		for( std::size_t i = 0; i < I; ++i ) {
+			bool const finite = std::abs( row_max[i] ) < infinity ;
+			for( std::size_t k = 0; k < K; ++k ) {
+				scaled_left[ i * K + k ] = finite ? std::exp( left( i, k ) - row_max[i] ) : 0.0 ;
+			}
+		}
+		for( std::size_t k = 0; k < K; ++k ) {
+			for( std::size_t j = 0; j < J; ++j ) {
+				bool const finite = std::abs( column_max[j] ) < infinity ;
+				scaled_right[ k * J + j ] = finite ? std::exp( right( k, j ) - column_max[j] ) : 0.0 ;
+			}
+		}
+
+		std::vector< double > product( I * J ) ;
+		if( I > 0 && J > 0 && K > 0 ) {
+			linear_space_matrix_multiply( &scaled_left[0], &scaled_right[0], &product[0], I, J, K ) ;
+		}
+
+		std::vector< double > entries( K ) ;
+		for( std::size_t i = 0; i < I; ++i ) {
+			for( std::size_t j = 0; j < J; ++j ) {
+				double const scaled_entry = product[ i * J + j ] ;
+				if( scaled_entry >= minimum_scaled_entry ) {
+					result( i, j ) = row_max[i] + column_max[j] + std::log( scaled_entry ) ;
+				} else if( row_max[i] == -infinity || column_max[j] == -infinity ) {
+					result( i, j ) = -infinity ;
+				} else {
+					for( std::size_t k = 0; k < K; ++k ) {
+						entries[k] = left( i, k ) + right( k, j ) ;
+					}
+					result( i, j ) = log_sum_exp( entries.begin(), entries.end() ) ;
 				}
-				result( i , j ) = log_sum_exp( entries.begin(), entries.end() ) ;
 			}
 		}
 		return result ;
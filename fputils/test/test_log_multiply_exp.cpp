@@ -5,8 +5,13 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include <iostream>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <algorithm>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/io.hpp>
+#include "fputils/floating_point_utils.hpp"
 #include "fputils/log_space_matrix_multiply.hpp"
 #include "test_case.hpp"
 
@@ -161,3 +166,37 @@ AUTO_TEST_CASE( test_log_space_matrix_multiply ) {
 		TEST_ASSERT( m == expected_results[i] ) ;
 	}
 }
+
+AUTO_TEST_CASE( test_log_space_matrix_multiply_wide_range ) {
+	std::cerr << "test_log_space_matrix_multiply_wide_range...\n" ;
+	// Entries spanning a range wider than double precision can represent in linear space,
+	// and -infinity entries, must give the same results as direct computation.
+	double const infinity = std::numeric_limits< double >::infinity() ;
+	Matrix left( 3, 3 ) ;
+	Matrix right( 3, 2 ) ;
+	left( 0, 0 ) = 0 ;			left( 0, 1 ) = -1000 ;		left( 0, 2 ) = -2000 ;
+	left( 1, 0 ) = -infinity ;	left( 1, 1 ) = -infinity ;	left( 1, 2 ) = -infinity ;
+	left( 2, 0 ) = 700 ;		left( 2, 1 ) = -infinity ;	left( 2, 2 ) = -5 ;
+	right( 0, 0 ) = -2000 ;		right( 0, 1 ) = 3 ;
+	right( 1, 0 ) = -1000 ;		right( 1, 1 ) = -infinity ;
+	right( 2, 0 ) = 0 ;			right( 2, 1 ) = 1 ;
+
+	Matrix m = fputils::log_space_matrix_multiply( left, right ) ;
+	for( std::size_t i = 0; i < m.size1(); ++i ) {
+		for( std::size_t j = 0; j < m.size2(); ++j ) {
+			std::vector< double > entries( left.size2() ) ;
+			for( std::size_t k = 0; k < left.size2(); ++k ) {
+				entries[k] = left( i, k ) + right( k, j ) ;
+			}
+			double const expected = fputils::log_sum_exp( entries.begin(), entries.end() ) ;
+			if( expected == -infinity ) {
+				TEST_ASSERT( m( i, j ) == -infinity ) ;
+			} else {
+				TEST_ASSERT( std::abs( m( i, j ) - expected ) < 1E-12 * std::max( 1.0, std::abs( expected ))) ;
+			}
+		}
+	}
+	TEST_ASSERT( std::abs( m( 0, 0 ) - ( -2000 + std::log( 3.0 ))) < 1E-9 ) ;
+	TEST_ASSERT( m( 1, 0 ) == -infinity ) ;
+	TEST_ASSERT( m( 1, 1 ) == -infinity ) ;
+}
@@ -116,7 +116,6 @@ namespace genfile {
 
 		~BGenFileSNPDataSink() ;
 
-		friend class SortingBGenFileSNPDataSink ;
 	} ;
 }
 
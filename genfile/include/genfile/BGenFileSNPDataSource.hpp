@@ -12,6 +12,7 @@
 #include "snp_data_utils.hpp"
 #include "SNPDataSource.hpp"
 #include "IdentifyingDataCachingSNPDataSource.hpp"
+#include "VariantIdentifyingDataTest.hpp"
 #include "bgen/bgen.hpp"
 #include "Chromosome.hpp"
 
@@ -34,13 +35,23 @@ namespace genfile {
 		unsigned int number_of_samples() const { return m_bgen_context.number_of_samples ; }
 		bool has_sample_ids() const ;
 		void get_sample_ids( GetSampleIds ) const ;
-		OptionalSnpCount total_number_of_snps() const { return m_bgen_context.number_of_variants ; }
+		OptionalSnpCount total_number_of_snps() const ;
 		operator bool() const { return m_stream_ptr->good() ; }
 
 		std::istream& stream() { return *m_stream_ptr ; }
 		std::istream const& stream() const { return *m_stream_ptr ; }
 		std::string get_source_spec() const ;
 		bgen::Context const& bgen_context() const { return m_bgen_context ; }
+		IOCounts get_io_counts() const { return m_io_counts ; }
+
+		// Skip variants for which the test's may_pass() returns false.  This is evaluated on the
+		// position and IDs as read from the file, before identifying data is constructed
+		// or genotypes are read.  The test must outlive this source.
+		void set_prefilter( VariantIdentifyingDataTest const& test ) ;
+
+		// Visit only the variants whose data starts at the given file offsets, as found in a .bgi index.
+		// Offsets are visited in increasing order.  This resets the source to the start.
+		void restrict_to_offsets( std::vector< int64_t > const& offsets ) ;
 
 	private:
 
@@ -52,6 +63,8 @@ namespace genfile {
 
 		void ignore_snp_probability_data_impl() ;
 
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
+
 	private:
 
 		std::string m_filename ;
@@ -59,12 +72,31 @@ namespace genfile {
 		bgen::Context m_bgen_context ;
 		boost::optional< std::vector< std::string > > m_sample_ids ;
 		std::auto_ptr< std::istream > m_stream_ptr ;
+		boost::optional< SampleSelection > m_sample_selection ;
+		std::size_t m_number_of_selected_samples ;
+		VariantIdentifyingDataTest const* m_prefilter ;
+		// Offsets of variants to visit, if restricted, and the index of the next one.
+		boost::optional< std::vector< int64_t > > m_visited_offsets ;
+		std::size_t m_visit_index ;
+
+		// Identifying data fields of the current variant, reused across variants.
+		std::string m_SNPID ;
+		std::string m_rsid ;
+		std::string m_chromosome_string ;
+		std::vector< std::string > m_alleles ;
+		VariantIdentifyingDataView m_view ;
+		// Files are usually sorted by chromosome, so we remember the last one seen.
+		std::string m_last_chromosome_string ;
+		Chromosome m_last_chromosome ;
 
 		void setup( std::auto_ptr< std::istream > stream ) ;
+		Chromosome const& get_chromosome( std::string const& name ) ;
+		bool seek_to_next_visited_variant() ;
 
 		uint32_t read_header_data() ;
 		std::vector< byte_t > m_compressed_data_buffer ;
 		std::vector< byte_t > m_uncompressed_data_buffer ;
+		IOCounts m_io_counts ;
 		
 		typedef std::istream_iterator<char> StreamIterator ;
 	} ;
@@ -9,9 +9,14 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <utility>
 #include "snp_data_utils.hpp"
 #include "SNPDataSource.hpp"
 #include "IdentifyingDataCachingSNPDataSource.hpp"
+#include "genfile/GenomePosition.hpp"
+#include "genfile/GenomePositionRange.hpp"
+#include "genfile/VariantIdentifyingDataTest.hpp"
 
 namespace genfile {
 	namespace impl {
@@ -19,7 +24,12 @@ namespace genfile {
 	}
 
 	// This class represents a SNPDataSource which reads its data
-	// from a BGEN file.
+	// from a PLINK binary PED (.bed) file.
+	// BED records have a fixed size, so the .bim file is loaded at construction
+	// and records are read by seeking directly to them.  This allows the set of
+	// variants visited to be restricted without reading the other records.
+	// To keep memory use low for large files, the .bim data is held in packed form
+	// and VariantIdentifyingData objects are constructed as variants are visited.
 	class BedFileSNPDataSource: public IdentifyingDataCachingSNPDataSource
 	{
 		friend struct impl::BedFileSNPDataReader ;
@@ -35,6 +45,25 @@ namespace genfile {
 		std::istream& stream() { return *m_bed_stream_ptr ; }
 		std::istream const& stream() const { return *m_bed_stream_ptr ; }
 		std::string get_source_spec() const { return m_bed_filename ; }
+		IOCounts get_io_counts() const { return m_io_counts ; }
+
+		// Restrict the variants visited to those in the given ranges or passing the given test.
+		// Restrictions are cumulative: each call narrows the current set of visited variants.
+		// Ranges are looked up using a sorted index of variant positions.
+		// These reset the source to the start and return the number of variants now visited.
+		std::size_t restrict_to_ranges( std::vector< GenomePositionRange > const& ranges ) ;
+		std::size_t restrict_to( VariantIdentifyingDataTest const& test ) ;
+
+		// Random access to all variants in the file, independent of any restriction
+		// and of the current position of the source.
+		std::size_t number_of_variants_in_file() const { return m_variant_keys.size() ; }
+		VariantIdentifyingData get_variant( std::size_t index ) const ;
+		std::size_t number_of_bytes_per_variant() const { return ( m_number_of_samples + 3 ) / 4 ; }
+
+		// Read the genotypes of count variants starting at first_variant into result, as
+		// count consecutive rows of number_of_bytes_per_variant() bytes in the BED 2-bit encoding.
+		// Rows cover all samples in the file, irrespective of any sample selection.
+		void read_packed_genotypes( std::size_t first_variant, std::size_t count, std::vector< char >* result ) ;
 
 	private:
 
@@ -43,6 +72,7 @@ namespace genfile {
 		void read_snp_identifying_data_impl( VariantIdentifyingData* result ) ;
 		VariantDataReader::UniquePtr read_variant_data_impl() ;
 		void ignore_snp_probability_data_impl() ;
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
 
 	private:
 		std::string const m_bed_filename ;
@@ -51,9 +81,31 @@ namespace genfile {
 		unsigned int m_number_of_samples ;
 		OptionalSnpCount m_total_number_of_snps ;
 		std::auto_ptr< std::istream > m_bed_stream_ptr ;
-		std::auto_ptr< std::istream > m_bim_stream_ptr ;
 		std::vector< std::pair< int64_t, int64_t > > m_genotype_table ;
+		boost::optional< std::vector< std::size_t > > m_selected_samples ;
+
+		// For each variant in file order, a key packing the index of its chromosome in m_chromosomes
+		// (upper 32 bits) with its position (lower 32 bits), and the offset of its ID and alleles,
+		// stored as consecutive nul-terminated strings, in m_identifiers.
+		std::vector< Chromosome > m_chromosomes ;
+		std::vector< uint64_t > m_variant_keys ;
+		std::vector< uint64_t > m_identifier_offsets ;
+		std::string m_identifiers ;
+		// Indices of variants sorted by key.
+		std::vector< uint32_t > m_position_index ;
+		// Indices of variants to visit, in file order, if restricted.
+		boost::optional< std::vector< std::size_t > > m_visited_variants ;
+		// Index into the list of visited variants, and the index in the file of the variant at that point.
+		std::size_t m_visit_index ;
+		std::size_t m_current_variant ;
+		// Index of the variant whose record the BED stream is positioned at.
+		std::size_t m_bed_stream_variant ;
+		IOCounts m_io_counts ;
+
 		void setup( std::string const& bedFilename, std::string const& bimFilename, std::string const& famFilename ) ;
+		void load_bim_file( std::string const& bimFilename ) ;
+		void seek_to_variant( std::size_t index ) ;
+		std::size_t set_visited_variants( std::vector< std::size_t > const& variants ) ;
 	} ;
 }
 
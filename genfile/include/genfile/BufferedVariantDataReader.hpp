@@ -0,0 +1,76 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_BUFFERED_VARIANT_DATA_READER_HPP
+#define GENFILE_BUFFERED_VARIANT_DATA_READER_HPP
+
+#include <map>
+#include <utility>
+#include <vector>
+#include <string>
+#include <exception>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/types.hpp"
+
+namespace genfile {
+	// A VariantDataReader that holds a complete copy of the data from another reader.
+	// Readers returned by SNPDataSource::read_variant_data() typically share buffers with their
+	// source and must be used before the next variant is read.  A BufferedVariantDataReader
+	// records every value the base reader sets, for each of a list of specs, in a compact encoding,
+	// and replays them on demand, so it remains valid after the source has moved on.  This allows
+	// data to be decoded in one thread and used in another.
+	class BufferedVariantDataReader: public VariantDataReader {
+	public:
+		typedef std::auto_ptr< BufferedVariantDataReader > UniquePtr ;
+
+		// Buffer the given specs from the given reader.
+		// If specs is empty, buffer all specs the reader lists in get_supported_specs(), together
+		// with ":genotypes:" and ":intensities:" if supported.
+		// An error raised while reading a spec is stored and raised again when that spec is requested.
+		static UniquePtr create(
+			VariantDataReader& reader,
+			std::vector< std::string > const& specs = std::vector< std::string >()
+		) ;
+
+		// Reconstruct a reader from the bytes written by serialise().
+		static UniquePtr deserialise( uint8_t const* begin, uint8_t const* const end ) ;
+
+	public:
+		BufferedVariantDataReader& get( std::string const& spec, PerSampleSetter& setter ) ;
+		bool supports( std::string const& spec ) const ;
+		void get_supported_specs( SpecSetter ) const ;
+		std::size_t get_number_of_samples() const { return m_number_of_samples ; }
+
+		// Append a binary encoding of the buffered data to the given buffer.
+		// Specs whose reading raised an error are omitted, so are not supported by the deserialised reader.
+		void serialise( std::vector< uint8_t >* buffer ) const ;
+
+		// Return the number of bytes used to hold the buffered data.
+		std::size_t get_memory_usage() const ;
+
+	private:
+		// The setter calls made by the base reader for one spec, encoded as a sequence of
+		// one-byte codes each followed by its arguments.  Sample and entry indices that follow
+		// on from the previous call, and repeated calls to set_number_of_entries(), are implied
+		// by the code; values 0 and 1 are encoded without arguments.
+		struct Record {
+			std::vector< uint8_t > data ;
+			std::exception_ptr error ;
+		} ;
+
+	private:
+		BufferedVariantDataReader( std::size_t number_of_samples ) ;
+		void record( VariantDataReader& reader, std::string const& spec ) ;
+
+	private:
+		std::size_t const m_number_of_samples ;
+		std::vector< std::pair< std::string, std::string > > m_supported_specs ;
+		typedef std::map< std::string, Record > Records ;
+		Records m_records ;
+	} ;
+}
+
+#endif
@@ -9,89 +9,83 @@
 
 #include <string>
 #include <iostream>
-#include <boost/noncopyable.hpp>
-#include <boost/optional.hpp>
-#include <boost/unordered_map.hpp>
+#include <stdint.h>
 
 namespace genfile {
-	struct Chromosome ;
-	namespace impl {
-		struct Genome: public boost::noncopyable {
-			virtual ~Genome() {} ;
-			virtual bool compare( Chromosome const& left, Chromosome const& right ) const = 0 ;
-		} ;
-
-		struct MapGenome: public Genome {
-			MapGenome( char const** strings, std::size_t N ) ;
-			~MapGenome() ;
-			bool compare( Chromosome const& left, Chromosome const& right ) const ;
-		private:
-			typedef boost::unordered_map< std::string, int > MapType ;
-			MapType m_map ;
-		} ;
-		
-		extern MapGenome human ;
-	}
-	
+	// A chromosome name, held as a code into a process-wide table of interned names so that
+	// chromosomes can be copied and compared as integers.
+	// Names of human chromosomes (1-22, X, Y and MT, with 0-padded and chr-prefixed variants)
+	// have fixed codes in genome order.  Other names are given increasing codes as they are
+	// first seen, and sort lexicographically after the human chromosomes.
+	// The missing chromosome sorts after all others.
 	struct Chromosome
 	{
 	public:
-		friend struct impl::MapGenome ;
+		typedef uint32_t Code ;
+		enum {
+			// Codes below this value are human chromosome names in genome order.
+			eNumberOfOrderedCodes = 62,
+			// Codes fit in 24 bits, see GenomePosition::key().
+			eMissingCode = 0xFFFFFF
+		} ;
 
 	public:
-		Chromosome( impl::Genome const& genome = impl::human ):
-			m_genome( &genome ),
-			m_repr()
+		Chromosome():
+			m_code( eMissingCode )
 		{}
 
-		Chromosome( std::string const& chromosome_str, impl::Genome const& genome = impl::human ):
-			m_genome( &genome ),
-			m_repr( chromosome_str )
-		{
-		}
+		Chromosome( std::string const& chromosome_str ) ;
 
 		Chromosome( Chromosome const& other ):
-			m_genome( other.m_genome ),
-			m_repr( other.m_repr )
+			m_code( other.m_code )
 		{}
 
 		Chromosome& operator=( Chromosome const& other ) {
-			m_genome = other.m_genome ;
-			m_repr = other.m_repr ;
+			m_code = other.m_code ;
 			return *this ;
 		}
 
 		bool operator==( std::string const& other ) const {
-			return m_repr == other ;
+			return m_code != eMissingCode && name( m_code ) == other ;
 		}
 
 		bool operator==( Chromosome const& other ) const {
-			return m_repr == other.m_repr ;
+			return m_code == other.m_code ;
 		}
 
 		bool operator!=( std::string const& other ) const {
-			return m_repr != other ;
+			return !operator==( other ) ;
 		}
 		
 		bool operator!=( Chromosome const& other ) const {
-			return m_repr != other.m_repr ;
+			return m_code != other.m_code ;
 		}
 		
 		bool operator<=( Chromosome const& other ) const {
-			return !m_genome->compare( other, *this ) ;
+			return !( other < *this ) ;
 		}
 
 		bool operator>=( Chromosome const& other ) const {
-			return !m_genome->compare( *this, other ) ;
+			return !( *this < other ) ;
 		}
 
 		bool operator<( Chromosome const& other ) const {
-			return m_genome->compare( *this, other ) ;
+			return compares_by_code( other ) ? ( m_code < other.m_code ) : less_by_name( m_code, other.m_code ) ;
 		}
 
 		bool operator>( Chromosome const& other ) const {
-			return m_genome->compare( other, *this ) ;
+			return other < *this ;
+		}
+
+		// Return true if this chromosome and the other are ordered in the same way as their codes.
+		// This is false only if both are non-human chromosomes with different names.
+		bool compares_by_code( Chromosome const& other ) const {
+			return m_code == other.m_code
+				|| m_code < eNumberOfOrderedCodes || other.m_code < eNumberOfOrderedCodes
+				|| m_code == eMissingCode || other.m_code == eMissingCode ;
 		}
+
+		Code code() const { return m_code ; }
 		
 		bool is_sex_determining() const ;
 		bool is_autosome() const ;
@@ -100,8 +94,10 @@ namespace genfile {
 		operator std::string () const ;
 
 	private:
-		impl::Genome const* m_genome ;
-		boost::optional< std::string > m_repr ;
+		Code m_code ;
+
+		static std::string const& name( Code code ) ;
+		static bool less_by_name( Code left, Code right ) ;
 	} ;
 	
 	std::ostream& operator<<( std::ostream&, Chromosome const& ) ;
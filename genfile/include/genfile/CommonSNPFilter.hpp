@@ -10,7 +10,8 @@
 #include <string>
 #include <memory>
 #include <set>
-#include <string>
+#include <map>
+#include <vector>
 #include "genfile/GenomePosition.hpp"
 #include "genfile/GenomePositionRange.hpp"
 #include "genfile/SNPDataSource.hpp"
@@ -21,6 +22,12 @@ namespace genfile {
 		/*
 		* This class acts as an easier-to-use frontend for a conjunction
 		* of common VariantIdentifyingDataTest types.
+		*
+		* Tests are compiled into a small number of clauses, each a disjunction
+		* of lookups in compact sorted or hashed structures: IDs in FlatStringSets,
+		* positions and ranges as sorted arrays of packed GenomePosition keys.
+		* Exclusions of the same kind share a clause, as do inclusions of the same kind.
+		* Clauses are evaluated cheapest first and evaluation stops at the first that fails.
 		*/
 	{
 	public:
@@ -28,11 +35,14 @@ namespace genfile {
 		
 		using VariantIdentifyingDataTest::operator() ;
 		bool operator()( VariantIdentifyingData const& data ) const ;
+		// Clauses that test only positions and IDs are evaluated on the view; others are assumed to pass.
+		bool may_pass( VariantIdentifyingDataView const& view ) const ;
 
 		std::string display() const ;
 
 	public:
 		CommonSNPFilter() ;
+		~CommonSNPFilter() ;
 		
 		enum Field { RSIDs = 1, SNPIDs = 2, Positions = 4 } ;
 		
@@ -60,12 +70,20 @@ namespace genfile {
 		CommonSNPFilter& include_snps_in_range( genfile::GenomePositionRange const& range ) ;
 
 	private:
-		VariantIdentifyingDataTestConjunction m_filter ;
-		std::map< std::string, CompoundVariantIdentifyingDataTest* > m_inclusion_filters ;
+		struct Clause ;
+		// Clauses in the order they were created, which is used for display.
+		std::vector< Clause* > m_clauses ;
+		// Clauses in the order they are evaluated.
+		std::vector< Clause const* > m_evaluation_order ;
+		// Clauses shared by all exclusions or all inclusions of a kind.
+		std::map< std::string, Clause* > m_named_clauses ;
+
 	private:
-		VariantIdentifyingDataTest::UniquePtr construct_snp_inclusion_test( std::set< std::string > const& set, int fields ) ;
-		void add_inclusion_filter_if_necessary( std::string const& name ) ;
-		std::set< std::string > read_strings_from_file( std::string const& filename ) ;
+		Clause& get_clause( std::string const& name, bool negated ) ;
+		Clause& add_clause( bool negated ) ;
+		void update_evaluation_order() ;
+		void add_snps_in_file( Clause& clause, std::string const& filename, int fields ) ;
+		void add_snps_in_set( Clause& clause, std::set< std::string > const& set, int fields ) ;
 	} ;
 }
 
@@ -0,0 +1,90 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_DECODED_VARIANT_DATA_HPP
+#define GENFILE_DECODED_VARIANT_DATA_HPP
+
+#include <map>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/Core>
+#include "genfile/types.hpp"
+
+namespace genfile {
+	class VariantDataReader ;
+
+	// Hard genotype calls for a set of samples, packed into two bits per sample.
+	struct HardCalls {
+		enum Call { eAA = 0, eAB = 1, eBB = 2, eMissing = 3 } ;
+
+		HardCalls() ;
+		// Resize to the given number of samples, with all calls missing.
+		void reset( std::size_t number_of_samples ) ;
+		std::size_t size() const { return m_size ; }
+		Call operator[]( std::size_t i ) const {
+			return Call(( m_data[ i >> 2 ] >> ( 2 * ( i & 3 ))) & 0x3 ) ;
+		}
+		void set( std::size_t i, Call call ) {
+			byte_t& byte = m_data[ i >> 2 ] ;
+			byte = ( byte & ~( 0x3 << ( 2 * ( i & 3 )))) | ( call << ( 2 * ( i & 3 ))) ;
+		}
+
+		// Store calls in the given vector, using the given value for each call.
+		template< typename Vector >
+		void get( Vector* result, double missing_value, double AA_value, double AB_value, double BB_value ) const {
+			double const values[4] = { AA_value, AB_value, BB_value, missing_value } ;
+			result->resize( m_size ) ;
+			for( std::size_t i = 0; i < m_size; ++i ) {
+				(*result)[i] = values[ (*this)[i] ] ;
+			}
+		}
+
+		// As above, also storing 1 for nonmissing and 0 for missing calls in nonmissingness.
+		template< typename Vector, typename Nonmissingness >
+		void get( Vector* result, Nonmissingness* nonmissingness, double missing_value, double AA_value, double AB_value, double BB_value ) const {
+			get( result, missing_value, AA_value, AB_value, BB_value ) ;
+			nonmissingness->resize( m_size ) ;
+			for( std::size_t i = 0; i < m_size; ++i ) {
+				(*nonmissingness)[i] = ( (*this)[i] == eMissing ) ? 0 : 1 ;
+			}
+		}
+
+	private:
+		std::size_t m_size ;
+		std::vector< byte_t > m_data ;
+	} ;
+
+	// Views of the ":genotypes:" field of a single variant, each decoded from the reader on first
+	// use and kept for later users.  This lets callbacks processing the same variant share one
+	// decode instead of each decoding their own copy.
+	// Genotypes are interpreted as by vcf::GenotypeSetterBase, so the variant must be biallelic.
+	// Views may be requested from several threads.
+	class DecodedVariantData: public boost::noncopyable {
+	public:
+		DecodedVariantData( VariantDataReader& reader ) ;
+
+		// Genotype probabilities as an N x 3 matrix, with rows of zeroes for missing samples.
+		Eigen::MatrixXd const& genotype_probabilities() ;
+		// Expected count of the second allele, or NaN for missing samples.
+		Eigen::VectorXf const& dosages() ;
+		// Calls of each genotype whose probability exceeds the given threshhold.
+		HardCalls const& hard_calls( double threshhold ) ;
+
+	private:
+		VariantDataReader& m_reader ;
+		boost::mutex m_mutex ;
+		bool m_have_probabilities ;
+		Eigen::MatrixXd m_probabilities ;
+		bool m_have_dosages ;
+		Eigen::VectorXf m_dosages ;
+		std::map< double, HardCalls > m_hard_calls ;
+
+		Eigen::MatrixXd const& get_probabilities() ;
+	} ;
+}
+
+#endif
@@ -0,0 +1,51 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_FLAT_STRING_SET_HPP
+#define GENFILE_FLAT_STRING_SET_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "genfile/string_utils/slice.hpp"
+
+namespace genfile {
+	// A set of strings stored end to end in a single buffer and looked up by hashing
+	// with open addressing.  Each string costs its length plus about 16 bytes, which
+	// makes this suitable for sets of millions of IDs where std::set< std::string >
+	// would need a heap node and string allocation per element.
+	struct FlatStringSet {
+	public:
+		typedef string_utils::slice slice ;
+
+	public:
+		FlatStringSet() ;
+
+		// Insert a value; return true if it was not already in the set.
+		bool insert( slice const& value ) ;
+		bool contains( slice const& value ) const ;
+		std::size_t size() const { return m_size ; }
+		bool empty() const { return m_size == 0 ; }
+		// Return up to the given number of values, in order of insertion.
+		std::vector< std::string > get_values( std::size_t max_number = std::string::npos ) const ;
+
+	private:
+		// Strings are stored as a 32-bit length followed by the characters.
+		std::vector< char > m_storage ;
+		// Each occupied slot holds 24 bits of the hash above 40 bits of ( offset into m_storage + 1 ).
+		// Empty slots hold zero.  The number of slots is a power of two.
+		std::vector< uint64_t > m_slots ;
+		std::size_t m_size ;
+
+	private:
+		static uint64_t hash( char const* begin, char const* end ) ;
+		bool equals( uint64_t slot, char const* begin, char const* end ) const ;
+		std::size_t find_slot( uint64_t hash, char const* begin, char const* end ) const ;
+		void rehash( std::size_t number_of_slots ) ;
+	} ;
+}
+
+#endif
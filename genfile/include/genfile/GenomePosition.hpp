@@ -44,13 +44,11 @@ namespace genfile {
 		Chromosome& chromosome() { return m_data.first ; }
 		Position const& position() const { return m_data.second ; }
 		Position& position() { return m_data.second ; }
-	
-		friend bool operator<( GenomePosition const& left, GenomePosition const& right ) ;
-		friend bool operator>( GenomePosition const& left, GenomePosition const& right ) ;
-		friend bool operator<=( GenomePosition const& left, GenomePosition const& right ) ;
-		friend bool operator>=( GenomePosition const& left, GenomePosition const& right ) ;
-		friend bool operator==( GenomePosition const& left, GenomePosition const& right ) ;
-		friend bool operator!=( GenomePosition const& left, GenomePosition const& right ) ;
+
+		// Return a key packing the chromosome code and position into 64 bits, as ( code << 40 ) | position.
+		// Keys are equal exactly when positions are equal, and order positions as operator< does
+		// when the chromosomes compare by code (see Chromosome::compares_by_code()).
+		uint64_t key() const { return ( uint64_t( m_data.first.code() ) << 40 ) | m_data.second ; }
 
 		static Position get_max_position( Chromosome chromosome ) ;
 		static Position get_min_position( Chromosome chromosome ) ;
@@ -59,6 +57,34 @@ namespace genfile {
 		std::pair< Chromosome, Position > m_data ;
 	} ;
 
+	inline bool operator<( GenomePosition const& left, GenomePosition const& right ) {
+		if( left.chromosome().compares_by_code( right.chromosome() )) {
+			return left.key() < right.key() ;
+		}
+		// Chromosomes are distinct, so they determine the order.
+		return left.chromosome() < right.chromosome() ;
+	}
+
+	inline bool operator>( GenomePosition const& left, GenomePosition const& right ) {
+		return right < left ;
+	}
+
+	inline bool operator<=( GenomePosition const& left, GenomePosition const& right ) {
+		return !( right < left ) ;
+	}
+
+	inline bool operator>=( GenomePosition const& left, GenomePosition const& right ) {
+		return !( left < right ) ;
+	}
+
+	inline bool operator==( GenomePosition const& left, GenomePosition const& right ) {
+		return left.key() == right.key() ;
+	}
+
+	inline bool operator!=( GenomePosition const& left, GenomePosition const& right ) {
+		return left.key() != right.key() ;
+	}
+
 	std::ostream& operator<<( std::ostream&, GenomePosition const& ) ;
 	std::istream& operator>>( std::istream& oStream, GenomePosition& pos ) ;
 	
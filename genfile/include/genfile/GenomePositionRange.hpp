@@ -26,6 +26,8 @@ namespace genfile {
 		Chromosome const chromosome() const { return m_start.chromosome() ; }
 		GenomePosition const& start() const { return m_start ; }
 		GenomePosition const& end() const { return m_end ; }
+		// Return false if the range applies to positions on any chromosome.
+		bool has_chromosome() const { return m_have_chromosome ; }
 
 		bool contains( GenomePosition const& position ) const ;
 
@@ -8,10 +8,16 @@
 #define GENFILE_MERGING_SNP_DATA_SOURCE_HPP
 
 #include <vector>
+#include <stdint.h>
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/SNPDataSource.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
 
 namespace genfile {
+	// This SNPDataSource merges several sources, each sorted in the order given by the compare fields,
+	// into a single sorted stream.  Variants that compare equal are taken in the order their sources were added.
+	// The next variant of each source is held in a heap ordered by packed position key, falling back
+	// to the full comparison only for variants at the same position.
 	struct MergingSNPDataSource: public SNPDataSource {
 
 		typedef std::auto_ptr< MergingSNPDataSource > UniquePtr ;
@@ -25,6 +31,13 @@ namespace genfile {
 		virtual ~MergingSNPDataSource() ;
 
 		void add_source( SNPDataSource::UniquePtr, std::string const& id_prefix = "" ) ;
+		// Read and decode each source added after this call ahead in its own thread, holding at most
+		// max_queue_bytes bytes of data per source and only the given specs (or all specs, if empty),
+		// so that sources are read concurrently.
+		void prefetch_sources(
+			std::size_t max_queue_bytes = PrefetchingSNPDataSource::default_max_queue_bytes,
+			std::vector< std::string > const& specs = std::vector< std::string >()
+		) ;
 
 		Metadata get_metadata() const ;
 
@@ -50,15 +63,41 @@ namespace genfile {
 	
 	private:
 		std::vector< SNPDataSource* > m_sources ;
-		typedef std::multimap< VariantIdentifyingData, std::size_t, VariantIdentifyingData::CompareFields > CurrentSnps ;
-		CurrentSnps m_current_snps ;
 		std::vector< std::string > m_merge_id_prefixes ;
 		Metadata m_metadata ;
-		
+		std::size_t m_max_prefetch_queue_bytes ;
+		std::vector< std::string > m_prefetch_specs ;
+
+		// Heap of sources that have a current variant.  The variant itself is held in m_top_snps, so that
+		// heap operations only move these small entries.  The sequence number records insertion order,
+		// so that equal variants are taken in the order they were read.
+		struct HeapEntry {
+			uint64_t position_key ;
+			std::size_t source ;
+			uint64_t sequence ;
+		} ;
+		struct HeapOrder {
+			HeapOrder( MergingSNPDataSource const& source ): m_source( source ) {}
+			// Return true if left should come out of the heap after right.
+			bool operator()( HeapEntry const& left, HeapEntry const& right ) const {
+				return m_source.comes_before( right, left ) ;
+			}
+		private:
+			MergingSNPDataSource const& m_source ;
+		} ;
+		VariantIdentifyingData::CompareFields const m_compare_fields ;
+		// True if the compare fields order by position first, so position keys can be compared directly.
+		bool const m_compare_by_position_first ;
+		std::vector< VariantIdentifyingData > m_top_snps ;
+		std::vector< HeapEntry > m_heap ;
+		uint64_t m_sequence ;
+
 		void get_top_snp_in_source( std::size_t source_i ) ;
+		bool comes_before( HeapEntry const& left, HeapEntry const& right ) const ;
 	protected:
-		CurrentSnps& current_snps() { return m_current_snps ; }
-		SNPDataSource& get_source( std::size_t i ) { return *m_sources[i] ; }
+		bool have_top_snp() const { return !m_heap.empty() ; }
+		VariantIdentifyingData const& top_snp() const { return m_top_snps[ m_heap.front().source ] ; }
+		SNPDataSource& top_source() { return *m_sources[ m_heap.front().source ] ; }
 		void discard_top_snp_and_get_next_candidate() ;
 		virtual void discard_top_snp_and_get_next() = 0 ;
 	} ;
@@ -0,0 +1,114 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_PREFETCHING_SNP_DATA_SOURCE_HPP
+#define GENFILE_PREFETCHING_SNP_DATA_SOURCE_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <exception>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/ptr_container/ptr_deque.hpp>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+
+namespace genfile {
+	// This SNPDataSource reads ahead from another source in a background thread.
+	// Variants are decoded into BufferedVariantDataReaders and held in a queue bounded by the memory
+	// it uses, so that decoding overlaps with whatever the caller does with the data.
+	// The wrapped source is read only by the background thread while prefetching.
+	class PrefetchingSNPDataSource: public SNPDataSource {
+	public:
+		typedef std::auto_ptr< PrefetchingSNPDataSource > UniquePtr ;
+		// Buffered data for one variant is typically a few bytes per sample per spec.
+		static std::size_t const default_max_queue_bytes = 64 * 1024 * 1024 ;
+
+		// Buffer the given specs for each variant (all supported specs if empty), holding at most
+		// max_queue_bytes bytes of buffered data.  At least one variant is always held.
+		static UniquePtr create(
+			SNPDataSource::UniquePtr source,
+			std::size_t max_queue_bytes = default_max_queue_bytes,
+			std::vector< std::string > const& specs = std::vector< std::string >()
+		) ;
+
+	public:
+		PrefetchingSNPDataSource(
+			SNPDataSource::UniquePtr source,
+			std::size_t max_queue_bytes,
+			std::vector< std::string > const& specs
+		) ;
+		~PrefetchingSNPDataSource() ;
+
+		// Start the background thread.  This happens on first access if not called explicitly.
+		void start_prefetching() ;
+		bool is_prefetching() const ;
+
+		operator bool() const ;
+		Metadata get_metadata() const ;
+		unsigned int number_of_samples() const ;
+		bool has_sample_ids() const ;
+		void get_sample_ids( GetSampleIds ) const ;
+		OptionalSnpCount total_number_of_snps() const ;
+		std::string get_source_spec() const ;
+		SNPDataSource const& get_parent_source() const ;
+		SNPDataSource const& get_base_source() const ;
+		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
+
+	protected:
+		void get_snp_identifying_data_impl( VariantIdentifyingData* variant ) ;
+		VariantDataReader::UniquePtr read_variant_data_impl() ;
+		void ignore_snp_probability_data_impl() ;
+		void reset_to_start_impl() ;
+		// Selections can only be passed on before prefetching starts.
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
+
+	private:
+		struct Entry {
+			Entry( VariantIdentifyingData const& variant_, VariantDataReader::UniquePtr data_, std::size_t size_ ):
+				variant( variant_ ),
+				data( data_ ),
+				size( size_ )
+			{}
+			VariantIdentifyingData variant ;
+			VariantDataReader::UniquePtr data ;
+			// Approximate number of bytes used by this entry.
+			std::size_t const size ;
+		} ;
+
+		typedef boost::mutex Mutex ;
+		typedef Mutex::scoped_lock ScopedLock ;
+		typedef boost::condition ConditionVariable ;
+
+		SNPDataSource::UniquePtr m_source ;
+		std::size_t const m_max_queue_bytes ;
+		std::vector< std::string > const m_specs ;
+		std::auto_ptr< boost::thread > m_thread ;
+
+		mutable Mutex m_mutex ;
+		ConditionVariable m_have_data_condition ;
+		ConditionVariable m_have_capacity_condition ;
+		boost::ptr_deque< Entry > m_queue ;
+		std::size_t m_queue_bytes ;
+		bool m_finished ;
+		bool m_stop ;
+		std::exception_ptr m_error ;
+		// True if the last call to get_snp_identifying_data_impl() found a variant.
+		bool m_have_variant ;
+
+	private:
+		void stop_prefetching() ;
+		void prefetch() ;
+		void pop_front() ;
+		// Wait until the queue is nonempty or the source is exhausted; return false in the latter case.
+		bool wait_for_data() ;
+	} ;
+}
+
+#endif
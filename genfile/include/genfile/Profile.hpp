@@ -0,0 +1,116 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_PROFILE_HPP
+#define GENFILE_PROFILE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <chrono>
+#include <atomic>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "genfile/types.hpp"
+
+namespace genfile {
+	// Timers and counters for the stages of a processing pipeline, such as the SNPDataSources
+	// in a chain and the callbacks of a SNPDataSourceProcessor.
+	// Each stage records the time spent in each of its operations, together with counts of
+	// variants and bytes, and can be written out as JSON.
+	// Timing is exclusive of nested stages: time spent in a stage while another timed operation
+	// runs inside it on the same thread counts as that operation's self time only.
+	// Stages and their timings must be created before processing starts.  After that, counters
+	// and timings are atomic and may be updated from any thread, as happens when prefetching
+	// threads read a profiled source while data is decoded on the main thread.  The profile may
+	// also be written while such threads are running; values are then a snapshot that need not
+	// be mutually consistent.
+	struct Profile: public boost::noncopyable {
+	public:
+		typedef std::auto_ptr< Profile > UniquePtr ;
+		typedef std::chrono::steady_clock Clock ;
+		static UniquePtr create() ;
+
+		// Counts of calls to operations whose duration falls in each bucket.
+		// Bucket 0 holds calls taking under 1us; bucket b > 0 holds calls taking [2^(b-1), 2^b)us.
+		struct Histogram {
+			enum { eNumberOfBuckets = 32 } ;
+			Histogram() ;
+			void add( double seconds ) ;
+			uint64_t operator[]( std::size_t bucket ) const { return m_counts[ bucket ] ; }
+			// Return the upper bound, in microseconds, of the given bucket.
+			static double upper_bound( std::size_t bucket ) ;
+		private:
+			std::atomic< uint64_t > m_counts[ eNumberOfBuckets ] ;
+		} ;
+
+		struct Timing {
+			Timing( std::string const& operation ) ;
+			std::string const operation ;
+			std::atomic< uint64_t > calls ;
+			std::atomic< double > total_seconds ;
+			std::atomic< double > self_seconds ;
+			Histogram histogram ;
+		} ;
+
+		struct Stage: public boost::noncopyable {
+			Stage( std::size_t id, std::string const& name, std::string const& type ) ;
+			std::size_t const id ;
+			std::string const name ;
+			std::string const type ;
+
+			// Return the timing for the named operation, creating it if necessary.
+			// The reference stays valid for the lifetime of the stage.
+			Timing& timing( std::string const& operation ) ;
+			std::size_t number_of_timings() const { return m_timings.size() ; }
+			Timing const& timing( std::size_t i ) const { return m_timings[i] ; }
+
+			// Set the stage that supplies input to this one.
+			void set_input( Stage const* input ) { m_input = input ; }
+			Stage const* input() const { return m_input ; }
+
+			// Variants whose data was read (for callbacks, the variants processed) and variants
+			// whose data was skipped.  Together these are the variants passed on by the stage.
+			std::atomic< uint64_t > variants_read ;
+			std::atomic< uint64_t > variants_ignored ;
+			uint64_t variants_out() const { return variants_read + variants_ignored ; }
+			std::atomic< uint64_t > bytes_read ;
+			std::atomic< uint64_t > bytes_decompressed ;
+
+		private:
+			boost::ptr_vector< Timing > m_timings ;
+			Stage const* m_input ;
+		} ;
+
+		// Times one call to an operation, from construction to destruction.
+		struct ScopedTimer: public boost::noncopyable {
+			ScopedTimer( Timing& timing ) ;
+			~ScopedTimer() ;
+		private:
+			Timing& m_timing ;
+			ScopedTimer* m_parent ;
+			Clock::time_point const m_start ;
+			double m_child_seconds ;
+		} ;
+
+	public:
+		Profile() ;
+		// Add a stage with the given name and type (e.g. "source" or "callback").
+		Stage& add_stage( std::string const& name, std::string const& type ) ;
+		std::size_t number_of_stages() const { return m_stages.size() ; }
+		Stage const& stage( std::size_t i ) const { return m_stages[i] ; }
+
+		void write_json( std::ostream& ) const ;
+		void write_json( std::string const& filename ) const ;
+
+	private:
+		Clock::time_point const m_start ;
+		boost::ptr_vector< Stage > m_stages ;
+	} ;
+}
+
+#endif
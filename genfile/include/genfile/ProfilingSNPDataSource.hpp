@@ -0,0 +1,65 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_PROFILING_SNP_DATA_SOURCE_HPP
+#define GENFILE_PROFILING_SNP_DATA_SOURCE_HPP
+
+#include <memory>
+#include <string>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/Profile.hpp"
+
+namespace genfile {
+	// This SNPDataSource passes on the data of another source unchanged, recording the time
+	// spent in and the variants passed through the other source as a stage of a Profile.
+	// Data readers it returns time the decoding of data as well.
+	// If the wrapped source, or a source in its parent hierarchy, is itself profiled,
+	// that stage is recorded as the input of this one.
+	class ProfilingSNPDataSource: public SNPDataSource {
+	public:
+		typedef std::auto_ptr< ProfilingSNPDataSource > UniquePtr ;
+		static UniquePtr create( SNPDataSource::UniquePtr source, Profile::Stage& stage ) ;
+
+	public:
+		ProfilingSNPDataSource( SNPDataSource::UniquePtr source, Profile::Stage& stage ) ;
+
+		Profile::Stage const& stage() const { return m_stage ; }
+
+		operator bool() const ;
+		Metadata get_metadata() const ;
+		unsigned int number_of_samples() const ;
+		bool has_sample_ids() const ;
+		void get_sample_ids( GetSampleIds ) const ;
+		OptionalSnpCount total_number_of_snps() const ;
+		std::string get_source_spec() const ;
+		SNPDataSource const& get_parent_source() const ;
+		SNPDataSource const& get_base_source() const ;
+		std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
+
+	protected:
+		void get_snp_identifying_data_impl( VariantIdentifyingData* variant ) ;
+		VariantDataReader::UniquePtr read_variant_data_impl() ;
+		void ignore_snp_probability_data_impl() ;
+		void reset_to_start_impl() ;
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
+
+	private:
+		SNPDataSource::UniquePtr m_source ;
+		Profile::Stage& m_stage ;
+		Profile::Timing& m_identifying_data_timing ;
+		Profile::Timing& m_read_timing ;
+		Profile::Timing& m_ignore_timing ;
+		Profile::Timing& m_decode_timing ;
+		Profile::Timing& m_reset_timing ;
+
+	private:
+		void count_io( IOCounts const& before ) ;
+	} ;
+}
+
+#endif
@@ -0,0 +1,41 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_PROFILING_SNP_DATA_SOURCE_PROCESSOR_HPP
+#define GENFILE_PROFILING_SNP_DATA_SOURCE_PROCESSOR_HPP
+
+#include <string>
+#include <vector>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/SNPDataSourceProcessor.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/Profile.hpp"
+
+namespace genfile {
+	// This processor visits each SNP in the source one at a time, like SimpleSNPDataSourceProcessor,
+	// and records the time spent in each callback as a stage of a Profile.
+	// Callbacks are named by their type.
+	// The profile is written as JSON to the given file once all callbacks have ended processing.
+	class ProfilingSNPDataSourceProcessor: public SimpleSNPDataSourceProcessor {
+	public:
+		ProfilingSNPDataSourceProcessor( Profile& profile, std::string const& filename ) ;
+
+	protected:
+		void call_begin_processing_snps( std::size_t const& number_of_samples, genfile::SNPDataSource::Metadata const& ) const ;
+		void call_processed_snp( VariantIdentifyingData const& id_data, VariantDataReader::SharedPtr data_reader ) const ;
+		void call_end_processing_snps() const ;
+
+	private:
+		Profile& m_profile ;
+		std::string const m_filename ;
+		// One stage per callback, created when processing begins.
+		mutable std::vector< Profile::Stage* > m_stages ;
+		mutable std::vector< Profile::Timing* > m_processed_snp_timings ;
+	} ;
+}
+
+#endif
@@ -161,6 +161,17 @@ namespace genfile {
 		SNPDataSource& ignore_snp_probability_data() ;
 		void pop() { ignore_snp_probability_data() ; }
 
+		// Function: set_sample_selection()
+		// Ask the source to return data only for samples i with selection[i] true.
+		// selection must have one entry per sample in the source.
+		// If the source can honour this request it returns true.  Thereafter, readers returned by
+		// read_variant_data() report only the selected samples, renumbered consecutively in their
+		// original order, and may skip decoding the others.  number_of_samples() and get_sample_ids()
+		// continue to reflect all samples in the source.
+		// If false is returned the source is unchanged and the caller must filter samples itself.
+		typedef std::vector< bool > SampleSelection ;
+		bool set_sample_selection( SampleSelection const& selection ) ;
+
 	public:
 		// Return the number of snps which have been read from the source so far.
 		std::size_t number_of_snps_read() const { return m_number_of_snps_read ; }
@@ -197,6 +208,15 @@ namespace genfile {
 		
 		virtual std::string get_summary( std::string const& prefix = "", std::size_t column_width = 20 ) const ;
 
+		// Return running totals of genotype data bytes read from storage and produced by
+		// decompression, for profiling.  Sources that do not count these report zero.
+		struct IOCounts {
+			IOCounts(): bytes_read( 0 ), bytes_decompressed( 0 ) {}
+			uint64_t bytes_read ;
+			uint64_t bytes_decompressed ;
+		} ;
+		virtual IOCounts get_io_counts() const { return IOCounts() ; }
+
 	protected:
 
 		virtual void get_snp_identifying_data_impl(
@@ -212,6 +232,8 @@ namespace genfile {
 
 		virtual void ignore_snp_probability_data_impl() = 0 ;
 		virtual void reset_to_start_impl() = 0 ;
+		// By default sources cannot skip samples.
+		virtual bool set_sample_selection_impl( SampleSelection const& selection ) { return false ; }
 
 	protected:
 
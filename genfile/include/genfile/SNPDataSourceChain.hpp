@@ -15,6 +15,7 @@
 #endif
 #include "snp_data_utils.hpp"
 #include "SNPDataSource.hpp"
+#include "PrefetchingSNPDataSource.hpp"
 #include "wildcard.hpp"
 
 namespace genfile {
@@ -46,6 +47,17 @@ namespace genfile {
 
 		void add_source( std::auto_ptr< SNPDataSource > source ) ;
 
+		// Read sources ahead of use in up to number_of_threads background threads.
+		// Threads are assigned to the current source and those following it, so that later files
+		// are decoded while earlier ones are consumed.  Data is still returned in chain order.
+		// Each source buffers at most max_queue_bytes bytes of data, holding only the given specs
+		// (or all specs, if empty).
+		void prefetch_sources(
+			std::size_t number_of_threads,
+			std::size_t max_queue_bytes = PrefetchingSNPDataSource::default_max_queue_bytes,
+			std::vector< std::string > const& specs = std::vector< std::string >()
+		) ;
+
 		Metadata get_metadata() const ;
 		unsigned int number_of_samples() const ;
 		bool has_sample_ids() const ;
@@ -70,6 +82,8 @@ VariantIdentifyingData* variant		) ;
 
 		void ignore_snp_probability_data_impl() ;
 
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
+
 	public:
 
 	#if HAVE_BOOST_FUNCTION
@@ -84,8 +98,14 @@ VariantIdentifyingData* variant		) ;
 
 		void move_to_next_source() ;
 		void move_to_next_nonempty_source_if_necessary() ;
+		void start_prefetching_sources() ;
 
 		std::vector< SNPDataSource* > m_sources ;
+		std::size_t m_number_of_prefetching_threads ;
+		std::size_t m_max_prefetch_queue_bytes ;
+		std::vector< std::string > m_prefetch_specs ;
+		// Entry i is the prefetching wrapper of source i, if any.
+		std::vector< PrefetchingSNPDataSource* > m_prefetching_sources ;
 		std::size_t m_current_source ;
 		unsigned int m_number_of_samples ;
 		Metadata m_metadata ;
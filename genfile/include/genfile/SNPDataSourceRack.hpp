@@ -12,6 +12,7 @@
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/GenomePosition.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
 
 namespace genfile {
 	
@@ -78,6 +79,14 @@ namespace genfile {
 		~SNPDataSourceRack() ;
 
 		void add_source( std::auto_ptr< SNPDataSource > source ) ;
+		// Read and decode each source ahead in its own background thread, holding at most max_queue_bytes
+		// bytes of data per source, and only the given specs (or all specs, if empty).  Sources are then
+		// read concurrently, so that reading the rack takes about as long as reading the slowest source.
+		// This applies to sources added before and after the call.
+		void prefetch_sources(
+			std::size_t max_queue_bytes = PrefetchingSNPDataSource::default_max_queue_bytes,
+			std::vector< std::string > const& specs = std::vector< std::string >()
+		) ;
 		std::size_t number_of_sources() const ;
 		SNPDataSource& get_source( std::size_t ) const ;
 
@@ -132,6 +141,10 @@ namespace genfile {
 		friend struct impl::RackVariantDataReader ;
 
 		std::vector< SNPDataSource* > m_sources ;
+		// Entry i is the prefetching wrapper of source i, if any.
+		std::vector< PrefetchingSNPDataSource* > m_prefetching_sources ;
+		std::size_t m_max_prefetch_queue_bytes ;
+		std::vector< std::string > m_prefetch_specs ;
 		std::vector< char > m_flips ;
 		uint32_t m_number_of_samples ;
 		bool m_read_past_end ;
@@ -16,10 +16,11 @@ namespace genfile {
 	public:
 		SNPIDMatchesTest( std::string const& expression ) ;
 		bool operator()( VariantIdentifyingData const& data ) const ;
+		bool may_pass( VariantIdentifyingDataView const& view ) const ;
 		std::string display() const ;
 	private:
 		void setup( std::string const& ) ;
-		bool match( std::string const& ) const ;
+		bool match( string_utils::slice const& ) const ;
 	private:
 		enum Type { eSNPID = 1, eRSID = 2, eEITHER = 3 } ;	
 		Type m_type ;
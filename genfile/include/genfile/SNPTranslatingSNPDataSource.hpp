@@ -85,6 +85,10 @@ namespace genfile {
 		VariantDataReader::UniquePtr read_variant_data_impl() ;
 
 		void ignore_snp_probability_data_impl() ;
+
+		bool set_sample_selection_impl( SampleSelection const& selection ) {
+			return m_source->set_sample_selection( selection ) ;
+		}
 	} ;
 }
 
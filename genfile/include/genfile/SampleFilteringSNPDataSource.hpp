@@ -77,6 +77,8 @@ namespace genfile {
 		std::auto_ptr< SNPDataSource > m_source ;
 		std::vector< std::size_t > m_indices_of_samples_to_filter_out ;
 		std::vector< double > m_genotype_data ;
+		// True if the source skips filtered-out samples itself.
+		bool m_source_applies_filter ;
 	} ;
 }
 
@@ -8,6 +8,7 @@
 #define GENFILE_SAMPLE_MAPPING_SNP_DATA_SOURCE_HPP
 
 #include <vector>
+#include <boost/optional.hpp>
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/CohortIndividualSource.hpp"
@@ -46,6 +47,8 @@ namespace genfile {
 		private:
 			std::auto_ptr< impl::SampleMapping > m_sample_mapping ;
 			SNPDataSource::UniquePtr m_source ;
+			// Set if the source skips unmapped samples itself.
+			boost::optional< std::vector< std::size_t > > m_selected_target_samples ;
 	} ;
 }
 
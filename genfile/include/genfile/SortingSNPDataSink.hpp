@@ -0,0 +1,94 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef GENFILE_SORTING_SNP_DATA_SINK_HPP
+#define GENFILE_SORTING_SNP_DATA_SINK_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <boost/optional.hpp>
+#include "genfile/SNPDataSink.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+
+namespace genfile {
+	// A SNPDataSink which sorts variants before writing them to another sink of any format.
+	// The given specs of each variant's data (or all specs, if none are given) are buffered
+	// (see BufferedVariantDataReader) and held in memory until the given memory budget is used;
+	// the batch is then sorted and spilled as a run to a temporary file.  When the sink is finalised,
+	// the runs are merged and written sequentially to the target sink.  A sink destroyed without
+	// being finalised writes nothing and only removes its temporary files.  At most
+	// max_runs_per_merge runs are read at once; if there are more, groups of runs are first merged
+	// into longer runs, in as many passes as needed.  If variants arrive in sorted order, no sorting
+	// or merging is done and the runs are simply copied in order.
+	// Variants that compare equal are written in the order they arrived.
+	class SortingSNPDataSink: public SNPDataSink
+	{
+	public:
+		typedef std::auto_ptr< SortingSNPDataSink > UniquePtr ;
+
+		SortingSNPDataSink(
+			SNPDataSink::UniquePtr sink,
+			VariantIdentifyingData::CompareFields const& comparer,
+			std::size_t memory_budget = 1024 * 1024 * 1024,
+			std::vector< std::string > const& specs = std::vector< std::string >(),
+			std::size_t max_runs_per_merge = 64
+		) ;
+		~SortingSNPDataSink() ;
+
+		std::string get_spec() const ;
+		operator bool() const { return m_sink.get() && (*m_sink) ; }
+
+		// Return the number of runs spilled to temporary files so far.
+		std::size_t number_of_runs() const { return m_runs.size() ; }
+		// Return true if all variants so far arrived in sorted order.
+		bool input_is_sorted() const { return m_input_is_sorted ; }
+
+	protected:
+		void set_sample_names_impl( std::size_t number_of_samples, SampleNameGetter ) ;
+		void set_metadata_impl( Metadata const& ) ;
+		void write_variant_data_impl(
+			VariantIdentifyingData const& id_data,
+			VariantDataReader& data_reader,
+			Info const& info
+		) ;
+		void finalise_impl() ;
+
+	public:
+		// A buffered variant.
+		struct Record {
+			VariantIdentifyingData id ;
+			Info info ;
+			std::vector< uint8_t > data ;
+		} ;
+
+	private:
+		SNPDataSink::UniquePtr m_sink ;
+		VariantIdentifyingData::CompareFields const m_comparer ;
+		std::size_t const m_memory_budget ;
+		std::vector< std::string > const m_specs ;
+		std::size_t const m_max_runs_per_merge ;
+		std::vector< Record > m_records ;
+		std::size_t m_bytes_used ;
+		boost::optional< VariantIdentifyingData > m_last_variant ;
+		bool m_input_is_sorted ;
+		bool m_batch_is_sorted ;
+		std::vector< std::string > m_runs ;
+		bool m_finalised ;
+
+		// Return the records of the current batch in sorted order.
+		std::vector< Record const* > get_sorted_batch() const ;
+		void spill_batch() ;
+		// Merge groups of runs into longer runs until at most max_runs_per_merge - 1 remain,
+		// leaving room for the current batch in the final merge.
+		void merge_runs() ;
+		void write_runs() ;
+		void remove_runs() ;
+	} ;
+}
+
+#endif
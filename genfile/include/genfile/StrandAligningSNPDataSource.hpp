@@ -96,6 +96,9 @@ VariantIdentifyingData* variant		) ;
 		VariantDataReader::UniquePtr read_variant_data_impl() ;
 		void ignore_snp_probability_data_impl() ;
 		void reset_to_start_impl() ;
+		bool set_sample_selection_impl( SampleSelection const& selection ) {
+			return m_source->set_sample_selection( selection ) ;
+		}
 	} ;
 }
 
@@ -73,6 +73,7 @@ VariantIdentifyingData* variant		) ;
 
 		void ignore_snp_probability_data_impl() ;
 		void reset_to_start_impl() ;
+		bool set_sample_selection_impl( SampleSelection const& selection ) ;
 
 	private:
 		std::string const m_spec ;
@@ -93,6 +94,8 @@ VariantIdentifyingData* variant		) ;
 		std::vector< std::string > const m_column_names ;
 		std::size_t const m_number_of_samples ;
 		OptionalSnpCount m_number_of_lines ;
+		boost::optional< SampleSelection > m_sample_selection ;
+		std::size_t m_number_of_selected_samples ;
 		
 		// We record the alleles per SNP, so that they can be used on subsequent SNPs.
 		std::vector< std::string > m_variant_alleles ;
@@ -20,6 +20,7 @@
 #include "genfile/SingleSNPGenotypeProbabilities.hpp"
 #include "genfile/BasicTypes.hpp"
 #include "genfile/vcf/Types.hpp"
+#include "genfile/DecodedVariantData.hpp"
 
 namespace genfile {
 	class VariantDataReader: public boost::noncopyable
@@ -38,6 +39,7 @@ namespace genfile {
 		typedef vcf::PerSampleEntriesSetter PerSampleSetter ;
 		typedef boost::function< void ( std::string, std::string ) > SpecSetter ;
 	public:
+		VariantDataReader() ;
 		virtual ~VariantDataReader() ;
 		virtual VariantDataReader& get( std::string const& spec, PerSampleSetter& setter ) = 0 ;
 		// The sole purpose of the next method is to support temporary setters.
@@ -48,6 +50,13 @@ namespace genfile {
 		virtual bool supports( std::string const& spec ) const = 0 ;
 		virtual void get_supported_specs( SpecSetter ) const = 0 ;
 		virtual std::size_t get_number_of_samples() const = 0 ;
+
+		// Return views of this variant's ":genotypes:" field, which are decoded on first use and
+		// then shared by everything holding this reader (see DecodedVariantData).
+		DecodedVariantData& decoded() { return m_decoded ; }
+
+	private:
+		DecodedVariantData m_decoded ;
 	} ;
 }
 
@@ -59,6 +59,10 @@ VariantIdentifyingData* variant		) ;
 
 		void ignore_snp_probability_data_impl() ;
 
+		bool set_sample_selection_impl( SampleSelection const& selection ) {
+			return m_source->set_sample_selection( selection ) ;
+		}
+
 	protected:
 		SNPDataSource& source() { return *m_source ; }
 		
@@ -18,9 +18,24 @@
 #include "genfile/GenomePosition.hpp"
 #include "genfile/Chromosome.hpp"
 #include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/string_utils/slice.hpp"
 
 namespace genfile {
-	
+	// The position and IDs of a variant as slices of bytes held elsewhere, typically
+	// a file reader's buffers.  This lets tests reject variants before a
+	// VariantIdentifyingData is constructed.
+	struct VariantIdentifyingDataView
+	{
+		typedef string_utils::slice slice ;
+		VariantIdentifyingDataView():
+			primary_id( "" )
+		{}
+
+		GenomePosition position ;
+		slice primary_id ;
+		std::vector< slice > alternate_ids ;
+	} ;
+
 	// Base class for objects which represent a boolean test of a SNP's "identifying data"
 	// (i.e. position, ids, and alleles)
 	//
@@ -36,6 +51,10 @@ namespace genfile {
 	
 		// Return true if the variant passes the test.
 		virtual bool operator()( VariantIdentifyingData const& data ) const = 0 ;
+
+		// Return false if a variant with the given position and IDs certainly fails the test,
+		// whatever its alleles.  The default implementation returns true.
+		virtual bool may_pass( VariantIdentifyingDataView const& view ) const { return true ; }
 		
 		// Return a vector of indices of SNPs which pass the test.
 		std::vector< std::size_t > get_indices_of_filtered_in_snps( std::vector< VariantIdentifyingData> const& snps ) const ;
@@ -77,6 +96,7 @@ namespace genfile {
 		typedef std::auto_ptr< VariantIdentifyingDataTestConjunction > UniquePtr ;
 	public:
 		bool operator()( VariantIdentifyingData const& data ) const ;
+		bool may_pass( VariantIdentifyingDataView const& view ) const ;
 		std::string display() const ;
 	} ;
 
@@ -86,6 +106,7 @@ namespace genfile {
 		typedef std::auto_ptr< VariantIdentifyingDataTestDisjunction > UniquePtr ;
 	public:
 		bool operator()( VariantIdentifyingData const& data ) const ;
+		bool may_pass( VariantIdentifyingDataView const& view ) const ;
 		std::string display() const ;
 	} ;
 }
@@ -26,6 +26,7 @@ namespace genfile {
 	public:
 		PositionMatchesTest( GenomePosition const& position ) ;
 		bool operator()( VariantIdentifyingData const& ) const ;
+		bool may_pass( VariantIdentifyingDataView const& view ) const ;
  		std::string display() const ;
  	private:
 		GenomePosition const m_position ;
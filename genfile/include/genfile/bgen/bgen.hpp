@@ -381,12 +381,14 @@ namespace genfile {
 		void read_length_followed_by_data( std::istream& in_stream, IntegerType* length_ptr, std::string* string_ptr ) {
 			IntegerType& length = *length_ptr ;
 			read_little_endian_integer( in_stream, length_ptr ) ;
-			std::vector< char >buffer ( length ) ;
-			in_stream.read( &buffer[0], length ) ;
-			if( !in_stream ) {
-				throw BGenError() ;
+			// Read straight into the string, so a string reused across variants is not reallocated.
+			string_ptr->resize( length ) ;
+			if( length > 0 ) {
+				in_stream.read( &(*string_ptr)[0], length ) ;
+				if( !in_stream ) {
+					throw BGenError() ;
+				}
 			}
-			string_ptr->assign( buffer.begin(), buffer.end() ) ;
 		}
 
 		// Write an integer to the buffer in little-endian format.
@@ -858,6 +860,16 @@ namespace genfile {
 						return value ;
 					}
 
+					// consume n values without decoding them
+					void skip( std::size_t n ) {
+						std::size_t const bits = n * m_bits + m_shift ;
+						m_buffer += 4 * ( bits / 32 ) ;
+						m_shift = bits % 32 ;
+#if BGEN_BIG_ENDIAN
+						read_little_endian_integer( m_buffer, m_end, &m_data ) ;
+#endif
+					}
+
 				private:
 					byte_t const* m_buffer ;
 					byte_t const* const m_end ;
@@ -896,6 +908,10 @@ namespace genfile {
 						) / 255.0;
 					}
 
+					void skip( std::size_t n ) {
+						m_buffer += n ;
+					}
+
 				private:
 					byte_t const* m_buffer ;
 					byte_t const* const m_end ;
@@ -931,6 +947,10 @@ namespace genfile {
 						return value ;
 					}
 
+					void skip( std::size_t n ) {
+						m_buffer += 2*n ;
+					}
+
 				private:
 					byte_t const* m_buffer ;
 					byte_t const* const m_end ;
@@ -1144,6 +1164,11 @@ namespace genfile {
 							if( !valueConsumer.check( 2 )) {
 								throw BGenError() ;
 							}
+							if( !( sample_status & 0x1 )) {
+								// Sample not wanted; step over its values without decoding them.
+								valueConsumer.skip( 2 ) ;
+								continue ;
+							}
 							// Consume values and interpret them.
 							for( uint32_t hap = 0; hap < 2; ++hap ) {
 								double const value = valueConsumer.next() ;
@@ -1171,6 +1196,10 @@ namespace genfile {
 							if( !valueConsumer.check( 2 )) {
 								throw BGenError() ;
 							}
+							if( !( sample_status & 0x1 )) {
+								valueConsumer.skip( 2 ) ;
+								continue ;
+							}
 							double const value1 = valueConsumer.next() ;
 							double const value2 = valueConsumer.next() ;
 
@@ -1246,6 +1275,10 @@ namespace genfile {
 							if( !valueConsumer.check( ploidy * (pack.numberOfAlleles-1) )) {
 								throw BGenError() ;
 							}
+							if( !( sample_status & 0x1 )) {
+								valueConsumer.skip( ploidy * (pack.numberOfAlleles-1) ) ;
+								continue ;
+							}
 							for( uint32_t hap = 0; hap < ploidy; ++hap ) {
 								for( uint32_t allele = 0; allele < (pack.numberOfAlleles-1); ++allele ) {
 									double const value = valueConsumer.next() ;
@@ -1299,6 +1332,10 @@ namespace genfile {
 							if( !valueConsumer.check( storedValueCount )) {
 								throw BGenError() ;
 							}
+							if( !( sample_status & 0x1 )) {
+								valueConsumer.skip( storedValueCount ) ;
+								continue ;
+							}
 							
 							double sum = 0.0 ;
 							uint32_t reportedValueCount = 0 ;
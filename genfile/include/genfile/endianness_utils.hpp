@@ -32,7 +32,7 @@ namespace genfile {
 	template< typename IntegerType >
 	void read_little_endian_integer( std::istream& in_stream, IntegerType* integer_ptr ) {
 		uint8_t buffer[ sizeof( IntegerType ) ] ;
-		in_stream.read( buffer, sizeof( IntegerType )) ;
+		in_stream.read( reinterpret_cast< char* >( buffer ), sizeof( IntegerType )) ;
 		if( in_stream ) {
 			read_little_endian_integer( buffer, buffer + sizeof( IntegerType ), integer_ptr ) ;
 		}
@@ -76,7 +76,7 @@ namespace genfile {
 	void write_little_endian_integer( std::ostream& out_stream, IntegerType const integer ) {
 		uint8_t buffer[ sizeof( IntegerType ) ] ;
 		write_little_endian_integer( buffer, buffer + sizeof( IntegerType ), integer ) ;
-		out_stream.write( buffer, sizeof( IntegerType )) ;
+		out_stream.write( reinterpret_cast< char const* >( buffer ), sizeof( IntegerType )) ;
 	}
 
 	// Write an integer to the buffer in big-endian format.
@@ -53,6 +53,11 @@ namespace genfile {
 			~CallReader() {} ;
 		
 			void set_strict_mode( bool value ) ;
+
+			// Report values only for samples i with (*selection)[i] true, numbered consecutively.
+			// Data for other samples is skipped without being split or parsed.
+			// The selection must outlive this object.
+			void set_sample_selection( std::vector< bool > const* selection ) ;
 			
 		private:
 			std::size_t const m_number_of_samples ;
@@ -71,7 +76,10 @@ namespace genfile {
 			std::vector< std::size_t > m_ploidy ;
 			std::vector< OrderType > m_order_types ;
 			bool m_strict_mode ;
+			std::vector< bool > const* m_sample_selection ;
+			std::size_t m_number_of_selected_samples ;
 		private:
+			bool is_selected( std::size_t sample_i ) const { return !m_sample_selection || (*m_sample_selection)[ sample_i ] ; }
 			void split_data() ;
 			void load_genotypes() ;
 			void set_values(
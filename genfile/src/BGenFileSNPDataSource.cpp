@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <string>
+#include <algorithm>
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include "genfile/snp_data_utils.hpp"
@@ -17,14 +18,20 @@
 namespace genfile {
 	BGenFileSNPDataSource::BGenFileSNPDataSource( std::auto_ptr< std::istream > stream, Chromosome missing_chromosome ):
 		m_filename( "(anonymous stream)" ),
-		m_missing_chromosome( missing_chromosome )
+		m_missing_chromosome( missing_chromosome ),
+		m_number_of_selected_samples( 0 ),
+		m_prefilter( 0 ),
+		m_visit_index( 0 )
 	{
 		setup( stream ) ;
 	}
 	
 	BGenFileSNPDataSource::BGenFileSNPDataSource( std::string const& filename, Chromosome missing_chromosome ):
 		m_filename( filename ),
-		m_missing_chromosome( missing_chromosome )
+		m_missing_chromosome( missing_chromosome ),
+		m_number_of_selected_samples( 0 ),
+		m_prefilter( 0 ),
+		m_visit_index( 0 )
 	{
 		setup(
 			open_binary_file_for_input(
@@ -42,6 +49,7 @@ namespace genfile {
 		bgen::uint32_t offset ;
 		bgen::read_offset( (*m_stream_ptr), &offset ) ;
 		m_stream_ptr->ignore( offset ) ;
+		m_visit_index = 0 ;
 	}
 
 	SNPDataSource::Metadata BGenFileSNPDataSource::get_metadata() const {
@@ -94,43 +102,138 @@ namespace genfile {
 		return result + ")" ;
 	}
 
+	SNPDataSource::OptionalSnpCount BGenFileSNPDataSource::total_number_of_snps() const {
+		if( m_prefilter ) {
+			return OptionalSnpCount() ;
+		} else if( m_visited_offsets ) {
+			return m_visited_offsets->size() ;
+		}
+		return m_bgen_context.number_of_variants ;
+	}
+
+	void BGenFileSNPDataSource::set_prefilter( VariantIdentifyingDataTest const& test ) {
+		m_prefilter = &test ;
+	}
+
+	void BGenFileSNPDataSource::restrict_to_offsets( std::vector< int64_t > const& offsets ) {
+		m_visited_offsets = offsets ;
+		std::sort( m_visited_offsets->begin(), m_visited_offsets->end() ) ;
+		reset_to_start() ;
+	}
+
+	bool BGenFileSNPDataSource::seek_to_next_visited_variant() {
+		if( !m_visited_offsets ) {
+			return true ;
+		}
+		if( m_visit_index == m_visited_offsets->size() ) {
+			// Leave the stream in the same state as at the end of the file.
+			stream().setstate( std::ios::eofbit | std::ios::failbit ) ;
+			return false ;
+		}
+		stream().seekg( (*m_visited_offsets)[ m_visit_index++ ] ) ;
+		return true ;
+	}
+
 	namespace {
 		void set_number_of_alleles( std::vector< std::string >* result, std::size_t n ) {
 			result->resize(n) ;
 		}
-		void set_allele( std::vector< std::string >* result, std::size_t i, std::string value ) {
-			(*result)[i] = value ;
+		void set_allele( std::vector< std::string >* result, std::size_t i, std::string const& value ) {
+			(*result)[i].assign( value ) ;
+		}
+	}
+
+	Chromosome const& BGenFileSNPDataSource::get_chromosome( std::string const& name ) {
+		if( name == "" ) {
+			return m_missing_chromosome ;
+		}
+		if( name != m_last_chromosome_string ) {
+			m_last_chromosome = Chromosome( name ) ;
+			m_last_chromosome_string = name ;
 		}
+		return m_last_chromosome ;
 	}
 
 	void BGenFileSNPDataSource::read_snp_identifying_data_impl( VariantIdentifyingData* result ) {
-		std::string SNPID, rsid ;
 		uint32_t position ;
-		std::string chromosome_string ;
-		std::vector< std::string > alleles ;
-		if(
-			bgen::read_snp_identifying_data( stream(), m_bgen_context, &SNPID, &rsid, &chromosome_string, &position,
-			boost::bind( &set_number_of_alleles, &alleles, _1 ),
-			boost::bind( &set_allele, &alleles, _1, _2 )
+		while(
+			seek_to_next_visited_variant()
+			&& bgen::read_snp_identifying_data( stream(), m_bgen_context, &m_SNPID, &m_rsid, &m_chromosome_string, &position,
+			boost::bind( &set_number_of_alleles, &m_alleles, _1 ),
+			boost::bind( &set_allele, &m_alleles, _1, _2 )
 		) ) {
-			Chromosome chromosome ;
-			if( chromosome_string == "" ) {
-				chromosome = m_missing_chromosome ;
-			} else {
-				chromosome = chromosome_string ;
+			GenomePosition const genome_position( get_chromosome( m_chromosome_string ), position ) ;
+			if( m_prefilter ) {
+				m_view.position = genome_position ;
+				m_view.primary_id = m_rsid ;
+				m_view.alternate_ids.clear() ;
+				if( m_SNPID.size() > 0 ) {
+					m_view.alternate_ids.push_back( m_SNPID ) ;
+				}
+				if( !m_prefilter->may_pass( m_view )) {
+					ignore_snp_probability_data_impl() ;
+					continue ;
+				}
 			}
-			*result = VariantIdentifyingData( rsid ) ;
-			if( SNPID.size() > 0 ) {
-				result->add_identifier( SNPID ) ;
+			*result = VariantIdentifyingData( m_rsid ) ;
+			if( m_SNPID.size() > 0 ) {
+				result->add_identifier( m_SNPID ) ;
 			}
-			result->set_position( GenomePosition( chromosome, position ) ) ;
-			for( std::size_t i = 0; i < alleles.size(); ++i ) {
-				result->add_allele( alleles[i] ) ;
+			result->set_position( genome_position ) ;
+			for( std::size_t i = 0; i < m_alleles.size(); ++i ) {
+				result->add_allele( m_alleles[i] ) ;
 			}
+			return ;
 		}
 	}
 
 	namespace impl {
+		// Setter that passes on values for selected samples only, numbering them consecutively.
+		// Returning false from set_sample() lets the bgen parser step over unselected samples' data.
+		struct SampleSelectingSetter: public VariantDataReader::PerSampleSetter {
+			SampleSelectingSetter(
+				VariantDataReader::PerSampleSetter& setter,
+				SNPDataSource::SampleSelection const& selection,
+				std::size_t const number_of_selected_samples
+			):
+				m_setter( setter ),
+				m_selection( selection ),
+				m_number_of_selected_samples( number_of_selected_samples ),
+				m_sample_i( 0 )
+			{}
+
+			~SampleSelectingSetter() throw() {}
+
+			void initialise( std::size_t nSamples, std::size_t nAlleles ) {
+				assert( nSamples == m_selection.size() ) ;
+				m_setter.initialise( m_number_of_selected_samples, nAlleles ) ;
+				m_sample_i = 0 ;
+			}
+
+			bool set_sample( std::size_t n ) {
+				return m_selection[n] && m_setter.set_sample( m_sample_i++ ) ;
+			}
+
+			void set_number_of_entries( uint32_t ploidy, std::size_t n, OrderType const order_type, ValueType const value_type ) {
+				m_setter.set_number_of_entries( ploidy, n, order_type, value_type ) ;
+			}
+
+			void set_value( std::size_t i, MissingValue const value ) { m_setter.set_value( i, value ) ; }
+			void set_value( std::size_t i, std::string& value ) { m_setter.set_value( i, value ) ; }
+			void set_value( std::size_t i, VariantEntry::Integer const value ) { m_setter.set_value( i, value ) ; }
+			void set_value( std::size_t i, double const value ) { m_setter.set_value( i, value ) ; }
+
+			void finalise() {
+				m_setter.finalise() ;
+			}
+
+		private:
+			VariantDataReader::PerSampleSetter& m_setter ;
+			SNPDataSource::SampleSelection const& m_selection ;
+			std::size_t const m_number_of_selected_samples ;
+			std::size_t m_sample_i ;
+		} ;
+
 		struct BGenFileSNPDataReader: public VariantDataReader {
 			BGenFileSNPDataReader( BGenFileSNPDataSource& source ):
 				m_source( source )
@@ -141,6 +244,7 @@ namespace genfile {
 					m_source.bgen_context(),
 					&m_source.m_compressed_data_buffer
 				) ;
+				m_source.m_io_counts.bytes_read += m_source.m_compressed_data_buffer.size() ;
 			}
 			
 			BGenFileSNPDataReader& get( std::string const& spec, PerSampleSetter& setter ) {
@@ -150,12 +254,29 @@ namespace genfile {
 					m_source.m_compressed_data_buffer,
 					&(m_source.m_uncompressed_data_buffer)
 				) ;
-				bgen::parse_probability_data(
-					&(m_source.m_uncompressed_data_buffer)[0],
-					&(m_source.m_uncompressed_data_buffer)[0] + m_source.m_uncompressed_data_buffer.size(),
-					m_source.bgen_context(),
-					setter
-				) ;
+				if( m_source.bgen_context().flags & bgen::e_CompressedSNPBlocks ) {
+					m_source.m_io_counts.bytes_decompressed += m_source.m_uncompressed_data_buffer.size() ;
+				}
+				if( m_source.m_sample_selection ) {
+					SampleSelectingSetter selecting_setter(
+						setter,
+						m_source.m_sample_selection.get(),
+						m_source.m_number_of_selected_samples
+					) ;
+					bgen::parse_probability_data(
+						&(m_source.m_uncompressed_data_buffer)[0],
+						&(m_source.m_uncompressed_data_buffer)[0] + m_source.m_uncompressed_data_buffer.size(),
+						m_source.bgen_context(),
+						selecting_setter
+					) ;
+				} else {
+					bgen::parse_probability_data(
+						&(m_source.m_uncompressed_data_buffer)[0],
+						&(m_source.m_uncompressed_data_buffer)[0] + m_source.m_uncompressed_data_buffer.size(),
+						m_source.bgen_context(),
+						setter
+					) ;
+				}
 				return *this ;
 			}
 			
@@ -164,7 +285,7 @@ namespace genfile {
 			}
 			
 			std::size_t get_number_of_samples() const {
-				return m_source.number_of_samples() ;
+				return m_source.m_sample_selection ? m_source.m_number_of_selected_samples : m_source.number_of_samples() ;
 			}
 
 			void get_supported_specs( SpecSetter setter ) const {
@@ -189,6 +310,12 @@ namespace genfile {
 		) ;
 	}
 
+	bool BGenFileSNPDataSource::set_sample_selection_impl( SampleSelection const& selection ) {
+		m_sample_selection = selection ;
+		m_number_of_selected_samples = std::count( selection.begin(), selection.end(), true ) ;
+		return true ;
+	}
+
 	void BGenFileSNPDataSource::setup( std::auto_ptr< std::istream > stream ) {
 		m_stream_ptr = stream ;
 		bgen::uint32_t offset = 0 ;
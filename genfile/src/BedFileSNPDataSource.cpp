@@ -6,6 +6,12 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <cstring>
 #include <boost/format.hpp>
 #include "genfile/snp_data_utils.hpp"
 #include "genfile/SNPDataSource.hpp"
@@ -18,7 +24,10 @@ namespace genfile {
 	BedFileSNPDataSource::BedFileSNPDataSource( std::string const& bedFilename, std::string const& bimFilename, std::string const& famFilename ):
 		m_bed_filename( bedFilename ),
 		m_bim_filename( bimFilename ),
-		m_exhausted( false )
+		m_exhausted( false ),
+		m_visit_index( 0 ),
+		m_current_variant( 0 ),
+		m_bed_stream_variant( 0 )
 	{
 		m_genotype_table.push_back( std::make_pair( 0, 0 )) ;
 		m_genotype_table.push_back( std::make_pair( -1, -1 )) ;
@@ -29,7 +38,6 @@ namespace genfile {
 
 	void BedFileSNPDataSource::setup( std::string const& bedFilename, std::string const& bimFilename, std::string const& famFilename ) {
 		m_bed_stream_ptr = open_binary_file_for_input( bedFilename ) ;
-		m_bim_stream_ptr = open_text_file_for_input( bimFilename ) ;
 
 		{
 			std::size_t sampleCount = 0 ;
@@ -62,15 +70,186 @@ namespace genfile {
 				0
 			) ;
 		}
+		load_bim_file( bimFilename ) ;
+		m_total_number_of_snps = m_variant_keys.size() ;
 	}
 
-	void BedFileSNPDataSource::reset_to_start_impl() {
-		m_bim_stream_ptr->clear() ;
-		m_bim_stream_ptr->seekg(0) ;
+	namespace {
+		uint64_t const position_mask = 0xFFFFFFFF ;
+
+		// Compare variant indices, or indices and keys, by key.  Ties between variants are broken by index.
+		struct KeyLess {
+			KeyLess( std::vector< uint64_t > const& keys ): m_keys( keys ) {}
+			bool operator()( uint32_t a, uint32_t b ) const {
+				return ( m_keys[a] < m_keys[b] ) || ( m_keys[a] == m_keys[b] && a < b ) ;
+			}
+			bool operator()( uint32_t a, uint64_t key ) const { return m_keys[a] < key ; }
+			bool operator()( uint64_t key, uint32_t a ) const { return key < m_keys[a] ; }
+		private:
+			std::vector< uint64_t > const& m_keys ;
+		} ;
+	}
+
+	void BedFileSNPDataSource::load_bim_file( std::string const& bimFilename ) {
+		std::auto_ptr< std::istream > bim = open_text_file_for_input( bimFilename ) ;
+		std::string chromosome ;
+		std::string rsid ;
+		uint32_t position ;
+		std::string alleleA, alleleB ;
+		double cM ;
+		std::map< std::string, uint64_t > chromosome_indices ;
+		while( (*bim) >> chromosome >> rsid >> cM >> position >> alleleA >> alleleB ) {
+			bim->ignore( std::numeric_limits< std::streamsize >::max(), '\n' ) ;
+			if( m_variant_keys.size() == std::numeric_limits< uint32_t >::max() ) {
+				throw MalformedInputError( bimFilename, "Too many variants in file", m_variant_keys.size() ) ;
+			}
+			std::map< std::string, uint64_t >::const_iterator where = chromosome_indices.find( chromosome ) ;
+			if( where == chromosome_indices.end() ) {
+				where = chromosome_indices.insert( std::make_pair( chromosome, m_chromosomes.size() )).first ;
+				m_chromosomes.push_back( Chromosome( chromosome )) ;
+			}
+			m_variant_keys.push_back( ( where->second << 32 ) | position ) ;
+			m_identifier_offsets.push_back( m_identifiers.size() ) ;
+			m_identifiers.append( rsid ).push_back( '\0' ) ;
+			m_identifiers.append( alleleA ).push_back( '\0' ) ;
+			m_identifiers.append( alleleB ).push_back( '\0' ) ;
+		}
+		if( !bim->eof() ) {
+			throw MalformedInputError( bimFilename, m_variant_keys.size() ) ;
+		}
+
+		m_position_index.resize( m_variant_keys.size() ) ;
+		for( std::size_t i = 0; i < m_variant_keys.size(); ++i ) {
+			m_position_index[i] = i ;
+		}
+		std::sort( m_position_index.begin(), m_position_index.end(), KeyLess( m_variant_keys ) ) ;
+	}
+
+	VariantIdentifyingData BedFileSNPDataSource::get_variant( std::size_t index ) const {
+		assert( index < m_variant_keys.size() ) ;
+		uint64_t const key = m_variant_keys[ index ] ;
+		char const* rsid = m_identifiers.data() + m_identifier_offsets[ index ] ;
+		char const* alleleA = rsid + std::strlen( rsid ) + 1 ;
+		char const* alleleB = alleleA + std::strlen( alleleA ) + 1 ;
+		return VariantIdentifyingData(
+			rsid,
+			GenomePosition( m_chromosomes[ key >> 32 ], Position( key & position_mask )),
+			alleleA,
+			alleleB
+		) ;
+	}
+
+	void BedFileSNPDataSource::seek_to_variant( std::size_t index ) {
+		std::streamoff const offset = 3 + std::streamoff( index ) * std::streamoff( number_of_bytes_per_variant() ) ;
 		m_bed_stream_ptr->clear() ;
-		m_bed_stream_ptr->seekg(0) ;
-		// skip the magic number and mode
-		m_bed_stream_ptr->ignore( 3 ) ;
+		m_bed_stream_ptr->seekg( offset ) ;
+		m_bed_stream_variant = index ;
+		if( !*m_bed_stream_ptr ) {
+			throw MalformedInputError(
+				m_bed_filename,
+				"Unable to seek to genotypes for variant " + string_utils::to_string( index + 1 ),
+				index
+			) ;
+		}
+	}
+
+	std::size_t BedFileSNPDataSource::restrict_to_ranges( std::vector< GenomePositionRange > const& ranges ) {
+		typedef std::vector< uint32_t >::const_iterator IndexIterator ;
+		KeyLess const less( m_variant_keys ) ;
+		IndexIterator const index_begin = m_position_index.begin() ;
+		IndexIterator const index_end = m_position_index.end() ;
+		std::vector< std::size_t > variants ;
+		for( std::size_t i = 0; i < ranges.size(); ++i ) {
+			GenomePositionRange const& range = ranges[i] ;
+			bool const single_chromosome = ( range.start().chromosome() == range.end().chromosome() ) ;
+			// Ranges may omit the chromosome, so look within each chromosome in the index.
+			for( uint64_t c = 0; c < m_chromosomes.size(); ++c ) {
+				Chromosome const& chromosome = m_chromosomes[c] ;
+				uint64_t const chromosome_key = c << 32 ;
+				IndexIterator where = std::lower_bound(
+					index_begin, index_end,
+					chromosome_key | ( single_chromosome ? range.start().position() : 0 ),
+					less
+				) ;
+				IndexIterator const block_end = std::upper_bound(
+					where, index_end,
+					chromosome_key | ( single_chromosome ? range.end().position() : position_mask ),
+					less
+				) ;
+				for( ; where != block_end; ++where ) {
+					if( range.contains( GenomePosition( chromosome, Position( m_variant_keys[ *where ] & position_mask )))) {
+						variants.push_back( *where ) ;
+					}
+				}
+			}
+		}
+		std::sort( variants.begin(), variants.end() ) ;
+		variants.erase( std::unique( variants.begin(), variants.end() ), variants.end() ) ;
+		if( m_visited_variants ) {
+			std::vector< std::size_t > intersection ;
+			std::set_intersection(
+				variants.begin(), variants.end(),
+				m_visited_variants->begin(), m_visited_variants->end(),
+				std::back_inserter( intersection )
+			) ;
+			variants.swap( intersection ) ;
+		}
+		return set_visited_variants( variants ) ;
+	}
+
+	std::size_t BedFileSNPDataSource::restrict_to( VariantIdentifyingDataTest const& test ) {
+		std::vector< std::size_t > variants ;
+		if( m_visited_variants ) {
+			std::vector< std::size_t > const& visited = m_visited_variants.get() ;
+			for( std::size_t i = 0; i < visited.size(); ++i ) {
+				if( test( get_variant( visited[i] ) )) {
+					variants.push_back( visited[i] ) ;
+				}
+			}
+		} else {
+			for( std::size_t i = 0; i < m_variant_keys.size(); ++i ) {
+				if( test( get_variant( i ) )) {
+					variants.push_back( i ) ;
+				}
+			}
+		}
+		return set_visited_variants( variants ) ;
+	}
+
+	std::size_t BedFileSNPDataSource::set_visited_variants( std::vector< std::size_t > const& variants ) {
+		m_visited_variants = variants ;
+		m_total_number_of_snps = variants.size() ;
+		reset_to_start() ;
+		return variants.size() ;
+	}
+
+	void BedFileSNPDataSource::read_packed_genotypes( std::size_t first_variant, std::size_t count, std::vector< char >* result ) {
+		assert( result ) ;
+		if( first_variant + count > m_variant_keys.size() ) {
+			throw BadArgumentError(
+				"genfile::BedFileSNPDataSource::read_packed_genotypes()",
+				"first_variant=" + string_utils::to_string( first_variant ) + ", count=" + string_utils::to_string( count ),
+				"File has only " + string_utils::to_string( m_variant_keys.size() ) + " variants."
+			) ;
+		}
+		result->resize( count * number_of_bytes_per_variant() ) ;
+		if( count > 0 ) {
+			seek_to_variant( first_variant ) ;
+			m_bed_stream_ptr->read( &(*result)[0], result->size() ) ;
+			m_io_counts.bytes_read += result->size() ;
+			if( !*m_bed_stream_ptr ) {
+				throw MalformedInputError(
+					m_bed_filename,
+					"Unable to read genotypes from file",
+					first_variant
+				) ;
+			}
+		}
+		m_bed_stream_variant = first_variant + count ;
+	}
+
+	void BedFileSNPDataSource::reset_to_start_impl() {
+		m_visit_index = 0 ;
 		m_exhausted = false ;
 	}
 
@@ -86,16 +265,11 @@ namespace genfile {
 	}
 
 	void BedFileSNPDataSource::read_snp_identifying_data_impl( VariantIdentifyingData* result ) {
-		std::string chromosome ;
-		std::string rsid ;
-		uint32_t position ;
-		std::string alleleA, alleleB ;
-		double cM ;
-		(*m_bim_stream_ptr) >> chromosome >> rsid >> cM >> position >> alleleA >> alleleB ;
-		m_bim_stream_ptr->ignore( std::numeric_limits< std::streamsize >::max(), '\n' ) ;
-		
-		if( *m_bim_stream_ptr ) {
-			*result = VariantIdentifyingData( rsid, GenomePosition( chromosome, position ), alleleA, alleleB ) ;
+		std::size_t const number_of_visited_variants = m_visited_variants ? m_visited_variants->size() : m_variant_keys.size() ;
+		if( m_visit_index < number_of_visited_variants ) {
+			m_current_variant = m_visited_variants ? m_visited_variants.get()[ m_visit_index ] : m_visit_index ;
+			++m_visit_index ;
+			*result = get_variant( m_current_variant ) ;
 		} else {
 			m_exhausted = true ;
 		}
@@ -106,9 +280,13 @@ namespace genfile {
 			BedFileSNPDataReader( BedFileSNPDataSource& source ):
 				m_source( source ),
 				m_number_of_samples( source.number_of_samples() ),
-				m_buffer( ( m_number_of_samples + 3 ) / 4, 0 )
+				m_buffer( source.number_of_bytes_per_variant(), 0 )
 			{
+				if( source.m_bed_stream_variant != source.m_current_variant ) {
+					source.seek_to_variant( source.m_current_variant ) ;
+				}
 				source.m_bed_stream_ptr->read( &m_buffer[0], m_buffer.size() ) ;
+				source.m_io_counts.bytes_read += m_buffer.size() ;
 				if( !(*source.m_bed_stream_ptr )) {
 					throw MalformedInputError(
 						source.m_bed_filename,
@@ -116,35 +294,35 @@ namespace genfile {
 						source.number_of_snps_read()
 					) ;
 				}
+				source.m_bed_stream_variant = source.m_current_variant + 1 ;
 			}
 			
 			BedFileSNPDataReader& get( std::string const& spec, PerSampleSetter& setter ) {
 				assert( spec == "GT" || spec == ":genotypes:" ) ;
-				setter.initialise( m_number_of_samples, 2 ) ;
-				uint32_t const ploidy = 2 ;
-				for( std::size_t i = 0; i < m_number_of_samples; ++i ) {
-					std::size_t index = i/4 ;
-					std::size_t data = ( m_buffer[ index ] >> (2*(i%4)) ) & 0x3 ;
-					setter.set_sample( i ) ;
-					setter.set_number_of_entries( ploidy, 2, ePerUnorderedHaplotype, eAlleleIndex ) ;
-					std::pair< int64_t, int64_t > const& genotype = m_source.m_genotype_table[ data ] ;
-#if DEBUG_BED_FORMAT > 2
-					std::cerr << "data for sample " << i << " is: " << data << ".\n";
-					std::cerr << "genotype is " << genotype.first << "/" << genotype.second << ".\n" ;
-#endif
-					if( genotype.first == -1 ) {
-						setter.set_value( 0, genfile::MissingValue() ) ;
-						setter.set_value( 1, genfile::MissingValue() ) ;
-					} else {
-						setter.set_value( 0, genotype.first ) ;
-						setter.set_value( 1, genotype.second ) ;
+				if( m_source.m_selected_samples ) {
+					// Decode only the 2-bit codes of selected samples.
+					std::vector< std::size_t > const& selected_samples = m_source.m_selected_samples.get() ;
+					setter.initialise( selected_samples.size(), 2 ) ;
+					for( std::size_t k = 0; k < selected_samples.size(); ++k ) {
+						if( setter.set_sample( k ) ) {
+							set_genotype( selected_samples[k], setter ) ;
+						}
+					}
+				} else {
+					setter.initialise( m_number_of_samples, 2 ) ;
+					for( std::size_t i = 0; i < m_number_of_samples; ++i ) {
+						if( setter.set_sample( i ) ) {
+							set_genotype( i, setter ) ;
+						}
 					}
 				}
 				setter.finalise() ;
 				return *this ;
 			}
 			
-			std::size_t get_number_of_samples() const { return m_number_of_samples ; }
+			std::size_t get_number_of_samples() const {
+				return m_source.m_selected_samples ? m_source.m_selected_samples->size() : m_number_of_samples ;
+			}
 			
 			bool supports( std::string const& spec ) const {
 				return spec == "GT" || spec == ":genotypes:";
@@ -159,6 +337,25 @@ namespace genfile {
 			BedFileSNPDataSource& m_source ;
 			std::size_t m_number_of_samples ;
 			std::vector< char > m_buffer ;
+
+		private:
+			void set_genotype( std::size_t i, PerSampleSetter& setter ) const {
+				uint32_t const ploidy = 2 ;
+				std::size_t data = ( m_buffer[ i/4 ] >> (2*(i%4)) ) & 0x3 ;
+				setter.set_number_of_entries( ploidy, 2, ePerUnorderedHaplotype, eAlleleIndex ) ;
+				std::pair< int64_t, int64_t > const& genotype = m_source.m_genotype_table[ data ] ;
+#if DEBUG_BED_FORMAT > 2
+				std::cerr << "data for sample " << i << " is: " << data << ".\n";
+				std::cerr << "genotype is " << genotype.first << "/" << genotype.second << ".\n" ;
+#endif
+				if( genotype.first == -1 ) {
+					setter.set_value( 0, genfile::MissingValue() ) ;
+					setter.set_value( 1, genfile::MissingValue() ) ;
+				} else {
+					setter.set_value( 0, genotype.first ) ;
+					setter.set_value( 1, genotype.second ) ;
+				}
+			}
 		} ;
 	}
 
@@ -167,8 +364,17 @@ namespace genfile {
 	}
 
 	void BedFileSNPDataSource::ignore_snp_probability_data_impl() {
-		m_bed_stream_ptr->ignore( ( m_number_of_samples + 3 ) / 4 ) ;
+		// Nothing to do; the next record read will seek past this one.
 	}
 
-}	
-
+	bool BedFileSNPDataSource::set_sample_selection_impl( SampleSelection const& selection ) {
+		std::vector< std::size_t > selected_samples ;
+		for( std::size_t i = 0; i < selection.size(); ++i ) {
+			if( selection[i] ) {
+				selected_samples.push_back( i ) ;
+			}
+		}
+		m_selected_samples = selected_samples ;
+		return true ;
+	}
+}
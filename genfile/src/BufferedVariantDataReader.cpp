@@ -0,0 +1,451 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <map>
+#include <vector>
+#include <string>
+#include <exception>
+#include <cstring>
+#include <boost/bind.hpp>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/BufferedVariantDataReader.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/Error.hpp"
+
+namespace genfile {
+	namespace {
+		// Codes for the setter calls held in a record.
+		enum Code {
+			eInitialise = 0,		// followed by number of samples and alleles
+			eSetSample,				// followed by the sample index
+			eNextSample,			// the sample after the previous one
+			eSetNumberOfEntries,	// followed by ploidy, number of entries, order type and value type
+			eRepeatNumberOfEntries,	// the same arguments as the previous eSetNumberOfEntries
+			eSetEntry,				// followed by the index of the next value; otherwise values follow on from the previous one
+			eMissing,
+			eInteger,				// followed by the value, zigzag-encoded
+			eZero,
+			eOne,
+			eDouble,				// followed by 8 bytes
+			eString,				// followed by the length and characters
+			eFinalise
+		} ;
+
+		template< typename IntegerType >
+		void append( std::vector< uint8_t >* buffer, IntegerType const value ) {
+			std::size_t const size = buffer->size() ;
+			buffer->resize( size + sizeof( IntegerType )) ;
+			write_little_endian_integer( &(*buffer)[0] + size, &(*buffer)[0] + buffer->size(), value ) ;
+		}
+
+		// Append an unsigned integer in seven-bit groups, least significant first; the top bit
+		// of each byte flags that more follow.
+		void append_varint( std::vector< uint8_t >* buffer, uint64_t value ) {
+			while( value >= 0x80 ) {
+				buffer->push_back( uint8_t( value | 0x80 )) ;
+				value >>= 7 ;
+			}
+			buffer->push_back( uint8_t( value )) ;
+		}
+
+		void append( std::vector< uint8_t >* buffer, std::string const& value ) {
+			append_varint( buffer, value.size() ) ;
+			buffer->insert( buffer->end(), value.begin(), value.end() ) ;
+		}
+
+		// Reads values written by append(), checking they lie within the buffer.
+		struct Parser {
+			Parser( uint8_t const* begin, uint8_t const* const end ):
+				m_p( begin ),
+				m_end( end )
+			{}
+
+			bool done() const { return m_p == m_end ; }
+			uint8_t const* position() const { return m_p ; }
+
+			uint8_t read_byte() {
+				check( 1 ) ;
+				return *m_p++ ;
+			}
+
+			template< typename IntegerType >
+			IntegerType read() {
+				check( sizeof( IntegerType )) ;
+				IntegerType result ;
+				m_p = read_little_endian_integer( m_p, m_end, &result ) ;
+				return result ;
+			}
+
+			uint64_t read_varint() {
+				uint64_t result = 0 ;
+				for( int shift = 0; shift < 64; shift += 7 ) {
+					uint8_t const byte = read_byte() ;
+					result |= uint64_t( byte & 0x7F ) << shift ;
+					if( !( byte & 0x80 )) {
+						return result ;
+					}
+				}
+				throw BadArgumentError(
+					"genfile::BufferedVariantDataReader::deserialise()",
+					"data",
+					"Integer is too long."
+				) ;
+			}
+
+			std::string read_string() {
+				uint64_t const size = read_varint() ;
+				check( size ) ;
+				std::string result( reinterpret_cast< char const* >( m_p ), size ) ;
+				m_p += size ;
+				return result ;
+			}
+
+			void skip( std::size_t size ) {
+				check( size ) ;
+				m_p += size ;
+			}
+
+		private:
+			uint8_t const* m_p ;
+			uint8_t const* const m_end ;
+
+			void check( uint64_t size ) const {
+				if( uint64_t( m_end - m_p ) < size ) {
+					throw BadArgumentError(
+						"genfile::BufferedVariantDataReader::deserialise()",
+						"data",
+						"Data is truncated."
+					) ;
+				}
+			}
+		} ;
+
+		// Setter which encodes each call into a byte buffer.
+		struct RecordingSetter: public VariantDataReader::PerSampleSetter {
+			RecordingSetter( std::vector< uint8_t >& data ):
+				m_data( data ),
+				m_next_sample( 0 ),
+				m_next_entry( 0 ),
+				m_have_entries( false )
+			{}
+
+			void initialise( std::size_t nSamples, std::size_t nAlleles ) {
+				m_data.push_back( eInitialise ) ;
+				append_varint( &m_data, nSamples ) ;
+				append_varint( &m_data, nAlleles ) ;
+				m_next_sample = 0 ;
+				m_have_entries = false ;
+			}
+			bool set_sample( std::size_t i ) {
+				if( i == m_next_sample ) {
+					m_data.push_back( eNextSample ) ;
+				} else {
+					m_data.push_back( eSetSample ) ;
+					append_varint( &m_data, i ) ;
+				}
+				m_next_sample = i + 1 ;
+				m_next_entry = 0 ;
+				return true ;
+			}
+			void set_number_of_entries( uint32_t ploidy, std::size_t n, OrderType const order_type, ValueType const value_type ) {
+				if(
+					m_have_entries && ploidy == m_ploidy && n == m_number_of_entries
+					&& order_type == m_order_type && value_type == m_value_type
+				) {
+					m_data.push_back( eRepeatNumberOfEntries ) ;
+				} else {
+					m_data.push_back( eSetNumberOfEntries ) ;
+					append_varint( &m_data, ploidy ) ;
+					append_varint( &m_data, n ) ;
+					m_data.push_back( uint8_t( order_type )) ;
+					m_data.push_back( uint8_t( value_type )) ;
+					m_have_entries = true ;
+					m_ploidy = ploidy ;
+					m_number_of_entries = n ;
+					m_order_type = order_type ;
+					m_value_type = value_type ;
+				}
+				m_next_entry = 0 ;
+			}
+			void set_value( std::size_t i, MissingValue const value ) {
+				set_entry( i ) ;
+				m_data.push_back( eMissing ) ;
+			}
+			void set_value( std::size_t i, std::string& value ) {
+				set_entry( i ) ;
+				m_data.push_back( eString ) ;
+				append( &m_data, value ) ;
+			}
+			void set_value( std::size_t i, Integer const value ) {
+				set_entry( i ) ;
+				m_data.push_back( eInteger ) ;
+				append_varint( &m_data, ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 )) ;
+			}
+			void set_value( std::size_t i, double const value ) {
+				set_entry( i ) ;
+				uint64_t bits ;
+				std::memcpy( &bits, &value, sizeof( double )) ;
+				if( bits == 0 ) {
+					m_data.push_back( eZero ) ;
+				} else if( value == 1.0 ) {
+					m_data.push_back( eOne ) ;
+				} else {
+					m_data.push_back( eDouble ) ;
+					append( &m_data, bits ) ;
+				}
+			}
+			void finalise() {
+				m_data.push_back( eFinalise ) ;
+			}
+
+		private:
+			std::vector< uint8_t >& m_data ;
+			std::size_t m_next_sample ;
+			std::size_t m_next_entry ;
+			bool m_have_entries ;
+			uint32_t m_ploidy ;
+			std::size_t m_number_of_entries ;
+			OrderType m_order_type ;
+			ValueType m_value_type ;
+
+			void set_entry( std::size_t i ) {
+				if( i != m_next_entry ) {
+					m_data.push_back( eSetEntry ) ;
+					append_varint( &m_data, i ) ;
+				}
+				m_next_entry = i + 1 ;
+			}
+		} ;
+
+		void add_spec( std::vector< std::pair< std::string, std::string > >* specs, std::string const& spec, std::string const& type ) {
+			specs->push_back( std::make_pair( spec, type )) ;
+		}
+	}
+
+	BufferedVariantDataReader::UniquePtr BufferedVariantDataReader::create(
+		VariantDataReader& reader,
+		std::vector< std::string > const& specs
+	) {
+		UniquePtr result( new BufferedVariantDataReader( reader.get_number_of_samples() )) ;
+		reader.get_supported_specs( boost::bind( &add_spec, &result->m_supported_specs, _1, _2 )) ;
+		if( specs.empty() ) {
+			for( std::size_t i = 0; i < result->m_supported_specs.size(); ++i ) {
+				result->record( reader, result->m_supported_specs[i].first ) ;
+			}
+			char const* pseudo_specs[] = { ":genotypes:", ":intensities:" } ;
+			for( std::size_t i = 0; i < 2; ++i ) {
+				if( reader.supports( pseudo_specs[i] ) && result->m_records.find( pseudo_specs[i] ) == result->m_records.end() ) {
+					result->record( reader, pseudo_specs[i] ) ;
+				}
+			}
+		} else {
+			for( std::size_t i = 0; i < specs.size(); ++i ) {
+				if( reader.supports( specs[i] ) ) {
+					result->record( reader, specs[i] ) ;
+				}
+			}
+		}
+		return result ;
+	}
+
+	BufferedVariantDataReader::BufferedVariantDataReader( std::size_t number_of_samples ):
+		m_number_of_samples( number_of_samples )
+	{}
+
+	void BufferedVariantDataReader::record( VariantDataReader& reader, std::string const& spec ) {
+		Record& record = m_records[ spec ] ;
+		RecordingSetter setter( record.data ) ;
+		try {
+			reader.get( spec, setter ) ;
+		}
+		catch( ... ) {
+			record.data.clear() ;
+			record.error = std::current_exception() ;
+		}
+		// Release the excess capacity left by growing the buffer.
+		std::vector< uint8_t >( record.data ).swap( record.data ) ;
+	}
+
+	BufferedVariantDataReader& BufferedVariantDataReader::get( std::string const& spec, PerSampleSetter& setter ) {
+		Records::const_iterator where = m_records.find( spec ) ;
+		if( where == m_records.end() ) {
+			throw BadArgumentError(
+				"genfile::BufferedVariantDataReader::get()",
+				"spec=\"" + spec + "\"",
+				"This spec was not buffered."
+			) ;
+		}
+		Record const& record = where->second ;
+		if( record.error ) {
+			std::rethrow_exception( record.error ) ;
+		}
+		if( record.data.empty() ) {
+			return *this ;
+		}
+		// Honour the setter's choice of samples, as the base reader would.
+		bool wanted = true ;
+		std::size_t next_sample = 0 ;
+		std::size_t entry = 0 ;
+		uint32_t ploidy = 0 ;
+		std::size_t number_of_entries = 0 ;
+		OrderType order_type = eUnknownOrderType ;
+		ValueType value_type = eUnknownValueType ;
+		Parser parser( &record.data[0], &record.data[0] + record.data.size() ) ;
+		while( !parser.done() ) {
+			switch( parser.read_byte() ) {
+				case eInitialise: {
+					std::size_t const nSamples = parser.read_varint() ;
+					std::size_t const nAlleles = parser.read_varint() ;
+					setter.initialise( nSamples, nAlleles ) ;
+					wanted = true ;
+					next_sample = 0 ;
+					break ;
+				}
+				case eSetSample:
+					next_sample = parser.read_varint() ;
+					// fall through
+				case eNextSample:
+					wanted = setter.set_sample( next_sample++ ) ;
+					entry = 0 ;
+					break ;
+				case eSetNumberOfEntries:
+					ploidy = parser.read_varint() ;
+					number_of_entries = parser.read_varint() ;
+					order_type = OrderType( parser.read_byte() ) ;
+					value_type = ValueType( parser.read_byte() ) ;
+					// fall through
+				case eRepeatNumberOfEntries:
+					if( wanted ) {
+						setter.set_number_of_entries( ploidy, number_of_entries, order_type, value_type ) ;
+					}
+					entry = 0 ;
+					break ;
+				case eSetEntry:
+					entry = parser.read_varint() ;
+					break ;
+				case eMissing:
+					if( wanted ) {
+						setter.set_value( entry, genfile::MissingValue() ) ;
+					}
+					++entry ;
+					break ;
+				case eInteger: {
+					uint64_t const value = parser.read_varint() ;
+					if( wanted ) {
+						setter.set_value( entry, vcf::EntrySetter::Integer( int64_t( value >> 1 ) ^ -int64_t( value & 1 ))) ;
+					}
+					++entry ;
+					break ;
+				}
+				case eZero:
+					if( wanted ) {
+						setter.set_value( entry, 0.0 ) ;
+					}
+					++entry ;
+					break ;
+				case eOne:
+					if( wanted ) {
+						setter.set_value( entry, 1.0 ) ;
+					}
+					++entry ;
+					break ;
+				case eDouble: {
+					uint64_t const bits = parser.read< uint64_t >() ;
+					if( wanted ) {
+						double value ;
+						std::memcpy( &value, &bits, sizeof( double )) ;
+						setter.set_value( entry, value ) ;
+					}
+					++entry ;
+					break ;
+				}
+				case eString: {
+					std::string value = parser.read_string() ;
+					if( wanted ) {
+						setter.set_value( entry, value ) ;
+					}
+					++entry ;
+					break ;
+				}
+				case eFinalise:
+					setter.finalise() ;
+					break ;
+				default:
+					throw BadArgumentError(
+						"genfile::BufferedVariantDataReader::get()",
+						"spec=\"" + spec + "\"",
+						"Buffered data contains an unrecognised code."
+					) ;
+			}
+		}
+		return *this ;
+	}
+
+	void BufferedVariantDataReader::serialise( std::vector< uint8_t >* buffer ) const {
+		append_varint( buffer, m_number_of_samples ) ;
+		append_varint( buffer, m_supported_specs.size() ) ;
+		for( std::size_t i = 0; i < m_supported_specs.size(); ++i ) {
+			append( buffer, m_supported_specs[i].first ) ;
+			append( buffer, m_supported_specs[i].second ) ;
+		}
+		std::size_t number_of_records = 0 ;
+		for( Records::const_iterator i = m_records.begin(); i != m_records.end(); ++i ) {
+			number_of_records += ( i->second.error ? 0 : 1 ) ;
+		}
+		append_varint( buffer, number_of_records ) ;
+		for( Records::const_iterator i = m_records.begin(); i != m_records.end(); ++i ) {
+			Record const& record = i->second ;
+			if( record.error ) {
+				continue ;
+			}
+			append( buffer, i->first ) ;
+			append_varint( buffer, record.data.size() ) ;
+			buffer->insert( buffer->end(), record.data.begin(), record.data.end() ) ;
+		}
+	}
+
+	BufferedVariantDataReader::UniquePtr BufferedVariantDataReader::deserialise( uint8_t const* begin, uint8_t const* const end ) {
+		Parser parser( begin, end ) ;
+		UniquePtr result( new BufferedVariantDataReader( parser.read_varint() )) ;
+		uint64_t const number_of_specs = parser.read_varint() ;
+		for( uint64_t i = 0; i < number_of_specs; ++i ) {
+			std::string const spec = parser.read_string() ;
+			result->m_supported_specs.push_back( std::make_pair( spec, parser.read_string() )) ;
+		}
+		uint64_t const number_of_records = parser.read_varint() ;
+		for( uint64_t i = 0; i < number_of_records; ++i ) {
+			Record& record = result->m_records[ parser.read_string() ] ;
+			uint64_t const size = parser.read_varint() ;
+			uint8_t const* data = parser.position() ;
+			parser.skip( size ) ;
+			record.data.assign( data, data + size ) ;
+		}
+		return result ;
+	}
+
+	std::size_t BufferedVariantDataReader::get_memory_usage() const {
+		std::size_t result = sizeof( *this ) ;
+		for( std::size_t i = 0; i < m_supported_specs.size(); ++i ) {
+			result += sizeof( m_supported_specs[i] ) + m_supported_specs[i].first.size() + m_supported_specs[i].second.size() ;
+		}
+		for( Records::const_iterator i = m_records.begin(); i != m_records.end(); ++i ) {
+			result += sizeof( *i ) + i->first.size() + i->second.data.capacity() ;
+		}
+		return result ;
+	}
+
+	bool BufferedVariantDataReader::supports( std::string const& spec ) const {
+		return m_records.find( spec ) != m_records.end() ;
+	}
+
+	void BufferedVariantDataReader::get_supported_specs( SpecSetter setter ) const {
+		for( std::size_t i = 0; i < m_supported_specs.size(); ++i ) {
+			if( supports( m_supported_specs[i].first ) ) {
+				setter( m_supported_specs[i].first, m_supported_specs[i].second ) ;
+			}
+		}
+	}
+}
@@ -8,72 +8,129 @@
 #include <iomanip>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <cassert>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/static_assert.hpp>
 #include "genfile/Chromosome.hpp"
 #include "genfile/Error.hpp"
 #include "genfile/string_utils/string_utils.hpp"
 
 namespace genfile {
-	namespace impl {
-		namespace {
-			char const* humanChromosomes [] = {
-				"1", "01", "chr1",
-				"2", "02", "chr2",
-				"3", "03", "chr3",
-				"4", "04", "chr4",
-				"5", "05", "chr5",
-				"6", "06", "chr6",
-				"7", "07", "chr7",
-				"8", "08", "chr8",
-				"9", "09", "chr9",
-				"10", "chr10",
-				"11", "chr11",
-				"12", "chr12",
-				"13", "chr13",
-				"14", "chr14",
-				"15", "chr15",
-				"16", "chr16",
-				"17", "chr17",
-				"18", "chr18",
-				"19", "chr19",
-				"20", "chr20",
-				"21", "chr21",
-				"22", "chr22",
-				"X", "0X", "chrX", "23",
-				"Y", "0Y", "chrY",
-				"MT", "chrMT"
+	namespace {
+		char const* humanChromosomes [] = {
+			"1", "01", "chr1",
+			"2", "02", "chr2",
+			"3", "03", "chr3",
+			"4", "04", "chr4",
+			"5", "05", "chr5",
+			"6", "06", "chr6",
+			"7", "07", "chr7",
+			"8", "08", "chr8",
+			"9", "09", "chr9",
+			"10", "chr10",
+			"11", "chr11",
+			"12", "chr12",
+			"13", "chr13",
+			"14", "chr14",
+			"15", "chr15",
+			"16", "chr16",
+			"17", "chr17",
+			"18", "chr18",
+			"19", "chr19",
+			"20", "chr20",
+			"21", "chr21",
+			"22", "chr22",
+			"X", "0X", "chrX", "23",
+			"Y", "0Y", "chrY",
+			"MT", "chrMT"
+		} ;
+		BOOST_STATIC_ASSERT( sizeof( humanChromosomes ) / sizeof( char const* ) == Chromosome::eNumberOfOrderedCodes ) ;
+
+		// The table of interned chromosome names.
+		// Human chromosome names are entered on construction and looked up without locking.
+		// Names are stored in chunks that are never moved or freed, so that they can be looked up
+		// by code without locking too.
+		struct ChromosomeTable: public boost::noncopyable {
+			static ChromosomeTable& get() {
+				// Never destroyed, so chromosomes remain usable during static destruction.
+				static ChromosomeTable* table = new ChromosomeTable() ;
+				return *table ;
+			}
+
+			Chromosome::Code intern( std::string const& name ) {
+				CodeMap::const_iterator where = m_human_codes.find( name ) ;
+				if( where != m_human_codes.end() ) {
+					return where->second ;
+				}
+				boost::mutex::scoped_lock lock( m_mutex ) ;
+				where = m_codes.find( name ) ;
+				if( where != m_codes.end() ) {
+					return where->second ;
+				}
+				return add( name, &m_codes ) ;
+			}
+
+			std::string const& name( Chromosome::Code code ) const {
+				assert( code < m_number_of_codes ) ;
+				return m_chunks[ code >> eChunkBits ][ code & eChunkMask ] ;
+			}
+
+		private:
+			enum {
+				eChunkBits = 12,
+				eChunkSize = 1 << eChunkBits,
+				eChunkMask = eChunkSize - 1,
+				eMaxChunks = ( Chromosome::eMissingCode >> eChunkBits ) + 1
 			} ;
-		}
-		MapGenome human(
-			humanChromosomes,
-			3*9 + 13*2 + 4 + 3 + 2
-		) ;
-	}
+			typedef boost::unordered_map< std::string, Chromosome::Code > CodeMap ;
+			CodeMap m_human_codes ;
+			CodeMap m_codes ;
+			std::string* m_chunks[ eMaxChunks ] ;
+			Chromosome::Code m_number_of_codes ;
+			boost::mutex m_mutex ;
 
-	namespace impl {
-		MapGenome::MapGenome( char const** strings, std::size_t N ) {
-			for( std::size_t i = 0; i < N; ++i ) {
-				m_map[ strings[i] ] = i ;
+		private:
+			ChromosomeTable():
+				m_number_of_codes( 0 )
+			{
+				std::fill( m_chunks, m_chunks + eMaxChunks, static_cast< std::string* >( 0 ) ) ;
+				for( std::size_t i = 0; i < Chromosome::eNumberOfOrderedCodes; ++i ) {
+					add( humanChromosomes[i], &m_human_codes ) ;
+				}
 			}
-		}
 
-		MapGenome::~MapGenome() {
-		}
-		
-		bool MapGenome::compare( Chromosome const& left, Chromosome const& right ) const {
-			bool const leftIsMissing = !left.m_repr ;
-			bool rightIsMissing = !right.m_repr ;
-			if( leftIsMissing || rightIsMissing ) {
-				return (!leftIsMissing) && rightIsMissing ;
+			Chromosome::Code add( std::string const& name, CodeMap* codes ) {
+				Chromosome::Code const code = m_number_of_codes ;
+				if( code == Chromosome::eMissingCode ) {
+					throw OperationFailedError( "genfile::Chromosome::Chromosome()", "chromosome \"" + name + "\"", "intern (too many distinct chromosome names)" ) ;
+				}
+				std::string*& chunk = m_chunks[ code >> eChunkBits ] ;
+				if( !chunk ) {
+					chunk = new std::string[ eChunkSize ] ;
+				}
+				chunk[ code & eChunkMask ] = name ;
+				(*codes)[ name ] = code ;
+				++m_number_of_codes ;
+				return code ;
 			}
-			MapType::const_iterator li = m_map.find( *left.m_repr ) ;
-			MapType::const_iterator ri = m_map.find( *right.m_repr ) ;
-			return (
-				(( li != m_map.end() ) && (( ri == m_map.end() ) || ( li->second < ri->second )))
-				||
-				(( li == m_map.end() ) && (( ri == m_map.end() ) && ( left.m_repr < right.m_repr )))
-			) ;		
-		}
+		} ;
+	}
+
+	Chromosome::Chromosome( std::string const& chromosome_str ):
+		m_code( ChromosomeTable::get().intern( chromosome_str ))
+	{}
+
+	std::string const& Chromosome::name( Code code ) {
+		return ChromosomeTable::get().name( code ) ;
 	}
+
+	bool Chromosome::less_by_name( Code left, Code right ) {
+		return name( left ) < name( right ) ;
+	}
+
 	std::ostream& operator<<( std::ostream& oStream, Chromosome const& chromosome ) {
 		return oStream << static_cast< std::string >( chromosome ) ;
 	}
@@ -86,22 +143,26 @@ namespace genfile {
 	}
 
 	Chromosome::operator std::string () const {
-		if( m_repr ) {
-			return *m_repr ;
+		if( m_code != eMissingCode ) {
+			return name( m_code ) ;
 		} else {
 			return "NA" ;
 		}
 	}
 
 	bool Chromosome::is_sex_determining() const {
-		return m_repr && ((*m_repr) == "0X" || (*m_repr) == "0Y" || (*m_repr) == "X" || (*m_repr) == "Y" ) ;
+		if( m_code == eMissingCode ) {
+			return false ;
+		}
+		std::string const& repr = name( m_code ) ;
+		return ( repr == "0X" || repr == "0Y" || repr == "X" || repr == "Y" ) ;
 	}
 
 	bool Chromosome::is_autosome() const {
 		bool result = false ;
-		if( m_repr ) {
+		if( m_code != eMissingCode ) {
 			try {
-				int c = string_utils::to_repr< int > ( *m_repr ) ;
+				int c = string_utils::to_repr< int > ( name( m_code ) ) ;
 				result = (c > 0 && c <= 22) ;
 			}
 			catch( string_utils::StringConversionError const& ) {
@@ -111,6 +172,6 @@ namespace genfile {
 	}
 
 	bool Chromosome::is_missing() const {
-		return (!m_repr) ;
+		return m_code == eMissingCode ;
 	}
 }
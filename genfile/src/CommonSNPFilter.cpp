@@ -6,178 +6,502 @@
 
 #include <cassert>
 #include <iterator>
-
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <boost/noncopyable.hpp>
+#include <boost/bind.hpp>
 #include "genfile/VariantIdentifyingDataTest.hpp"
 #include "genfile/CommonSNPFilter.hpp"
-#include "genfile/RSIDInListTest.hpp"
-#include "genfile/SNPIDInListTest.hpp"
-#include "genfile/SNPIDFieldsInListTest.hpp"
-#include "genfile/ChromosomeInSetTest.hpp"
+#include "genfile/FlatStringSet.hpp"
 #include "genfile/SNPIDMatchesTest.hpp"
-#include "genfile/SNPInSetTest.hpp"
-#include "genfile/SNPPositionInRangeTest.hpp"
-#include "genfile/PositionInListTest.hpp"
 #include "genfile/snp_data_utils.hpp"
+#include "genfile/string_utils/string_utils.hpp"
 
 namespace genfile {
+	namespace {
+		// A set of closed intervals of 64-bit values, held sorted with overlapping
+		// and adjacent intervals merged so that membership is a binary search.
+		// Intervals added in sorted order are appended in constant time.
+		struct IntervalSet {
+			typedef std::pair< uint64_t, uint64_t > Interval ;
+
+			void add( uint64_t start, uint64_t end ) {
+				assert( start <= end ) ;
+				std::vector< Interval >::iterator i = std::upper_bound(
+					m_intervals.begin(), m_intervals.end(),
+					Interval( start, std::numeric_limits< uint64_t >::max() )
+				) ;
+				if( i != m_intervals.begin() && ( i - 1 )->second + 1 >= start ) {
+					--i ;
+					start = i->first ;
+				}
+				std::vector< Interval >::iterator j = i ;
+				for( ; j != m_intervals.end() && j->first <= end + 1; ++j ) {
+					end = std::max( end, j->second ) ;
+				}
+				i = m_intervals.erase( i, j ) ;
+				m_intervals.insert( i, Interval( start, end )) ;
+			}
+
+			bool contains( uint64_t value ) const {
+				std::vector< Interval >::const_iterator i = std::upper_bound(
+					m_intervals.begin(), m_intervals.end(),
+					Interval( value, std::numeric_limits< uint64_t >::max() )
+				) ;
+				return i != m_intervals.begin() && value <= ( i - 1 )->second ;
+			}
+
+			bool empty() const { return m_intervals.empty() ; }
+
+		private:
+			std::vector< Interval > m_intervals ;
+		} ;
+
+		bool less_by_key( GenomePosition const& left, GenomePosition const& right ) {
+			return left.key() < right.key() ;
+		}
+
+		bool equal_by_key( GenomePosition const& left, GenomePosition const& right ) {
+			return left.key() == right.key() ;
+		}
+
+		// A set of variants compared by the given fields, held in a sorted vector.
+		// If positions are compared, a sorted array of position keys is used to reject
+		// most variants without comparing other fields.
+		struct VariantSet: public boost::noncopyable {
+			VariantSet( std::vector< VariantIdentifyingData > const& snps, VariantIdentifyingData::CompareFields const& comparer ):
+				m_comparer( comparer ),
+				m_snps( snps )
+			{
+				std::sort( m_snps.begin(), m_snps.end(), m_comparer ) ;
+				m_snps.erase(
+					std::unique(
+						m_snps.begin(), m_snps.end(),
+						boost::bind( &VariantIdentifyingData::CompareFields::are_equal, &m_comparer, _1, _2 )
+					),
+					m_snps.end()
+				) ;
+				std::vector< int > const& fields = m_comparer.get_compared_fields() ;
+				if( std::find( fields.begin(), fields.end(), int( VariantIdentifyingData::CompareFields::ePosition )) != fields.end() ) {
+					m_positions.reserve( m_snps.size() ) ;
+					for( std::size_t i = 0; i < m_snps.size(); ++i ) {
+						m_positions.push_back( m_snps[i].get_position().key() ) ;
+					}
+					std::sort( m_positions.begin(), m_positions.end() ) ;
+					m_positions.erase( std::unique( m_positions.begin(), m_positions.end() ), m_positions.end() ) ;
+				}
+			}
+
+			bool contains( VariantIdentifyingData const& data ) const {
+				if( !m_positions.empty() && !std::binary_search( m_positions.begin(), m_positions.end(), data.get_position().key() )) {
+					return false ;
+				}
+				return std::binary_search( m_snps.begin(), m_snps.end(), data, m_comparer ) ;
+			}
+
+			std::string display() const {
+				std::ostringstream ostr ;
+				ostr << "SNP (" + m_comparer.get_summary() + ") in { " ;
+				for( std::size_t i = 0; i < m_snps.size() && i < 3; ++i ) {
+					ostr << ( i > 0 ? ", " : "" ) << m_snps[i] ;
+				}
+				if( m_snps.size() > 3 ) {
+					ostr << "...(+" << m_snps.size() << " others)" ;
+				}
+				ostr << " }" ;
+				return ostr.str() ;
+			}
+
+		private:
+			VariantIdentifyingData::CompareFields const m_comparer ;
+			std::vector< VariantIdentifyingData > m_snps ;
+			std::vector< uint64_t > m_positions ;
+		} ;
+
+		std::string display_set( std::string const& what, FlatStringSet const& set ) {
+			std::string result = what + " in { " ;
+			if( set.size() <= 10 ) {
+				std::vector< std::string > values = set.get_values() ;
+				std::sort( values.begin(), values.end() ) ;
+				result += string_utils::join( values, ", " ) ;
+			} else {
+				result += "set of " + string_utils::to_string( set.size() ) ;
+			}
+			return result + " }" ;
+		}
+	}
+
+	// A disjunction of tests, optionally negated.
+	// The tests are lookups in sets of each kind, evaluated in order of increasing cost.
+	struct CommonSNPFilter::Clause: public boost::noncopyable {
+		Clause( bool negated_ ):
+			negated( negated_ )
+		{}
+
+		~Clause() {
+			for( std::size_t i = 0; i < variant_sets.size(); ++i ) {
+				delete variant_sets[i] ;
+			}
+			for( std::size_t i = 0; i < other_tests.size(); ++i ) {
+				delete other_tests[i] ;
+			}
+		}
+
+		bool operator()( VariantIdentifyingData const& data ) const {
+			return evaluate( data ) != negated ;
+		}
+
+		static bool less_by_cost( Clause const* left, Clause const* right ) {
+			return left->cost() < right->cost() ;
+		}
+
+		// Return the cost of evaluating the clause, as the cost of the most expensive kind of test in it.
+		int cost() const {
+			if( !other_tests.empty() ) {
+				return 5 ;
+			} else if( !variant_sets.empty() ) {
+				return 4 ;
+			} else if( !rsids.empty() || !snpids.empty() || !ids.empty() ) {
+				return 3 ;
+			} else if( !positions.empty() || !ranges.empty() || !position_ranges.empty() ) {
+				return 2 ;
+			}
+			return 1 ;
+		}
+
+		void add_snp( std::string const& value, int fields ) {
+			switch( fields ) {
+				case RSIDs:
+					rsids.insert( value ) ;
+					break ;
+				case SNPIDs:
+					snpids.insert( value ) ;
+					break ;
+				case RSIDs | SNPIDs:
+					ids.insert( value ) ;
+					break ;
+				case Positions:
+					positions.push_back( GenomePosition( value )) ;
+					break ;
+				default:
+					assert(0) ;
+			}
+		}
+
+		void add_range( GenomePositionRange const& range ) {
+			if( range.has_chromosome() ) {
+				ranges.add( range.start().key(), range.end().key() ) ;
+			} else {
+				position_ranges.add( range.start().position(), range.end().position() ) ;
+			}
+			range_list.push_back( range ) ;
+		}
+
+		// Sort positions and chromosomes after adding them.
+		void finalise() {
+			std::sort( positions.begin(), positions.end(), &less_by_key ) ;
+			positions.erase( std::unique( positions.begin(), positions.end(), &equal_by_key ), positions.end() ) ;
+			std::sort( chromosomes.begin(), chromosomes.end() ) ;
+			chromosomes.erase( std::unique( chromosomes.begin(), chromosomes.end() ), chromosomes.end() ) ;
+		}
+
+		std::string display() const {
+			std::vector< std::string > terms ;
+			if( !chromosomes.empty() ) {
+				std::ostringstream ostr ;
+				ostr << "chromosome in { " ;
+				for( std::size_t i = 0; i < chromosomes.size(); ++i ) {
+					ostr << ( i > 0 ? ", " : "" ) << chromosomes[i] ;
+				}
+				ostr << " }" ;
+				terms.push_back( ostr.str() ) ;
+			}
+			if( !positions.empty() ) {
+				std::ostringstream ostr ;
+				ostr << "Position in { " ;
+				if( positions.size() <= 10 ) {
+					for( std::size_t i = 0; i < positions.size(); ++i ) {
+						ostr << ( i > 0 ? ", " : "" ) << positions[i] ;
+					}
+				} else {
+					ostr << "set of " << positions.size() ;
+				}
+				ostr << " }" ;
+				terms.push_back( ostr.str() ) ;
+			}
+			if( range_list.size() <= 10 ) {
+				for( std::size_t i = 0; i < range_list.size(); ++i ) {
+					terms.push_back( "position in " + string_utils::to_string( range_list[i] )) ;
+				}
+			} else {
+				terms.push_back( "position in set of " + string_utils::to_string( range_list.size() ) + " ranges" ) ;
+			}
+			if( !rsids.empty() ) {
+				terms.push_back( display_set( "RSID", rsids )) ;
+			}
+			if( !snpids.empty() ) {
+				terms.push_back( display_set( "SNPID", snpids )) ;
+			}
+			if( !ids.empty() ) {
+				terms.push_back( display_set( "SNPID or RSID", ids )) ;
+			}
+			for( std::size_t i = 0; i < variant_sets.size(); ++i ) {
+				terms.push_back( variant_sets[i]->display() ) ;
+			}
+			for( std::size_t i = 0; i < other_tests.size(); ++i ) {
+				terms.push_back( other_tests[i]->display() ) ;
+			}
+			std::string const result = terms.empty() ? "false" : string_utils::join( terms, " OR " ) ;
+			return negated ? ( "NOT( " + result + " )" ) : result ;
+		}
+
+	public:
+		bool const negated ;
+		std::vector< Chromosome > chromosomes ;
+		std::vector< GenomePosition > positions ;
+		IntervalSet ranges ;
+		IntervalSet position_ranges ;
+		std::vector< GenomePositionRange > range_list ;
+		FlatStringSet rsids ;
+		FlatStringSet snpids ;
+		FlatStringSet ids ;
+		std::vector< VariantSet* > variant_sets ;
+		std::vector< VariantIdentifyingDataTest* > other_tests ;
+
+		// Return false if the clause certainly fails for a variant with the given position and IDs.
+		bool may_pass( VariantIdentifyingDataView const& view ) const {
+			if( !variant_sets.empty() || !other_tests.empty() ) {
+				return true ;
+			}
+			return (
+				matches_position( view.position )
+				|| matches_ids( view.primary_id, view.alternate_ids )
+			) != negated ;
+		}
+
+	private:
+		bool evaluate( VariantIdentifyingData const& data ) const {
+			if( matches_position( data.get_position() )) {
+				return true ;
+			}
+			if( !rsids.empty() || !snpids.empty() || !ids.empty() ) {
+				if( matches_ids( data.get_primary_id(), data.get_identifiers( 1 ) )) {
+					return true ;
+				}
+			}
+			for( std::size_t i = 0; i < variant_sets.size(); ++i ) {
+				if( variant_sets[i]->contains( data )) {
+					return true ;
+				}
+			}
+			for( std::size_t i = 0; i < other_tests.size(); ++i ) {
+				if( (*other_tests[i])( data )) {
+					return true ;
+				}
+			}
+			return false ;
+		}
+
+		bool matches_position( GenomePosition const& position ) const {
+			if( !chromosomes.empty() && std::binary_search( chromosomes.begin(), chromosomes.end(), position.chromosome() )) {
+				return true ;
+			}
+			if( !positions.empty() && std::binary_search( positions.begin(), positions.end(), position, &less_by_key )) {
+				return true ;
+			}
+			return ranges.contains( position.key() ) || position_ranges.contains( position.position() ) ;
+		}
+
+		bool matches_ids( VariantIdentifyingData::slice const& primary_id, std::vector< VariantIdentifyingData::slice > const& alternate_ids ) const {
+			if( rsids.contains( primary_id ) || ids.contains( primary_id )) {
+				return true ;
+			}
+			if( !snpids.empty() || !ids.empty() ) {
+				for( std::size_t i = 0; i < alternate_ids.size(); ++i ) {
+					if( snpids.contains( alternate_ids[i] ) || ids.contains( alternate_ids[i] )) {
+						return true ;
+					}
+				}
+			}
+			return false ;
+		}
+	} ;
+
 	CommonSNPFilter::CommonSNPFilter() {
 	}
 
+	CommonSNPFilter::~CommonSNPFilter() {
+		for( std::size_t i = 0; i < m_clauses.size(); ++i ) {
+			delete m_clauses[i] ;
+		}
+	}
+
 	bool CommonSNPFilter::operator()( VariantIdentifyingData const& data ) const {
-		return m_filter( data ) ;
+		for( std::size_t i = 0; i < m_evaluation_order.size(); ++i ) {
+			if( !(*m_evaluation_order[i])( data )) {
+				return false ;
+			}
+		}
+		return true ;
+	}
+
+	bool CommonSNPFilter::may_pass( VariantIdentifyingDataView const& view ) const {
+		for( std::size_t i = 0; i < m_evaluation_order.size(); ++i ) {
+			if( !m_evaluation_order[i]->may_pass( view )) {
+				return false ;
+			}
+		}
+		return true ;
 	}
 	
-	std::string CommonSNPFilter::display() const { return m_filter.display() ; }
-	
+	std::string CommonSNPFilter::display() const {
+		if( m_clauses.empty() ) {
+			return "true" ;
+		}
+		std::vector< std::string > terms ;
+		for( std::size_t i = 0; i < m_clauses.size(); ++i ) {
+			terms.push_back( m_clauses[i]->display() ) ;
+		}
+		return string_utils::join( terms, " AND " ) ;
+	}
+
+	CommonSNPFilter::Clause& CommonSNPFilter::get_clause( std::string const& name, bool negated ) {
+		std::string const key = ( negated ? "exclude " : "include " ) + name ;
+		std::map< std::string, Clause* >::iterator where = m_named_clauses.find( key ) ;
+		if( where == m_named_clauses.end() ) {
+			where = m_named_clauses.insert( std::make_pair( key, &add_clause( negated ))).first ;
+		}
+		return *where->second ;
+	}
+
+	CommonSNPFilter::Clause& CommonSNPFilter::add_clause( bool negated ) {
+		m_clauses.push_back( new Clause( negated )) ;
+		return *m_clauses.back() ;
+	}
+
+	void CommonSNPFilter::update_evaluation_order() {
+		m_evaluation_order.assign( m_clauses.begin(), m_clauses.end() ) ;
+		std::stable_sort( m_evaluation_order.begin(), m_evaluation_order.end(), &Clause::less_by_cost ) ;
+	}
+
+	void CommonSNPFilter::add_snps_in_file( Clause& clause, std::string const& filename, int fields ) {
+		// Strings go straight into the clause rather than through an intermediate std::set.
+		std::auto_ptr< std::istream > file = open_text_file_for_input( filename, "no_compression" ) ;
+		std::string value ;
+		while( (*file) >> value ) {
+			clause.add_snp( value, fields ) ;
+		}
+		clause.finalise() ;
+		update_evaluation_order() ;
+	}
+
+	void CommonSNPFilter::add_snps_in_set( Clause& clause, std::set< std::string > const& set, int fields ) {
+		for( std::set< std::string >::const_iterator i = set.begin(); i != set.end(); ++i ) {
+			clause.add_snp( *i, fields ) ;
+		}
+		clause.finalise() ;
+		update_evaluation_order() ;
+	}
+
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_in_file( std::string const& filename, int fields ) {
-		exclude_snps_in_set( read_strings_from_file( filename ), fields ) ;
+		add_snps_in_file( get_clause( "id", true ), filename, fields ) ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::include_snps_in_file( std::string const& filename, int fields ) {
-		include_snps_in_set( read_strings_from_file( filename ), fields ) ;
+		add_snps_in_file( get_clause( "id", false ), filename, fields ) ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_not_in_file( std::string const& filename, int fields ) {
-		return exclude_snps_not_in_set( read_strings_from_file( filename ), fields ) ;
+		add_snps_in_file( add_clause( false ), filename, fields ) ;
+		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_in_set( std::set< std::string > const& set, int fields ) {
-		VariantIdentifyingDataTest::UniquePtr test = construct_snp_inclusion_test( set, fields ) ;
-		test.reset( new VariantIdentifyingDataTestNegation( test )) ;
-		m_filter.add_subtest( test ) ;
+		add_snps_in_set( get_clause( "id", true ), set, fields ) ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::include_snps_in_set( std::set< std::string > const& set, int fields ) {
-		VariantIdentifyingDataTest::UniquePtr test = construct_snp_inclusion_test( set, fields ) ;
-		add_inclusion_filter_if_necessary( "id" ) ;
-		m_inclusion_filters[ "id" ]->add_subtest( test ) ;
+		add_snps_in_set( get_clause( "id", false ), set, fields ) ;
 		return *this ;
 	}
 
-	CommonSNPFilter& CommonSNPFilter::exclude_snps( std::vector< VariantIdentifyingData > const& snps, VariantIdentifyingData::CompareFields const& comparer ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPInSetTest( std::set< VariantIdentifyingData >( snps.begin(), snps.end() ), comparer ) ) ;
-		test.reset( new VariantIdentifyingDataTestNegation( test )) ;
-		m_filter.add_subtest( test ) ;
+	CommonSNPFilter& CommonSNPFilter::exclude_snps_not_in_set( std::set< std::string > const& set, int fields ) {
+		add_snps_in_set( add_clause( false ), set, fields ) ;
 		return *this ;
 	}
 
-	CommonSNPFilter& CommonSNPFilter::include_snps( std::vector< VariantIdentifyingData > const& snps, VariantIdentifyingData::CompareFields const& comparer ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPInSetTest( std::set< VariantIdentifyingData >( snps.begin(), snps.end() ), comparer ) ) ;
-		add_inclusion_filter_if_necessary( "snps" ) ;
-		m_inclusion_filters[ "snps" ]->add_subtest( test ) ;
+	CommonSNPFilter& CommonSNPFilter::exclude_snps( std::vector< VariantIdentifyingData > const& snps, VariantIdentifyingData::CompareFields const& comparer ) {
+		get_clause( "snps", true ).variant_sets.push_back( new VariantSet( snps, comparer )) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
-	void CommonSNPFilter::add_inclusion_filter_if_necessary( std::string const& name ) {
-		if( m_inclusion_filters.find( name ) == m_inclusion_filters.end() ) {
-			VariantIdentifyingDataTestDisjunction::UniquePtr test( new VariantIdentifyingDataTestDisjunction() ) ;
-			m_inclusion_filters[ name ] = test.get() ;
-			m_filter.add_subtest( VariantIdentifyingDataTest::UniquePtr( test.release() )) ;
-		}
-	}
-
-	CommonSNPFilter& CommonSNPFilter::exclude_snps_not_in_set( std::set< std::string > const& set, int fields ) {
-		VariantIdentifyingDataTest::UniquePtr test = construct_snp_inclusion_test( set, fields ) ;
-		m_filter.add_subtest( test ) ;
+	CommonSNPFilter& CommonSNPFilter::include_snps( std::vector< VariantIdentifyingData > const& snps, VariantIdentifyingData::CompareFields const& comparer ) {
+		get_clause( "snps", false ).variant_sets.push_back( new VariantSet( snps, comparer )) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
-	std::set< std::string > CommonSNPFilter::read_strings_from_file( std::string const& filename ) {
-		std::set< std::string > result ;
-		std::auto_ptr< std::istream > file = open_text_file_for_input( filename, "no_compression" ) ;
-		result.insert( std::istream_iterator< std::string >( *file ), std::istream_iterator< std::string >() ) ;
-		return result ;
-	}
-	
-	VariantIdentifyingDataTest::UniquePtr CommonSNPFilter::construct_snp_inclusion_test( std::set< std::string > const& set, int fields ) {
-		VariantIdentifyingDataTest::UniquePtr test ;
-		std::set< GenomePosition > position_set ;
-		std::set< std::string >::const_iterator i = set.begin() ;
-		std::set< std::string >::const_iterator const end_i = set.end() ;
-		
-		switch( fields ) {
-			case RSIDs:
-				test.reset( new RSIDInListTest( set ) ) ;
-				break ;
-			case SNPIDs:
-				test.reset( new SNPIDInListTest( set ) ) ;
-				break ;
-			case RSIDs | SNPIDs:
-				test.reset( new SNPIDFieldsInListTest( set ) ) ;
-				break ;
-			case Positions:
-				for( ; i != end_i; ++i ) {
-					position_set.insert( GenomePosition( *i ) ) ;
-				}
-				test.reset( new PositionInListTest( position_set )) ;
-				break ;
-			default:
-				assert(0) ;
-		}
-		return test ;
-	}
-
 	CommonSNPFilter& CommonSNPFilter::exclude_chromosomes_in_set( std::set< genfile::Chromosome > const& set ) {
-		VariantIdentifyingDataTest::UniquePtr test( new ChromosomeInSetTest( set ) ) ;
-		test.reset( new VariantIdentifyingDataTestNegation( test )) ;
-		m_filter.add_subtest( test ) ;
+		Clause& clause = get_clause( "chromosome", true ) ;
+		clause.chromosomes.insert( clause.chromosomes.end(), set.begin(), set.end() ) ;
+		clause.finalise() ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::include_chromosomes_in_set( std::set< genfile::Chromosome > const& set ) {
-		VariantIdentifyingDataTest::UniquePtr test( new ChromosomeInSetTest( set ) ) ;
-		add_inclusion_filter_if_necessary( "chromosome" ) ;
-		m_inclusion_filters[ "chromosome" ]->add_subtest( test ) ;
+		Clause& clause = get_clause( "chromosome", false ) ;
+		clause.chromosomes.insert( clause.chromosomes.end(), set.begin(), set.end() ) ;
+		clause.finalise() ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 	
 	CommonSNPFilter& CommonSNPFilter::exclude_chromosomes_not_in_set( std::set< genfile::Chromosome > const& set ) {
-		VariantIdentifyingDataTest::UniquePtr test( new ChromosomeInSetTest( set ) ) ;
-		m_filter.add_subtest( test ) ;
+		Clause& clause = add_clause( false ) ;
+		clause.chromosomes.assign( set.begin(), set.end() ) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_matching( std::string const& expression ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPIDMatchesTest( expression ) ) ;
-		test.reset( new VariantIdentifyingDataTestNegation( test )) ;
-		m_filter.add_subtest( test ) ;
+		get_clause( "match", true ).other_tests.push_back( new SNPIDMatchesTest( expression )) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::include_snps_matching( std::string const& expression ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPIDMatchesTest( expression ) ) ;
-		add_inclusion_filter_if_necessary( "match" ) ;
-		m_inclusion_filters[ "match" ]->add_subtest( test ) ;
+		get_clause( "match", false ).other_tests.push_back( new SNPIDMatchesTest( expression )) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_not_matching( std::string const& expression ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPIDMatchesTest( expression ) ) ;
-		m_filter.add_subtest( test ) ;
+		add_clause( false ).other_tests.push_back( new SNPIDMatchesTest( expression )) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_in_range( genfile::GenomePositionRange const& range ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPPositionInRangeTest( range ) ) ;
-		test.reset( new VariantIdentifyingDataTestNegation( test )) ;
-		m_filter.add_subtest( test ) ;
+		get_clause( "range", true ).add_range( range ) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::include_snps_in_range( genfile::GenomePositionRange const& range ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPPositionInRangeTest( range ) ) ;
-		add_inclusion_filter_if_necessary( "range" ) ;
-		m_inclusion_filters[ "range" ]->add_subtest( test ) ;
+		get_clause( "range", false ).add_range( range ) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
 
 	CommonSNPFilter& CommonSNPFilter::exclude_snps_not_in_range( genfile::GenomePositionRange const& range ) {
-		VariantIdentifyingDataTest::UniquePtr test( new SNPPositionInRangeTest( range ) ) ;
-		m_filter.add_subtest( test ) ;
+		add_clause( false ).add_range( range ) ;
+		update_evaluation_order() ;
 		return *this ;
 	}
-
 }
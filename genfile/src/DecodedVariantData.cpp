@@ -0,0 +1,85 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <limits>
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/vcf/get_set_eigen.hpp"
+#include "genfile/DecodedVariantData.hpp"
+
+namespace genfile {
+	HardCalls::HardCalls():
+		m_size( 0 )
+	{}
+
+	void HardCalls::reset( std::size_t number_of_samples ) {
+		m_size = number_of_samples ;
+		// All bits set means all calls missing.
+		m_data.assign( ( number_of_samples + 3 ) / 4, 0xFF ) ;
+	}
+
+	DecodedVariantData::DecodedVariantData( VariantDataReader& reader ):
+		m_reader( reader ),
+		m_have_probabilities( false ),
+		m_have_dosages( false )
+	{}
+
+	Eigen::MatrixXd const& DecodedVariantData::genotype_probabilities() {
+		boost::mutex::scoped_lock lock( m_mutex ) ;
+		return get_probabilities() ;
+	}
+
+	Eigen::VectorXf const& DecodedVariantData::dosages() {
+		boost::mutex::scoped_lock lock( m_mutex ) ;
+		if( !m_have_dosages ) {
+			Eigen::MatrixXd const& probabilities = get_probabilities() ;
+			m_dosages.resize( probabilities.rows() ) ;
+			for( int i = 0; i < probabilities.rows(); ++i ) {
+				if( probabilities.row(i).sum() == 0 ) {
+					m_dosages(i) = std::numeric_limits< float >::quiet_NaN() ;
+				} else {
+					m_dosages(i) = probabilities(i,1) + 2.0 * probabilities(i,2) ;
+				}
+			}
+			m_have_dosages = true ;
+		}
+		return m_dosages ;
+	}
+
+	HardCalls const& DecodedVariantData::hard_calls( double threshhold ) {
+		boost::mutex::scoped_lock lock( m_mutex ) ;
+		std::map< double, HardCalls >::iterator where = m_hard_calls.find( threshhold ) ;
+		if( where == m_hard_calls.end() ) {
+			Eigen::MatrixXd const& probabilities = get_probabilities() ;
+			HardCalls& calls = m_hard_calls[ threshhold ] ;
+			calls.reset( probabilities.rows() ) ;
+			for( int i = 0; i < probabilities.rows(); ++i ) {
+				// Same precedence as vcf::get_threshholded_calls().
+				if( probabilities(i,0) > threshhold ) {
+					calls.set( i, HardCalls::eAA ) ;
+				} else if( probabilities(i,1) > threshhold ) {
+					calls.set( i, HardCalls::eAB ) ;
+				} else if( probabilities(i,2) > threshhold ) {
+					calls.set( i, HardCalls::eBB ) ;
+				}
+			}
+			return calls ;
+		}
+		return where->second ;
+	}
+
+	Eigen::MatrixXd const& DecodedVariantData::get_probabilities() {
+		if( !m_have_probabilities ) {
+			m_probabilities.setZero( m_reader.get_number_of_samples(), 3 ) ;
+			vcf::GenotypeSetter< Eigen::MatrixBase< Eigen::MatrixXd > > setter( m_probabilities ) ;
+			m_reader.get( ":genotypes:", setter ) ;
+			m_have_probabilities = true ;
+		}
+		return m_probabilities ;
+	}
+}
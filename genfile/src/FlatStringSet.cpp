@@ -0,0 +1,110 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include <stdint.h>
+#include "genfile/string_utils/slice.hpp"
+#include "genfile/FlatStringSet.hpp"
+
+namespace genfile {
+	namespace {
+		uint64_t const offsetMask = ( uint64_t( 1 ) << 40 ) - 1 ;
+		uint64_t const tagMask = ~offsetMask ;
+	}
+
+	FlatStringSet::FlatStringSet():
+		m_slots( 16, 0 ),
+		m_size( 0 )
+	{}
+
+	uint64_t FlatStringSet::hash( char const* begin, char const* end ) {
+		// 64-bit FNV-1a.
+		uint64_t result = 14695981039346656037ULL ;
+		for( ; begin != end; ++begin ) {
+			result ^= uint64_t( static_cast< unsigned char >( *begin )) ;
+			result *= 1099511628211ULL ;
+		}
+		return result ;
+	}
+
+	bool FlatStringSet::equals( uint64_t slot, char const* begin, char const* end ) const {
+		char const* stored = &m_storage[0] + ( slot & offsetMask ) - 1 ;
+		uint32_t size ;
+		std::memcpy( &size, stored, sizeof( uint32_t )) ;
+		return size == uint32_t( end - begin ) && std::memcmp( stored + sizeof( uint32_t ), begin, size ) == 0 ;
+	}
+
+	std::size_t FlatStringSet::find_slot( uint64_t h, char const* begin, char const* end ) const {
+		std::size_t const mask = m_slots.size() - 1 ;
+		uint64_t const tag = h & tagMask ;
+		std::size_t i = std::size_t( h ) & mask ;
+		// Linear probing; the table is never more than 3/4 full so this terminates.
+		while( m_slots[i] != 0 && !(( m_slots[i] & tagMask ) == tag && equals( m_slots[i], begin, end ))) {
+			i = ( i + 1 ) & mask ;
+		}
+		return i ;
+	}
+
+	bool FlatStringSet::insert( slice const& value ) {
+		uint64_t const h = hash( value.begin(), value.end() ) ;
+		std::size_t slot = find_slot( h, value.begin(), value.end() ) ;
+		if( m_slots[ slot ] != 0 ) {
+			return false ;
+		}
+		uint64_t const offset = m_storage.size() ;
+		assert( offset + 1 <= offsetMask ) ;
+		uint32_t const size = value.size() ;
+		m_storage.resize( m_storage.size() + sizeof( uint32_t ) + size ) ;
+		std::memcpy( &m_storage[ offset ], &size, sizeof( uint32_t )) ;
+		std::copy( value.begin(), value.end(), m_storage.begin() + offset + sizeof( uint32_t )) ;
+		m_slots[ slot ] = ( h & tagMask ) | ( offset + 1 ) ;
+		++m_size ;
+		if( 4 * m_size > 3 * m_slots.size() ) {
+			rehash( 2 * m_slots.size() ) ;
+		}
+		return true ;
+	}
+
+	bool FlatStringSet::contains( slice const& value ) const {
+		if( m_size == 0 ) {
+			return false ;
+		}
+		return m_slots[ find_slot( hash( value.begin(), value.end() ), value.begin(), value.end() ) ] != 0 ;
+	}
+
+	void FlatStringSet::rehash( std::size_t number_of_slots ) {
+		std::vector< uint64_t > slots( number_of_slots, 0 ) ;
+		std::size_t const mask = number_of_slots - 1 ;
+		for( std::size_t i = 0; i < m_slots.size(); ++i ) {
+			if( m_slots[i] != 0 ) {
+				char const* stored = &m_storage[0] + ( m_slots[i] & offsetMask ) - 1 ;
+				uint32_t size ;
+				std::memcpy( &size, stored, sizeof( uint32_t )) ;
+				std::size_t j = std::size_t( hash( stored + sizeof( uint32_t ), stored + sizeof( uint32_t ) + size )) & mask ;
+				while( slots[j] != 0 ) {
+					j = ( j + 1 ) & mask ;
+				}
+				slots[j] = m_slots[i] ;
+			}
+		}
+		m_slots.swap( slots ) ;
+	}
+
+	std::vector< std::string > FlatStringSet::get_values( std::size_t max_number ) const {
+		std::vector< std::string > result ;
+		for( std::size_t offset = 0; offset < m_storage.size() && result.size() < max_number; ) {
+			uint32_t size ;
+			std::memcpy( &size, &m_storage[ offset ], sizeof( uint32_t )) ;
+			offset += sizeof( uint32_t ) ;
+			result.push_back( std::string( m_storage.begin() + offset, m_storage.begin() + offset + size )) ;
+			offset += size ;
+		}
+		return result ;
+	}
+}
@@ -27,30 +27,6 @@ namespace genfile {
 		}
 	}
 	
-	bool operator<( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data < right.m_data ;
-	}
-
-	bool operator>( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data > right.m_data ;
-	}
-
-	bool operator<=( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data <= right.m_data ;
-	}
-
-	bool operator>=( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data >= right.m_data ;
-	}
-
-	bool operator==( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data == right.m_data ;
-	}
-
-	bool operator!=( GenomePosition const& left, GenomePosition const& right ) {
-		return left.m_data != right.m_data ;
-	}
-
 	std::ostream& operator<<( std::ostream& oStream, GenomePosition const& pos ) {
 		if( pos.chromosome() != Chromosome() ) {
 			oStream << pos.chromosome() << ":" ;
@@ -104,7 +104,9 @@ namespace genfile {
 			return m_start.position() <= position.position() && position.position() <= m_end.position() ;
 		}
 		else {
-			return ( m_start <= position ) && ( position <= m_end ) ;
+			// Start and end are on the same chromosome, so this holds exactly when position is on
+			// that chromosome and between them.
+			return ( m_start.key() <= position.key() ) && ( position.key() <= m_end.key() ) ;
 		}
 	}
 	
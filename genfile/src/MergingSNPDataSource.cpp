@@ -5,8 +5,10 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include <vector>
+#include <algorithm>
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/SNPDataSource.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
 #include "genfile/MergingSNPDataSource.hpp"
 #include "genfile/string_utils.hpp"
 #include "genfile/Error.hpp"
@@ -38,7 +40,13 @@ namespace genfile {
 	}
 	
 	MergingSNPDataSource::MergingSNPDataSource( VariantIdentifyingData::CompareFields const& compare_fields ):
-		m_current_snps( compare_fields )
+		m_max_prefetch_queue_bytes( 0 ),
+		m_compare_fields( compare_fields ),
+		m_compare_by_position_first(
+			compare_fields.get_compared_fields().size() > 0
+			&& compare_fields.get_compared_fields()[0] == VariantIdentifyingData::CompareFields::ePosition
+		),
+		m_sequence( 0 )
 	{}
 
 	MergingSNPDataSource::~MergingSNPDataSource() {
@@ -63,9 +71,13 @@ namespace genfile {
 				+ ")"
 				) ;
 		}
+		if( m_max_prefetch_queue_bytes > 0 ) {
+			source.reset( PrefetchingSNPDataSource::create( source, m_max_prefetch_queue_bytes, m_prefetch_specs ).release() ) ;
+		}
 		m_sources.push_back( 0 ) ;
 		m_sources.back() = source.release() ;
 		m_merge_id_prefixes.push_back( id_prefix ) ;
+		m_top_snps.push_back( VariantIdentifyingData() ) ;
 
 		// Get metadata.
 		// Currently we just take the metadata from the first source.
@@ -77,24 +89,58 @@ namespace genfile {
 		get_top_snp_in_source( m_sources.size() - 1 ) ;
 	}
 
+	void MergingSNPDataSource::prefetch_sources( std::size_t max_queue_bytes, std::vector< std::string > const& specs ) {
+		if( max_queue_bytes == 0 ) {
+			throw BadArgumentError(
+				"genfile::MergingSNPDataSource::prefetch_sources()",
+				"max_queue_bytes=0",
+				"Queue size must be positive."
+			) ;
+		}
+		m_max_prefetch_queue_bytes = max_queue_bytes ;
+		m_prefetch_specs = specs ;
+	}
+
 	SNPDataSource::Metadata MergingSNPDataSource::get_metadata() const {
 		return m_metadata ;
 	}
 
 	void MergingSNPDataSource::get_top_snp_in_source( std::size_t source_i ) {
 		assert( source_i < m_sources.size() ) ;
-		VariantIdentifyingData snp ;
+		VariantIdentifyingData& snp = m_top_snps[ source_i ] ;
 		if( m_sources[ source_i ]->get_snp_identifying_data( &snp ) ) {
-			m_current_snps.insert(
-				std::make_pair( snp, source_i )
-			) ;
+			HeapEntry entry ;
+			entry.position_key = snp.get_position().key() ;
+			entry.source = source_i ;
+			entry.sequence = m_sequence++ ;
+			m_heap.push_back( entry ) ;
+			std::push_heap( m_heap.begin(), m_heap.end(), HeapOrder( *this )) ;
+		}
+	}
+
+	bool MergingSNPDataSource::comes_before( HeapEntry const& left, HeapEntry const& right ) const {
+		VariantIdentifyingData const& left_snp = m_top_snps[ left.source ] ;
+		VariantIdentifyingData const& right_snp = m_top_snps[ right.source ] ;
+		if(
+			m_compare_by_position_first
+			&& left.position_key != right.position_key
+			&& left_snp.get_position().chromosome().compares_by_code( right_snp.get_position().chromosome() )
+		) {
+			return left.position_key < right.position_key ;
+		}
+		if( m_compare_fields( left_snp, right_snp )) {
+			return true ;
+		} else if( m_compare_fields( right_snp, left_snp )) {
+			return false ;
 		}
+		return left.sequence < right.sequence ;
 	}
 
 	void MergingSNPDataSource::discard_top_snp_and_get_next_candidate() {
-		assert( m_current_snps.size() > 0 ) ;
-		std::size_t source_i = m_current_snps.begin()->second ;
-		m_current_snps.erase( m_current_snps.begin() ) ;
+		assert( m_heap.size() > 0 ) ;
+		std::size_t source_i = m_heap.front().source ;
+		std::pop_heap( m_heap.begin(), m_heap.end(), HeapOrder( *this )) ;
+		m_heap.pop_back() ;
 		get_top_snp_in_source( source_i ) ;
 	}
 
@@ -107,16 +153,16 @@ namespace genfile {
 	}
 
 	void DropDuplicatesStrategyMergingSNPDataSource::discard_top_snp_and_get_next() {
-		assert( current_snps().size() > 0 ) ;
+		assert( have_top_snp() ) ;
 		
-		genfile::VariantIdentifyingData const current_snp = current_snps().begin()->first ;
+		genfile::GenomePosition const current_position = top_snp().get_position() ;
 		discard_top_snp_and_get_next_candidate() ;
 
 		while(
-			current_snps().size() > 0
-			&& current_snps().begin()->first.get_position() == current_snp.get_position()
+			have_top_snp()
+			&& top_snp().get_position() == current_position
 		) {
-			get_source( current_snps().begin()->second ).ignore_snp_probability_data() ;
+			top_source().ignore_snp_probability_data() ;
 			discard_top_snp_and_get_next_candidate() ;
 		}
 	}
@@ -126,7 +172,7 @@ namespace genfile {
 	{}
 		
 	MergingSNPDataSource::operator bool() const {
-		return !m_current_snps.empty() ;
+		return !m_heap.empty() ;
 	}
 
 	// Return the number of samples represented in the snps in this source.
@@ -176,10 +222,9 @@ namespace genfile {
 	void MergingSNPDataSource::get_snp_identifying_data_impl( 
 		VariantIdentifyingData* result
 	) {
-		if( m_current_snps.size() > 0 ) {
-			//std::cerr << m_current_snps.begin()->first << "\n" ;
-			VariantIdentifyingData const& snp = m_current_snps.begin()->first ;
-			std::size_t source_index = m_current_snps.begin()->second ;
+		if( m_heap.size() > 0 ) {
+			std::size_t source_index = m_heap.front().source ;
+			VariantIdentifyingData const& snp = m_top_snps[ source_index ] ;
 			*result = VariantIdentifyingData(
 				snp.get_primary_id(),
 				snp.get_position(),
@@ -195,22 +240,22 @@ namespace genfile {
 
 	VariantDataReader::UniquePtr MergingSNPDataSource::read_variant_data_impl() {
 		VariantDataReader::UniquePtr result ;
-		assert( m_current_snps.size() > 0 ) ;
-		std::size_t source_i = m_current_snps.begin()->second ;
+		assert( m_heap.size() > 0 ) ;
+		std::size_t source_i = m_heap.front().source ;
 		result = m_sources[ source_i ]->read_variant_data() ;
 		discard_top_snp_and_get_next() ;
 		return result ;
 	}
 
 	void MergingSNPDataSource::ignore_snp_probability_data_impl() {
-		assert( m_current_snps.size() > 0 ) ;
-		std::size_t source_i = m_current_snps.begin()->second ;
+		assert( m_heap.size() > 0 ) ;
+		std::size_t source_i = m_heap.front().source ;
 		m_sources[ source_i ]->ignore_snp_probability_data() ;
 		discard_top_snp_and_get_next() ;
 	}
 
 	void MergingSNPDataSource::reset_to_start_impl() {
-		m_current_snps.clear() ;
+		m_heap.clear() ;
 		for( std::size_t i = 0; i < m_sources.size(); ++i ) {
 			m_sources[ i ]->reset_to_start() ;
 			get_top_snp_in_source( i ) ;
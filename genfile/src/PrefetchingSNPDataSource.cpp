@@ -0,0 +1,206 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <exception>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/BufferedVariantDataReader.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
+#include "genfile/Error.hpp"
+
+namespace genfile {
+	PrefetchingSNPDataSource::UniquePtr PrefetchingSNPDataSource::create(
+		SNPDataSource::UniquePtr source,
+		std::size_t max_queue_bytes,
+		std::vector< std::string > const& specs
+	) {
+		return UniquePtr( new PrefetchingSNPDataSource( source, max_queue_bytes, specs )) ;
+	}
+
+	PrefetchingSNPDataSource::PrefetchingSNPDataSource(
+		SNPDataSource::UniquePtr source,
+		std::size_t max_queue_bytes,
+		std::vector< std::string > const& specs
+	):
+		m_source( source ),
+		m_max_queue_bytes( max_queue_bytes ),
+		m_specs( specs ),
+		m_queue_bytes( 0 ),
+		m_finished( false ),
+		m_stop( false ),
+		m_have_variant( true )
+	{
+		if( max_queue_bytes == 0 ) {
+			throw BadArgumentError(
+				"genfile::PrefetchingSNPDataSource::PrefetchingSNPDataSource()",
+				"max_queue_bytes=0",
+				"Queue size must be positive."
+			) ;
+		}
+	}
+
+	PrefetchingSNPDataSource::~PrefetchingSNPDataSource() {
+		stop_prefetching() ;
+	}
+
+	void PrefetchingSNPDataSource::start_prefetching() {
+		if( !m_thread.get() ) {
+			m_finished = false ;
+			m_stop = false ;
+			m_error = std::exception_ptr() ;
+			m_thread.reset( new boost::thread( boost::bind( &PrefetchingSNPDataSource::prefetch, this ))) ;
+		}
+	}
+
+	bool PrefetchingSNPDataSource::is_prefetching() const {
+		return m_thread.get() ;
+	}
+
+	void PrefetchingSNPDataSource::stop_prefetching() {
+		if( m_thread.get() ) {
+			{
+				ScopedLock lock( m_mutex ) ;
+				m_stop = true ;
+				m_have_capacity_condition.notify_all() ;
+			}
+			m_thread->join() ;
+			m_thread.reset() ;
+			m_queue.clear() ;
+			m_queue_bytes = 0 ;
+		}
+	}
+
+	// Runs in the background thread.
+	void PrefetchingSNPDataSource::prefetch() {
+		try {
+			VariantIdentifyingData variant ;
+			while( m_source->get_snp_identifying_data( &variant ) ) {
+				VariantDataReader::UniquePtr reader = m_source->read_variant_data() ;
+				BufferedVariantDataReader::UniquePtr data = BufferedVariantDataReader::create( *reader, m_specs ) ;
+				reader.reset() ;
+				std::size_t const size = sizeof( Entry ) + variant.estimate_bytes_used() + data->get_memory_usage() ;
+				std::auto_ptr< Entry > entry( new Entry( variant, VariantDataReader::UniquePtr( data.release() ), size )) ;
+				ScopedLock lock( m_mutex ) ;
+				while( !m_queue.empty() && m_queue_bytes + size > m_max_queue_bytes && !m_stop ) {
+					m_have_capacity_condition.wait( lock ) ;
+				}
+				if( m_stop ) {
+					return ;
+				}
+				m_queue.push_back( entry.release() ) ;
+				m_queue_bytes += size ;
+				m_have_data_condition.notify_one() ;
+			}
+		}
+		catch( ... ) {
+			ScopedLock lock( m_mutex ) ;
+			m_error = std::current_exception() ;
+		}
+		ScopedLock lock( m_mutex ) ;
+		m_finished = true ;
+		m_have_data_condition.notify_all() ;
+	}
+
+	bool PrefetchingSNPDataSource::wait_for_data() {
+		start_prefetching() ;
+		ScopedLock lock( m_mutex ) ;
+		while( m_queue.empty() && !m_finished ) {
+			m_have_data_condition.wait( lock ) ;
+		}
+		if( m_queue.empty() && m_error ) {
+			std::rethrow_exception( m_error ) ;
+		}
+		return !m_queue.empty() ;
+	}
+
+	PrefetchingSNPDataSource::operator bool() const {
+		return m_have_variant ;
+	}
+
+	SNPDataSource::Metadata PrefetchingSNPDataSource::get_metadata() const {
+		return m_source->get_metadata() ;
+	}
+
+	unsigned int PrefetchingSNPDataSource::number_of_samples() const {
+		return m_source->number_of_samples() ;
+	}
+
+	bool PrefetchingSNPDataSource::has_sample_ids() const {
+		return m_source->has_sample_ids() ;
+	}
+
+	void PrefetchingSNPDataSource::get_sample_ids( GetSampleIds getter ) const {
+		m_source->get_sample_ids( getter ) ;
+	}
+
+	SNPDataSource::OptionalSnpCount PrefetchingSNPDataSource::total_number_of_snps() const {
+		return m_source->total_number_of_snps() ;
+	}
+
+	std::string PrefetchingSNPDataSource::get_source_spec() const {
+		return m_source->get_source_spec() ;
+	}
+
+	SNPDataSource const& PrefetchingSNPDataSource::get_parent_source() const {
+		return *m_source ;
+	}
+
+	SNPDataSource const& PrefetchingSNPDataSource::get_base_source() const {
+		return m_source->get_base_source() ;
+	}
+
+	std::string PrefetchingSNPDataSource::get_summary( std::string const& prefix, std::size_t column_width ) const {
+		return m_source->get_summary( prefix, column_width ) ;
+	}
+
+	void PrefetchingSNPDataSource::get_snp_identifying_data_impl( VariantIdentifyingData* variant ) {
+		m_have_variant = wait_for_data() ;
+		if( m_have_variant ) {
+			ScopedLock lock( m_mutex ) ;
+			*variant = m_queue.front().variant ;
+		}
+	}
+
+	VariantDataReader::UniquePtr PrefetchingSNPDataSource::read_variant_data_impl() {
+		ScopedLock lock( m_mutex ) ;
+		assert( !m_queue.empty() ) ;
+		VariantDataReader::UniquePtr result = m_queue.front().data ;
+		pop_front() ;
+		return result ;
+	}
+
+	void PrefetchingSNPDataSource::ignore_snp_probability_data_impl() {
+		ScopedLock lock( m_mutex ) ;
+		assert( !m_queue.empty() ) ;
+		pop_front() ;
+	}
+
+	// Called with the mutex held.
+	void PrefetchingSNPDataSource::pop_front() {
+		m_queue_bytes -= m_queue.front().size ;
+		m_queue.pop_front() ;
+		m_have_capacity_condition.notify_one() ;
+	}
+
+	void PrefetchingSNPDataSource::reset_to_start_impl() {
+		stop_prefetching() ;
+		m_source->reset_to_start() ;
+		m_have_variant = true ;
+	}
+
+	bool PrefetchingSNPDataSource::set_sample_selection_impl( SampleSelection const& selection ) {
+		if( m_thread.get() ) {
+			return false ;
+		}
+		return m_source->set_sample_selection( selection ) ;
+	}
+}
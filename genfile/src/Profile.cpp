@@ -0,0 +1,198 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include "genfile/Profile.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/Error.hpp"
+
+namespace genfile {
+	namespace {
+		// The innermost running timer on this thread.
+		thread_local Profile::ScopedTimer* current_timer = 0 ;
+
+		// std::atomic< double > has no fetch_add() before C++20.
+		void add_to( std::atomic< double >* value, double const amount ) {
+			double current = value->load() ;
+			while( !value->compare_exchange_weak( current, current + amount )) {}
+		}
+
+		double seconds_since( Profile::Clock::time_point const& start ) {
+			return std::chrono::duration< double >( Profile::Clock::now() - start ).count() ;
+		}
+
+		std::string json_escape( std::string const& value ) {
+			std::string result ;
+			result.reserve( value.size() ) ;
+			for( std::size_t i = 0; i < value.size(); ++i ) {
+				char const c = value[i] ;
+				if( c == '"' || c == '\\' ) {
+					result += '\\' ;
+					result += c ;
+				} else if( static_cast< unsigned char >( c ) < 0x20 ) {
+					char buffer[8] ;
+					std::snprintf( buffer, 8, "\\u%04x", int( c ) ) ;
+					result += buffer ;
+				} else {
+					result += c ;
+				}
+			}
+			return result ;
+		}
+	}
+
+	Profile::UniquePtr Profile::create() {
+		return UniquePtr( new Profile() ) ;
+	}
+
+	Profile::Histogram::Histogram() {
+		for( std::size_t b = 0; b < eNumberOfBuckets; ++b ) {
+			m_counts[b] = 0 ;
+		}
+	}
+
+	void Profile::Histogram::add( double seconds ) {
+		double const microseconds = seconds * 1000000.0 ;
+		std::size_t bucket = 0 ;
+		if( microseconds >= 1.0 ) {
+			int exponent = 0 ;
+			std::frexp( microseconds, &exponent ) ;
+			bucket = std::min< std::size_t >( exponent, eNumberOfBuckets - 1 ) ;
+		}
+		++m_counts[ bucket ] ;
+	}
+
+	double Profile::Histogram::upper_bound( std::size_t bucket ) {
+		return std::ldexp( 1.0, int( bucket ) ) ;
+	}
+
+	Profile::Timing::Timing( std::string const& operation_ ):
+		operation( operation_ ),
+		calls( 0 ),
+		total_seconds( 0 ),
+		self_seconds( 0 )
+	{}
+
+	Profile::Stage::Stage( std::size_t id_, std::string const& name_, std::string const& type_ ):
+		id( id_ ),
+		name( name_ ),
+		type( type_ ),
+		variants_read( 0 ),
+		variants_ignored( 0 ),
+		bytes_read( 0 ),
+		bytes_decompressed( 0 ),
+		m_input( 0 )
+	{}
+
+	Profile::Timing& Profile::Stage::timing( std::string const& operation ) {
+		for( std::size_t i = 0; i < m_timings.size(); ++i ) {
+			if( m_timings[i].operation == operation ) {
+				return m_timings[i] ;
+			}
+		}
+		m_timings.push_back( new Timing( operation )) ;
+		return m_timings.back() ;
+	}
+
+	Profile::ScopedTimer::ScopedTimer( Timing& timing ):
+		m_timing( timing ),
+		m_parent( current_timer ),
+		m_start( Clock::now() ),
+		m_child_seconds( 0 )
+	{
+		current_timer = this ;
+	}
+
+	Profile::ScopedTimer::~ScopedTimer() {
+		double const elapsed = seconds_since( m_start ) ;
+		++m_timing.calls ;
+		add_to( &m_timing.total_seconds, elapsed ) ;
+		add_to( &m_timing.self_seconds, std::max( elapsed - m_child_seconds, 0.0 ) ) ;
+		m_timing.histogram.add( elapsed ) ;
+		if( m_parent ) {
+			m_parent->m_child_seconds += elapsed ;
+		}
+		current_timer = m_parent ;
+	}
+
+	Profile::Profile():
+		m_start( Clock::now() )
+	{}
+
+	Profile::Stage& Profile::add_stage( std::string const& name, std::string const& type ) {
+		m_stages.push_back( new Stage( m_stages.size(), name, type )) ;
+		return m_stages.back() ;
+	}
+
+	void Profile::write_json( std::ostream& out ) const {
+		std::streamsize const precision = out.precision( 6 ) ;
+		out << "{\n"
+			<< "  \"wall_time_seconds\": " << seconds_since( m_start ) << ",\n"
+			<< "  \"stages\": [" ;
+		for( std::size_t i = 0; i < m_stages.size(); ++i ) {
+			Stage const& stage = m_stages[i] ;
+			double total_seconds = 0 ;
+			double self_seconds = 0 ;
+			for( std::size_t j = 0; j < stage.number_of_timings(); ++j ) {
+				total_seconds += stage.timing(j).total_seconds ;
+				self_seconds += stage.timing(j).self_seconds ;
+			}
+			out << ( i > 0 ? "," : "" ) << "\n    {\n"
+				<< "      \"id\": " << stage.id << ",\n"
+				<< "      \"name\": \"" << json_escape( stage.name ) << "\",\n"
+				<< "      \"type\": \"" << json_escape( stage.type ) << "\",\n" ;
+			if( stage.input() ) {
+				out << "      \"input\": " << stage.input()->id << ",\n"
+					<< "      \"variants_in\": " << stage.input()->variants_out() << ",\n" ;
+			}
+			out << "      \"variants_out\": " << stage.variants_out() << ",\n"
+				<< "      \"variants_read\": " << stage.variants_read.load() << ",\n"
+				<< "      \"variants_ignored\": " << stage.variants_ignored.load() << ",\n"
+				<< "      \"bytes_read\": " << stage.bytes_read.load() << ",\n"
+				<< "      \"bytes_decompressed\": " << stage.bytes_decompressed.load() << ",\n"
+				<< "      \"total_seconds\": " << total_seconds << ",\n"
+				<< "      \"self_seconds\": " << self_seconds << ",\n"
+				<< "      \"operations\": [" ;
+			for( std::size_t j = 0; j < stage.number_of_timings(); ++j ) {
+				Timing const& timing = stage.timing(j) ;
+				out << ( j > 0 ? "," : "" ) << "\n        {\n"
+					<< "          \"name\": \"" << json_escape( timing.operation ) << "\",\n"
+					<< "          \"calls\": " << timing.calls.load() << ",\n"
+					<< "          \"total_seconds\": " << timing.total_seconds.load() << ",\n"
+					<< "          \"self_seconds\": " << timing.self_seconds.load() << ",\n"
+					<< "          \"histogram\": [" ;
+				// Only nonempty buckets are written.
+				bool first = true ;
+				for( std::size_t b = 0; b < Histogram::eNumberOfBuckets; ++b ) {
+					if( timing.histogram[b] > 0 ) {
+						out << ( first ? "" : ", " )
+							<< "{ \"max_us\": " << Histogram::upper_bound( b ) << ", \"count\": " << timing.histogram[b] << " }" ;
+						first = false ;
+					}
+				}
+				out << "]\n        }" ;
+			}
+			out << ( stage.number_of_timings() > 0 ? "\n      " : "" ) << "]\n    }" ;
+		}
+		out << ( m_stages.size() > 0 ? "\n  " : "" ) << "]\n}\n" ;
+		out.precision( precision ) ;
+	}
+
+	void Profile::write_json( std::string const& filename ) const {
+		std::auto_ptr< std::ostream > out = open_text_file_for_output( filename ) ;
+		write_json( *out ) ;
+		if( !*out ) {
+			throw OutputError( filename ) ;
+		}
+	}
+}
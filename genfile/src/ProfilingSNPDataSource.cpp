@@ -0,0 +1,188 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <memory>
+#include <string>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/Profile.hpp"
+#include "genfile/ProfilingSNPDataSource.hpp"
+
+namespace genfile {
+	namespace impl {
+		struct ProfilingVariantDataReader: public VariantDataReader {
+			typedef boost::function< void ( SNPDataSource::IOCounts const& ) > CountIO ;
+
+			ProfilingVariantDataReader(
+				VariantDataReader::UniquePtr reader,
+				SNPDataSource const& source,
+				Profile::Timing& timing,
+				CountIO count_io
+			):
+				m_reader( reader ),
+				m_source( source ),
+				m_timing( timing ),
+				m_count_io( count_io )
+			{}
+
+			ProfilingVariantDataReader& get( std::string const& spec, PerSampleSetter& setter ) {
+				SNPDataSource::IOCounts const before = m_source.get_io_counts() ;
+				{
+					Profile::ScopedTimer timer( m_timing ) ;
+					m_reader->get( spec, setter ) ;
+				}
+				m_count_io( before ) ;
+				return *this ;
+			}
+
+			ProfilingVariantDataReader& get( std::string const& spec, PerVariantSetter& setter ) {
+				Profile::ScopedTimer timer( m_timing ) ;
+				m_reader->get( spec, setter ) ;
+				return *this ;
+			}
+
+			bool supports( std::string const& spec ) const {
+				return m_reader->supports( spec ) ;
+			}
+
+			void get_supported_specs( SpecSetter setter ) const {
+				m_reader->get_supported_specs( setter ) ;
+			}
+
+			std::size_t get_number_of_samples() const {
+				return m_reader->get_number_of_samples() ;
+			}
+
+		private:
+			VariantDataReader::UniquePtr m_reader ;
+			SNPDataSource const& m_source ;
+			Profile::Timing& m_timing ;
+			CountIO m_count_io ;
+		} ;
+	}
+
+	ProfilingSNPDataSource::UniquePtr ProfilingSNPDataSource::create( SNPDataSource::UniquePtr source, Profile::Stage& stage ) {
+		return UniquePtr( new ProfilingSNPDataSource( source, stage )) ;
+	}
+
+	ProfilingSNPDataSource::ProfilingSNPDataSource( SNPDataSource::UniquePtr source, Profile::Stage& stage ):
+		m_source( source ),
+		m_stage( stage ),
+		m_identifying_data_timing( stage.timing( "get_snp_identifying_data" )),
+		m_read_timing( stage.timing( "read_variant_data" )),
+		m_ignore_timing( stage.timing( "ignore_snp_probability_data" )),
+		m_decode_timing( stage.timing( "decode" )),
+		m_reset_timing( stage.timing( "reset_to_start" ))
+	{
+		// Find the nearest profiled source feeding this one.
+		SNPDataSource const* input = m_source.get() ;
+		while( true ) {
+			if( ProfilingSNPDataSource const* profiled = dynamic_cast< ProfilingSNPDataSource const* >( input ) ) {
+				m_stage.set_input( &profiled->stage() ) ;
+				break ;
+			}
+			SNPDataSource const* parent = &input->get_parent_source() ;
+			if( parent == input ) {
+				break ;
+			}
+			input = parent ;
+		}
+	}
+
+	ProfilingSNPDataSource::operator bool() const {
+		return *m_source ;
+	}
+
+	SNPDataSource::Metadata ProfilingSNPDataSource::get_metadata() const {
+		return m_source->get_metadata() ;
+	}
+
+	unsigned int ProfilingSNPDataSource::number_of_samples() const {
+		return m_source->number_of_samples() ;
+	}
+
+	bool ProfilingSNPDataSource::has_sample_ids() const {
+		return m_source->has_sample_ids() ;
+	}
+
+	void ProfilingSNPDataSource::get_sample_ids( GetSampleIds getter ) const {
+		m_source->get_sample_ids( getter ) ;
+	}
+
+	SNPDataSource::OptionalSnpCount ProfilingSNPDataSource::total_number_of_snps() const {
+		return m_source->total_number_of_snps() ;
+	}
+
+	std::string ProfilingSNPDataSource::get_source_spec() const {
+		return m_source->get_source_spec() ;
+	}
+
+	SNPDataSource const& ProfilingSNPDataSource::get_parent_source() const {
+		return *m_source ;
+	}
+
+	SNPDataSource const& ProfilingSNPDataSource::get_base_source() const {
+		return m_source->get_base_source() ;
+	}
+
+	std::string ProfilingSNPDataSource::get_summary( std::string const& prefix, std::size_t column_width ) const {
+		return m_source->get_summary( prefix, column_width ) ;
+	}
+
+	void ProfilingSNPDataSource::get_snp_identifying_data_impl( VariantIdentifyingData* variant ) {
+		IOCounts const before = m_source->get_io_counts() ;
+		{
+			Profile::ScopedTimer timer( m_identifying_data_timing ) ;
+			m_source->get_snp_identifying_data( variant ) ;
+		}
+		count_io( before ) ;
+	}
+
+	VariantDataReader::UniquePtr ProfilingSNPDataSource::read_variant_data_impl() {
+		IOCounts const before = m_source->get_io_counts() ;
+		VariantDataReader::UniquePtr reader ;
+		{
+			Profile::ScopedTimer timer( m_read_timing ) ;
+			reader = m_source->read_variant_data() ;
+		}
+		++m_stage.variants_read ;
+		count_io( before ) ;
+		return VariantDataReader::UniquePtr(
+			new impl::ProfilingVariantDataReader(
+				reader, *m_source, m_decode_timing,
+				boost::bind( &ProfilingSNPDataSource::count_io, this, _1 )
+			)
+		) ;
+	}
+
+	void ProfilingSNPDataSource::ignore_snp_probability_data_impl() {
+		IOCounts const before = m_source->get_io_counts() ;
+		{
+			Profile::ScopedTimer timer( m_ignore_timing ) ;
+			m_source->ignore_snp_probability_data() ;
+		}
+		++m_stage.variants_ignored ;
+		count_io( before ) ;
+	}
+
+	void ProfilingSNPDataSource::reset_to_start_impl() {
+		Profile::ScopedTimer timer( m_reset_timing ) ;
+		m_source->reset_to_start() ;
+	}
+
+	bool ProfilingSNPDataSource::set_sample_selection_impl( SampleSelection const& selection ) {
+		return m_source->set_sample_selection( selection ) ;
+	}
+
+	void ProfilingSNPDataSource::count_io( IOCounts const& before ) {
+		IOCounts const after = m_source->get_io_counts() ;
+		m_stage.bytes_read += after.bytes_read - before.bytes_read ;
+		m_stage.bytes_decompressed += after.bytes_decompressed - before.bytes_decompressed ;
+	}
+}
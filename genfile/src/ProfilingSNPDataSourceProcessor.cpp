@@ -0,0 +1,58 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <typeinfo>
+#include <boost/units/detail/utility.hpp>
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/SNPDataSourceProcessor.hpp"
+#include "genfile/Profile.hpp"
+#include "genfile/ProfilingSNPDataSourceProcessor.hpp"
+
+namespace genfile {
+	ProfilingSNPDataSourceProcessor::ProfilingSNPDataSourceProcessor( Profile& profile, std::string const& filename ):
+		m_profile( profile ),
+		m_filename( filename )
+	{}
+
+	void ProfilingSNPDataSourceProcessor::call_begin_processing_snps( std::size_t const& number_of_samples, genfile::SNPDataSource::Metadata const& metadata ) const {
+		std::vector< Callback* > const& callbacks = get_callbacks() ;
+		m_stages.clear() ;
+		m_processed_snp_timings.clear() ;
+		for( std::size_t i = 0; i < callbacks.size(); ++i ) {
+			m_stages.push_back(
+				&m_profile.add_stage( boost::units::detail::demangle( typeid( *callbacks[i] ).name() ), "callback" )
+			) ;
+			m_processed_snp_timings.push_back( &m_stages[i]->timing( "processed_snp" )) ;
+		}
+		for( std::size_t i = 0; i < callbacks.size(); ++i ) {
+			Profile::ScopedTimer timer( m_stages[i]->timing( "begin_processing_snps" )) ;
+			callbacks[i]->begin_processing_snps( number_of_samples, metadata ) ;
+		}
+	}
+
+	void ProfilingSNPDataSourceProcessor::call_processed_snp( VariantIdentifyingData const& id_data, VariantDataReader::SharedPtr data_reader ) const {
+		std::vector< Callback* > const& callbacks = get_callbacks() ;
+		for( std::size_t i = 0; i < callbacks.size(); ++i ) {
+			{
+				Profile::ScopedTimer timer( *m_processed_snp_timings[i] ) ;
+				callbacks[i]->processed_snp( id_data, data_reader ) ;
+			}
+			++m_stages[i]->variants_read ;
+		}
+	}
+
+	void ProfilingSNPDataSourceProcessor::call_end_processing_snps() const {
+		std::vector< Callback* > const& callbacks = get_callbacks() ;
+		for( std::size_t i = 0; i < callbacks.size(); ++i ) {
+			Profile::ScopedTimer timer( m_stages[i]->timing( "end_processing_snps" )) ;
+			callbacks[i]->end_processing_snps() ;
+		}
+		m_profile.write_json( m_filename ) ;
+	}
+}
@@ -332,6 +332,11 @@ namespace genfile {
 		return *this ;
 	}
 
+	bool SNPDataSource::set_sample_selection( SampleSelection const& selection ) {
+		assert( selection.size() == number_of_samples() ) ;
+		return set_sample_selection_impl( selection ) ;
+	}
+
 	std::string SNPDataSource::get_summary( std::string const& prefix, std::size_t width ) const {
 		std::ostringstream ostr ;
 		ostr << prefix << std::setw( width ) << "Spec: " << get_source_spec() << "\n" ;
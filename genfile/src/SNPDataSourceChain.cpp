@@ -8,6 +8,7 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include <algorithm>
 #include "config/config.hpp"
 #if HAVE_BOOST_FUNCTION
 #include <boost/function.hpp>
@@ -16,6 +17,7 @@
 #include "genfile/snp_data_utils.hpp"
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/SNPDataSourceChain.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
 #include "genfile/SNPDataSourceRack.hpp"
 #include "genfile/wildcard.hpp"
 
@@ -71,7 +73,7 @@ namespace genfile {
 	}
 		
 	SNPDataSourceChain::SNPDataSourceChain()
-		: m_current_source(0), m_number_of_samples(0), m_moved_to_next_source_callback(0)
+		: m_number_of_prefetching_threads(0), m_max_prefetch_queue_bytes(0), m_current_source(0), m_number_of_samples(0), m_moved_to_next_source_callback(0)
 	{}
 
 	SNPDataSourceChain::~SNPDataSourceChain() {
@@ -92,6 +94,13 @@ namespace genfile {
 		else if( source->number_of_samples() != m_number_of_samples ) {
 			throw FileContainsSNPsOfDifferentSizes() ;
 		}
+		if( m_number_of_prefetching_threads > 0 ) {
+			PrefetchingSNPDataSource::UniquePtr prefetching_source = PrefetchingSNPDataSource::create( source, m_max_prefetch_queue_bytes, m_prefetch_specs ) ;
+			m_prefetching_sources.push_back( prefetching_source.get() ) ;
+			source.reset( prefetching_source.release() ) ;
+		} else {
+			m_prefetching_sources.push_back( 0 ) ;
+		}
 		m_sources.push_back( source.release() ) ;
 		//m_sources.back()->reset_to_start() ;
 
@@ -106,6 +115,38 @@ namespace genfile {
 		m_metadata = new_metadata ;
 	}
 
+	void SNPDataSourceChain::prefetch_sources(
+		std::size_t number_of_threads,
+		std::size_t max_queue_bytes,
+		std::vector< std::string > const& specs
+	) {
+		m_number_of_prefetching_threads = number_of_threads ;
+		m_max_prefetch_queue_bytes = max_queue_bytes ;
+		m_prefetch_specs = specs ;
+		if( number_of_threads > 0 ) {
+			for( std::size_t i = 0; i < m_sources.size(); ++i ) {
+				if( !m_prefetching_sources[i] ) {
+					PrefetchingSNPDataSource::UniquePtr prefetching_source = PrefetchingSNPDataSource::create(
+						SNPDataSource::UniquePtr( m_sources[i] ),
+						max_queue_bytes,
+						specs
+					) ;
+					m_prefetching_sources[i] = prefetching_source.get() ;
+					m_sources[i] = prefetching_source.release() ;
+				}
+			}
+		}
+	}
+
+	void SNPDataSourceChain::start_prefetching_sources() {
+		std::size_t const end = std::min( m_current_source + m_number_of_prefetching_threads, m_sources.size() ) ;
+		for( std::size_t i = m_current_source; i < end; ++i ) {
+			if( m_prefetching_sources[i] ) {
+				m_prefetching_sources[i]->start_prefetching() ;
+			}
+		}
+	}
+
 	unsigned int SNPDataSourceChain::number_of_samples() const {
 		return m_number_of_samples ;
 	}
@@ -198,9 +239,24 @@ namespace genfile {
 		m_current_source = 0 ;
 	}
 
+	bool SNPDataSourceChain::set_sample_selection_impl( SampleSelection const& selection ) {
+		// All sources must honour the selection, or none.
+		for( std::size_t i = 0; i < m_sources.size(); ++i ) {
+			if( !m_sources[i]->set_sample_selection( selection ) ) {
+				SampleSelection const all_samples( selection.size(), true ) ;
+				for( std::size_t j = 0; j < i; ++j ) {
+					m_sources[j]->set_sample_selection( all_samples ) ;
+				}
+				return false ;
+			}
+		}
+		return true ;
+	}
+
 	void SNPDataSourceChain::get_snp_identifying_data_impl( 
 		VariantIdentifyingData* result
 	) {
+		start_prefetching_sources() ;
 		move_to_next_nonempty_source_if_necessary() ;
 		if( m_current_source < m_sources.size() ) {
 			m_sources[m_current_source]->get_snp_identifying_data( result ) ;
@@ -222,6 +278,7 @@ namespace genfile {
 
 	void SNPDataSourceChain::move_to_next_source() {
 		++m_current_source ;
+		start_prefetching_sources() ;
 		if( m_moved_to_next_source_callback ) {
 			m_moved_to_next_source_callback( m_current_source ) ;
 		}
@@ -13,6 +13,7 @@
 #include "genfile/Error.hpp"
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/SNPDataSourceRack.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
 #include "genfile/VariantIdentifyingData.hpp"
 #include "genfile/OffsetFlippedAlleleSetter.hpp"
 #include "genfile/get_set.hpp"
@@ -48,14 +49,16 @@ namespace genfile {
 	}
 	
 	SNPDataSourceRack::SNPDataSourceRack()
-		: m_number_of_samples(0),
+		: m_max_prefetch_queue_bytes(0),
+		  m_number_of_samples(0),
 		  m_read_past_end( false ),
 		  m_comparator( "position,rsid,SNPID,alleles" )
 	{
 	}
 
 	SNPDataSourceRack::SNPDataSourceRack( std::string const& snp_match_fields )
-		: m_number_of_samples(0),
+		: m_max_prefetch_queue_bytes(0),
+		  m_number_of_samples(0),
 		  m_read_past_end( false ),
 		  m_comparator( snp_match_fields )
 	{
@@ -64,7 +67,8 @@ namespace genfile {
 	}
 
 	SNPDataSourceRack::SNPDataSourceRack( genfile::VariantIdentifyingData::CompareFields const& comparator )
-		: m_number_of_samples(0),
+		: m_max_prefetch_queue_bytes(0),
+		  m_number_of_samples(0),
 		  m_read_past_end( false ),
 		  m_comparator( comparator )
 	{
@@ -84,6 +88,13 @@ namespace genfile {
 	void SNPDataSourceRack::add_source(
 		std::auto_ptr< SNPDataSource > source
 	) {
+		if( m_max_prefetch_queue_bytes > 0 ) {
+			PrefetchingSNPDataSource::UniquePtr prefetching_source = PrefetchingSNPDataSource::create( source, m_max_prefetch_queue_bytes, m_prefetch_specs ) ;
+			m_prefetching_sources.push_back( prefetching_source.get() ) ;
+			source.reset( prefetching_source.release() ) ;
+		} else {
+			m_prefetching_sources.push_back( 0 ) ;
+		}
 		m_sources.push_back( source.release() ) ;
 		m_flips.push_back( eNoFlip ) ;
 		m_number_of_samples += m_sources.back()->number_of_samples() ;
@@ -96,6 +107,29 @@ namespace genfile {
 		}
 	}
 	
+	void SNPDataSourceRack::prefetch_sources( std::size_t max_queue_bytes, std::vector< std::string > const& specs ) {
+		if( max_queue_bytes == 0 ) {
+			throw BadArgumentError(
+				"genfile::SNPDataSourceRack::prefetch_sources()",
+				"max_queue_bytes=0",
+				"Queue size must be positive."
+			) ;
+		}
+		m_max_prefetch_queue_bytes = max_queue_bytes ;
+		m_prefetch_specs = specs ;
+		for( std::size_t i = 0; i < m_sources.size(); ++i ) {
+			if( !m_prefetching_sources[i] ) {
+				PrefetchingSNPDataSource::UniquePtr prefetching_source = PrefetchingSNPDataSource::create(
+					SNPDataSource::UniquePtr( m_sources[i] ),
+					max_queue_bytes,
+					specs
+				) ;
+				m_prefetching_sources[i] = prefetching_source.get() ;
+				m_sources[i] = prefetching_source.release() ;
+			}
+		}
+	}
+
 	void SNPDataSourceRack::check_snps_are_sorted_by_position(
 		std::vector< VariantIdentifyingData > const& snps,
 		std::size_t cohort_index
@@ -234,6 +268,12 @@ namespace genfile {
 		if( m_sources.size() == 0 ) {
 			return ;
 		}
+		// Start all prefetching sources together, rather than as each is first read.
+		for( std::size_t i = 0; i < m_prefetching_sources.size(); ++i ) {
+			if( m_prefetching_sources[i] ) {
+				m_prefetching_sources[i]->start_prefetching() ;
+			}
+		}
 		
 		VariantIdentifyingData this_snp ;
 		VariantIdentifyingData merged_snp ;
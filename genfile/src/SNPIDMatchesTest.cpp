@@ -6,6 +6,7 @@
 
 #include <string>
 #include <cassert>
+#include <algorithm>
 #include "genfile/VariantIdentifyingDataTest.hpp"
 #include "genfile/SNPIDMatchesTest.hpp"
 #include "genfile/string_utils.hpp"
@@ -77,13 +78,27 @@ namespace genfile {
 		}
 		return false ;
 	}
+
+	bool SNPIDMatchesTest::may_pass( VariantIdentifyingDataView const& view ) const {
+		if( ( m_type == eRSID || m_type == eEITHER ) && match( view.primary_id ) ) {
+			return true ;
+		}
+		if( m_type == eSNPID || m_type == eEITHER ) {
+			for( std::size_t i = 0; i < view.alternate_ids.size(); ++i ) {
+				if( match( view.alternate_ids[i] ) ) {
+					return true ;
+				}
+			}
+		}
+		return false ;
+	}
 	
-	bool SNPIDMatchesTest::match( std::string const& s ) const {
+	bool SNPIDMatchesTest::match( string_utils::slice const& s ) const {
 		if( m_have_wildcard ) {
 			return
 				s.size() >= (m_prefix.size() + m_suffix.size())
-				&& s.compare( 0, m_prefix.size(), m_prefix ) == 0
-				&& s.compare( s.size() - m_suffix.size(), m_suffix.size(), m_suffix ) == 0
+				&& std::equal( m_prefix.begin(), m_prefix.end(), s.begin() )
+				&& std::equal( m_suffix.begin(), m_suffix.end(), s.end() - m_suffix.size() )
 			;
 		} else {
 			return s == m_prefix ;
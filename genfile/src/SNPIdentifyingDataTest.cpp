@@ -81,6 +81,15 @@ namespace genfile {
 		return true ;
 	}
 
+	bool VariantIdentifyingDataTestConjunction::may_pass( VariantIdentifyingDataView const& view ) const {
+		for( std::size_t i = 0; i < get_number_of_subtests(); ++i ) {
+			if( !get_subtest(i).may_pass( view ) ) {
+				return false ;
+			}
+		}
+		return true ;
+	}
+
 	std::string VariantIdentifyingDataTestConjunction::display() const {
 		if( get_number_of_subtests() == 0 ) {
 			return "true" ;
@@ -108,6 +117,15 @@ namespace genfile {
 		}
 		return false ;
 	}
+
+	bool VariantIdentifyingDataTestDisjunction::may_pass( VariantIdentifyingDataView const& view ) const {
+		for( std::size_t i = 0; i < get_number_of_subtests(); ++i ) {
+			if( get_subtest( i ).may_pass( view ) ) {
+				return true ;
+			}
+		}
+		return false ;
+	}
 	
 	std::string VariantIdentifyingDataTestDisjunction::display() const {
 		if( get_number_of_subtests() == 0 ) {
@@ -28,12 +28,22 @@ namespace genfile {
 	)
 		: m_source( source ),
 		  m_indices_of_samples_to_filter_out( indices_of_samples_to_filter_out.begin(), indices_of_samples_to_filter_out.end() ),
-		  m_genotype_data( m_source->number_of_samples() * 3 )
+		  m_genotype_data( m_source->number_of_samples() * 3 ),
+		  m_source_applies_filter( false )
 	{
 		std::sort( m_indices_of_samples_to_filter_out.begin(), m_indices_of_samples_to_filter_out.end() ) ;
 		if( m_indices_of_samples_to_filter_out.size() > 0 && m_indices_of_samples_to_filter_out.back() >= m_source->number_of_samples() ) {
 			throw SampleIndexOutOfRangeError( m_indices_of_samples_to_filter_out.back(), m_source->number_of_samples() ) ;
 		}
+		// Ask the source to skip filtered-out samples while decoding.
+		// If it can't, we filter its output below.
+		if( m_indices_of_samples_to_filter_out.size() > 0 ) {
+			SampleSelection selection( m_source->number_of_samples(), true ) ;
+			for( std::size_t i = 0; i < m_indices_of_samples_to_filter_out.size(); ++i ) {
+				selection[ m_indices_of_samples_to_filter_out[i] ] = false ;
+			}
+			m_source_applies_filter = m_source->set_sample_selection( selection ) ;
+		}
 	}
 	
 	SampleFilteringSNPDataSource::~SampleFilteringSNPDataSource() {}
@@ -265,6 +275,9 @@ namespace genfile {
 	}
 
 	VariantDataReader::UniquePtr SampleFilteringSNPDataSource::read_variant_data_impl() {
+		if( m_source_applies_filter ) {
+			return m_source->read_variant_data() ;
+		}
 		return VariantDataReader::UniquePtr(
 			new impl::SampleFilteringVariantDataReader(
 				m_source->read_variant_data(),
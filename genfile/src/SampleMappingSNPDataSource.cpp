@@ -137,10 +137,12 @@ namespace genfile {
 		struct SampleMappingPerSampleSetter: public VariantDataReader::PerSampleSetter {
 			SampleMappingPerSampleSetter(
 				VariantDataReader::PerSampleSetter& setter,
-				SampleMapping const& mapped_to_reference_sample_mapping
+				SampleMapping const& mapped_to_reference_sample_mapping,
+				std::vector< std::size_t > const* selected_target_samples
 			):
 					m_setter( setter ),
 					m_sample_mapping( mapped_to_reference_sample_mapping ),
+					m_selected_target_samples( selected_target_samples ),
 					m_set_this_sample( false ),
 					m_last_source_sample( 0 )
 			{}
@@ -153,7 +155,9 @@ namespace genfile {
 			}
 
 			bool set_sample( std::size_t n ) {
-				boost::optional< std::size_t > const source_sample = m_sample_mapping.find_source_sample_for( n ) ;
+				// If the source applies our sample selection, n indexes the selected samples.
+				std::size_t const target_sample = m_selected_target_samples ? (*m_selected_target_samples)[n] : n ;
+				boost::optional< std::size_t > const source_sample = m_sample_mapping.find_source_sample_for( target_sample ) ;
 				if( source_sample ) {
 					for( int s = m_last_source_sample; s < source_sample.get(); ++s ) {
 						m_setter.set_sample( s ) ;
@@ -203,6 +207,7 @@ namespace genfile {
 		private:
 			VariantDataReader::PerSampleSetter& m_setter ;
 			SampleMapping const& m_sample_mapping ;
+			std::vector< std::size_t > const* m_selected_target_samples ;
 			bool m_set_this_sample ;
 			std::size_t m_last_source_sample ;
 		} ;
@@ -211,24 +216,27 @@ namespace genfile {
 		public:
 			static UniquePtr create(
 				VariantDataReader::UniquePtr data_reader,
-				SampleMapping const& sample_mapping
+				SampleMapping const& sample_mapping,
+				std::vector< std::size_t > const* selected_target_samples
 			) {
 				return UniquePtr(
-					new SampleMappingVariantDataReader( data_reader, sample_mapping )
+					new SampleMappingVariantDataReader( data_reader, sample_mapping, selected_target_samples )
 				) ;
 			}
 
 			SampleMappingVariantDataReader(
 				VariantDataReader::UniquePtr data_reader,
-				SampleMapping const& sample_mapping
+				SampleMapping const& sample_mapping,
+				std::vector< std::size_t > const* selected_target_samples
 			):
 				m_data_reader( data_reader ),
-				m_sample_mapping( sample_mapping )
+				m_sample_mapping( sample_mapping ),
+				m_selected_target_samples( selected_target_samples )
 			{}
 
 		public:
 			VariantDataReader& get( std::string const& spec, PerSampleSetter& setter ) {
-				SampleMappingPerSampleSetter mapping_setter( setter, m_sample_mapping ) ;
+				SampleMappingPerSampleSetter mapping_setter( setter, m_sample_mapping, m_selected_target_samples ) ;
 				m_data_reader->get(
 					spec,
 					mapping_setter
@@ -251,6 +259,7 @@ namespace genfile {
 		private:
 			VariantDataReader::UniquePtr m_data_reader ;
 			SampleMapping const& m_sample_mapping ;
+			std::vector< std::size_t > const* m_selected_target_samples ;
 		} ;
 	}
 
@@ -269,6 +278,18 @@ namespace genfile {
 		),
 		m_source( source )
 	{
+		// Only mapped samples are needed, so ask the source to skip the rest.
+		SampleSelection selection( m_source->number_of_samples(), false ) ;
+		std::vector< std::size_t > selected_target_samples ;
+		for( std::size_t i = 0; i < selection.size(); ++i ) {
+			if( m_sample_mapping->find_source_sample_for( i ) ) {
+				selection[i] = true ;
+				selected_target_samples.push_back( i ) ;
+			}
+		}
+		if( selected_target_samples.size() < selection.size() && m_source->set_sample_selection( selection ) ) {
+			m_selected_target_samples = selected_target_samples ;
+		}
 	}
 
 	SampleMappingSNPDataSource::operator bool() const {
@@ -311,7 +332,8 @@ namespace genfile {
 	VariantDataReader::UniquePtr SampleMappingSNPDataSource::read_variant_data_impl() {
 		return impl::SampleMappingVariantDataReader::create(
 			m_source->read_variant_data(),
-			*m_sample_mapping
+			*m_sample_mapping,
+			m_selected_target_samples ? &m_selected_target_samples.get() : 0
 		) ;
 	}
 
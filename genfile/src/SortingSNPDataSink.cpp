@@ -0,0 +1,517 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/filesystem/operations.hpp>
+#include "genfile/SNPDataSink.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/BufferedVariantDataReader.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/Error.hpp"
+#include "genfile/SortingSNPDataSink.hpp"
+
+namespace genfile {
+	namespace {
+		typedef SortingSNPDataSink::Record Record ;
+
+		void write_string( std::ostream& stream, std::string const& value ) {
+			write_little_endian_integer( stream, uint32_t( value.size() )) ;
+			stream.write( value.data(), value.size() ) ;
+		}
+
+		std::string read_string( std::istream& stream ) {
+			uint32_t size = 0 ;
+			read_little_endian_integer( stream, &size ) ;
+			std::string result( size, '\0' ) ;
+			if( size > 0 ) {
+				stream.read( &result[0], size ) ;
+			}
+			return result ;
+		}
+
+		void write_chromosome( std::ostream& stream, Chromosome const& chromosome ) {
+			write_little_endian_integer( stream, uint8_t( chromosome.is_missing() ? 0 : 1 )) ;
+			if( !chromosome.is_missing() ) {
+				write_string( stream, chromosome ) ;
+			}
+		}
+
+		Chromosome read_chromosome( std::istream& stream ) {
+			uint8_t present = 0 ;
+			read_little_endian_integer( stream, &present ) ;
+			return present ? Chromosome( read_string( stream )) : Chromosome() ;
+		}
+
+		void write_entry( std::ostream& stream, VariantEntry const& entry ) {
+			if( entry.is_string() ) {
+				write_little_endian_integer( stream, uint8_t( 1 )) ;
+				write_string( stream, entry.as< std::string >() ) ;
+			} else if( entry.is_int() ) {
+				write_little_endian_integer( stream, uint8_t( 2 )) ;
+				write_little_endian_integer( stream, entry.as< VariantEntry::Integer >() ) ;
+			} else if( entry.is_double() ) {
+				double const value = entry.as< double >() ;
+				uint64_t bits ;
+				std::memcpy( &bits, &value, sizeof( double )) ;
+				write_little_endian_integer( stream, uint8_t( 3 )) ;
+				write_little_endian_integer( stream, bits ) ;
+			} else if( entry.is_chromosome() ) {
+				write_little_endian_integer( stream, uint8_t( 4 )) ;
+				write_chromosome( stream, entry.as< Chromosome >() ) ;
+			} else if( entry.is_position() ) {
+				GenomePosition const position = entry.as< GenomePosition >() ;
+				write_little_endian_integer( stream, uint8_t( 5 )) ;
+				write_chromosome( stream, position.chromosome() ) ;
+				write_little_endian_integer( stream, uint32_t( position.position() )) ;
+			} else {
+				assert( entry.is_missing() ) ;
+				write_little_endian_integer( stream, uint8_t( 0 )) ;
+			}
+		}
+
+		VariantEntry read_entry( std::istream& stream ) {
+			uint8_t type = 0 ;
+			read_little_endian_integer( stream, &type ) ;
+			switch( type ) {
+				case 1:
+					return read_string( stream ) ;
+				case 2: {
+					VariantEntry::Integer value = 0 ;
+					read_little_endian_integer( stream, &value ) ;
+					return value ;
+				}
+				case 3: {
+					uint64_t bits = 0 ;
+					double value ;
+					read_little_endian_integer( stream, &bits ) ;
+					std::memcpy( &value, &bits, sizeof( double )) ;
+					return value ;
+				}
+				case 4:
+					return read_chromosome( stream ) ;
+				case 5: {
+					Chromosome const chromosome = read_chromosome( stream ) ;
+					uint32_t position = 0 ;
+					read_little_endian_integer( stream, &position ) ;
+					return GenomePosition( chromosome, position ) ;
+				}
+				default:
+					return VariantEntry() ;
+			}
+		}
+
+		void write_record( std::ostream& stream, Record const& record ) {
+			VariantIdentifyingData const& id = record.id ;
+			write_chromosome( stream, id.get_position().chromosome() ) ;
+			write_little_endian_integer( stream, uint32_t( id.get_position().position() )) ;
+			std::vector< VariantIdentifyingData::slice > const identifiers = id.get_identifiers() ;
+			write_little_endian_integer( stream, uint32_t( identifiers.size() )) ;
+			for( std::size_t i = 0; i < identifiers.size(); ++i ) {
+				write_string( stream, identifiers[i] ) ;
+			}
+			write_little_endian_integer( stream, uint32_t( id.number_of_alleles() )) ;
+			for( std::size_t i = 0; i < id.number_of_alleles(); ++i ) {
+				write_string( stream, id.get_allele(i) ) ;
+			}
+			write_little_endian_integer( stream, uint32_t( record.info.size() )) ;
+			for( SNPDataSink::Info::const_iterator i = record.info.begin(); i != record.info.end(); ++i ) {
+				write_string( stream, i->first ) ;
+				write_little_endian_integer( stream, uint32_t( i->second.size() )) ;
+				for( std::size_t j = 0; j < i->second.size(); ++j ) {
+					write_entry( stream, i->second[j] ) ;
+				}
+			}
+			write_little_endian_integer( stream, uint64_t( record.data.size() )) ;
+			stream.write( reinterpret_cast< char const* >( &record.data[0] ), record.data.size() ) ;
+		}
+
+		// Read a record written by write_record(), returning false at the end of the stream.
+		bool read_record( std::istream& stream, Record* record ) {
+			Chromosome const chromosome = read_chromosome( stream ) ;
+			if( !stream ) {
+				return false ;
+			}
+			uint32_t position = 0 ;
+			read_little_endian_integer( stream, &position ) ;
+			uint32_t number_of_identifiers = 0 ;
+			read_little_endian_integer( stream, &number_of_identifiers ) ;
+			record->id = VariantIdentifyingData( read_string( stream )) ;
+			for( uint32_t i = 1; i < number_of_identifiers; ++i ) {
+				record->id.add_identifier( read_string( stream )) ;
+			}
+			record->id.set_position( GenomePosition( chromosome, position )) ;
+			uint32_t number_of_alleles = 0 ;
+			read_little_endian_integer( stream, &number_of_alleles ) ;
+			for( uint32_t i = 0; i < number_of_alleles; ++i ) {
+				record->id.add_allele( read_string( stream )) ;
+			}
+			uint32_t number_of_info_fields = 0 ;
+			read_little_endian_integer( stream, &number_of_info_fields ) ;
+			record->info.clear() ;
+			for( uint32_t i = 0; i < number_of_info_fields; ++i ) {
+				std::vector< VariantEntry >& values = record->info[ read_string( stream ) ] ;
+				uint32_t number_of_values = 0 ;
+				read_little_endian_integer( stream, &number_of_values ) ;
+				for( uint32_t j = 0; j < number_of_values; ++j ) {
+					values.push_back( read_entry( stream )) ;
+				}
+			}
+			uint64_t size = 0 ;
+			read_little_endian_integer( stream, &size ) ;
+			record->data.resize( size ) ;
+			stream.read( reinterpret_cast< char* >( &record->data[0] ), size ) ;
+			if( !stream ) {
+				throw MalformedInputError( "genfile::SortingSNPDataSink", "(temporary file)", 0 ) ;
+			}
+			return true ;
+		}
+
+		// Approximate number of bytes of memory taken by a record.
+		std::size_t estimate_bytes_used( Record const& record ) {
+			std::size_t result = sizeof( Record ) + record.id.estimate_bytes_used() + record.data.size() ;
+			for( SNPDataSink::Info::const_iterator i = record.info.begin(); i != record.info.end(); ++i ) {
+				result += i->first.size() + i->second.size() * sizeof( VariantEntry ) + 64 ;
+			}
+			return result ;
+		}
+
+		// Return the size of the buffer through which each run is read.  Runs are read in big
+		// sequential chunks, but the buffers of one merge are kept within the memory budget.
+		std::size_t get_read_buffer_size( std::size_t memory_budget, std::size_t max_runs_per_merge ) {
+			return std::max< std::size_t >( 4096, std::min< std::size_t >( 1024 * 1024, memory_budget / max_runs_per_merge )) ;
+		}
+
+		void remove_file( std::string const& filename ) {
+			boost::system::error_code ec ;
+			boost::filesystem::remove( filename, ec ) ;
+			if( ec ) {
+				std::cerr << "!! genfile::SortingSNPDataSink: could not remove temporary file \"" << filename << "\": " << ec.message() << ".\n" ;
+			}
+		}
+
+		// Steps through the records of one sorted run, either held in a temporary file
+		// or in memory.
+		struct RunCursor {
+			RunCursor( std::string const& filename, std::size_t buffer_size ):
+				m_buffer( buffer_size ),
+				m_stream( new std::ifstream() ),
+				m_batch( 0 ),
+				m_index( 0 ),
+				m_current( 0 )
+			{
+				m_stream->rdbuf()->pubsetbuf( &m_buffer[0], m_buffer.size() ) ;
+				m_stream->open( filename.c_str(), std::ios::binary ) ;
+				if( !*m_stream ) {
+					throw ResourceNotOpenedError( filename ) ;
+				}
+				advance() ;
+			}
+
+			RunCursor( std::vector< Record const* > const& batch ):
+				m_batch( &batch ),
+				m_index( 0 ),
+				m_current( 0 )
+			{
+				advance() ;
+			}
+
+			Record const* current() const { return m_current ; }
+
+			void advance() {
+				if( m_batch ) {
+					m_current = ( m_index < m_batch->size() ) ? (*m_batch)[ m_index++ ] : 0 ;
+				} else {
+					m_current = read_record( *m_stream, &m_record ) ? &m_record : 0 ;
+				}
+			}
+
+		private:
+			std::vector< char > m_buffer ;
+			std::auto_ptr< std::ifstream > m_stream ;
+			std::vector< Record const* > const* m_batch ;
+			std::size_t m_index ;
+			Record m_record ;
+			Record const* m_current ;
+		} ;
+
+		typedef std::vector< boost::shared_ptr< RunCursor > > RunCursors ;
+
+		// Writes records to a temporary file as a new run.
+		struct RunWriter {
+			RunWriter( std::string const& filename ):
+				m_filename( filename ),
+				m_buffer( 1024 * 1024 )
+			{
+				m_stream.rdbuf()->pubsetbuf( &m_buffer[0], m_buffer.size() ) ;
+				m_stream.open( filename.c_str(), std::ios::binary | std::ios::trunc ) ;
+				if( !m_stream ) {
+					throw ResourceNotOpenedError( filename ) ;
+				}
+			}
+
+			void write( Record const& record ) {
+				write_record( m_stream, record ) ;
+			}
+
+			void close() {
+				m_stream.close() ;
+				if( !m_stream ) {
+					throw OperationFailedError( "genfile::SortingSNPDataSink", m_filename, "write" ) ;
+				}
+			}
+
+		private:
+			std::string const m_filename ;
+			std::vector< char > m_buffer ;
+			std::ofstream m_stream ;
+		} ;
+
+		void write_to_sink( SNPDataSink& sink, Record const& record ) {
+			sink.write_variant_data(
+				record.id,
+				*BufferedVariantDataReader::deserialise( &record.data[0], &record.data[0] + record.data.size() ),
+				record.info
+			) ;
+		}
+
+		typedef boost::function< void( Record const& ) > RecordCallback ;
+
+		void copy_run( RunCursor& run, RecordCallback callback ) {
+			for( ; run.current(); run.advance() ) {
+				callback( *run.current() ) ;
+			}
+		}
+
+		// Orders runs so that the one with the least current variant is at the top of a heap.
+		// Ties go to the earlier run, so that equal variants keep the order they arrived in.
+		struct CompareRuns {
+			CompareRuns( RunCursors const& runs, VariantIdentifyingData::CompareFields const& comparer ):
+				m_runs( runs ),
+				m_comparer( comparer )
+			{}
+
+			bool operator()( std::size_t a, std::size_t b ) const {
+				VariantIdentifyingData const& left = m_runs[a]->current()->id ;
+				VariantIdentifyingData const& right = m_runs[b]->current()->id ;
+				if( m_comparer( right, left ) ) {
+					return true ;
+				} else if( m_comparer( left, right ) ) {
+					return false ;
+				}
+				return a > b ;
+			}
+		private:
+			RunCursors const& m_runs ;
+			VariantIdentifyingData::CompareFields const& m_comparer ;
+		} ;
+
+		// Pass the records of the given runs, which must be in arrival order, to the callback in sorted order.
+		void merge( RunCursors const& runs, VariantIdentifyingData::CompareFields const& comparer, RecordCallback callback ) {
+			std::priority_queue< std::size_t, std::vector< std::size_t >, CompareRuns > heap( CompareRuns( runs, comparer )) ;
+			for( std::size_t i = 0; i < runs.size(); ++i ) {
+				if( runs[i]->current() ) {
+					heap.push( i ) ;
+				}
+			}
+			while( !heap.empty() ) {
+				std::size_t const i = heap.top() ;
+				heap.pop() ;
+				callback( *runs[i]->current() ) ;
+				runs[i]->advance() ;
+				if( runs[i]->current() ) {
+					heap.push( i ) ;
+				}
+			}
+		}
+
+		struct CompareRecords {
+			CompareRecords( VariantIdentifyingData::CompareFields const& comparer ):
+				m_comparer( comparer )
+			{}
+			bool operator()( Record const* left, Record const* right ) const {
+				return m_comparer( left->id, right->id ) ;
+			}
+		private:
+			VariantIdentifyingData::CompareFields const& m_comparer ;
+		} ;
+	}
+
+	SortingSNPDataSink::SortingSNPDataSink(
+		SNPDataSink::UniquePtr sink,
+		VariantIdentifyingData::CompareFields const& comparer,
+		std::size_t memory_budget,
+		std::vector< std::string > const& specs,
+		std::size_t max_runs_per_merge
+	):
+		m_sink( sink ),
+		m_comparer( comparer ),
+		m_memory_budget( memory_budget ),
+		m_specs( specs ),
+		m_max_runs_per_merge( max_runs_per_merge ),
+		m_bytes_used( 0 ),
+		m_input_is_sorted( true ),
+		m_batch_is_sorted( true ),
+		m_finalised( false )
+	{
+		assert( m_sink.get() ) ;
+		assert( m_max_runs_per_merge > 1 ) ;
+	}
+
+	// Output is only written by finalise(); a sink destroyed without it (e.g. during stack unwinding)
+	// just cleans up its temporary files.
+	SortingSNPDataSink::~SortingSNPDataSink() {
+		try {
+			remove_runs() ;
+		} catch( std::exception const& e ) {
+			std::cerr << "!! genfile::SortingSNPDataSink::~SortingSNPDataSink(): failed to remove temporary files: " << e.what() << ".\n" ;
+		}
+	}
+
+	std::string SortingSNPDataSink::get_spec() const {
+		return m_sink->get_spec() ;
+	}
+
+	void SortingSNPDataSink::set_sample_names_impl( std::size_t number_of_samples, SampleNameGetter name_getter ) {
+		m_sink->set_sample_names( number_of_samples, name_getter ) ;
+	}
+
+	void SortingSNPDataSink::set_metadata_impl( Metadata const& metadata ) {
+		m_sink->set_metadata( metadata ) ;
+	}
+
+	void SortingSNPDataSink::write_variant_data_impl(
+		VariantIdentifyingData const& id_data,
+		VariantDataReader& data_reader,
+		Info const& info
+	) {
+		if( m_last_variant && m_comparer( id_data, *m_last_variant )) {
+			m_input_is_sorted = false ;
+			m_batch_is_sorted = false ;
+		}
+		m_last_variant = id_data ;
+
+		m_records.push_back( Record() ) ;
+		Record& record = m_records.back() ;
+		record.id = id_data ;
+		record.info = info ;
+		BufferedVariantDataReader::create( data_reader, m_specs )->serialise( &record.data ) ;
+		m_bytes_used += estimate_bytes_used( record ) ;
+
+		if( m_bytes_used > m_memory_budget ) {
+			spill_batch() ;
+		}
+	}
+
+	std::vector< SortingSNPDataSink::Record const* > SortingSNPDataSink::get_sorted_batch() const {
+		std::vector< Record const* > result( m_records.size() ) ;
+		for( std::size_t i = 0; i < m_records.size(); ++i ) {
+			result[i] = &m_records[i] ;
+		}
+		if( !m_batch_is_sorted ) {
+			std::stable_sort( result.begin(), result.end(), CompareRecords( m_comparer )) ;
+		}
+		return result ;
+	}
+
+	void SortingSNPDataSink::spill_batch() {
+		std::string const filename = create_temporary_filename() ;
+		m_runs.push_back( filename ) ;
+		{
+			RunWriter writer( filename ) ;
+			std::vector< Record const* > const batch = get_sorted_batch() ;
+			for( std::size_t i = 0; i < batch.size(); ++i ) {
+				writer.write( *batch[i] ) ;
+			}
+			writer.close() ;
+		}
+		m_records.clear() ;
+		m_bytes_used = 0 ;
+		m_batch_is_sorted = true ;
+	}
+
+	void SortingSNPDataSink::merge_runs() {
+		std::size_t const buffer_size = get_read_buffer_size( m_memory_budget, m_max_runs_per_merge ) ;
+		while( m_runs.size() >= m_max_runs_per_merge ) {
+			// Merge consecutive groups of runs, so that equal variants keep the order they arrived in.
+			// Merged runs are added to m_runs as they are made, so that they are removed on error.
+			std::size_t const number_of_runs = m_runs.size() ;
+			for( std::size_t i = 0; i < number_of_runs; i += m_max_runs_per_merge ) {
+				std::size_t const end = std::min( i + m_max_runs_per_merge, number_of_runs ) ;
+				if( end == i + 1 ) {
+					std::string const run = m_runs[i] ;
+					m_runs.push_back( run ) ;
+					continue ;
+				}
+				std::string const filename = create_temporary_filename() ;
+				m_runs.push_back( filename ) ;
+				{
+					RunCursors runs ;
+					for( std::size_t j = i; j < end; ++j ) {
+						runs.push_back( boost::shared_ptr< RunCursor >( new RunCursor( m_runs[j], buffer_size ))) ;
+					}
+					RunWriter writer( filename ) ;
+					merge( runs, m_comparer, boost::bind( &RunWriter::write, &writer, _1 )) ;
+					writer.close() ;
+				}
+				for( std::size_t j = i; j < end; ++j ) {
+					remove_file( m_runs[j] ) ;
+				}
+			}
+			m_runs.erase( m_runs.begin(), m_runs.begin() + number_of_runs ) ;
+		}
+	}
+
+	void SortingSNPDataSink::write_runs() {
+		std::size_t const buffer_size = get_read_buffer_size( m_memory_budget, m_max_runs_per_merge ) ;
+		std::vector< Record const* > const batch = get_sorted_batch() ;
+		RecordCallback const callback = boost::bind( &write_to_sink, boost::ref( *m_sink ), _1 ) ;
+		if( m_input_is_sorted ) {
+			// Runs follow each other in order, so just copy them one at a time.
+			for( std::size_t i = 0; i < m_runs.size(); ++i ) {
+				RunCursor run( m_runs[i], buffer_size ) ;
+				copy_run( run, callback ) ;
+			}
+			RunCursor run( batch ) ;
+			copy_run( run, callback ) ;
+		} else {
+			merge_runs() ;
+			RunCursors runs ;
+			for( std::size_t i = 0; i < m_runs.size(); ++i ) {
+				runs.push_back( boost::shared_ptr< RunCursor >( new RunCursor( m_runs[i], buffer_size ))) ;
+			}
+			runs.push_back( boost::shared_ptr< RunCursor >( new RunCursor( batch ))) ;
+			merge( runs, m_comparer, callback ) ;
+		}
+		m_records.clear() ;
+		remove_runs() ;
+	}
+
+	void SortingSNPDataSink::remove_runs() {
+		for( std::size_t i = 0; i < m_runs.size(); ++i ) {
+			remove_file( m_runs[i] ) ;
+		}
+		m_runs.clear() ;
+	}
+
+	void SortingSNPDataSink::finalise_impl() {
+		if( !m_finalised ) {
+			write_runs() ;
+			m_finalised = true ;
+		}
+		m_sink->finalise() ;
+	}
+}
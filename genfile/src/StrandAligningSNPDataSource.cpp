@@ -153,10 +153,13 @@ namespace genfile {
 	}
 
  	VariantDataReader::UniquePtr StrandAligningSNPDataSource::read_variant_data_impl() {
+		VariantDataReader::UniquePtr reader = m_source->read_variant_data() ;
+		// The reader reports fewer samples than the source if a sample selection is in effect.
+		std::size_t const number_of_samples = reader->get_number_of_samples() ;
 		return VariantDataReader::UniquePtr(
 			new AlleleFlippingVariantDataReader(
-				number_of_samples(),
-				m_source->read_variant_data(),
+				number_of_samples,
+				reader,
 				m_current_strand_flip_spec.flip
 			)
 		) ;
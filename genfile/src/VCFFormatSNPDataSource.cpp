@@ -8,6 +8,7 @@
 #include <map>
 #include <set>
 #include <memory>
+#include <algorithm>
 #include <iostream>
 #include <boost/tuple/tuple.hpp>
 #include <boost/bimap.hpp>
@@ -60,7 +61,8 @@ namespace genfile {
 		m_have_id_data( false ),
 		m_strict_mode( true ),
 		m_column_names( read_column_names( *m_stream_ptr )),
-		m_number_of_samples( m_column_names.size() - 9 )
+		m_number_of_samples( m_column_names.size() - 9 ),
+		m_number_of_selected_samples( m_number_of_samples )
 	{
 	}
 
@@ -81,7 +83,8 @@ namespace genfile {
 		m_have_id_data( false ),
 		m_strict_mode( true ),
 		m_column_names( read_column_names( *m_stream_ptr )),
-		m_number_of_samples( m_column_names.size() - 9 )
+		m_number_of_samples( m_column_names.size() - 9 ),
+		m_number_of_selected_samples( m_number_of_samples )
 	{
 	}
 
@@ -350,6 +353,9 @@ namespace genfile {
 					std::getline( *(m_source.m_stream_ptr), data ) ;
 					m_data_reader.reset( new vcf::CallReader( m_source.number_of_samples(), variant_alleles.size(), FORMAT, data, format_types ) ) ;
 					m_data_reader->set_strict_mode( m_source.m_strict_mode ) ;
+					if( m_source.m_sample_selection ) {
+						m_data_reader->set_sample_selection( &m_source.m_sample_selection.get() ) ;
+					}
 				}
 			}
 
@@ -384,7 +390,7 @@ namespace genfile {
 				return *this ;
 			}
 			
-			std::size_t get_number_of_samples() const { return m_source.number_of_samples() ; }
+			std::size_t get_number_of_samples() const { return m_source.m_number_of_selected_samples ; }
 			
 			bool supports( std::string const& spec ) const {
 				return ( spec == ":genotypes:" && m_source.m_genotype_field != "" ) || ( spec == ":intensities:" && m_source.m_intensity_field != "" ) || ( m_field_mapping.left.find( spec ) != m_field_mapping.left.end() ) ;
@@ -469,6 +475,12 @@ namespace genfile {
 		m_have_id_data = false ;
 	}
 
+	bool VCFFormatSNPDataSource::set_sample_selection_impl( SampleSelection const& selection ) {
+		m_sample_selection = selection ;
+		m_number_of_selected_samples = std::count( selection.begin(), selection.end(), true ) ;
+		return true ;
+	}
+
 	void VCFFormatSNPDataSource::reset_to_start_impl() {
 		// seek back to the start and skip over metadata and column names.
 		reset_stream() ;
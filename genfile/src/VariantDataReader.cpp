@@ -9,9 +9,15 @@
 #include "genfile/VariantDataReader.hpp"
 #include "genfile/vcf/get_set.hpp"
 #include "genfile/SingleSNPGenotypeProbabilities.hpp"
+#include "genfile/DecodedVariantData.hpp"
 
 namespace genfile {
 
+	VariantDataReader::VariantDataReader():
+		// Views are only decoded on first use, so constructing these costs no decoding.
+		m_decoded( *this )
+	{}
+
 	VariantDataReader::~VariantDataReader() {}
 
 //	VariantDataReader& VariantDataReader::get( std::string const& spec, std::vector< std::vector< Entry > >& data ) {
@@ -435,11 +435,8 @@ namespace genfile {
 		for( std::size_t i = 0; i < m_fields_to_compare.size(); ++i ) {
 			switch( m_fields_to_compare[i] ) {
 				case ePosition:
-					if( left.get_position() > right.get_position() ) {
-						return false ;
-					}
-					else if( left.get_position() < right.get_position() ) {
-						return true ;
+					if( left.get_position() != right.get_position() ) {
+						return left.get_position() < right.get_position() ;
 					}
 					break ;
 				case eRSID:
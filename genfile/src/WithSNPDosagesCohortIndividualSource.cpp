@@ -60,6 +60,10 @@ namespace genfile {
 	bool PositionMatchesTest::operator()( VariantIdentifyingData const& data ) const {
 		return data.get_position() == m_position ;
 	}
+
+	bool PositionMatchesTest::may_pass( VariantIdentifyingDataView const& view ) const {
+		return view.position == m_position ;
+	}
 		
 	std::string PositionMatchesTest::display() const {
 		return "position=" + genfile::string_utils::to_string( m_position ) ;
@@ -0,0 +1,47 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include "genfile/bgen/Query.hpp"
+
+namespace genfile {
+	namespace bgen {
+		Query::UniquePtr Query::create() {
+			return Query::UniquePtr( new Query() ) ;
+		}
+
+		Query& Query::include_range( GenomicRange const& range ) {
+			m_included_ranges.push_back( range ) ;
+			return *this ;
+		}
+
+		Query& Query::exclude_range( GenomicRange const& range ) {
+			m_excluded_ranges.push_back( range ) ;
+			return *this ;
+		}
+
+		Query& Query::include_ranges( std::vector< GenomicRange > const& ranges ) {
+			m_included_ranges.insert( m_included_ranges.end(), ranges.begin(), ranges.end() ) ;
+			return *this ;
+		}
+
+		Query& Query::exclude_ranges( std::vector< GenomicRange > const& ranges ) {
+			m_excluded_ranges.insert( m_excluded_ranges.end(), ranges.begin(), ranges.end() ) ;
+			return *this ;
+		}
+
+		Query& Query::include_rsids( std::vector< std::string > const& ids ) {
+			m_included_rsids.insert( m_included_rsids.end(), ids.begin(), ids.end() ) ;
+			return *this ;
+		}
+
+		Query& Query::exclude_rsids( std::vector< std::string > const& ids ) {
+			m_excluded_rsids.insert( m_excluded_rsids.end(), ids.begin(), ids.end() ) ;
+			return *this ;
+		}
+	}
+}
@@ -4,6 +4,7 @@
 //    (See accompanying file LICENSE_1_0.txt or copy at
 //          http://www.boost.org/LICENSE_1_0.txt)
 
+#include <algorithm>
 #include "genfile/vcf/CallReader.hpp"
 #include "genfile/vcf/Types.hpp"
 #include "genfile/string_utils.hpp"
@@ -60,7 +61,9 @@ namespace genfile {
 			m_data( data ),
 			m_entry_types( entry_types ),
 			m_entries_by_position( impl::get_entries_by_position( m_format_elts, entry_types )),
-			m_strict_mode( true )
+			m_strict_mode( true ),
+			m_sample_selection( 0 ),
+			m_number_of_selected_samples( number_of_samples )
 		{
 			if( m_number_of_alleles == 0 ) {
 				throw BadArgumentError( "genfile::vcf::CallReader::CallReader()", "number_of_alleles = " + string_utils::to_string( number_of_alleles ) ) ;
@@ -80,6 +83,15 @@ namespace genfile {
 			m_strict_mode = value ;
 		}
 
+		void CallReader::set_sample_selection( std::vector< bool > const* selection ) {
+			assert( m_components.empty() ) ;
+			assert( !selection || selection->size() == m_number_of_samples ) ;
+			m_sample_selection = selection ;
+			m_number_of_selected_samples = selection
+				? std::count( selection->begin(), selection->end(), true )
+				: m_number_of_samples ;
+		}
+
 		namespace impl {
 			struct CallReaderGenotypeSetter: public CallReader::Setter {
 				CallReaderGenotypeSetter(
@@ -184,11 +196,14 @@ namespace genfile {
 				if( spec == "GT" ) {
 					assert( m_ploidy.size() > 0 ) ;
 					std::size_t index = 0 ;
-					setter.initialise( m_number_of_samples, m_number_of_alleles ) ;
-					for( std::size_t sample_i = 0; sample_i < m_number_of_samples; ++sample_i ) {
+					setter.initialise( m_number_of_selected_samples, m_number_of_alleles ) ;
+					for( std::size_t sample_i = 0, selected_i = 0; sample_i < m_number_of_samples; ++sample_i ) {
 						std::size_t const ploidy = m_ploidy[ sample_i ] ;
 						assert( m_genotype_calls.size() >= ( index + ploidy ) ) ;
-						setter.set_sample( sample_i ) ;
+						if( !is_selected( sample_i ) || !setter.set_sample( selected_i++ ) ) {
+							index += ploidy ;
+							continue ;
+						}
 						setter.set_number_of_entries(
 							ploidy, ploidy,
 							m_order_types[ sample_i ],
@@ -205,13 +220,15 @@ namespace genfile {
 					setter.finalise() ;
 				}
 				else {
-					setter.initialise( m_number_of_samples, m_number_of_alleles ) ;
+					setter.initialise( m_number_of_selected_samples, m_number_of_alleles ) ;
 					for(
-						std::size_t sample_i = 0, component_index = 0;
+						std::size_t sample_i = 0, selected_i = 0, component_index = 0;
 						sample_i < m_number_of_samples;
 						component_index += m_component_counts[ sample_i++ ]
 					) {
-						setter.set_sample( sample_i ) ;
+						if( !is_selected( sample_i ) || !setter.set_sample( selected_i++ ) ) {
+							continue ;
+						}
 						assert( m_components.size() >= ( component_index + m_component_counts[ sample_i ] ) ) ;
 						set_values(
 							sample_i,
@@ -239,7 +256,7 @@ namespace genfile {
 			m_components.reserve( m_number_of_samples ) ;
 			for( std::size_t sample_i = 0; sample_i < elts.size(); ++sample_i ) {
 				std::size_t const current_size = m_components.size() ;
-				if( elts[ sample_i ].size() > 0 ) {
+				if( elts[ sample_i ].size() > 0 && is_selected( sample_i ) ) {
 					elts[ sample_i ].split( ":", &m_components ) ;
 				}
 				m_component_counts.push_back( m_components.size() - current_size ) ;
@@ -277,6 +294,10 @@ namespace genfile {
 				sample_i < m_number_of_samples;
 				component_index += m_component_counts[ sample_i++ ]
 			) {
+				if( !is_selected( sample_i )) {
+					m_ploidy[ sample_i ] = 0 ;
+					continue ;
+				}
 				try {
 					genotype_setter.set_sample( sample_i ) ;
 					m_genotype_call_entry_type.parse( m_components[ component_index + GT_field_pos ], m_number_of_alleles, eUnknownPloidy, genotype_setter ) ;
@@ -0,0 +1,268 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include "test_case.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/BedFileSNPDataSource.hpp"
+#include "genfile/GenomePositionRange.hpp"
+#include "genfile/vcf/Types.hpp"
+
+AUTO_TEST_SUITE( test_bed_file_snp_data_source )
+
+namespace {
+	std::size_t const number_of_samples = 6 ;
+	std::size_t const number_of_variants = 6 ;
+	char const* const chromosomes[] = { "1", "1", "1", "2", "2", "3" } ;
+	int const positions[] = { 100, 200, 300, 150, 250, 100 } ;
+
+	// The 2-bit BED code of sample i at variant v.
+	int get_code( std::size_t v, std::size_t i ) {
+		return ( v + i ) % 4 ;
+	}
+
+	struct BedFiles {
+		BedFiles() {
+			std::string const stub = genfile::create_temporary_filename() ;
+			bed = stub + ".bed" ;
+			bim = stub + ".bim" ;
+			fam = stub + ".fam" ;
+			{
+				std::ofstream fam_file( fam.c_str() ) ;
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					fam_file << "F" << i << " S" << i << " 0 0 0 -9\n" ;
+				}
+			}
+			{
+				std::ofstream bim_file( bim.c_str() ) ;
+				for( std::size_t v = 0; v < number_of_variants; ++v ) {
+					bim_file << chromosomes[v] << "\trs" << v << "\t0\t" << positions[v] << "\tA\tG\n" ;
+				}
+			}
+			{
+				std::ofstream bed_file( bed.c_str(), std::ios::binary ) ;
+				char const header[3] = { 108, 27, 1 } ;
+				bed_file.write( header, 3 ) ;
+				for( std::size_t v = 0; v < number_of_variants; ++v ) {
+					std::vector< char > record( ( number_of_samples + 3 ) / 4, 0 ) ;
+					for( std::size_t i = 0; i < number_of_samples; ++i ) {
+						record[ i / 4 ] |= char( get_code( v, i ) << ( 2 * ( i % 4 ))) ;
+					}
+					bed_file.write( &record[0], record.size() ) ;
+				}
+			}
+		}
+
+		std::string bed, bim, fam ;
+	} ;
+
+	// Record genotypes as BED codes so they can be compared directly.
+	struct CodeSetter: public genfile::VariantDataReader::PerSampleSetter {
+		CodeSetter( std::vector< int >* codes ): m_codes( codes ) {}
+		void initialise( std::size_t nSamples, std::size_t ) { m_codes->assign( nSamples, -1 ) ; }
+		bool set_sample( std::size_t i ) { m_sample = i ; return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) { m_count = 0 ; m_sum = 0 ; }
+		void set_value( std::size_t, genfile::MissingValue const ) { (*m_codes)[ m_sample ] = 1 ; }
+		void set_value( std::size_t, genfile::Integer const value ) {
+			m_sum += value ;
+			if( ++m_count == 2 ) {
+				(*m_codes)[ m_sample ] = ( m_sum == 0 ) ? 0 : ( m_sum == 1 ? 2 : 3 ) ;
+			}
+		}
+		void finalise() {}
+	private:
+		std::vector< int >* m_codes ;
+		std::size_t m_sample ;
+		int m_count ;
+		int m_sum ;
+	} ;
+
+	// Read all variants from the source and check their data; return the rsids read.
+	std::vector< std::size_t > read_and_check( genfile::SNPDataSource& source ) {
+		std::vector< std::size_t > result ;
+		genfile::VariantIdentifyingData variant ;
+		std::vector< int > codes ;
+		while( source.get_snp_identifying_data( &variant ) ) {
+			std::size_t const v = genfile::string_utils::to_repr< std::size_t >( std::string( variant.get_primary_id() ).substr( 2 ) ) ;
+			TEST_ASSERT( variant.get_position() == genfile::GenomePosition( genfile::Chromosome( chromosomes[v] ), positions[v] ) ) ;
+			TEST_ASSERT( variant.get_allele(0) == "A" && variant.get_allele(1) == "G" ) ;
+			CodeSetter setter( &codes ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+			TEST_ASSERT( codes.size() == number_of_samples ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				BOOST_CHECK_EQUAL( codes[i], get_code( v, i ) ) ;
+			}
+			result.push_back( v ) ;
+		}
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_bed_file_streaming ) {
+	BedFiles files ;
+	genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+	TEST_ASSERT( source.number_of_samples() == number_of_samples ) ;
+	TEST_ASSERT( source.number_of_variants_in_file() == number_of_variants ) ;
+	TEST_ASSERT( *source.total_number_of_snps() == number_of_variants ) ;
+	TEST_ASSERT( source.get_variant( 4 ) == genfile::VariantIdentifyingData( "rs4", genfile::GenomePosition( genfile::Chromosome( "2" ), 250 ), "A", "G" ) ) ;
+	std::vector< std::size_t > const visited = read_and_check( source ) ;
+	TEST_ASSERT( visited.size() == number_of_variants ) ;
+	for( std::size_t v = 0; v < visited.size(); ++v ) {
+		TEST_ASSERT( visited[v] == v ) ;
+	}
+
+	// Skipping variants must not disturb later reads.
+	source.reset_to_start() ;
+	genfile::VariantIdentifyingData variant ;
+	std::vector< int > codes ;
+	TEST_ASSERT( source.get_snp_identifying_data( &variant )) ;
+	source.ignore_snp_probability_data() ;
+	TEST_ASSERT( source.get_snp_identifying_data( &variant )) ;
+	source.ignore_snp_probability_data() ;
+	TEST_ASSERT( source.get_snp_identifying_data( &variant )) ;
+	CodeSetter setter( &codes ) ;
+	source.read_variant_data()->get( ":genotypes:", setter ) ;
+	for( std::size_t i = 0; i < number_of_samples; ++i ) {
+		BOOST_CHECK_EQUAL( codes[i], get_code( 2, i ) ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_bed_file_reread_after_reset ) {
+	BedFiles files ;
+	genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+	genfile::VariantIdentifyingData variant ;
+
+	// Read the first variant only, then reset and read everything twice.
+	std::vector< int > first_codes ;
+	{
+		TEST_ASSERT( source.get_snp_identifying_data( &variant )) ;
+		CodeSetter setter( &first_codes ) ;
+		source.read_variant_data()->get( ":genotypes:", setter ) ;
+	}
+	std::vector< std::vector< int > > passes[2] ;
+	for( std::size_t pass = 0; pass < 2; ++pass ) {
+		source.reset_to_start() ;
+		while( source.get_snp_identifying_data( &variant )) {
+			std::vector< int > codes ;
+			CodeSetter setter( &codes ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+			passes[pass].push_back( codes ) ;
+		}
+	}
+	TEST_ASSERT( passes[0].size() == number_of_variants ) ;
+	TEST_ASSERT( passes[0] == passes[1] ) ;
+	TEST_ASSERT( passes[0][0] == first_codes ) ;
+	for( std::size_t v = 0; v < number_of_variants; ++v ) {
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			BOOST_CHECK_EQUAL( passes[0][v][i], get_code( v, i ) ) ;
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_bed_file_restriction ) {
+	BedFiles files ;
+	{
+		genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+		std::vector< genfile::GenomePositionRange > ranges ;
+		ranges.push_back( genfile::GenomePositionRange::parse( "1:150-300" )) ;
+		ranges.push_back( genfile::GenomePositionRange::parse( "3:1-100" )) ;
+		TEST_ASSERT( source.restrict_to_ranges( ranges ) == 3 ) ;
+		TEST_ASSERT( *source.total_number_of_snps() == 3 ) ;
+		std::vector< std::size_t > const visited = read_and_check( source ) ;
+		TEST_ASSERT( visited.size() == 3 ) ;
+		TEST_ASSERT( visited[0] == 1 && visited[1] == 2 && visited[2] == 5 ) ;
+
+		// Restrictions narrow the current set.
+		ranges.clear() ;
+		ranges.push_back( genfile::GenomePositionRange::parse( "1:250-1000" )) ;
+		TEST_ASSERT( source.restrict_to_ranges( ranges ) == 1 ) ;
+		TEST_ASSERT( read_and_check( source ) == std::vector< std::size_t >( 1, 2 ) ) ;
+	}
+	{
+		// A range without a chromosome applies to all chromosomes.
+		genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+		std::vector< genfile::GenomePositionRange > ranges ;
+		ranges.push_back( genfile::GenomePositionRange::parse( "100-150" )) ;
+		TEST_ASSERT( source.restrict_to_ranges( ranges ) == 3 ) ;
+		std::vector< std::size_t > const visited = read_and_check( source ) ;
+		TEST_ASSERT( visited.size() == 3 ) ;
+		TEST_ASSERT( visited[0] == 0 && visited[1] == 3 && visited[2] == 5 ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_bed_file_packed_genotypes ) {
+	BedFiles files ;
+	genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+	std::size_t const bytes = source.number_of_bytes_per_variant() ;
+	TEST_ASSERT( bytes == 2 ) ;
+
+	// Read a block in the middle of streaming; streaming should continue unaffected.
+	genfile::VariantIdentifyingData variant ;
+	TEST_ASSERT( source.get_snp_identifying_data( &variant )) ;
+
+	std::vector< char > packed ;
+	source.read_packed_genotypes( 2, 3, &packed ) ;
+	TEST_ASSERT( packed.size() == 3 * bytes ) ;
+	for( std::size_t k = 0; k < 3; ++k ) {
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			int const code = ( packed[ k * bytes + i / 4 ] >> ( 2 * ( i % 4 ))) & 0x3 ;
+			BOOST_CHECK_EQUAL( code, get_code( 2 + k, i ) ) ;
+		}
+	}
+
+	std::vector< int > codes ;
+	CodeSetter setter( &codes ) ;
+	source.read_variant_data()->get( ":genotypes:", setter ) ;
+	for( std::size_t i = 0; i < number_of_samples; ++i ) {
+		BOOST_CHECK_EQUAL( codes[i], get_code( 0, i ) ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_bed_file_sample_selection ) {
+	BedFiles files ;
+	std::vector< std::vector< int > > all_codes ;
+	{
+		genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+		genfile::VariantIdentifyingData variant ;
+		while( source.get_snp_identifying_data( &variant )) {
+			all_codes.push_back( std::vector< int >() ) ;
+			CodeSetter setter( &all_codes.back() ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+		}
+	}
+	TEST_ASSERT( all_codes.size() == number_of_variants ) ;
+
+	for( std::size_t subset = 0; subset < ( 1u << number_of_samples ); ++subset ) {
+		genfile::SNPDataSource::SampleSelection selection( number_of_samples ) ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			selection[i] = subset & ( 1u << i ) ;
+		}
+		genfile::BedFileSNPDataSource source( files.bed, files.bim, files.fam ) ;
+		TEST_ASSERT( source.set_sample_selection( selection )) ;
+		genfile::VariantIdentifyingData variant ;
+		std::size_t v = 0 ;
+		for( ; source.get_snp_identifying_data( &variant ); ++v ) {
+			std::vector< int > codes ;
+			CodeSetter setter( &codes ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+			std::vector< int > expected ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				if( selection[i] ) {
+					expected.push_back( all_codes[v][i] ) ;
+				}
+			}
+			TEST_ASSERT( codes == expected ) ;
+		}
+		TEST_ASSERT( v == number_of_variants ) ;
+	}
+}
+
+AUTO_TEST_SUITE_END()
@@ -0,0 +1,253 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <set>
+#include <boost/bind.hpp>
+#include "test_case.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/SNPDataSink.hpp"
+#include "genfile/BGenFileSNPDataSink.hpp"
+#include "genfile/BGenFileSNPDataSource.hpp"
+#include "genfile/CommonSNPFilter.hpp"
+#include "genfile/GenomePositionRange.hpp"
+#include "genfile/SNPIDMatchesTest.hpp"
+#include "genfile/WithSNPDosagesCohortIndividualSource.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+
+AUTO_TEST_SUITE( test_bgen_file_snp_data_source )
+
+namespace {
+	std::size_t const number_of_samples = 4 ;
+	std::size_t const number_of_variants = 6 ;
+	char const* const chromosomes[] = { "1", "1", "1", "2", "2", "" } ;
+	int const positions[] = { 100, 200, 300, 150, 250, 100 } ;
+
+	// Sample i at variant v has genotype ( v + i ) % 3 with certainty.
+	double get_probability( std::size_t v, std::size_t g, std::size_t i ) {
+		return ( ( v + i ) % 3 == g ) ? 1.0 : 0.0 ;
+	}
+
+	genfile::VariantEntry get_sample_name( std::size_t i ) {
+		return "S" + genfile::string_utils::to_string( i ) ;
+	}
+
+	std::string write_bgen_file() {
+		std::string const filename = genfile::create_temporary_filename() + ".bgen" ;
+		genfile::SNPDataSink::UniquePtr sink = genfile::SNPDataSink::create( filename ) ;
+		sink->set_sample_names( number_of_samples, &get_sample_name ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			std::string const index = genfile::string_utils::to_string( v ) ;
+			sink->write_snp(
+				number_of_samples,
+				"snp" + index, "rs" + index,
+				genfile::Chromosome( chromosomes[v] ), positions[v],
+				"A", "G",
+				boost::bind( &get_probability, v, 0, _1 ),
+				boost::bind( &get_probability, v, 1, _1 ),
+				boost::bind( &get_probability, v, 2, _1 )
+			) ;
+		}
+		sink->finalise() ;
+		return filename ;
+	}
+
+	struct GenotypeSetter: public genfile::VariantDataReader::PerSampleSetter {
+		GenotypeSetter( std::vector< int >* genotypes ): m_genotypes( genotypes ) {}
+		void initialise( std::size_t nSamples, std::size_t ) { m_genotypes->assign( nSamples, -1 ) ; }
+		bool set_sample( std::size_t i ) { m_sample = i ; return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) {}
+		void set_value( std::size_t, genfile::MissingValue const ) {}
+		void set_value( std::size_t g, double const value ) {
+			if( value > 0.5 ) {
+				(*m_genotypes)[ m_sample ] = g ;
+			}
+		}
+		void finalise() {}
+	private:
+		std::vector< int >* m_genotypes ;
+		std::size_t m_sample ;
+	} ;
+
+	// Read all visible variants, returning their rsids and checking their genotypes.
+	std::vector< std::string > read_variants( genfile::SNPDataSource& source ) {
+		std::vector< std::string > result ;
+		genfile::VariantIdentifyingData variant ;
+		std::vector< int > genotypes ;
+		while( source.get_snp_identifying_data( &variant )) {
+			result.push_back( variant.get_primary_id() ) ;
+			std::size_t const v = genfile::string_utils::to_repr< std::size_t >( std::string( variant.get_primary_id() ).substr( 2 )) ;
+			BOOST_CHECK_EQUAL( variant.get_position().position(), positions[v] ) ;
+			BOOST_CHECK_EQUAL( variant.get_allele( 1 ), "G" ) ;
+			GenotypeSetter setter( &genotypes ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				BOOST_CHECK_EQUAL( genotypes[i], int( ( v + i ) % 3 )) ;
+			}
+		}
+		return result ;
+	}
+
+	// Probabilities that vary by sample, so that skipping a sample by the wrong number of bits shows up.
+	double get_varying_probability( std::size_t v, std::size_t g, std::size_t i ) {
+		double const AA = (( v * 7 + i * 3 ) % 5 ) / 10.0 ;
+		double const AB = (( v + 2 * i ) % 4 ) / 10.0 ;
+		return ( g == 0 ) ? AA : (( g == 1 ) ? AB : ( 1.0 - AA - AB )) ;
+	}
+
+	std::string write_varying_bgen_file( std::size_t number_of_samples, int number_of_bits ) {
+		std::string const filename = genfile::create_temporary_filename() + ".bgen" ;
+		genfile::BGenFileSNPDataSink sink( filename, genfile::SNPDataSink::Metadata(), "v12", number_of_bits ) ;
+		sink.set_sample_names( number_of_samples, &get_sample_name ) ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			std::string const index = genfile::string_utils::to_string( v ) ;
+			sink.write_snp(
+				number_of_samples,
+				"snp" + index, "rs" + index,
+				genfile::Chromosome( "1" ), positions[v],
+				"A", "G",
+				boost::bind( &get_varying_probability, v, 0, _1 ),
+				boost::bind( &get_varying_probability, v, 1, _1 ),
+				boost::bind( &get_varying_probability, v, 2, _1 )
+			) ;
+		}
+		sink.finalise() ;
+		return filename ;
+	}
+
+	// Record each sample's probabilities; missing values are recorded as -1.
+	struct ProbabilitySetter: public genfile::VariantDataReader::PerSampleSetter {
+		typedef std::vector< std::vector< double > > Probabilities ;
+		ProbabilitySetter( Probabilities* probabilities ): m_probabilities( probabilities ) {}
+		void initialise( std::size_t nSamples, std::size_t ) { m_probabilities->assign( nSamples, std::vector< double >() ) ; }
+		bool set_sample( std::size_t i ) { m_sample = i ; return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) {}
+		void set_value( std::size_t, genfile::MissingValue const ) { (*m_probabilities)[ m_sample ].push_back( -1 ) ; }
+		void set_value( std::size_t, double const value ) { (*m_probabilities)[ m_sample ].push_back( value ) ; }
+		void finalise() {}
+	private:
+		Probabilities* m_probabilities ;
+		std::size_t m_sample ;
+	} ;
+
+	std::vector< ProbabilitySetter::Probabilities > read_probabilities( genfile::SNPDataSource& source ) {
+		std::vector< ProbabilitySetter::Probabilities > result ;
+		genfile::VariantIdentifyingData variant ;
+		while( source.get_snp_identifying_data( &variant )) {
+			result.push_back( ProbabilitySetter::Probabilities() ) ;
+			ProbabilitySetter setter( &result.back() ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+		}
+		return result ;
+	}
+
+	std::string join( std::vector< std::string > const& values ) {
+		return genfile::string_utils::join( values, " " ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_prefilter ) {
+	std::string const filename = write_bgen_file() ;
+
+	{
+		genfile::BGenFileSNPDataSource source( filename, genfile::Chromosome( "3" )) ;
+		BOOST_CHECK_EQUAL( join( read_variants( source )), "rs0 rs1 rs2 rs3 rs4 rs5" ) ;
+	}
+
+	genfile::CommonSNPFilter filter ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "1:150-300" )) ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "2:1-200" )) ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "3:1-200" )) ;
+	std::set< std::string > excluded ;
+	excluded.insert( "snp2" ) ;
+	filter.exclude_snps_in_set( excluded, genfile::CommonSNPFilter::SNPIDs ) ;
+
+	{
+		// The variant with no chromosome takes the source's missing chromosome.
+		genfile::BGenFileSNPDataSource source( filename, genfile::Chromosome( "3" )) ;
+		source.set_prefilter( filter ) ;
+		BOOST_CHECK( !source.total_number_of_snps() ) ;
+		BOOST_CHECK_EQUAL( join( read_variants( source )), "rs1 rs3 rs5" ) ;
+		source.reset_to_start() ;
+		BOOST_CHECK_EQUAL( join( read_variants( source )), "rs1 rs3 rs5" ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_restrict_to_offsets ) {
+	std::string const filename = write_bgen_file() ;
+	std::vector< int64_t > offsets ;
+	{
+		genfile::BGenFileSNPDataSource source( filename ) ;
+		genfile::VariantIdentifyingData variant ;
+		for( offsets.push_back( source.stream().tellg() ); source.get_snp_identifying_data( &variant ); offsets.push_back( source.stream().tellg() )) {
+			source.ignore_snp_probability_data() ;
+		}
+	}
+	BOOST_CHECK_EQUAL( offsets.size(), number_of_variants + 1 ) ;
+
+	genfile::BGenFileSNPDataSource source( filename ) ;
+	std::vector< int64_t > visited ;
+	visited.push_back( offsets[4] ) ;
+	visited.push_back( offsets[1] ) ;
+	source.restrict_to_offsets( visited ) ;
+	BOOST_CHECK_EQUAL( source.total_number_of_snps().get(), 2 ) ;
+	BOOST_CHECK_EQUAL( join( read_variants( source )), "rs1 rs4" ) ;
+	BOOST_CHECK( !source ) ;
+
+	// Tests of IDs and positions, as used by -condition-on, can be used as prefilters too.
+	genfile::VariantIdentifyingDataTestDisjunction test ;
+	test.add_subtest( genfile::VariantIdentifyingDataTest::UniquePtr( new genfile::SNPIDMatchesTest( "rsid~rs4" ))) ;
+	test.add_subtest( genfile::VariantIdentifyingDataTest::UniquePtr( new genfile::SNPIDMatchesTest( "snpid~snp%" ))) ;
+	source.set_prefilter( test ) ;
+	source.reset_to_start() ;
+	BOOST_CHECK_EQUAL( join( read_variants( source )), "rs1 rs4" ) ;
+
+	genfile::BGenFileSNPDataSource unrestricted( filename ) ;
+	genfile::VariantIdentifyingDataTestDisjunction position_test ;
+	position_test.add_subtest( genfile::VariantIdentifyingDataTest::UniquePtr( new genfile::PositionMatchesTest( genfile::GenomePosition( "2:250" )))) ;
+	position_test.add_subtest( genfile::VariantIdentifyingDataTest::UniquePtr( new genfile::SNPIDMatchesTest( "rsid~rs%0" ))) ;
+	unrestricted.set_prefilter( position_test ) ;
+	BOOST_CHECK_EQUAL( join( read_variants( unrestricted )), "rs0 rs4" ) ;
+}
+
+AUTO_TEST_CASE( test_sample_selection ) {
+	// 5-bit values use the generic bit parser; 8- and 16-bit values have their own parsers.
+	std::size_t const number_of_samples = 7 ;
+	int const bit_depths[] = { 5, 8, 16 } ;
+	for( std::size_t b = 0; b < 3; ++b ) {
+		std::string const filename = write_varying_bgen_file( number_of_samples, bit_depths[b] ) ;
+		std::vector< ProbabilitySetter::Probabilities > all_data ;
+		{
+			genfile::BGenFileSNPDataSource source( filename ) ;
+			all_data = read_probabilities( source ) ;
+		}
+		BOOST_CHECK_EQUAL( all_data.size(), number_of_variants ) ;
+		BOOST_CHECK_EQUAL( all_data[0].size(), number_of_samples ) ;
+
+		for( std::size_t subset = 0; subset < ( 1u << number_of_samples ); ++subset ) {
+			genfile::SNPDataSource::SampleSelection selection( number_of_samples ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				selection[i] = subset & ( 1u << i ) ;
+			}
+			genfile::BGenFileSNPDataSource source( filename ) ;
+			BOOST_CHECK( source.set_sample_selection( selection )) ;
+			std::vector< ProbabilitySetter::Probabilities > const selected_data = read_probabilities( source ) ;
+			BOOST_CHECK_EQUAL( selected_data.size(), all_data.size() ) ;
+			for( std::size_t v = 0; v < selected_data.size(); ++v ) {
+				ProbabilitySetter::Probabilities expected ;
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					if( selection[i] ) {
+						expected.push_back( all_data[v][i] ) ;
+					}
+				}
+				BOOST_CHECK( selected_data[v] == expected ) ;
+			}
+		}
+	}
+}
+
+AUTO_TEST_SUITE_END()
@@ -0,0 +1,146 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <cmath>
+#include <boost/bind.hpp>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/BufferedVariantDataReader.hpp"
+#include "genfile/Error.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_buffered_variant_data_reader )
+
+namespace {
+	std::size_t const number_of_samples = 1000 ;
+
+	// Reader producing hard-called probabilities for "GP", and a mixture of all kinds of
+	// setter call for "XX".  Like real readers, values are not set for samples the setter declines.
+	struct TestReader: public genfile::VariantDataReader {
+		TestReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			if( spec == "GP" ) {
+				setter.initialise( number_of_samples, 2 ) ;
+				for( std::size_t i = 0; i < number_of_samples; ++i ) {
+					if( setter.set_sample( i )) {
+						setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+						for( std::size_t g = 0; g < 3; ++g ) {
+							setter.set_value( g, ( i % 3 == g ) ? 1.0 : 0.0 ) ;
+						}
+					}
+				}
+				setter.finalise() ;
+			} else if( spec == "XX" ) {
+				setter.initialise( 4, 3 ) ;
+				if( setter.set_sample( 0 )) {
+					setter.set_number_of_entries( 1, 2, genfile::ePerPhasedHaplotypePerAllele, genfile::eAlleleIndex ) ;
+					setter.set_value( 0, genfile::VariantEntry::Integer( -5 )) ;
+					setter.set_value( 1, genfile::VariantEntry::Integer( std::numeric_limits< int64_t >::max() )) ;
+				}
+				if( setter.set_sample( 2 )) {
+					setter.set_number_of_entries( 2, 4, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					setter.set_value( 0, -0.0 ) ;
+					setter.set_value( 1, 0.25 ) ;
+					setter.set_value( 3, genfile::MissingValue() ) ;
+					setter.set_value( 2, std::numeric_limits< double >::infinity() ) ;
+				}
+				if( setter.set_sample( 1 )) {
+					setter.set_number_of_entries( 2, 4, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					std::string value = "a string" ;
+					setter.set_value( 0, value ) ;
+					setter.set_value( 1, genfile::VariantEntry::Integer( std::numeric_limits< int64_t >::min() )) ;
+				}
+				if( setter.set_sample( 3 )) {
+					setter.set_number_of_entries( 2, 300, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+					setter.set_value( 299, 1.0 ) ;
+				}
+				setter.finalise() ;
+			} else {
+				throw genfile::BadArgumentError( "TestReader::get()", "spec=\"" + spec + "\"" ) ;
+			}
+			return *this ;
+		}
+
+		bool supports( std::string const& spec ) const {
+			return spec == "GP" || spec == "XX" ;
+		}
+
+		void get_supported_specs( SpecSetter setter ) const {
+			setter( "GP", "Float" ) ;
+			setter( "XX", "Float" ) ;
+		}
+
+		std::size_t get_number_of_samples() const { return number_of_samples ; }
+	} ;
+
+	// Setter logging each call it receives, optionally declining odd-numbered samples.
+	struct LoggingSetter: public genfile::VariantDataReader::PerSampleSetter {
+		LoggingSetter( bool odd_samples = true ): m_odd_samples( odd_samples ) {}
+		void initialise( std::size_t nSamples, std::size_t nAlleles ) { m_log << "initialise(" << nSamples << "," << nAlleles << ")\n" ; }
+		bool set_sample( std::size_t i ) {
+			m_log << "set_sample(" << i << ")\n" ;
+			return m_odd_samples || ( i % 2 == 0 ) ;
+		}
+		void set_number_of_entries( uint32_t ploidy, std::size_t n, genfile::OrderType const order_type, genfile::ValueType const value_type ) {
+			m_log << "set_number_of_entries(" << ploidy << "," << n << "," << order_type << "," << value_type << ")\n" ;
+		}
+		void set_value( std::size_t i, genfile::MissingValue const ) { m_log << "missing(" << i << ")\n" ; }
+		void set_value( std::size_t i, std::string& value ) { m_log << "string(" << i << "," << value << ")\n" ; }
+		void set_value( std::size_t i, Integer const value ) { m_log << "integer(" << i << "," << value << ")\n" ; }
+		void set_value( std::size_t i, double const value ) {
+			// Distinguish -0.0 from 0.0.
+			m_log << "double(" << i << "," << value << "," << std::signbit( value ) << ")\n" ;
+		}
+		void finalise() { m_log << "finalise()\n" ; }
+		std::string log() const { return m_log.str() ; }
+	private:
+		bool const m_odd_samples ;
+		std::ostringstream m_log ;
+	} ;
+
+	std::string get_log( genfile::VariantDataReader& reader, std::string const& spec, bool odd_samples ) {
+		LoggingSetter setter( odd_samples ) ;
+		reader.get( spec, setter ) ;
+		return setter.log() ;
+	}
+}
+
+AUTO_TEST_CASE( test_replay ) {
+	TestReader reader ;
+	genfile::BufferedVariantDataReader::UniquePtr buffered = genfile::BufferedVariantDataReader::create( reader ) ;
+	std::vector< uint8_t > serialised ;
+	buffered->serialise( &serialised ) ;
+	genfile::BufferedVariantDataReader::UniquePtr deserialised = genfile::BufferedVariantDataReader::deserialise(
+		&serialised[0], &serialised[0] + serialised.size()
+	) ;
+
+	char const* specs[] = { "GP", "XX" } ;
+	for( std::size_t i = 0; i < 2; ++i ) {
+		BOOST_CHECK( buffered->supports( specs[i] )) ;
+		BOOST_CHECK( deserialised->supports( specs[i] )) ;
+		for( int odd_samples = 0; odd_samples < 2; ++odd_samples ) {
+			std::string const expected = get_log( reader, specs[i], odd_samples ) ;
+			BOOST_CHECK_EQUAL( get_log( *buffered, specs[i], odd_samples ), expected ) ;
+			BOOST_CHECK_EQUAL( get_log( *deserialised, specs[i], odd_samples ), expected ) ;
+		}
+	}
+	BOOST_CHECK_EQUAL( deserialised->get_number_of_samples(), number_of_samples ) ;
+}
+
+AUTO_TEST_CASE( test_spec_selection_and_size ) {
+	TestReader reader ;
+	std::vector< std::string > specs( 1, "GP" ) ;
+	genfile::BufferedVariantDataReader::UniquePtr buffered = genfile::BufferedVariantDataReader::create( reader, specs ) ;
+	BOOST_CHECK( buffered->supports( "GP" )) ;
+	BOOST_CHECK( !buffered->supports( "XX" )) ;
+	BOOST_CHECK_THROW( get_log( *buffered, "XX", true ), genfile::BadArgumentError ) ;
+	// Hard calls take one byte for each setter call.
+	BOOST_CHECK_LT( buffered->get_memory_usage(), 6 * number_of_samples ) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <set>
+#include <boost/lexical_cast.hpp>
+#include "genfile/CommonSNPFilter.hpp"
+#include "genfile/FlatStringSet.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_common_snp_filter )
+
+namespace {
+	genfile::VariantIdentifyingData make_snp( std::string const& snpid, std::string const& rsid, std::string const& chromosome, genfile::Position position ) {
+		return genfile::VariantIdentifyingData( snpid, rsid, genfile::GenomePosition( genfile::Chromosome( chromosome ), position ), "A", "G" ) ;
+	}
+
+	std::set< std::string > make_set( std::string const& a, std::string const& b = "" ) {
+		std::set< std::string > result ;
+		result.insert( a ) ;
+		if( b != "" ) {
+			result.insert( b ) ;
+		}
+		return result ;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_string_set ) {
+	genfile::FlatStringSet set ;
+	BOOST_CHECK( !set.contains( "rs1" )) ;
+	for( std::size_t i = 0; i < 10000; ++i ) {
+		BOOST_CHECK( set.insert( "rs" + boost::lexical_cast< std::string >( i ))) ;
+	}
+	BOOST_CHECK( !set.insert( "rs10" )) ;
+	BOOST_CHECK( set.insert( "" )) ;
+	BOOST_CHECK_EQUAL( set.size(), 10001 ) ;
+	for( std::size_t i = 0; i < 10000; ++i ) {
+		BOOST_CHECK( set.contains( "rs" + boost::lexical_cast< std::string >( i ))) ;
+		BOOST_CHECK( !set.contains( "rs" + boost::lexical_cast< std::string >( i + 10000 ))) ;
+	}
+	BOOST_CHECK( set.contains( "" )) ;
+	BOOST_CHECK( !set.contains( "r" )) ;
+	std::vector< std::string > const values = set.get_values( 2 ) ;
+	BOOST_CHECK_EQUAL( values.size(), 2 ) ;
+	BOOST_CHECK_EQUAL( values[1], "rs1" ) ;
+}
+
+BOOST_AUTO_TEST_CASE( test_ids_and_chromosomes ) {
+	genfile::VariantIdentifyingData const a = make_snp( "snpA", "rsA", "1", 100 ) ;
+	genfile::VariantIdentifyingData const b = make_snp( "snpB", "rsB", "2", 200 ) ;
+	genfile::VariantIdentifyingData const c = make_snp( "snpC", "rsC", "scaffold1", 300 ) ;
+
+	{
+		genfile::CommonSNPFilter filter ;
+		BOOST_CHECK( filter( a ) && filter( b ) && filter( c )) ;
+		// Inclusions of the same kind are combined by OR.
+		filter.include_snps_in_set( make_set( "rsA" ), genfile::CommonSNPFilter::RSIDs ) ;
+		filter.include_snps_in_set( make_set( "snpC" ), genfile::CommonSNPFilter::SNPIDs ) ;
+		BOOST_CHECK( filter( a ) && !filter( b ) && filter( c )) ;
+		// Inclusions of different kinds are combined by AND.
+		std::set< genfile::Chromosome > chromosomes ;
+		chromosomes.insert( genfile::Chromosome( "scaffold1" )) ;
+		filter.include_chromosomes_in_set( chromosomes ) ;
+		BOOST_CHECK( !filter( a ) && !filter( b ) && filter( c )) ;
+		filter.exclude_snps_in_set( make_set( "rsC" ), genfile::CommonSNPFilter::RSIDs ) ;
+		BOOST_CHECK( !filter( a ) && !filter( b ) && !filter( c )) ;
+	}
+
+	{
+		genfile::CommonSNPFilter filter ;
+		filter.exclude_snps_in_set( make_set( "rsA" ), genfile::CommonSNPFilter::RSIDs ) ;
+		filter.exclude_snps_in_set( make_set( "snpB" ), genfile::CommonSNPFilter::RSIDs | genfile::CommonSNPFilter::SNPIDs ) ;
+		BOOST_CHECK( !filter( a ) && !filter( b ) && filter( c )) ;
+		BOOST_CHECK_EQUAL( filter.display(), "NOT( RSID in { rsA } OR SNPID or RSID in { snpB } )" ) ;
+	}
+
+	{
+		// Each exclusion of variants not in a set is a separate condition.
+		genfile::CommonSNPFilter filter ;
+		filter.exclude_snps_not_in_set( make_set( "rsA", "rsB" ), genfile::CommonSNPFilter::RSIDs ) ;
+		filter.exclude_snps_not_in_set( make_set( "rsB", "rsC" ), genfile::CommonSNPFilter::RSIDs ) ;
+		BOOST_CHECK( !filter( a ) && filter( b ) && !filter( c )) ;
+	}
+
+	{
+		genfile::CommonSNPFilter filter ;
+		filter.include_snps_in_set( make_set( "2:200", "scaffold1:301" ), genfile::CommonSNPFilter::Positions ) ;
+		BOOST_CHECK( !filter( a ) && filter( b ) && !filter( c )) ;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( test_ranges ) {
+	genfile::CommonSNPFilter filter ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "1:100-200" )) ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "1:150-300" )) ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "1:500-600" )) ;
+	filter.include_snps_in_range( genfile::GenomePositionRange::parse( "2:50-60" )) ;
+	filter.exclude_snps_in_range( genfile::GenomePositionRange::parse( "550-560" )) ;
+
+	BOOST_CHECK( !filter( make_snp( "", "", "1", 99 ))) ;
+	BOOST_CHECK( filter( make_snp( "", "", "1", 100 ))) ;
+	BOOST_CHECK( filter( make_snp( "", "", "1", 250 ))) ;
+	BOOST_CHECK( filter( make_snp( "", "", "1", 300 ))) ;
+	BOOST_CHECK( !filter( make_snp( "", "", "1", 301 ))) ;
+	BOOST_CHECK( filter( make_snp( "", "", "1", 549 ))) ;
+	BOOST_CHECK( !filter( make_snp( "", "", "1", 555 ))) ;
+	BOOST_CHECK( !filter( make_snp( "", "", "01", 150 ))) ;
+	BOOST_CHECK( filter( make_snp( "", "", "2", 50 ))) ;
+	BOOST_CHECK( !filter( make_snp( "", "", "2", 150 ))) ;
+	BOOST_CHECK( !filter( make_snp( "", "", "3", 55 ))) ;
+}
+
+BOOST_AUTO_TEST_CASE( test_variants ) {
+	std::vector< genfile::VariantIdentifyingData > snps ;
+	snps.push_back( make_snp( "snpA", "rsA", "1", 100 )) ;
+	snps.push_back( make_snp( "snpB", "rsB", "1", 200 )) ;
+	snps.push_back( make_snp( "snpB", "rsB", "1", 200 )) ;
+
+	genfile::CommonSNPFilter filter ;
+	filter.include_snps( snps, genfile::VariantIdentifyingData::CompareFields( "position,alleles" )) ;
+	BOOST_CHECK( filter( make_snp( "x", "y", "1", 100 ))) ;
+	BOOST_CHECK( filter( make_snp( "x", "y", "1", 200 ))) ;
+	BOOST_CHECK( !filter( make_snp( "x", "y", "1", 150 ))) ;
+	genfile::VariantIdentifyingData swapped = make_snp( "snpA", "rsA", "1", 100 ) ;
+	swapped.swap_alleles() ;
+	BOOST_CHECK( !filter( swapped )) ;
+
+	genfile::CommonSNPFilter rsid_filter ;
+	rsid_filter.exclude_snps( snps, genfile::VariantIdentifyingData::CompareFields( "rsid" )) ;
+	BOOST_CHECK( !rsid_filter( make_snp( "x", "rsA", "2", 1 ))) ;
+	BOOST_CHECK( rsid_filter( make_snp( "x", "rsC", "1", 100 ))) ;
+}
+
+BOOST_AUTO_TEST_CASE( test_may_pass ) {
+	genfile::VariantIdentifyingDataView view ;
+	std::string const rsid = "rsA", snpid = "snpA" ;
+	view.position = genfile::GenomePosition( genfile::Chromosome( "1" ), 150 ) ;
+	view.primary_id = rsid ;
+	view.alternate_ids.push_back( snpid ) ;
+
+	{
+		genfile::CommonSNPFilter filter ;
+		BOOST_CHECK( filter.may_pass( view )) ;
+		filter.include_snps_in_range( genfile::GenomePositionRange::parse( "1:100-200" )) ;
+		BOOST_CHECK( filter.may_pass( view )) ;
+		filter.exclude_snps_in_set( make_set( "snpA" ), genfile::CommonSNPFilter::SNPIDs ) ;
+		BOOST_CHECK( !filter.may_pass( view )) ;
+	}
+
+	{
+		genfile::CommonSNPFilter filter ;
+		filter.include_snps_in_set( make_set( "rsA" ), genfile::CommonSNPFilter::RSIDs ) ;
+		BOOST_CHECK( filter.may_pass( view )) ;
+		view.position = genfile::GenomePosition( genfile::Chromosome( "2" ), 150 ) ;
+		filter.exclude_snps_in_range( genfile::GenomePositionRange::parse( "2:1-1000" )) ;
+		BOOST_CHECK( !filter.may_pass( view )) ;
+	}
+
+	{
+		// Tests involving alleles cannot be decided from the view.
+		std::vector< genfile::VariantIdentifyingData > snps ;
+		snps.push_back( make_snp( "snpB", "rsB", "1", 100 )) ;
+		genfile::CommonSNPFilter filter ;
+		filter.include_snps( snps, genfile::VariantIdentifyingData::CompareFields( "position,alleles" )) ;
+		BOOST_CHECK( filter.may_pass( view )) ;
+		BOOST_CHECK( !filter( make_snp( snpid, rsid, "2", 150 ))) ;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
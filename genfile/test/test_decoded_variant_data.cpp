@@ -0,0 +1,128 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <Eigen/Core>
+#include "genfile/VariantDataReader.hpp"
+#include "genfile/DecodedVariantData.hpp"
+#include "genfile/Error.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_decoded_variant_data )
+
+namespace {
+	// Reader supplying the given genotype probabilities, with a row of NaNs meaning missing,
+	// and counting the number of times the data is read.
+	struct CountingReader: public genfile::VariantDataReader {
+		CountingReader( Eigen::MatrixXd const& probabilities ):
+			m_probabilities( probabilities ),
+			number_of_reads( 0 )
+		{}
+
+		CountingReader& get( std::string const& spec, PerSampleSetter& setter ) {
+			TEST_ASSERT( spec == ":genotypes:" ) ;
+			++number_of_reads ;
+			setter.initialise( m_probabilities.rows(), 2 ) ;
+			for( int i = 0; i < m_probabilities.rows(); ++i ) {
+				setter.set_sample( i ) ;
+				setter.set_number_of_entries( 2, 3, genfile::ePerUnorderedGenotype, genfile::eProbability ) ;
+				for( int g = 0; g < 3; ++g ) {
+					if( m_probabilities(i,g) == m_probabilities(i,g) ) {
+						setter.set_value( g, m_probabilities(i,g) ) ;
+					} else {
+						setter.set_value( g, genfile::MissingValue() ) ;
+					}
+				}
+			}
+			setter.finalise() ;
+			return *this ;
+		}
+		bool supports( std::string const& spec ) const { return spec == ":genotypes:" ; }
+		void get_supported_specs( SpecSetter ) const {}
+		std::size_t get_number_of_samples() const { return m_probabilities.rows() ; }
+
+	private:
+		Eigen::MatrixXd const m_probabilities ;
+	public:
+		int number_of_reads ;
+	} ;
+}
+
+BOOST_AUTO_TEST_CASE( test_views ) {
+	double const NaN = std::numeric_limits< double >::quiet_NaN() ;
+	Eigen::MatrixXd probabilities( 6, 3 ) ;
+	probabilities <<
+		1, 0, 0,
+		0.05, 0.95, 0,
+		0, 0.1, 0.9,
+		0.4, 0.3, 0.3,
+		NaN, NaN, NaN,
+		0, 0, 1 ;
+	CountingReader reader( probabilities ) ;
+
+	Eigen::MatrixXd const& gp = reader.decoded().genotype_probabilities() ;
+	BOOST_CHECK_EQUAL( gp.rows(), 6 ) ;
+	BOOST_CHECK_EQUAL( gp.cols(), 3 ) ;
+	BOOST_CHECK( gp.topRows( 4 ) == probabilities.topRows( 4 ) ) ;
+	BOOST_CHECK( gp.row( 4 ).isZero() ) ;
+	BOOST_CHECK( gp.row( 5 ) == probabilities.row( 5 ) ) ;
+
+	Eigen::VectorXf const& dosages = reader.decoded().dosages() ;
+	BOOST_CHECK_EQUAL( dosages.size(), 6 ) ;
+	BOOST_CHECK_CLOSE( dosages(0), 0.0, 1E-4 ) ;
+	BOOST_CHECK_CLOSE( dosages(1), 0.95, 1E-4 ) ;
+	BOOST_CHECK_CLOSE( dosages(2), 1.9, 1E-4 ) ;
+	BOOST_CHECK_CLOSE( dosages(3), 0.9, 1E-4 ) ;
+	BOOST_CHECK( dosages(4) != dosages(4) ) ;
+	BOOST_CHECK_CLOSE( dosages(5), 2.0, 1E-4 ) ;
+
+	genfile::HardCalls const& calls = reader.decoded().hard_calls( 0.9 ) ;
+	BOOST_CHECK_EQUAL( calls.size(), 6 ) ;
+	BOOST_CHECK_EQUAL( calls[0], genfile::HardCalls::eAA ) ;
+	BOOST_CHECK_EQUAL( calls[1], genfile::HardCalls::eAB ) ;
+	// Calls require probability strictly above the threshhold.
+	BOOST_CHECK_EQUAL( calls[2], genfile::HardCalls::eMissing ) ;
+	BOOST_CHECK_EQUAL( calls[3], genfile::HardCalls::eMissing ) ;
+	BOOST_CHECK_EQUAL( calls[4], genfile::HardCalls::eMissing ) ;
+	BOOST_CHECK_EQUAL( calls[5], genfile::HardCalls::eBB ) ;
+
+	genfile::HardCalls const& lenient_calls = reader.decoded().hard_calls( 0.35 ) ;
+	BOOST_CHECK_EQUAL( lenient_calls[2], genfile::HardCalls::eBB ) ;
+	BOOST_CHECK_EQUAL( lenient_calls[3], genfile::HardCalls::eAA ) ;
+	BOOST_CHECK_EQUAL( &reader.decoded().hard_calls( 0.9 ), &calls ) ;
+
+	Eigen::VectorXd values, nonmissingness ;
+	calls.get( &values, &nonmissingness, -1, 0, 1, 2 ) ;
+	Eigen::VectorXd expected_values( 6 ), expected_nonmissingness( 6 ) ;
+	expected_values << 0, 1, -1, -1, -1, 2 ;
+	expected_nonmissingness << 1, 1, 0, 0, 0, 1 ;
+	BOOST_CHECK( values == expected_values ) ;
+	BOOST_CHECK( nonmissingness == expected_nonmissingness ) ;
+
+	// All views share a single read of the data.
+	BOOST_CHECK_EQUAL( reader.number_of_reads, 1 ) ;
+}
+
+BOOST_AUTO_TEST_CASE( test_hard_call_packing ) {
+	genfile::HardCalls calls ;
+	calls.reset( 11 ) ;
+	for( std::size_t i = 0; i < calls.size(); ++i ) {
+		BOOST_CHECK_EQUAL( calls[i], genfile::HardCalls::eMissing ) ;
+	}
+	for( std::size_t i = 0; i < calls.size(); ++i ) {
+		calls.set( i, genfile::HardCalls::Call( i % 4 )) ;
+	}
+	for( std::size_t i = 0; i < calls.size(); ++i ) {
+		BOOST_CHECK_EQUAL( calls[i], genfile::HardCalls::Call( i % 4 )) ;
+	}
+	calls.set( 5, genfile::HardCalls::eAA ) ;
+	BOOST_CHECK_EQUAL( calls[4], genfile::HardCalls::eAA ) ;
+	BOOST_CHECK_EQUAL( calls[5], genfile::HardCalls::eAA ) ;
+	BOOST_CHECK_EQUAL( calls[6], genfile::HardCalls::eBB ) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
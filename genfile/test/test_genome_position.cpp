@@ -0,0 +1,77 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include "genfile/Chromosome.hpp"
+#include "genfile/GenomePosition.hpp"
+#include "genfile/GenomePositionRange.hpp"
+#include "test_case.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_genome_position )
+
+BOOST_AUTO_TEST_CASE( test_chromosome_order ) {
+	// Chromosomes in the expected sort order.
+	std::vector< genfile::Chromosome > chromosomes ;
+	chromosomes.push_back( genfile::Chromosome( "1" )) ;
+	chromosomes.push_back( genfile::Chromosome( "01" )) ;
+	chromosomes.push_back( genfile::Chromosome( "chr1" )) ;
+	chromosomes.push_back( genfile::Chromosome( "2" )) ;
+	chromosomes.push_back( genfile::Chromosome( "10" )) ;
+	chromosomes.push_back( genfile::Chromosome( "22" )) ;
+	chromosomes.push_back( genfile::Chromosome( "X" )) ;
+	chromosomes.push_back( genfile::Chromosome( "chrMT" )) ;
+	// Other names sort lexicographically regardless of the order they were first seen.
+	genfile::Chromosome const zeta( "zeta" ) ;
+	genfile::Chromosome const alpha( "alpha" ) ;
+	chromosomes.push_back( genfile::Chromosome( "" )) ;
+	chromosomes.push_back( alpha ) ;
+	chromosomes.push_back( genfile::Chromosome( "chr1_random" )) ;
+	chromosomes.push_back( zeta ) ;
+	chromosomes.push_back( genfile::Chromosome() ) ;
+
+	for( std::size_t i = 0; i < chromosomes.size(); ++i ) {
+		for( std::size_t j = 0; j < chromosomes.size(); ++j ) {
+			BOOST_CHECK_EQUAL( chromosomes[i] < chromosomes[j], i < j ) ;
+			BOOST_CHECK_EQUAL( chromosomes[i] == chromosomes[j], i == j ) ;
+			BOOST_CHECK_EQUAL( chromosomes[i] <= chromosomes[j], i <= j ) ;
+		}
+	}
+
+	BOOST_CHECK( genfile::Chromosome( "zeta" ) == zeta ) ;
+	BOOST_CHECK( genfile::Chromosome( "zeta" ).code() == zeta.code() ) ;
+	BOOST_CHECK( zeta == std::string( "zeta" )) ;
+	BOOST_CHECK( genfile::Chromosome() != std::string( "NA" )) ;
+	BOOST_CHECK_EQUAL( std::string( genfile::Chromosome() ), "NA" ) ;
+	BOOST_CHECK_EQUAL( std::string( zeta ), "zeta" ) ;
+	BOOST_CHECK( genfile::Chromosome( "0X" ).is_sex_determining() ) ;
+	BOOST_CHECK( genfile::Chromosome( "05" ).is_autosome() ) ;
+	BOOST_CHECK( !genfile::Chromosome( "X" ).is_autosome() ) ;
+	BOOST_CHECK( genfile::Chromosome().is_missing() ) ;
+}
+
+BOOST_AUTO_TEST_CASE( test_position_keys ) {
+	genfile::GenomePosition const a( genfile::Chromosome( "2" ), 100 ) ;
+	genfile::GenomePosition const b( genfile::Chromosome( "2" ), 4000000000u ) ;
+	genfile::GenomePosition const c( genfile::Chromosome( "10" ), 1 ) ;
+	genfile::GenomePosition const d( genfile::Chromosome( "zeta" ), 1 ) ;
+	genfile::GenomePosition const e( genfile::Chromosome( "alpha" ), 2 ) ;
+
+	BOOST_CHECK( a.key() < b.key() ) ;
+	BOOST_CHECK( b.key() < c.key() ) ;
+	BOOST_CHECK( a < b && b < c && c < e && e < d ) ;
+	BOOST_CHECK( a == genfile::GenomePosition( genfile::Chromosome( "2" ), 100 )) ;
+	BOOST_CHECK( a != genfile::GenomePosition( genfile::Chromosome( "02" ), 100 )) ;
+	BOOST_CHECK( d >= e && d > e && e <= d ) ;
+
+	genfile::GenomePositionRange const range = genfile::GenomePositionRange::parse( "2:50-200" ) ;
+	BOOST_CHECK( range.contains( a )) ;
+	BOOST_CHECK( !range.contains( b )) ;
+	BOOST_CHECK( !range.contains( genfile::GenomePosition( genfile::Chromosome( "1" ), 100 ))) ;
+	BOOST_CHECK( !range.contains( genfile::GenomePosition( genfile::Chromosome( "3" ), 100 ))) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
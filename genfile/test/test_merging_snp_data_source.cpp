@@ -0,0 +1,160 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "test_case.hpp"
+
+#if HAVE_BOOST_FILESYSTEM
+	#include <boost/filesystem/operations.hpp>
+#endif
+
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/MergingSNPDataSource.hpp"
+
+AUTO_TEST_SUITE( test_merging_snp_data_source )
+
+namespace {
+	// Each source has two samples.  The first sample's genotype (AA or AB) identifies which source a variant came from.
+	std::string const data1 =
+		"SNP1 rs1 1000 A G 1 0 0 0 1 0\n"
+		"SNP2 rs2 2000 A G 1 0 0 0 1 0\n"
+		"SNP3 rs3 3000 A G 1 0 0 0 1 0\n"
+		"SNP5 rs5b 5000 A G 1 0 0 0 1 0\n" ;
+	std::string const data2 =
+		"SNP1 rs1 1000 A G 0 1 0 0 1 0\n"
+		"SNP2 rs2 2000 A G 0 1 0 0 1 0\n"
+		"SNP25 rs25 2500 A G 0 1 0 0 1 0\n"
+		"SNP4 rs4 4000 A G 0 1 0 0 1 0\n"
+		"SNP5 rs5a 5000 A G 0 1 0 0 1 0\n"
+		"SNP6 rs6 6000 A G 0 1 0 0 1 0\n" ;
+
+	struct Variant {
+		std::string rsid ;
+		std::string alternate_id ;
+		genfile::Position position ;
+		int source ;
+		bool operator==( Variant const& other ) const {
+			return rsid == other.rsid && alternate_id == other.alternate_id && position == other.position && source == other.source ;
+		}
+	} ;
+
+	Variant make_variant( std::string const& rsid, std::string const& alternate_id, genfile::Position position, int source ) {
+		Variant result ;
+		result.rsid = rsid ;
+		result.alternate_id = alternate_id ;
+		result.position = position ;
+		result.source = source ;
+		return result ;
+	}
+
+	// Record the called genotype of the first sample, which identifies the source.
+	struct SourceSetter: public genfile::VariantDataReader::PerSampleSetter {
+		SourceSetter( int* source ): m_source( source ) {}
+		void initialise( std::size_t, std::size_t ) { *m_source = 0 ; }
+		bool set_sample( std::size_t i ) { m_sample = i ; return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) {}
+		void set_value( std::size_t, genfile::MissingValue const ) {}
+		void set_value( std::size_t g, double const value ) {
+			if( m_sample == 0 && value > 0.5 ) {
+				*m_source = g + 1 ;
+			}
+		}
+		void finalise() {}
+	private:
+		int* m_source ;
+		std::size_t m_sample ;
+	} ;
+
+	std::vector< Variant > read_variants( genfile::SNPDataSource& source ) {
+		std::vector< Variant > result ;
+		genfile::VariantIdentifyingData snp ;
+		while( source.get_snp_identifying_data( &snp )) {
+			Variant variant ;
+			variant.rsid = snp.get_primary_id() ;
+			std::vector< genfile::string_utils::slice > const ids = snp.get_identifiers( 1 ) ;
+			variant.alternate_id = ids.empty() ? "" : std::string( ids[0] ) ;
+			variant.position = snp.get_position().position() ;
+			SourceSetter setter( &variant.source ) ;
+			source.read_variant_data()->get( ":genotypes:", setter ) ;
+			result.push_back( variant ) ;
+		}
+		return result ;
+	}
+
+	std::string create_file( std::string const& data ) {
+		std::string const filename = tmpnam(0) + std::string( ".gen" ) ;
+		std::ofstream file( filename.c_str() ) ;
+		file << data ;
+		return filename ;
+	}
+
+	// Merge the two files, prefetching the second unless prefetch_queue_bytes is zero.
+	std::vector< Variant > merge(
+		std::string const& strategy,
+		std::string const& filename1,
+		std::string const& filename2,
+		std::size_t prefetch_queue_bytes,
+		std::vector< std::string > const& prefetch_specs = std::vector< std::string >()
+	) {
+		genfile::MergingSNPDataSource::UniquePtr source = genfile::MergingSNPDataSource::create( strategy ) ;
+		source->add_source( genfile::SNPDataSource::create( filename1 )) ;
+		if( prefetch_queue_bytes > 0 ) {
+			source->prefetch_sources( prefetch_queue_bytes, prefetch_specs ) ;
+		}
+		source->add_source( genfile::SNPDataSource::create( filename2 ), "merged:" ) ;
+		std::vector< Variant > result = read_variants( *source ) ;
+		source->reset_to_start() ;
+		TEST_ASSERT( read_variants( *source ) == result ) ;
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_merge_strategies ) {
+	std::string const filename1 = create_file( data1 ) ;
+	std::string const filename2 = create_file( data2 ) ;
+
+	// Equal variants come out in the order of their sources; variants at the same position are ordered by rsid.
+	std::vector< Variant > expected_keep_all ;
+	expected_keep_all.push_back( make_variant( "rs1", "SNP1", 1000, 1 )) ;
+	expected_keep_all.push_back( make_variant( "rs1", "merged:SNP1", 1000, 2 )) ;
+	expected_keep_all.push_back( make_variant( "rs2", "SNP2", 2000, 1 )) ;
+	expected_keep_all.push_back( make_variant( "rs2", "merged:SNP2", 2000, 2 )) ;
+	expected_keep_all.push_back( make_variant( "rs25", "merged:SNP25", 2500, 2 )) ;
+	expected_keep_all.push_back( make_variant( "rs3", "SNP3", 3000, 1 )) ;
+	expected_keep_all.push_back( make_variant( "rs4", "merged:SNP4", 4000, 2 )) ;
+	expected_keep_all.push_back( make_variant( "rs5a", "merged:SNP5", 5000, 2 )) ;
+	expected_keep_all.push_back( make_variant( "rs5b", "SNP5", 5000, 1 )) ;
+	expected_keep_all.push_back( make_variant( "rs6", "merged:SNP6", 6000, 2 )) ;
+
+	// Dropping duplicates keeps only the first variant at each position.
+	std::vector< Variant > expected_drop_duplicates ;
+	expected_drop_duplicates.push_back( make_variant( "rs1", "SNP1", 1000, 1 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs2", "SNP2", 2000, 1 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs25", "merged:SNP25", 2500, 2 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs3", "SNP3", 3000, 1 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs4", "merged:SNP4", 4000, 2 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs5a", "merged:SNP5", 5000, 2 )) ;
+	expected_drop_duplicates.push_back( make_variant( "rs6", "merged:SNP6", 6000, 2 )) ;
+
+	// Small queues make the prefetching threads wait for the reader; a 1-byte queue holds one variant.
+	std::size_t const queue_bytes[] = { 0, 1, 4096 } ;
+	std::vector< std::string > const genotypes_only( 1, ":genotypes:" ) ;
+	for( std::size_t k = 0; k < 3; ++k ) {
+		TEST_ASSERT( merge( "keep-all", filename1, filename2, queue_bytes[k] ) == expected_keep_all ) ;
+		TEST_ASSERT( merge( "drop-duplicates", filename1, filename2, queue_bytes[k] ) == expected_drop_duplicates ) ;
+		TEST_ASSERT( merge( "keep-all", filename1, filename2, queue_bytes[k], genotypes_only ) == expected_keep_all ) ;
+	}
+
+	boost::filesystem::remove( filename1 ) ;
+	boost::filesystem::remove( filename2 ) ;
+}
+
+AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "test_case.hpp"
+#include "genfile/Profile.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/GenFileSNPDataSource.hpp"
+#include "genfile/PrefetchingSNPDataSource.hpp"
+#include "genfile/ProfilingSNPDataSource.hpp"
+
+AUTO_TEST_SUITE( test_profile )
+
+namespace {
+	std::size_t const number_of_samples = 3 ;
+	std::size_t const number_of_variants = 5 ;
+
+	std::string gen_data() {
+		std::ostringstream result ;
+		for( std::size_t v = 0; v < number_of_variants; ++v ) {
+			result << "SNP" << v << " rs" << v << " " << ( 1000 + v ) << " A G 1 0 0 0 1 0 0 0 1\n" ;
+		}
+		return result.str() ;
+	}
+
+	genfile::SNPDataSource::UniquePtr create_source() {
+		return genfile::SNPDataSource::UniquePtr(
+			new genfile::GenFileSNPDataSource(
+				std::auto_ptr< std::istream >( new std::istringstream( gen_data() )),
+				genfile::Chromosome( "1" )
+			)
+		) ;
+	}
+
+	// Counts the samples whose data is set.
+	struct CountingSetter: public genfile::VariantDataReader::PerSampleSetter {
+		CountingSetter(): count( 0 ) {}
+		void initialise( std::size_t, std::size_t ) { count = 0 ; }
+		bool set_sample( std::size_t ) { ++count ; return true ; }
+		void set_number_of_entries( uint32_t, std::size_t, genfile::OrderType const, genfile::ValueType const ) {}
+		void set_value( std::size_t, genfile::MissingValue const ) {}
+		void set_value( std::size_t, double const ) {}
+		void finalise() {}
+		std::size_t count ;
+	} ;
+
+	void time_calls( genfile::Profile::Stage* stage, genfile::Profile::Timing* timing, std::size_t number_of_calls ) {
+		for( std::size_t i = 0; i < number_of_calls; ++i ) {
+			genfile::Profile::ScopedTimer timer( *timing ) ;
+			++stage->variants_read ;
+			stage->bytes_read += 3 ;
+		}
+	}
+
+	uint64_t histogram_total( genfile::Profile::Timing const& timing ) {
+		uint64_t result = 0 ;
+		for( std::size_t b = 0; b < genfile::Profile::Histogram::eNumberOfBuckets; ++b ) {
+			result += timing.histogram[b] ;
+		}
+		return result ;
+	}
+}
+
+AUTO_TEST_CASE( test_histogram ) {
+	typedef genfile::Profile::Histogram Histogram ;
+	Histogram histogram ;
+	histogram.add( 0.5e-6 ) ;
+	histogram.add( 1.5e-6 ) ;
+	histogram.add( 3e-6 ) ;
+	histogram.add( 3.5e-6 ) ;
+	histogram.add( 1e6 ) ;
+	BOOST_CHECK_EQUAL( histogram[0], 1 ) ;
+	BOOST_CHECK_EQUAL( histogram[1], 1 ) ;
+	BOOST_CHECK_EQUAL( histogram[2], 2 ) ;
+	BOOST_CHECK_EQUAL( histogram[ Histogram::eNumberOfBuckets - 1 ], 1 ) ;
+	BOOST_CHECK_EQUAL( Histogram::upper_bound( 2 ), 4.0 ) ;
+}
+
+AUTO_TEST_CASE( test_nested_timers ) {
+	genfile::Profile profile ;
+	genfile::Profile::Stage& stage = profile.add_stage( "stage", "test" ) ;
+	genfile::Profile::Timing& outer = stage.timing( "outer" ) ;
+	genfile::Profile::Timing& inner = stage.timing( "inner" ) ;
+	BOOST_CHECK_EQUAL( &stage.timing( "outer" ), &outer ) ;
+	BOOST_CHECK_EQUAL( stage.number_of_timings(), 2 ) ;
+	{
+		genfile::Profile::ScopedTimer outer_timer( outer ) ;
+		boost::this_thread::sleep_for( boost::chrono::milliseconds( 2 )) ;
+		for( std::size_t i = 0; i < 2; ++i ) {
+			genfile::Profile::ScopedTimer inner_timer( inner ) ;
+			boost::this_thread::sleep_for( boost::chrono::milliseconds( 2 )) ;
+		}
+	}
+	BOOST_CHECK_EQUAL( outer.calls.load(), 1 ) ;
+	BOOST_CHECK_EQUAL( inner.calls.load(), 2 ) ;
+	BOOST_CHECK_EQUAL( inner.self_seconds.load(), inner.total_seconds.load() ) ;
+	BOOST_CHECK_GE( inner.total_seconds.load(), 0.004 ) ;
+	BOOST_CHECK_GE( outer.total_seconds.load(), inner.total_seconds.load() + 0.002 ) ;
+	// Time in the inner timer counts towards the outer total, but not towards its self time.
+	BOOST_CHECK_CLOSE( outer.self_seconds.load() + inner.total_seconds.load(), outer.total_seconds.load(), 1e-6 ) ;
+	BOOST_CHECK_EQUAL( histogram_total( outer ), 1 ) ;
+	BOOST_CHECK_EQUAL( histogram_total( inner ), 2 ) ;
+}
+
+AUTO_TEST_CASE( test_concurrent_updates ) {
+	genfile::Profile profile ;
+	genfile::Profile::Stage& stage = profile.add_stage( "stage", "test" ) ;
+	genfile::Profile::Timing& timing = stage.timing( "operation" ) ;
+	std::size_t const number_of_threads = 4 ;
+	std::size_t const number_of_calls = 20000 ;
+	boost::thread_group threads ;
+	for( std::size_t i = 0; i < number_of_threads; ++i ) {
+		threads.create_thread( boost::bind( &time_calls, &stage, &timing, number_of_calls )) ;
+	}
+	// Writing the profile while it is being updated is allowed.
+	std::ostringstream json ;
+	profile.write_json( json ) ;
+	threads.join_all() ;
+
+	uint64_t const total_calls = number_of_threads * number_of_calls ;
+	BOOST_CHECK_EQUAL( timing.calls.load(), total_calls ) ;
+	BOOST_CHECK_EQUAL( histogram_total( timing ), total_calls ) ;
+	BOOST_CHECK_EQUAL( stage.variants_read.load(), total_calls ) ;
+	BOOST_CHECK_EQUAL( stage.bytes_read.load(), 3 * total_calls ) ;
+	// Threads add in different orders, so the sums can differ by rounding.
+	BOOST_CHECK_CLOSE( timing.self_seconds.load(), timing.total_seconds.load(), 1e-6 ) ;
+}
+
+AUTO_TEST_CASE( test_profiling_snp_data_source ) {
+	genfile::Profile profile ;
+	genfile::Profile::Stage& inner_stage = profile.add_stage( "inner", "source" ) ;
+	genfile::Profile::Stage& outer_stage = profile.add_stage( "outer", "source" ) ;
+	genfile::SNPDataSource::UniquePtr source( genfile::ProfilingSNPDataSource::create( create_source(), inner_stage ).release() ) ;
+	source.reset( genfile::ProfilingSNPDataSource::create( source, outer_stage ).release() ) ;
+	TEST_ASSERT( inner_stage.input() == 0 ) ;
+	TEST_ASSERT( outer_stage.input() == &inner_stage ) ;
+	TEST_ASSERT( source->number_of_samples() == number_of_samples ) ;
+
+	// Read and decode the first variant, skip the second, and read the rest without decoding.
+	genfile::VariantIdentifyingData variant ;
+	std::size_t v = 0 ;
+	for( ; source->get_snp_identifying_data( &variant ); ++v ) {
+		TEST_ASSERT( variant.get_primary_id() == "rs" + genfile::string_utils::to_string( v )) ;
+		if( v == 1 ) {
+			source->ignore_snp_probability_data() ;
+		} else {
+			genfile::VariantDataReader::UniquePtr reader = source->read_variant_data() ;
+			if( v == 0 ) {
+				CountingSetter setter ;
+				reader->get( ":genotypes:", setter ) ;
+				BOOST_CHECK_EQUAL( setter.count, number_of_samples ) ;
+			}
+		}
+	}
+	TEST_ASSERT( v == number_of_variants ) ;
+
+	genfile::Profile::Stage* stages[2] = { &inner_stage, &outer_stage } ;
+	for( std::size_t i = 0; i < 2; ++i ) {
+		genfile::Profile::Stage& stage = *stages[i] ;
+		BOOST_CHECK_EQUAL( stage.variants_read.load(), number_of_variants - 1 ) ;
+		BOOST_CHECK_EQUAL( stage.variants_ignored.load(), 1 ) ;
+		BOOST_CHECK_EQUAL( stage.variants_out(), number_of_variants ) ;
+		BOOST_CHECK_EQUAL( stage.timing( "get_snp_identifying_data" ).calls.load(), number_of_variants + 1 ) ;
+		BOOST_CHECK_EQUAL( stage.timing( "read_variant_data" ).calls.load(), number_of_variants - 1 ) ;
+		BOOST_CHECK_EQUAL( stage.timing( "ignore_snp_probability_data" ).calls.load(), 1 ) ;
+		BOOST_CHECK_EQUAL( stage.timing( "decode" ).calls.load(), 1 ) ;
+	}
+	// The outer stage's operations include the inner stage's, so take at least as long.
+	BOOST_CHECK_GE(
+		outer_stage.timing( "get_snp_identifying_data" ).total_seconds.load(),
+		inner_stage.timing( "get_snp_identifying_data" ).total_seconds.load()
+	) ;
+
+	std::ostringstream json ;
+	profile.write_json( json ) ;
+	BOOST_CHECK( json.str().find( "\"name\": \"outer\"" ) != std::string::npos ) ;
+	BOOST_CHECK( json.str().find( "\"input\": 0" ) != std::string::npos ) ;
+	BOOST_CHECK( json.str().find( "\"variants_in\": 5" ) != std::string::npos ) ;
+}
+
+AUTO_TEST_CASE( test_profiling_prefetched_source ) {
+	// The inner stage is updated by the prefetching thread, the outer one by this thread.
+	for( std::size_t repeat = 0; repeat < 10; ++repeat ) {
+		genfile::Profile profile ;
+		genfile::Profile::Stage& inner_stage = profile.add_stage( "inner", "source" ) ;
+		genfile::Profile::Stage& outer_stage = profile.add_stage( "outer", "source" ) ;
+		genfile::SNPDataSource::UniquePtr source( genfile::ProfilingSNPDataSource::create( create_source(), inner_stage ).release() ) ;
+		source.reset( genfile::PrefetchingSNPDataSource::create( source, 1 ).release() ) ;
+		source.reset( genfile::ProfilingSNPDataSource::create( source, outer_stage ).release() ) ;
+		TEST_ASSERT( outer_stage.input() == &inner_stage ) ;
+
+		genfile::VariantIdentifyingData variant ;
+		std::size_t v = 0 ;
+		for( ; source->get_snp_identifying_data( &variant ); ++v ) {
+			CountingSetter setter ;
+			source->read_variant_data()->get( ":genotypes:", setter ) ;
+			BOOST_CHECK_EQUAL( setter.count, number_of_samples ) ;
+		}
+		TEST_ASSERT( v == number_of_variants ) ;
+		BOOST_CHECK_EQUAL( outer_stage.variants_read.load(), number_of_variants ) ;
+		BOOST_CHECK_EQUAL( outer_stage.timing( "decode" ).calls.load(), number_of_variants ) ;
+		source.reset() ;
+		BOOST_CHECK_EQUAL( inner_stage.variants_read.load(), number_of_variants ) ;
+		BOOST_CHECK_EQUAL( inner_stage.variants_out(), number_of_variants ) ;
+	}
+}
+
+AUTO_TEST_SUITE_END()
@@ -20,6 +20,7 @@
 #include "genfile/SNPDataSource.hpp"
 #include "genfile/SNPDataSourceRack.hpp"
 #include "genfile/GenFileSNPDataSource.hpp"
+#include "genfile/VCFFormatSNPDataSource.hpp"
 #include "genfile/SampleFilteringSNPDataSource.hpp"
 #include "stdint.h"
 
@@ -180,4 +181,56 @@ AUTO_TEST_CASE( test_sample_filtering_snp_data_source ) {
 	std::cout << "==== success ====\n" ;
 }
 
+// VCF sources skip filtered-out samples themselves; check they give the same results
+// as filtering the full data.
+AUTO_TEST_CASE( test_sample_filtering_vcf_source ) {
+	std::string const data =
+		"##fileformat=VCFv4.1\n"
+		"##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+		"#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tS1\tS2\tS3\tS4\tS5\n"
+		"1\t1\trs1\tA\tG\t.\t.\t.\tGT\t0/0\t0/1\t1/1\t./.\t0|1\n"
+		"1\t2\trs2\tC\tT\t.\t.\t.\tGT\t1/1\t0/0\t0/1\t1|0\t./.\n"
+		"1\t3\trs3\tG\tT\t.\t.\t.\tGT\t0/1\t1/1\t./.\t0/0\t1/1\n"
+	;
+	std::size_t const number_of_samples = 5 ;
+
+	std::vector< SnpData > unfiltered_data ;
+	{
+		std::auto_ptr< std::istream > stream( new std::istringstream( data ) ) ;
+		genfile::VCFFormatSNPDataSource source( stream ) ;
+		unfiltered_data = read_snp_data( source ) ;
+	}
+	TEST_ASSERT( unfiltered_data.size() == 3 ) ;
+
+	for( std::size_t subset = 0; subset < ( 1u << number_of_samples ); ++subset ) {
+		std::set< std::size_t > filtered_out ;
+		for( std::size_t i = 0; i < number_of_samples; ++i ) {
+			if( subset & ( 1u << i )) {
+				filtered_out.insert( i ) ;
+			}
+		}
+		std::auto_ptr< std::istream > stream( new std::istringstream( data ) ) ;
+		genfile::SNPDataSource::UniquePtr source( new genfile::VCFFormatSNPDataSource( stream )) ;
+		genfile::SampleFilteringSNPDataSource::UniquePtr filtering_source = genfile::SampleFilteringSNPDataSource::create(
+			source,
+			filtered_out
+		) ;
+		TEST_ASSERT( filtering_source->number_of_samples() == number_of_samples - filtered_out.size() ) ;
+
+		std::vector< SnpData > filtered_data = read_snp_data( *filtering_source ) ;
+		TEST_ASSERT( filtered_data.size() == unfiltered_data.size() ) ;
+		for( std::size_t j = 0; j < filtered_data.size(); ++j ) {
+			TEST_ASSERT( filtered_data[j].snp == unfiltered_data[j].snp ) ;
+			std::vector< probabilities_t > expected ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				if( filtered_out.find( i ) == filtered_out.end() ) {
+					expected.push_back( unfiltered_data[j].probabilities[i] ) ;
+				}
+			}
+			TEST_ASSERT( filtered_data[j].probabilities.size() == expected.size() ) ;
+			TEST_ASSERT( filtered_data[j].probabilities == expected ) ;
+		}
+	}
+}
+
 AUTO_TEST_SUITE_END()
@@ -211,4 +211,45 @@ AUTO_TEST_CASE( test_snp_data_source_chain ) {
 	}
 }
 
+AUTO_TEST_CASE( test_snp_data_source_chain_prefetching ) {
+	std::string original = genfile::create_temporary_filename() + std::string( ".gen" );
+	std::string gen = genfile::create_temporary_filename() + std::string( ".gen" );
+	std::string gen2 = genfile::create_temporary_filename() + std::string( ".gen" );
+	create_files( original, gen, gen2 ) ;
+
+	std::vector< genfile::wildcard::FilenameMatch > filenames ;
+	filenames.push_back( original ) ;
+	filenames.push_back( gen ) ;
+	filenames.push_back( gen2 ) ;
+	std::vector< SnpData > const expected = read_gen_files( filenames ) ;
+	TEST_ASSERT( expected.size() == 3 * data::number_of_snps ) ;
+
+	// Small queues make the prefetching threads wait for the reader; a 1-byte queue holds one variant.
+	std::size_t const queue_bytes[] = { 1, 4096, genfile::PrefetchingSNPDataSource::default_max_queue_bytes } ;
+	std::vector< std::string > const genotypes_only( 1, ":genotypes:" ) ;
+	for( std::size_t number_of_threads = 1; number_of_threads < 5; ++number_of_threads ) {
+		for( std::size_t k = 0; k < 6; ++k ) {
+			genfile::SNPDataSourceChain::UniquePtr chain = genfile::SNPDataSourceChain::create( filenames ) ;
+			chain->prefetch_sources(
+				number_of_threads,
+				queue_bytes[ k % 3 ],
+				( k < 3 ) ? std::vector< std::string >() : genotypes_only
+			) ;
+			TEST_ASSERT( chain->number_of_samples() == data::number_of_samples ) ;
+			TEST_ASSERT( read_snp_data( *chain ) == expected ) ;
+
+			// Abandon reading part-way through and start again.
+			chain->reset_to_start() ;
+			SnpData snp_data ;
+			for( std::size_t i = 0; i < data::number_of_snps + 3; ++i ) {
+				TEST_ASSERT( chain->get_snp_identifying_data( &snp_data.snp )) ;
+				TEST_ASSERT( snp_data.snp == expected[i].snp ) ;
+				chain->ignore_snp_probability_data() ;
+			}
+			chain->reset_to_start() ;
+			TEST_ASSERT( read_snp_data( *chain ) == expected ) ;
+		}
+	}
+}
+
 AUTO_TEST_SUITE_END()
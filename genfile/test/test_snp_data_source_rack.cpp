@@ -210,5 +210,51 @@ AUTO_TEST_CASE( test_snp_data_source_rack ) {
 	
 }
 
+AUTO_TEST_CASE( test_snp_data_source_rack_prefetching ) {
+	std::vector< std::vector< std::string > > data = construct_data() ;
+	// Small queues make the prefetching threads wait for the reader; a 1-byte queue holds one variant.
+	std::size_t const queue_bytes[] = { 1, 4096, genfile::PrefetchingSNPDataSource::default_max_queue_bytes } ;
+	std::vector< std::string > const genotypes_only( 1, ":genotypes:" ) ;
+	for( std::size_t i = 0; i < data.size(); ++i ) {
+		std::cout << "==== Looking at test data " << i << " (prefetching) ====\n" ;
+		std::vector< std::string > filenames( data[i].size() ) ;
+		for( std::size_t j = 0; j < filenames.size(); ++j ) {
+			filenames[j] = tmpnam(0) + std::string( ".gen" ) ;
+			create_file( data[i][j], filenames[j] ) ;
+		}
+
+		std::vector< SnpData > expected ;
+		{
+			std::auto_ptr< genfile::SNPDataSourceRack > rack( new genfile::SNPDataSourceRack() ) ;
+			for( std::size_t j = 0; j < filenames.size(); ++j ) {
+				rack->add_source( genfile::SNPDataSource::create( filenames[j] )) ;
+			}
+			expected = read_snp_data( *rack ) ;
+		}
+
+		for( std::size_t k = 0; k < 6; ++k ) {
+			std::auto_ptr< genfile::SNPDataSourceRack > rack( new genfile::SNPDataSourceRack() ) ;
+			// Prefetching applies to sources added both before and after the call.
+			for( std::size_t j = 0; j < filenames.size(); ++j ) {
+				if( j == filenames.size() / 2 ) {
+					rack->prefetch_sources(
+						queue_bytes[ k % 3 ],
+						( k < 3 ) ? std::vector< std::string >() : genotypes_only
+					) ;
+				}
+				rack->add_source( genfile::SNPDataSource::create( filenames[j] )) ;
+			}
+			TEST_ASSERT( read_snp_data( *rack ) == expected ) ;
+			rack->reset_to_start() ;
+			TEST_ASSERT( read_snp_data( *rack ) == expected ) ;
+		}
+
+		for( std::size_t j = 0; j < filenames.size(); ++j ) {
+			boost::filesystem::remove( filenames[j] ) ;
+		}
+	}
+	std::cout << "==== success ====\n" ;
+}
+
 AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,184 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include "test_case.hpp"
+#include "genfile/FileUtils.hpp"
+#include "genfile/SNPDataSink.hpp"
+#include "genfile/SNPDataSource.hpp"
+#include "genfile/SortingSNPDataSink.hpp"
+#include "genfile/string_utils/string_utils.hpp"
+
+AUTO_TEST_SUITE( test_sorting_snp_data_sink )
+
+namespace {
+	std::size_t const number_of_samples = 3 ;
+
+	// Sample i at variant v has genotype ( v + i ) % 3 with certainty.
+	double get_probability( std::size_t v, std::size_t g, std::size_t i ) {
+		return ( ( v + i ) % 3 == g ) ? 1.0 : 0.0 ;
+	}
+
+	genfile::VariantEntry get_sample_name( std::size_t i ) {
+		return "S" + genfile::string_utils::to_string( i ) ;
+	}
+
+	void set_probabilities( std::vector< double >* result, std::size_t i, double AA, double AB, double BB ) {
+		result->resize( std::max( result->size(), 3 * ( i + 1 ))) ;
+		(*result)[ 3*i ] = AA ;
+		(*result)[ 3*i + 1 ] = AB ;
+		(*result)[ 3*i + 2 ] = BB ;
+	}
+
+	// Write variants rs<v> at the given positions through a sorting sink, then read back
+	// the rsids in the order they appear in the output file.  If finalise is false, the sink
+	// is destroyed without being finalised.
+	std::vector< std::string > write_sorted(
+		std::string const& extension,
+		std::vector< int > const& positions,
+		std::size_t memory_budget,
+		bool* input_is_sorted,
+		std::size_t* number_of_runs,
+		std::vector< std::string > const& specs = std::vector< std::string >(),
+		std::size_t max_runs_per_merge = 64,
+		bool finalise = true
+	) {
+		std::string const filename = genfile::create_temporary_filename() + extension ;
+		{
+			genfile::SortingSNPDataSink sink(
+				genfile::SNPDataSink::create( filename ),
+				genfile::VariantIdentifyingData::CompareFields( "position" ),
+				memory_budget,
+				specs,
+				max_runs_per_merge
+			) ;
+			sink.set_sample_names( number_of_samples, &get_sample_name ) ;
+			for( std::size_t v = 0; v < positions.size(); ++v ) {
+				std::string const index = genfile::string_utils::to_string( v ) ;
+				sink.write_snp(
+					number_of_samples,
+					"snp" + index, "rs" + index,
+					genfile::Chromosome( "1" ), positions[v],
+					"A", "G",
+					boost::bind( &get_probability, v, 0, _1 ),
+					boost::bind( &get_probability, v, 1, _1 ),
+					boost::bind( &get_probability, v, 2, _1 )
+				) ;
+			}
+			*input_is_sorted = sink.input_is_sorted() ;
+			*number_of_runs = sink.number_of_runs() ;
+			if( finalise ) {
+				sink.finalise() ;
+			}
+		}
+
+		std::vector< std::string > result ;
+		genfile::SNPDataSource::UniquePtr source = genfile::SNPDataSource::create( filename ) ;
+		genfile::VariantIdentifyingData variant ;
+		std::vector< double > probabilities ;
+		while( source->get_snp_identifying_data( &variant )) {
+			std::string const rsid = variant.get_primary_id() ;
+			std::size_t const v = genfile::string_utils::to_repr< std::size_t >( rsid.substr( 2 )) ;
+			BOOST_CHECK_EQUAL( variant.get_position().position(), positions[v] ) ;
+			source->read_snp_probability_data( boost::bind( &set_probabilities, &probabilities, _1, _2, _3, _4 )) ;
+			BOOST_CHECK_EQUAL( probabilities.size(), 3 * number_of_samples ) ;
+			for( std::size_t i = 0; i < number_of_samples; ++i ) {
+				for( std::size_t g = 0; g < 3; ++g ) {
+					BOOST_CHECK_CLOSE( probabilities[ 3*i + g ] + 1.0, get_probability( v, g, i ) + 1.0, 0.01 ) ;
+				}
+			}
+			result.push_back( rsid ) ;
+		}
+		return result ;
+	}
+
+	std::string join( std::vector< std::string > const& values ) {
+		return genfile::string_utils::join( values, " " ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_sorting ) {
+	// rs1 and rs4 share a position, and must stay in the order they were written.
+	int const unsorted[] = { 500, 300, 400, 100, 300, 200 } ;
+	std::vector< int > const positions( unsorted, unsorted + 6 ) ;
+	char const* extensions[] = { ".bgen", ".gen" } ;
+	// GEN and BGEN sinks only need genotypes to be held.
+	std::vector< std::vector< std::string > > specs( 2 ) ;
+	specs[1].push_back( ":genotypes:" ) ;
+	for( std::size_t i = 0; i < 2; ++i ) {
+		for( std::size_t j = 0; j < specs.size(); ++j ) {
+			bool sorted = true ;
+			std::size_t runs = 0 ;
+			// Everything fits in memory.
+			BOOST_CHECK_EQUAL( join( write_sorted( extensions[i], positions, 1024 * 1024, &sorted, &runs, specs[j] )), "rs3 rs5 rs1 rs4 rs2 rs0" ) ;
+			BOOST_CHECK( !sorted ) ;
+			BOOST_CHECK_EQUAL( runs, 0 ) ;
+			// Each variant is spilled to its own run.
+			BOOST_CHECK_EQUAL( join( write_sorted( extensions[i], positions, 1, &sorted, &runs, specs[j] )), "rs3 rs5 rs1 rs4 rs2 rs0" ) ;
+			BOOST_CHECK( !sorted ) ;
+			BOOST_CHECK_EQUAL( runs, 6 ) ;
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_multi_pass_merge ) {
+	// 50 variants at 13 distinct positions, each spilled to its own run.
+	std::vector< int > positions ;
+	for( int v = 0; v < 50; ++v ) {
+		positions.push_back( 100 * (( v * 7 ) % 13 )) ;
+	}
+	// Equal variants must stay in the order they were written.
+	std::vector< std::pair< int, std::size_t > > expected_order ;
+	for( std::size_t v = 0; v < positions.size(); ++v ) {
+		expected_order.push_back( std::make_pair( positions[v], v )) ;
+	}
+	std::sort( expected_order.begin(), expected_order.end() ) ;
+	std::vector< std::string > expected ;
+	for( std::size_t v = 0; v < expected_order.size(); ++v ) {
+		expected.push_back( "rs" + genfile::string_utils::to_string( expected_order[v].second )) ;
+	}
+
+	std::vector< std::string > const genotypes_only( 1, ":genotypes:" ) ;
+	// A fan-in of 2 takes six passes over the runs; 3 and 7 leave runs over at the end of a pass.
+	std::size_t const max_runs_per_merge[] = { 2, 3, 7, 64 } ;
+	for( std::size_t i = 0; i < 4; ++i ) {
+		bool sorted = true ;
+		std::size_t runs = 0 ;
+		BOOST_CHECK_EQUAL(
+			join( write_sorted( ".bgen", positions, 1, &sorted, &runs, genotypes_only, max_runs_per_merge[i] )),
+			join( expected )
+		) ;
+		BOOST_CHECK( !sorted ) ;
+		BOOST_CHECK_EQUAL( runs, 50 ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_sorted_input ) {
+	int const sorted_positions[] = { 100, 200, 200, 300 } ;
+	std::vector< int > const positions( sorted_positions, sorted_positions + 4 ) ;
+	bool sorted = false ;
+	std::size_t runs = 0 ;
+	BOOST_CHECK_EQUAL( join( write_sorted( ".bgen", positions, 1, &sorted, &runs )), "rs0 rs1 rs2 rs3" ) ;
+	BOOST_CHECK( sorted ) ;
+	BOOST_CHECK_EQUAL( runs, 4 ) ;
+}
+
+AUTO_TEST_CASE( test_destroyed_without_finalise ) {
+	// A sink that is never finalised, e.g. because processing failed, writes no variants.
+	int const unsorted[] = { 500, 300, 400, 100 } ;
+	std::vector< int > const positions( unsorted, unsorted + 4 ) ;
+	std::size_t const memory_budgets[] = { 1, 1024 * 1024 } ;
+	for( std::size_t i = 0; i < 2; ++i ) {
+		bool sorted = true ;
+		std::size_t runs = 0 ;
+		BOOST_CHECK_EQUAL( join( write_sorted( ".gen", positions, memory_budgets[i], &sorted, &runs, std::vector< std::string >(), 64, false )), "" ) ;
+	}
+}
+
+AUTO_TEST_SUITE_END()
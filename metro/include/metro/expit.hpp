@@ -0,0 +1,30 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef METRO_EXPIT_HPP
+#define METRO_EXPIT_HPP
+
+#include <cmath>
+#include <Eigen/Core>
+
+namespace metro {
+	// Elementwise logistic function expit(x) = 1 / ( 1 + exp(-x) ).
+	// This is written as a single Eigen expression so that it is evaluated in one pass using Eigen's
+	// packet (SSE/AVX) exp(), without temporaries.  Unlike exp(x) / ( 1 + exp(x) ) it does not
+	// overflow for large x: it returns 1 for x > ~37 and underflows smoothly to 0 for x < -709.
+	template< typename Input, typename Output >
+	void expit( Eigen::MatrixBase< Input > const& x, Eigen::MatrixBase< Output > const& result ) {
+		Eigen::MatrixBase< Output >& out = const_cast< Eigen::MatrixBase< Output >& >( result ) ;
+		out.array() = ( 1.0 + ( -x.array() ).exp() ).inverse() ;
+	}
+
+	// Scalar version, for use in reference computations and non-vectorised code.
+	inline double expit( double x ) {
+		return 1.0 / ( 1.0 + std::exp( -x )) ;
+	}
+}
+
+#endif
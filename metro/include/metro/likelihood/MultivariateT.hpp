@@ -152,12 +152,16 @@ namespace metro {
 				// when computing the log-likelihood.
 				m_ldlt.compute( m_sigma ) ;
 				m_log_determinant = m_ldlt.vectorD().array().log().sum() ;
-				m_mean_centred_data = m_data->rowwise() - m_mean.transpose() ;
 				// Z is a vector of the terms ( x_i - mu )^t Sigma^-1 ( x_i - mu ).
-				m_A = m_ldlt.solve( m_mean_centred_data.transpose() ) ;
-				m_Z = (
-					m_mean_centred_data.array() * m_A.transpose().array()
-				).rowwise().sum() ;
+				// Only entries in the data subset are computed; others are set to zero.
+				m_Z.setZero( m_data->rows() ) ;
+				for( std::size_t i = 0; i < m_data_subset.number_of_subranges(); ++i ) {
+					DataRange const& range = m_data_subset[i] ;
+					compute_mahalanobis_distances(
+						m_data->block( range.begin(), 0, range.size(), m_p ),
+						m_Z.segment( range.begin(), range.size() )
+					) ;
+				}
 			}
 
 			// Get the value of the log-likelihood for the given data,
@@ -347,13 +351,8 @@ namespace metro {
 					// compute weights
 					// Vector of weights is given as
 					// (nu+p) / nu + (x_i-mean)^t R^-1 ( x_i - mean ).
-					// Our x_i - mean_i is stored in a single row of m_mean_centred_data.
-					m_A = m_ldlt.solve( m_mean_centred_data.transpose() ) ;
-					iterationWeights = (
-						m_mean_centred_data.array() * m_A.transpose().array()
-					).rowwise().sum() ;
-					iterationWeights += Vector::Constant( m_data->rows(), m_nu ) ;
-					iterationWeights.array() = iterationWeights.array().inverse() * ( m_nu + m_p ) ;
+					// The quadratic form was computed as m_Z by evaluate_at().
+					iterationWeights.array() = ( m_Z.array() + m_nu ).inverse() * ( m_nu + m_p ) ;
 
 					// compute new parameter estimates
 					// these are
@@ -388,11 +387,33 @@ namespace metro {
 
 			Eigen::LDLT< Matrix > m_ldlt ;
 			double m_log_determinant ;
-			Matrix m_mean_centred_data ;
-			Matrix m_A ;
 			Vector m_Z ;
 			
 		private:
+			// Compute ( x_i - mu )^t Sigma^-1 ( x_i - mu ) for each row x_i of a block of data,
+			// using the current mean and the decomposition of sigma computed by evaluate().
+			// For bivariate data (the common case, e.g. for intensity clusters) the inverse is written
+			// out explicitly so the whole block is computed in a single vectorised expression.
+			template< typename Data, typename Result >
+			void compute_mahalanobis_distances( Data const& data, Result result ) const {
+				if( m_p == 2 ) {
+					double const a = m_sigma( 0, 0 ) ;
+					double const b = m_sigma( 1, 0 ) ;
+					double const c = m_sigma( 1, 1 ) ;
+					double const determinant = a * c - b * b ;
+					result.array() = (
+						c * ( data.col(0).array() - m_mean(0) ).square()
+						- 2.0 * b * ( data.col(0).array() - m_mean(0) ) * ( data.col(1).array() - m_mean(1) )
+						+ a * ( data.col(1).array() - m_mean(1) ).square()
+					) / determinant ;
+				} else {
+					Matrix const mean_centred_data = data.rowwise() - m_mean.transpose() ;
+					result = (
+						mean_centred_data.array() * m_ldlt.solve( mean_centred_data.transpose() ).transpose().array()
+					).rowwise().sum() ;
+				}
+			}
+
 			
 			double compute_constant_terms( double const nu, double const p ) const {
 #if DEBUG_MULTIVARIATE_T
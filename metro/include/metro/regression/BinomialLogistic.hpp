@@ -86,7 +86,9 @@ namespace metro {
 			Matrix m_hx ; // coefficient for each level x in complete data likelihood for each sample.
 			Matrix m_normalisedDhx ; // coefficient of x in 1st derivative of mean function.
 			Matrix m_normalisedDdhx ; // coefficient of x^t ⊗ x in 2nd derivative of mean function.
-			Matrix m_f1 ; // temp storage used in likelihood and derivative computations
+			Vector m_linear_combination ; // temp storage used in likelihood and derivative computations
+			Eigen::ArrayXd m_f1 ; // temp storage for expit( linear combination )
+			Eigen::ArrayXd m_f0 ; // temp storage for expit( -linear combination )
 
 			Matrix m_first_derivative_terms ;
 			double m_value_of_function ;
@@ -0,0 +1,76 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef METRO_REGRESSION_LOGISTIC_TERMS_HPP
+#define METRO_REGRESSION_LOGISTIC_TERMS_HPP
+
+#include <cassert>
+#include <Eigen/Core>
+#include "metro/expit.hpp"
+
+namespace metro {
+	namespace regression {
+		// Compute per-sample terms of the binomial logistic likelihood and its derivatives over a range of samples.
+		// Given the linear predictor η and outcome counts k0 (baseline, 1st column of outcome) and k1
+		// (non-baseline, 2nd column), and writing f1 = expit(η) and f0 = expit(-η), this computes
+		//
+		//   fx = f1^k1 f0^k0
+		//   dfx = ( k1 f0 - k0 f1 ) fx                          (coefficient of xᵗ in the 1st derivative)
+		//   ddfx = ( ( k1 f0 - k0 f1 )² - ( k0 + k1 ) f0 f1 ) fx  (coefficient of x ⊗ xᵗ in the 2nd derivative)
+		//
+		// f0 is computed directly rather than as 1 - f1, so it keeps full precision when f1 is close to 1.
+		// When all outcome counts are 0 or 1 (the usual case) the powers are computed by selection rather than pow().
+		// Outputs are written elementwise, so they can be columns of larger matrices; dfx and ddfx are
+		// only written if numberOfDerivatives is at least 1 or 2 respectively.
+		// f1 and f0 are workspace owned by the caller, so that repeated calls do not allocate.
+		template< typename LinearPredictor, typename Outcome, typename Result >
+		void compute_logistic_terms(
+			Eigen::MatrixBase< LinearPredictor > const& linear_predictor,
+			Eigen::MatrixBase< Outcome > const& outcome,
+			Eigen::MatrixBase< Result > const& fx_,
+			Eigen::MatrixBase< Result > const& dfx_,
+			Eigen::MatrixBase< Result > const& ddfx_,
+			int const numberOfDerivatives,
+			Eigen::ArrayXd* f1_,
+			Eigen::ArrayXd* f0_
+		) {
+			assert( f1_ != 0 && f0_ != 0 ) ;
+			assert( outcome.cols() == 2 ) ;
+			assert( outcome.rows() == linear_predictor.rows() ) ;
+			Eigen::MatrixBase< Result >& fx = const_cast< Eigen::MatrixBase< Result >& >( fx_ ) ;
+			Eigen::MatrixBase< Result >& dfx = const_cast< Eigen::MatrixBase< Result >& >( dfx_ ) ;
+			Eigen::MatrixBase< Result >& ddfx = const_cast< Eigen::MatrixBase< Result >& >( ddfx_ ) ;
+
+			Eigen::ArrayXd& f1 = *f1_ ;
+			Eigen::ArrayXd& f0 = *f0_ ;
+			f1.resize( linear_predictor.rows() ) ;
+			f0.resize( linear_predictor.rows() ) ;
+			expit( linear_predictor, f1.matrix() ) ;
+			expit( -linear_predictor, f0.matrix() ) ;
+
+			bool const binary = (( outcome.array() == 0.0 ) || ( outcome.array() == 1.0 )).all() ;
+			if( binary ) {
+				fx.array() = ( outcome.col(1).array() != 0.0 ).select( f1, 1.0 )
+					* ( outcome.col(0).array() != 0.0 ).select( f0, 1.0 ) ;
+			} else {
+				fx.array() = f1.pow( outcome.col(1).array() ) * f0.pow( outcome.col(0).array() ) ;
+			}
+
+			if( numberOfDerivatives > 0 ) {
+				dfx.array() = outcome.col(1).array() * f0 - outcome.col(0).array() * f1 ;
+				if( numberOfDerivatives > 1 ) {
+					ddfx.array() = (
+						dfx.array().square()
+						- ( outcome.col(0).array() + outcome.col(1).array() ) * f0 * f1
+					) * fx.array() ;
+				}
+				dfx.array() *= fx.array() ;
+			}
+		}
+	}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <Eigen/Core>
 #include "metro/log_sum_exp.hpp"
 
@@ -23,29 +24,43 @@ namespace metro {
 			return max_value ;
 		}
 		// exponentiate
-		double result = max_value ;
+		double result = 0.0 ;
 		for( std::size_t i = 0; i < data.size(); ++i ) {
 			result += std::exp(data[i] - max_value) ;
 		}
 		return max_value + std::log( result ) ;
 	}
 	
+	// The rowwise versions work on whole columns at once, so that exp() is evaluated by Eigen's
+	// packet (SSE/AVX) implementation rather than one row at a time.
 	void rowwise_log_sum_exp( Eigen::MatrixXd const& data, Eigen::VectorXd* result ) {
 		assert( result ) ;
 		assert( result->size() == data.rows() ) ;
-
-		for( int i = 0; i < result->size(); ++i ) {
-			(*result)(i) = log_sum_exp( data.row(i) ) ;
+		if( data.cols() == 0 ) {
+			result->setZero() ;
+			return ;
 		}
+		Eigen::VectorXd const max_values = data.rowwise().maxCoeff() ;
+		Eigen::VectorXd const sums = ( data.colwise() - max_values ).array().exp().rowwise().sum() ;
+		result->array() = ( max_values.array() == -std::numeric_limits< double >::infinity() )
+			.select( max_values.array(), max_values.array() + sums.array().log() ) ;
 	}
+
 	void rowwise_log_sum_exp( Eigen::MatrixXd const& data, Eigen::MatrixXd const& nonmissingness, Eigen::VectorXd* result ) {
 		assert( result ) ;
 		assert( result->size() == data.rows() ) ;
 		assert( data.rows() == nonmissingness.rows() ) ;
 		assert( data.cols() == nonmissingness.cols() ) ;
-
-		for( int i = 0; i < result->size(); ++i ) {
-			(*result)(i) = log_sum_exp( data.row(i), nonmissingness.row(i) ) ;
+		if( data.cols() == 0 ) {
+			result->setZero() ;
+			return ;
 		}
+		Eigen::VectorXd const max_values = ( data.array() * nonmissingness.array() ).rowwise().maxCoeff() ;
+		Eigen::VectorXd const sums = (( data.colwise() - max_values ).array().exp() * nonmissingness.array() ).rowwise().sum() ;
+		result->array() = ( nonmissingness.array().rowwise().sum() == 0 ).select(
+			0.0,
+			( max_values.array() == -std::numeric_limits< double >::infinity() )
+				.select( max_values.array(), max_values.array() + sums.array().log() )
+		) ;
 	}
 }
@@ -12,6 +12,7 @@
 #include <boost/format.hpp>
 #include <boost/iterator/counting_iterator.hpp>
 #include "metro/regression/BinomialLogistic.hpp"
+#include "metro/regression/logistic_terms.hpp"
 #include "metro/intersect_ranges.hpp"
 #include "metro/count_range.hpp"
 #include "metro/summation.hpp"
@@ -426,10 +427,8 @@ namespace metro {
 			// Outcome data is two columns, conceptually row sum is n
 			// (the number of trials) and 2nd column is k (number of successes / non-baseline outcomes)
 			// The computation requires us to compute f0 and f1, the prob of a single
-			// baseline / non-baseline observation.
-			m_f1.resize( fx->rows(), 1 ) ;
-			Vector linear_combination ;
-			
+			// baseline / non-baseline observation; this is done for each range of samples
+			// by compute_logistic_terms().
 			for( int g = 0; g < L; ++g ) {
 				for( std::size_t i = 0; i < m_evaluated_samples.size(); ++i ) {
 					metro::SampleRange const& range = m_evaluated_samples[i] ; 
@@ -439,8 +438,6 @@ namespace metro {
 					ConstMatrixBlock design_matrix_block
 						= m_design->set_predictor_level( g, range ).matrix( range ) ;
 					
-					MatrixBlock f1 = m_f1.block( storage_range.begin(), 0, storage_range.size(), 1 ) ;
-					
 					ConstMatrixBlock outcome = m_design->outcome().block( range.begin(), 0, range.size(), m_design->outcome().cols() ) ;
 					assert( outcome.cols() == 2 ) ;
 
@@ -448,75 +445,29 @@ namespace metro {
 					MatrixBlock dfxBlock = dfx->block( storage_range.begin(), 0, storage_range.size(), L ) ;
 					MatrixBlock ddfxBlock = ddfx->block( storage_range.begin(), 0, storage_range.size(), L ) ;
 
-					auto one = Vector::Ones( range.size() ) ;
-
 #if DEBUG_LOGLIKELIHOOD
 					std::cerr << "design(" << g << ") =\n"
 						<< design_matrix_block.block( 0, 0, std::min( 10, int(design_matrix_block.rows())), design_matrix_block.cols() ) << ".\n" ;
 					std::cerr << "outcome(" << g << ") =\n"
 						<< outcome.block( 0, 0, std::min( 10, int(outcome.rows())), outcome.cols() ) << ".\n" ;
 #endif
-					f1 = (design_matrix_block * parameters).array().exp() ;
-					f1 = f1.array() * ((one + f1).array().inverse()) ;
-				
-				// Likelihood is obtained by raising f1 and f0 to appropriate powers
-				
-#if DEBUG_LOGLIKELIHOOD
-					std::cerr << "(*fx) = \n"
-						<< fx->block( 0, 0, std::min( 10, int(fx->rows())), fx->cols() ) << ".\n" ;
-					std::cerr << "f1 = \n"
-						<< f1.block( 0, 0, std::min( 10, int(f1.rows())), f1.cols() ) << ".\n" ;
-#endif
-					fxBlock.col(g)
-						= f1.array().pow( outcome.col(1).array() )
-						* (one.array() - f1.array() ).pow( outcome.col(0).array() ) ;
-
-#if DEBUG_LOGLIKELIHOOD
-					std::cerr << "Computed f1 and fx, f1 = " << f1.block( 0, 0, std::min( 5, int(f1.rows())), 1 ).transpose() << ", \n"
-						<< "fx(" << g << ") = " << fxBlock.col(g).block(0, 0, std::min( 5, int(f1.rows())), 1 ).transpose() << ".\n" ;
-#endif
-
-					if( numberOfDerivatives > 0 ) {
-						// compute coefficient of x^t in 1st derivative
-						// To share computation with 2nd derivative,
-						// first compute the shared term, we multiple by fx below.
-
-#if DEBUG_LOGLIKELIHOOD
-						std::cerr << "    dfx: " << dfx->rows() << "x" << dfx->cols() << ".\n" ;
-						std::cerr << "outcome: " << outcome.rows() << "x" << outcome.cols() << ".\n" ;
-#endif
-						dfxBlock.col(g)
-							= ( outcome.col(1).array() * ( one - f1 ).array() - outcome.col(0).array() * f1.array() )
-						;
-
-#if DEBUG_LOGLIKELIHOOD
-						std::cerr << "dfx(" << g << ") before fx term = "
-							<< dfxBlock.col(g).segment(0, std::min( 5, int(dfxBlock.rows()) )).transpose() << ".\n" ;
-#endif
-
-						if( numberOfDerivatives > 1 ) {
-							// compute coefficient of x ⊗ x^t in 2nd derivative
-							ddfxBlock.col(g)
-								= dfxBlock.col(g).array().square()
-								- (
-										(outcome.col(0) + outcome.col(1)).array()
-										* (f1.array() * ( one.array() - f1.array() ))
-								).array()
-							;
-							ddfxBlock.col(g).array() *= fxBlock.col(g).array() ;
-
-#if DEBUG_LOGLIKELIHOOD
-							std::cerr << "ddfx(" << g << ") = "
-								<< ddfxBlock.col(g).segment(0, std::min( 5, int(ddfxBlock.rows()) )).transpose() << ".\n" ;
-#endif
-						}
-						dfxBlock.col(g).array() *= fxBlock.col(g).array() ;
+					m_linear_combination.noalias() = design_matrix_block * parameters ;
+					compute_logistic_terms(
+						m_linear_combination,
+						outcome,
+						fxBlock.col(g),
+						dfxBlock.col(g),
+						ddfxBlock.col(g),
+						numberOfDerivatives,
+						&m_f1,
+						&m_f0
+					) ;
 
 #if DEBUG_LOGLIKELIHOOD
-						std::cerr << "dfx(" << g << ") = "
-							<< dfxBlock.col(g).segment(0, std::min( 5, int(dfxBlock.rows()) )).transpose() << ".\n" ;
+					std::cerr << "fx(" << g << ") = " << fxBlock.col(g).segment(0, std::min( 5, int(fxBlock.rows()) )).transpose() << ".\n"
+						<< "dfx(" << g << ") = " << dfxBlock.col(g).segment(0, std::min( 5, int(dfxBlock.rows()) )).transpose() << ".\n"
+						<< "ddfx(" << g << ") = " << ddfxBlock.col(g).segment(0, std::min( 5, int(ddfxBlock.rows()) )).transpose() << ".\n" ;
 #endif
-					}
 				}
 			}
 		}
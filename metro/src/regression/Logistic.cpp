@@ -12,6 +12,7 @@
 #include <boost/format.hpp>
 #include <boost/iterator/counting_iterator.hpp>
 #include "metro/regression/Logistic.hpp"
+#include "metro/expit.hpp"
 #include "metro/intersect_ranges.hpp"
 #include "metro/summation.hpp"
 #include "genfile/string_utils.hpp"
@@ -250,9 +251,10 @@ namespace metro {
 		Logistic::Vector Logistic::evaluate_mean_function( Vector const& linear_combinations, Matrix const& outcomes ) const {
 			assert( linear_combinations.size() == outcomes.rows() ) ;
 			// Only the 2nd column of the outcome (i.e. outcome is not baseline) is used in this calculation.
-			Vector exps = linear_combinations.array().exp() ;
-			Vector ones = Vector::Ones( linear_combinations.size() ) ;
-			return ( ones.array() + outcomes.col(1).array() * ( exps.array() - ones.array() ) )  / ( ones + exps ).array() ;
+			// The result is expit(η) for non-baseline outcomes and expit(-η) for baseline outcomes.
+			Vector result( linear_combinations.size() ) ;
+			expit( (( 2.0 * outcomes.col(1).array() - 1.0 ) * linear_combinations.array() ).matrix(), result ) ;
+			return result ;
 		}
 
 		void Logistic::compute_value_of_function( Matrix const& V, std::vector< metro::SampleRange > const& included_samples ) {
@@ -0,0 +1,136 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <vector>
+#include <iostream>
+#include <limits>
+#include <cmath>
+#include <Eigen/Core>
+#include "test_case.hpp"
+#include "metro/expit.hpp"
+#include "metro/log_sum_exp.hpp"
+#include "metro/regression/logistic_terms.hpp"
+
+// Check the vectorised kernels against straightforward scalar computations.
+
+BOOST_AUTO_TEST_SUITE( test_expit )
+
+AUTO_TEST_CASE( test_expit_accuracy ) {
+	int const N = 3001 ;
+	Eigen::VectorXd x( N ) ;
+	for( int i = 0; i < N; ++i ) {
+		x(i) = -750.0 + 0.5 * i ;
+	}
+	Eigen::VectorXd result( N ) ;
+	metro::expit( x, result ) ;
+	for( int i = 0; i < N; ++i ) {
+		double const expected = 1.0 / ( 1.0 + std::exp( -x(i) )) ;
+		BOOST_CHECK( result(i) == result(i) ) ;
+		BOOST_CHECK( result(i) >= 0.0 && result(i) <= 1.0 ) ;
+		if( expected > std::numeric_limits< double >::min() ) {
+			BOOST_CHECK_CLOSE( result(i), expected, 1E-12 ) ;
+		} else {
+			BOOST_CHECK_SMALL( result(i), std::numeric_limits< double >::min() ) ;
+		}
+		BOOST_CHECK_EQUAL( metro::expit( x(i) ), expected ) ;
+	}
+}
+
+AUTO_TEST_CASE( test_logistic_terms ) {
+	int const N = 401 ;
+	Eigen::VectorXd linear_predictor( N ) ;
+	for( int i = 0; i < N; ++i ) {
+		linear_predictor(i) = -20.0 + 0.1 * i ;
+	}
+	// Binary outcomes, and binomial counts.
+	// Workspace is reused across calls.
+	Eigen::ArrayXd f1, f0 ;
+	for( int binomial = 0; binomial < 2; ++binomial ) {
+		Eigen::MatrixXd outcome( N, 2 ) ;
+		for( int i = 0; i < N; ++i ) {
+			outcome( i, 1 ) = binomial ? ( i % 4 ) : ( i % 2 ) ;
+			outcome( i, 0 ) = binomial ? ( 3 - ( i % 4 )) : ( 1 - ( i % 2 )) ;
+		}
+		Eigen::MatrixXd terms( N, 3 ) ;
+		metro::regression::compute_logistic_terms( linear_predictor, outcome, terms.col(0), terms.col(1), terms.col(2), 2, &f1, &f0 ) ;
+		for( int i = 0; i < N; ++i ) {
+			double const f1 = std::exp( linear_predictor(i) ) / ( 1.0 + std::exp( linear_predictor(i) )) ;
+			double const f0 = 1.0 - f1 ;
+			double const k1 = outcome( i, 1 ) ;
+			double const k0 = outcome( i, 0 ) ;
+			double const fx = std::pow( f1, k1 ) * std::pow( f0, k0 ) ;
+			double const d = k1 * f0 - k0 * f1 ;
+			double const dfx = d * fx ;
+			double const ddfx = ( d * d - ( k0 + k1 ) * f0 * f1 ) * fx ;
+			// The scalar reference loses relative precision in f0 as f1 approaches 1.
+			double const tolerance = ( linear_predictor(i) > 5 ) ? 1E-4 : 1E-9 ;
+			BOOST_CHECK_CLOSE( terms( i, 0 ), fx, tolerance ) ;
+			if( std::abs( dfx ) > 1E-300 ) {
+				BOOST_CHECK_CLOSE( terms( i, 1 ), dfx, tolerance ) ;
+			}
+			if( std::abs( ddfx ) > 1E-12 ) {
+				BOOST_CHECK_CLOSE( terms( i, 2 ), ddfx, tolerance ) ;
+			}
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_logistic_terms_extreme_values ) {
+	// exp(x)/(1+exp(x)) is NaN for x > 709; the kernel is not.
+	Eigen::VectorXd linear_predictor( 4 ) ;
+	linear_predictor << -1000, -710, 710, 1000 ;
+	Eigen::MatrixXd outcome = Eigen::MatrixXd::Zero( 4, 2 ) ;
+	outcome.col(1).setOnes() ;
+	Eigen::MatrixXd terms( 4, 3 ) ;
+	Eigen::ArrayXd f1, f0 ;
+	metro::regression::compute_logistic_terms( linear_predictor, outcome, terms.col(0), terms.col(1), terms.col(2), 2, &f1, &f0 ) ;
+	BOOST_CHECK_SMALL( terms( 0, 0 ), 1E-300 ) ;
+	BOOST_CHECK_SMALL( terms( 1, 0 ), 1E-300 ) ;
+	BOOST_CHECK_EQUAL( terms( 2, 0 ), 1.0 ) ;
+	BOOST_CHECK_EQUAL( terms( 3, 0 ), 1.0 ) ;
+	BOOST_CHECK( terms.allFinite() ) ;
+}
+
+AUTO_TEST_CASE( test_rowwise_log_sum_exp ) {
+	double const infinity = std::numeric_limits< double >::infinity() ;
+	Eigen::MatrixXd data( 6, 3 ) ;
+	data <<
+		0, 0, 0,
+		-1000, -1000, -1000,
+		1000, 0, -1000,
+		-infinity, -infinity, -infinity,
+		-infinity, 2.5, -infinity,
+		-3.2, 7.1, 0.01 ;
+	Eigen::MatrixXd nonmissingness = Eigen::MatrixXd::Ones( 6, 3 ) ;
+	nonmissingness( 2, 0 ) = 0 ;
+	nonmissingness( 5, 1 ) = 0 ;
+
+	Eigen::VectorXd result( 6 ) ;
+	metro::rowwise_log_sum_exp( data, &result ) ;
+	Eigen::VectorXd nonmissing_result( 6 ) ;
+	metro::rowwise_log_sum_exp( data, nonmissingness, &nonmissing_result ) ;
+
+	for( int i = 0; i < data.rows(); ++i ) {
+		double const expected = metro::log_sum_exp( data.row(i) ) ;
+		if( expected == -infinity ) {
+			BOOST_CHECK_EQUAL( result(i), -infinity ) ;
+		} else {
+			BOOST_CHECK_CLOSE( result(i), expected, 1E-12 ) ;
+		}
+	}
+	BOOST_CHECK_CLOSE( result(0), std::log( 3.0 ), 1E-12 ) ;
+	BOOST_CHECK_CLOSE( result(1), -1000 + std::log( 3.0 ), 1E-12 ) ;
+	BOOST_CHECK_CLOSE( result(2), 1000.0, 1E-12 ) ;
+	BOOST_CHECK_CLOSE( result(4), 2.5, 1E-12 ) ;
+
+	for( int i = 0; i < 2; ++i ) {
+		BOOST_CHECK_CLOSE( nonmissing_result(i), result(i), 1E-12 ) ;
+	}
+	BOOST_CHECK_CLOSE( nonmissing_result(5), std::log( std::exp( -3.2 ) + std::exp( 0.01 )), 1E-12 ) ;
+	BOOST_CHECK_CLOSE( nonmissing_result(5), metro::log_sum_exp( data.row(5), nonmissingness.row(5) ), 1E-12 ) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef QCTOOL_QCDB_COLUMNAR_FILE_OUTPUTTER_HPP
+#define QCTOOL_QCDB_COLUMNAR_FILE_OUTPUTTER_HPP
+
+#include <string>
+#include <memory>
+#include <map>
+#include <vector>
+#include <utility>
+#include "genfile/VariantEntry.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "statfile/ColumnarFormat.hpp"
+#include "qcdb/Storage.hpp"
+#include "qcdb/StorageOptions.hpp"
+
+namespace qcdb {
+	// Storage that writes per-variant data to a columnar binary file (see statfile/ColumnarFormat.hpp),
+	// with the same columns as FlatFileOutputter.  Values are buffered by column and written
+	// as a row group every 10000 variants.  Unlike flat files, variables may be added after
+	// data has been written; earlier rows have missing values for them.
+	struct ColumnarFileOutputter: public Storage {
+		typedef std::map< std::string, std::pair< std::vector< std::string >, std::string > > Metadata ;
+		static UniquePtr create(
+			std::string const& filename,
+			std::string const& analysis_name,
+			Metadata const& metadata,
+			statfile::columnar::Compression compression = statfile::columnar::eZstdCompression
+		) ;
+		static SharedPtr create_shared(
+			std::string const& filename,
+			std::string const& analysis_name,
+			Metadata const& metadata,
+			statfile::columnar::Compression compression = statfile::columnar::eZstdCompression
+		) ;
+
+		ColumnarFileOutputter(
+			std::string const& filename,
+			std::string const& analysis_name,
+			Metadata const& metadata,
+			statfile::columnar::Compression compression
+		) ;
+		~ColumnarFileOutputter() ;
+
+		void add_variable( std::string const& ) ;
+
+		void create_new_variant( genfile::VariantIdentifyingData const& ) ;
+		void store_per_variant_data(
+			genfile::VariantIdentifyingData const& snp,
+			std::string const& value_name,
+			genfile::VariantEntry const& value
+		) ;
+
+		void finalise( long options = eCreateIndices ) ;
+
+		AnalysisId analysis_id() const ;
+	private:
+		std::string const m_analysis_name ;
+		Metadata const m_metadata ;
+		std::size_t const m_max_snps_per_block ;
+		statfile::columnar::Writer::UniquePtr m_writer ;
+		std::vector< genfile::VariantIdentifyingData > m_snps ;
+		std::vector< std::string > m_column_names ;
+		typedef std::map< std::string, std::size_t > VariableMap ;
+		VariableMap m_variables ;
+		std::vector< std::vector< genfile::VariantEntry > > m_columns ;
+		bool m_finalised ;
+
+	private:
+		void add_snp( genfile::VariantIdentifyingData const& snp ) ;
+		std::size_t get_column( std::string const& variable ) ;
+		void store_block() ;
+		std::string format_metadata() const ;
+	} ;
+}
+
+#endif
@@ -0,0 +1,177 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <memory>
+#include <sstream>
+#include <boost/bind.hpp>
+#include "genfile/VariantEntry.hpp"
+#include "genfile/VariantIdentifyingData.hpp"
+#include "genfile/Error.hpp"
+#include "genfile/string_utils.hpp"
+#include "statfile/ColumnarFormat.hpp"
+#include "appcontext/get_current_time_as_string.hpp"
+#include "qcdb/Storage.hpp"
+#include "qcdb/ColumnarFileOutputter.hpp"
+
+namespace qcdb {
+	namespace {
+		void append_to_string( std::string* target, std::string const& value ) {
+			(*target) += ( target->size() > 0 ? "," : "" ) + value ;
+		}
+
+		enum { eAlternateIds = 0, eRsid = 1, eChromosome = 2, ePosition = 3, eAlleleA = 4, eAlleleB = 5, eNumberOfFixedColumns = 6 } ;
+	}
+
+	ColumnarFileOutputter::UniquePtr ColumnarFileOutputter::create(
+		std::string const& filename,
+		std::string const& analysis_name,
+		Metadata const& metadata,
+		statfile::columnar::Compression compression
+	) {
+		return UniquePtr( new ColumnarFileOutputter( filename, analysis_name, metadata, compression ) ) ;
+	}
+
+	ColumnarFileOutputter::SharedPtr ColumnarFileOutputter::create_shared(
+		std::string const& filename,
+		std::string const& analysis_name,
+		Metadata const& metadata,
+		statfile::columnar::Compression compression
+	) {
+		return SharedPtr( new ColumnarFileOutputter( filename, analysis_name, metadata, compression ) ) ;
+	}
+
+	ColumnarFileOutputter::ColumnarFileOutputter(
+		std::string const& filename,
+		std::string const& analysis_name,
+		Metadata const& metadata,
+		statfile::columnar::Compression compression
+	):
+		m_analysis_name( analysis_name ),
+		m_metadata( metadata ),
+		m_max_snps_per_block( 10000 ),
+		m_writer( statfile::columnar::Writer::create( filename, compression )),
+		m_columns( eNumberOfFixedColumns ),
+		m_finalised( false )
+	{
+		m_column_names.push_back( "alternate_ids" ) ;
+		m_column_names.push_back( "rsid" ) ;
+		m_column_names.push_back( "chromosome" ) ;
+		m_column_names.push_back( "position" ) ;
+		m_column_names.push_back( "alleleA" ) ;
+		m_column_names.push_back( "alleleB" ) ;
+		m_snps.reserve( m_max_snps_per_block ) ;
+	}
+
+	ColumnarFileOutputter::~ColumnarFileOutputter() {
+		if( !m_finalised ) {
+			store_block() ;
+			m_writer->finalise( format_metadata(), m_column_names ) ;
+		}
+	}
+
+	void ColumnarFileOutputter::finalise( long ) {
+		store_block() ;
+		m_writer->finalise(
+			format_metadata() + "Completed successfully at " + appcontext::get_current_time_as_string() + "\n",
+			m_column_names
+		) ;
+		m_finalised = true ;
+	}
+
+	ColumnarFileOutputter::AnalysisId ColumnarFileOutputter::analysis_id() const {
+		// A columnar file only ever has one analysis.
+		return 0 ;
+	}
+
+	void ColumnarFileOutputter::add_variable( std::string const& variable ) {
+		get_column( variable ) ;
+	}
+
+	void ColumnarFileOutputter::create_new_variant( genfile::VariantIdentifyingData const& snp ) {
+		add_snp( snp ) ;
+	}
+
+	void ColumnarFileOutputter::store_per_variant_data(
+		genfile::VariantIdentifyingData const& snp,
+		std::string const& variable,
+		genfile::VariantEntry const& value
+	) {
+		if( m_snps.empty() || snp != m_snps.back() ) {
+			add_snp( snp ) ;
+		}
+		std::vector< genfile::VariantEntry >& column = m_columns[ get_column( variable ) ] ;
+		column.resize( m_snps.size() ) ;
+		column.back() = value ;
+	}
+
+	void ColumnarFileOutputter::add_snp( genfile::VariantIdentifyingData const& snp ) {
+		// If we have a whole block's worth of data, store it now.
+		if( m_snps.size() == m_max_snps_per_block ) {
+			store_block() ;
+		}
+		m_snps.push_back( snp ) ;
+	}
+
+	std::size_t ColumnarFileOutputter::get_column( std::string const& variable ) {
+		VariableMap::const_iterator where = m_variables.find( variable ) ;
+		if( where == m_variables.end() ) {
+			// Retain the order of addition.
+			where = m_variables.insert( std::make_pair( variable, m_column_names.size() ) ).first ;
+			m_column_names.push_back( variable ) ;
+			m_columns.resize( m_column_names.size() ) ;
+		}
+		return where->second ;
+	}
+
+	void ColumnarFileOutputter::store_block() {
+		if( m_snps.empty() ) {
+			return ;
+		}
+		std::size_t const N = m_snps.size() ;
+		for( std::size_t i = 0; i < eNumberOfFixedColumns; ++i ) {
+			m_columns[i].resize( N ) ;
+		}
+		for( std::size_t snp_i = 0; snp_i < N; ++snp_i ) {
+			genfile::VariantIdentifyingData const& snp = m_snps[ snp_i ] ;
+			std::string SNPID ;
+			if( snp.number_of_identifiers() == 1 ) {
+				SNPID = "NA" ;
+			} else {
+				snp.get_identifiers( boost::bind( &append_to_string, &SNPID, _1 ), 1 ) ;
+			}
+			m_columns[ eAlternateIds ][ snp_i ] = SNPID ;
+			m_columns[ eRsid ][ snp_i ] = std::string( snp.get_primary_id() ) ;
+			m_columns[ eChromosome ][ snp_i ] = std::string( snp.get_position().chromosome() ) ;
+			m_columns[ ePosition ][ snp_i ] = genfile::VariantEntry::Integer( snp.get_position().position() ) ;
+			m_columns[ eAlleleA ][ snp_i ] = std::string( snp.get_allele(0) ) ;
+			m_columns[ eAlleleB ][ snp_i ] = ( snp.number_of_alleles() < 2 ) ? std::string( "." ) : snp.get_alleles_as_string( ",", 1, snp.number_of_alleles() ) ;
+		}
+		for( std::size_t i = eNumberOfFixedColumns; i < m_columns.size(); ++i ) {
+			m_columns[i].resize( N ) ;
+		}
+		m_writer->write_row_group( m_columns ) ;
+		for( std::size_t i = 0; i < m_columns.size(); ++i ) {
+			m_columns[i].clear() ;
+		}
+		m_snps.clear() ;
+	}
+
+	std::string ColumnarFileOutputter::format_metadata() const {
+		std::ostringstream str ;
+		str << "Analysis: \"" << m_analysis_name << "\"\n"
+			<< " started: " << appcontext::get_current_time_as_string() << "\n" ;
+		str << "\nAnalysis properties:\n" ;
+		for( Metadata::const_iterator i = m_metadata.begin(); i != m_metadata.end(); ++i ) {
+			str << "  "
+				<< i->first
+				<< " "
+				<< genfile::string_utils::join( i->second.first, " " )
+				<< " (" + i->second.second + ")\n" ;
+		}
+		return str.str() ;
+	}
+}
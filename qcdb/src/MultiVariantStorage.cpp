@@ -14,6 +14,7 @@
 #include "qcdb/MultiVariantStorage.hpp"
 #include "qcdb/FlatTableMultiVariantDBOutputter.hpp"
 #include "qcdb/FlatFileMultiVariantOutputter.hpp"
+#include "genfile/Error.hpp"
 
 namespace qcdb {
 	MultiVariantStorage::UniquePtr MultiVariantStorage::create(
@@ -54,6 +55,12 @@ namespace qcdb {
 				metadata
 			) ;
 			result.reset( file_storage.release() ) ;
+		} else if( file_spec[0] == "columnar" ) {
+			throw genfile::BadArgumentError(
+				"qcdb::MultiVariantStorage::create()",
+				"filename=\"" + filename + "\"",
+				"Columnar output is not supported for multi-variant results."
+			) ;
 		} else {
 			assert(0) ;
 		}
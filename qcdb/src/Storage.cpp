@@ -14,6 +14,8 @@
 #include "qcdb/Storage.hpp"
 #include "qcdb/FlatTableDBOutputter.hpp"
 #include "qcdb/FlatFileOutputter.hpp"
+#include "qcdb/ColumnarFileOutputter.hpp"
+#include "statfile/ColumnarFormat.hpp"
 
 namespace qcdb {
 	std::vector< std::string > Storage::parse_filespec( std::string spec ) {
@@ -31,6 +33,8 @@ namespace qcdb {
 
 		if( elts[0].size() >= 7 && elts[0].substr( elts[0].size() - 7, 7 ) == ".sqlite" ) {
 			result[0] = "sqlite" ;
+		} else if( result[0] == "flat" && statfile::columnar::is_columnar_filename( elts[0] )) {
+			result[0] = "columnar" ;
 		}
 		result[1] = elts[0] ;
 
@@ -38,10 +42,14 @@ namespace qcdb {
 			throw genfile::BadArgumentError(
 				"parse_filespec()",
 				"spec=\"" + spec + "\"",
-				"Expected format for filespec is <filename> or sqlite://<filename>[:<tablename>]."
+				"Expected format for filespec is <filename>, <filename>.qcol[:<compression>] or sqlite://<filename>[:<tablename>]."
 			) ;
 		}
-		if( elts.size() == 2 ) {
+		if( elts.size() == 2 && result[0] == "columnar" ) {
+			// Check the compression now so that errors are reported early.
+			statfile::columnar::parse_compression( elts[1] ) ;
+			result.push_back( elts[1] ) ;
+		} else if( elts.size() == 2 ) {
 			if( result[0] != "sqlite" ) {
 				throw genfile::BadArgumentError(
 					"parse_filespec()",
@@ -85,6 +93,13 @@ namespace qcdb {
 				table_storage->set_table_name( file_spec[2] ) ;
 			}
 			result = table_storage ;
+		} else if( file_spec[0] == "columnar" ) {
+			result = ColumnarFileOutputter::create(
+				file_spec[1],
+				analysis_name,
+				metadata,
+				( file_spec.size() == 3 ) ? statfile::columnar::parse_compression( file_spec[2] ) : statfile::columnar::eZstdCompression
+			) ;
 		} else {
 			assert( file_spec[0] == "flat" ) ;
 			result = FlatFileOutputter::create(
@@ -0,0 +1,148 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef STATFILE_COLUMNAR_FORMAT_HPP
+#define STATFILE_COLUMNAR_FORMAT_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include "genfile/VariantEntry.hpp"
+
+namespace statfile {
+	// Self-describing columnar binary files of typed values.
+	// A columnar file consists of:
+	// - the 8 bytes "QCCOLUMN" and a 32-bit format version,
+	// - a sequence of row groups, each a sequence of column chunks holding the values of one column
+	//   for consecutive rows,
+	// - the footer, described below,
+	// - the 64-bit file offset of the footer, and the 8 bytes "QCCOLUMN" again.
+	// Each column chunk holds one bit per row (set if the value is present) padded to a whole byte,
+	// followed by the values:
+	// - for int64 chunks, a 64-bit integer per row;
+	// - for double chunks, a 64-bit IEEE double per row;
+	// - for string chunks, a 32-bit dictionary size, each distinct string as a 32-bit length and bytes,
+	//   and a 32-bit dictionary index per row.
+	// Missing rows hold zero.  The chunk may be compressed with zstd as a whole.
+	// The footer consists of:
+	// - a 32-bit length and that many bytes of free-text metadata,
+	// - a 32-bit number of columns, then each column name as a 32-bit length and bytes,
+	// - a 64-bit total number of rows and a 32-bit number of row groups,
+	// - for each row group, a 64-bit number of rows and 32-bit number of chunks, then for each chunk the
+	//   8-bit type and compression, a 16-bit zero, 64-bit file offset, stored size and uncompressed size,
+	//   and an 8-bit flag indicating whether the minimum and maximum present values follow.  These are stored
+	//   as 64-bit values for int64 and double chunks, and as 32-bit length and bytes for string chunks.
+	// A row group may have fewer chunks than there are columns; values of the remaining columns are missing.
+	// All numbers are little-endian.
+	namespace columnar {
+		enum ColumnType { eInt64 = 1, eDouble = 2, eString = 3 } ;
+		enum Compression { eNoCompression = 0, eZstdCompression = 1 } ;
+		static uint32_t const version = 1 ;
+
+		// Return true if the filename indicates a columnar file, i.e. ends in ".qcol".
+		bool is_columnar_filename( std::string const& filename ) ;
+		// Parse a compression name, "zstd" or "none".
+		Compression parse_compression( std::string const& spec ) ;
+
+		// Description of one column chunk, as stored in the footer.
+		struct Chunk {
+			Chunk() ;
+			ColumnType type ;
+			Compression compression ;
+			uint64_t offset ;
+			uint64_t stored_size ;
+			uint64_t uncompressed_size ;
+			bool has_range ;
+			genfile::VariantEntry minimum ;
+			genfile::VariantEntry maximum ;
+		} ;
+
+		struct RowGroup {
+			uint64_t number_of_rows ;
+			std::vector< Chunk > chunks ;
+		} ;
+
+		// The values of one column chunk, as decoded from the file.
+		struct Column {
+			ColumnType type ;
+			std::vector< char > present ;
+			std::vector< int64_t > integers ;
+			std::vector< double > doubles ;
+			std::vector< std::string > dictionary ;
+			std::vector< uint32_t > indices ;
+
+			// Fill with the given number of missing values.
+			void set_missing( std::size_t number_of_rows ) ;
+			std::size_t size() const { return present.size() ; }
+			bool is_missing( std::size_t i ) const { return !present[i] ; }
+			genfile::VariantEntry get( std::size_t i ) const ;
+		} ;
+
+		// Writes row groups of values to a columnar file.
+		// Each chunk takes the narrowest type that holds all its values: int64 if all present values are
+		// integers, double if all are numbers, and string otherwise.  Chromosomes and positions are stored
+		// as strings and integers respectively.
+		struct Writer: public boost::noncopyable {
+			typedef std::auto_ptr< Writer > UniquePtr ;
+			static UniquePtr create( std::string const& filename, Compression compression = eZstdCompression ) ;
+
+			Writer( std::string const& filename, Compression compression ) ;
+			~Writer() ;
+
+			// Write a row group; columns[i] holds the values of column i, and all must have the same size.
+			void write_row_group( std::vector< std::vector< genfile::VariantEntry > > const& columns ) ;
+			// Write the footer with the given metadata and column names and close the file.
+			void finalise( std::string const& metadata, std::vector< std::string > const& column_names ) ;
+
+		private:
+			std::string const m_filename ;
+			Compression const m_compression ;
+			std::ofstream m_stream ;
+			uint64_t m_number_of_rows ;
+			std::vector< RowGroup > m_row_groups ;
+			std::vector< uint8_t > m_buffer ;
+			std::vector< uint8_t > m_compressed ;
+			bool m_finalised ;
+
+			void write_chunk( std::vector< genfile::VariantEntry > const& values, Chunk* chunk ) ;
+		} ;
+
+		// Reads the footer and column chunks of a columnar file.
+		struct Reader: public boost::noncopyable {
+			typedef std::auto_ptr< Reader > UniquePtr ;
+			static UniquePtr open( std::string const& filename ) ;
+
+			Reader( std::string const& filename ) ;
+
+			std::string const& filename() const { return m_filename ; }
+			std::string const& metadata() const { return m_metadata ; }
+			std::vector< std::string > const& column_names() const { return m_column_names ; }
+			uint64_t number_of_rows() const { return m_number_of_rows ; }
+			std::size_t number_of_row_groups() const { return m_row_groups.size() ; }
+			RowGroup const& row_group( std::size_t i ) const { return m_row_groups[i] ; }
+
+			// Read and decode the given column of the given row group.
+			void read_column( std::size_t row_group, std::size_t column, Column* result ) ;
+
+		private:
+			std::string const m_filename ;
+			std::ifstream m_stream ;
+			std::string m_metadata ;
+			std::vector< std::string > m_column_names ;
+			uint64_t m_number_of_rows ;
+			std::vector< RowGroup > m_row_groups ;
+			std::vector< uint8_t > m_buffer ;
+			std::vector< uint8_t > m_uncompressed ;
+
+			void read_footer() ;
+		} ;
+	}
+}
+
+#endif
@@ -0,0 +1,66 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef STATFILE_COLUMNAR_STAT_SINK_HPP
+#define STATFILE_COLUMNAR_STAT_SINK_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "genfile/Chromosome.hpp"
+#include "genfile/GenomePosition.hpp"
+#include "genfile/MissingValue.hpp"
+#include "genfile/VariantEntry.hpp"
+#include "statfile/StatSink.hpp"
+#include "statfile/BuiltInTypeStatSink.hpp"
+#include "statfile/ColumnarFormat.hpp"
+
+namespace statfile {
+	// Writes rows to a file in the columnar format (see ColumnarFormat.hpp).
+	// Rows are buffered and written as a row group every rows_per_group rows; the footer is
+	// written when the sink is destroyed.
+	class ColumnarStatSink: public ColumnNamingStatSink< BuiltInTypeStatSink >
+	{
+	public:
+		typedef ColumnNamingStatSink< BuiltInTypeStatSink > Base ;
+		typedef std::auto_ptr< ColumnarStatSink > UniquePtr ;
+
+		ColumnarStatSink(
+			std::string const& filename,
+			columnar::Compression compression = columnar::eZstdCompression,
+			std::size_t rows_per_group = 10000
+		) ;
+		~ColumnarStatSink() ;
+
+		operator bool() const { return true ; }
+		void write_metadata( std::string const& metadata ) { m_metadata = metadata ; }
+		void write_comment( std::string const& comment ) ;
+
+	protected:
+		using Base::write_value ;
+		void write_value( int32_t const& value ) { store( genfile::VariantEntry::Integer( value )) ; }
+		void write_value( uint32_t const& value ) { store( genfile::VariantEntry::Integer( value )) ; }
+		void write_value( int64_t const& value ) { store( genfile::VariantEntry::Integer( value )) ; }
+		void write_value( uint64_t const& value ) { store( genfile::VariantEntry::Integer( value )) ; }
+		void write_value( std::string const& value ) { store( value ) ; }
+		void write_value( double const& value ) { store( value ) ; }
+		void write_value( genfile::MissingValue const& value ) { store( value ) ; }
+		void write_value( genfile::Chromosome const& value ) { store( value ) ; }
+		void write_value( genfile::GenomePosition const& value ) { store( value ) ; }
+
+	private:
+		columnar::Writer::UniquePtr m_writer ;
+		std::size_t const m_rows_per_group ;
+		std::string m_metadata ;
+		std::vector< std::vector< genfile::VariantEntry > > m_columns ;
+
+		void store( genfile::VariantEntry const& value ) ;
+		void move_to_next_row_impl() ;
+		void write_row_group() ;
+	} ;
+}
+
+#endif
@@ -0,0 +1,84 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef STATFILE_COLUMNAR_STAT_SOURCE_HPP
+#define STATFILE_COLUMNAR_STAT_SOURCE_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "statfile/StatSource.hpp"
+#include "statfile/BuiltInTypeStatSource.hpp"
+#include "statfile/ColumnarFormat.hpp"
+
+namespace statfile {
+	// Reads files written in the columnar format (see ColumnarFormat.hpp).
+	// Column chunks are decoded only when a value in them is read, so columns that are ignored
+	// are never decompressed.
+	// Range filters restrict the rows returned to those whose value in a column lies in a range.
+	// Row groups whose stored minimum and maximum show that no row can match are skipped without
+	// being read, so filtering on chromosome and position is cheap for files sorted by position.
+	class ColumnarStatSource: public ColumnNamingStatSource< BuiltInTypeStatSource >
+	{
+		typedef ColumnNamingStatSource< BuiltInTypeStatSource > Base ;
+	public:
+		typedef std::auto_ptr< ColumnarStatSource > UniquePtr ;
+		static UniquePtr open( std::string const& filename ) ;
+
+		ColumnarStatSource( std::string const& filename ) ;
+
+		// Return only rows whose value in the given column is a number in [lower, upper].
+		void add_range_filter( std::string const& column, double lower, double upper ) ;
+		// Return only rows whose value in the given column is a string in [lower, upper]
+		// in lexicographical order.
+		void add_range_filter( std::string const& column, std::string const& lower, std::string const& upper ) ;
+
+		void reset_to_start() ;
+		operator bool() const { return m_have_more_data ; }
+		OptionalCount number_of_rows() const ;
+		std::string get_descriptive_text() const { return m_reader->metadata() ; }
+		std::string get_source_spec() const { return m_reader->filename() ; }
+		// Return the number of row groups read so far.
+		std::size_t number_of_row_groups_read() const { return m_number_of_row_groups_read ; }
+
+	protected:
+		using Base::read_value ;
+		void read_value( int32_t& ) ;
+		void read_value( uint32_t& ) ;
+		void read_value( std::string& ) ;
+		void read_value( double& ) ;
+		void ignore_value() {}
+		void ignore_all() {}
+		void restart_row() {}
+		void move_to_next_row_impl() ;
+
+	private:
+		struct RangeFilter {
+			std::size_t column ;
+			bool numeric ;
+			double lower, upper ;
+			std::string lower_string, upper_string ;
+		} ;
+
+		columnar::Reader::UniquePtr m_reader ;
+		std::vector< RangeFilter > m_filters ;
+		std::size_t m_group ;
+		std::size_t m_row ;
+		bool m_have_more_data ;
+		std::vector< columnar::Column > m_columns ;
+		std::vector< char > m_loaded ;
+		std::size_t m_number_of_row_groups_read ;
+
+		columnar::Column const& column( std::size_t i ) ;
+		void load_group( std::size_t group ) ;
+		void find_next_row( std::size_t group, std::size_t row ) ;
+		bool row_group_may_match( std::size_t group ) const ;
+		bool row_matches( std::size_t row ) ;
+		int64_t read_integer() ;
+	} ;
+}
+
+#endif
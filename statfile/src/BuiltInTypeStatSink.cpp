@@ -9,6 +9,7 @@
 #include <string>
 #include "statfile/StatSink.hpp"
 #include "statfile/DelimitedStatSink.hpp"
+#include "statfile/ColumnarStatSink.hpp"
 
 namespace statfile {
 	std::auto_ptr< BuiltInTypeStatSink > BuiltInTypeStatSink::open( std::string const& filename ) {
@@ -24,6 +25,9 @@ namespace statfile {
 		else if( format == statfile::e_SpaceDelimited ) {
 			result.reset( new statfile::DelimitedStatSink( filename, " " ) ) ;
 		}
+		else if( format == statfile::e_ColumnarFormat ) {
+			result.reset( new statfile::ColumnarStatSink( filename ) ) ;
+		}
 		else {
 			// default to tab-separated format.
 			result.reset( new statfile::DelimitedStatSink( filename, "\t" ) ) ;
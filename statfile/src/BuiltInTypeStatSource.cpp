@@ -9,6 +9,7 @@
 #include "statfile/statfile_utils.hpp"
 #include "statfile/StatSource.hpp"
 #include "statfile/DelimitedStatSource.hpp"
+#include "statfile/ColumnarStatSource.hpp"
 #include "statfile/BuiltInTypeStatSource.hpp"
 #include "statfile/BuiltInTypeStatSourceChain.hpp"
 
@@ -25,6 +26,9 @@ namespace statfile {
 		else if( format == e_SpaceDelimited ) {
 			source.reset( new statfile::DelimitedStatSource( filename, " " )) ;
 		}
+		else if( format == e_ColumnarFormat ) {
+			source.reset( new statfile::ColumnarStatSource( filename )) ;
+		}
 		else {
 			// default to space-delimited format
 			source.reset( new statfile::DelimitedStatSource( filename, " " )) ;
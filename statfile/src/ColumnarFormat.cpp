@@ -0,0 +1,496 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include "genfile/VariantEntry.hpp"
+#include "genfile/Error.hpp"
+#include "genfile/endianness_utils.hpp"
+#include "genfile/zlib.hpp"
+#include "statfile/ColumnarFormat.hpp"
+
+namespace statfile {
+	namespace columnar {
+		namespace {
+			char const magic[] = "QCCOLUMN" ;
+			std::size_t const magic_size = 8 ;
+			int const zstd_compression_level = 3 ;
+
+			template< typename T >
+			void append( std::vector< uint8_t >* buffer, T const value ) {
+				std::size_t const offset = buffer->size() ;
+				buffer->resize( offset + sizeof( T )) ;
+				genfile::write_little_endian_integer( &(*buffer)[ offset ], &(*buffer)[0] + buffer->size(), value ) ;
+			}
+
+			void append( std::vector< uint8_t >* buffer, double const value ) {
+				uint64_t bits ;
+				std::memcpy( &bits, &value, sizeof( double )) ;
+				append( buffer, bits ) ;
+			}
+
+			void append( std::vector< uint8_t >* buffer, std::string const& value ) {
+				append( buffer, uint32_t( value.size() )) ;
+				buffer->insert( buffer->end(), value.begin(), value.end() ) ;
+			}
+
+			// Reads values from a buffer, checking that they lie within it.
+			struct Cursor {
+				Cursor( std::string const& source, uint8_t const* begin, uint8_t const* end ):
+					m_source( source ),
+					m_pointer( begin ),
+					m_end( end )
+				{}
+
+				template< typename T >
+				T read() {
+					check( sizeof( T )) ;
+					T result ;
+					m_pointer = genfile::read_little_endian_integer( m_pointer, m_end, &result ) ;
+					return result ;
+				}
+
+				double read_double() {
+					uint64_t const bits = read< uint64_t >() ;
+					double result ;
+					std::memcpy( &result, &bits, sizeof( double )) ;
+					return result ;
+				}
+
+				std::string read_string() {
+					uint32_t const size = read< uint32_t >() ;
+					check( size ) ;
+					std::string result( m_pointer, m_pointer + size ) ;
+					m_pointer += size ;
+					return result ;
+				}
+
+				uint8_t const* read_bytes( std::size_t size ) {
+					check( size ) ;
+					uint8_t const* result = m_pointer ;
+					m_pointer += size ;
+					return result ;
+				}
+
+			private:
+				std::string const m_source ;
+				uint8_t const* m_pointer ;
+				uint8_t const* const m_end ;
+
+				void check( std::size_t size ) const {
+					if( std::size_t( m_end - m_pointer ) < size ) {
+						throw genfile::MalformedInputError( m_source, "Unexpected end of columnar data", 0 ) ;
+					}
+				}
+			} ;
+
+			std::string to_string( genfile::VariantEntry const& value ) {
+				if( value.is_string() ) {
+					return value.as< std::string >() ;
+				}
+				std::ostringstream stream ;
+				stream << value ;
+				return stream.str() ;
+			}
+
+			ColumnType get_column_type( std::vector< genfile::VariantEntry > const& values ) {
+				ColumnType result = eInt64 ;
+				for( std::size_t i = 0; i < values.size(); ++i ) {
+					genfile::VariantEntry const& value = values[i] ;
+					if( value.is_double() ) {
+						result = eDouble ;
+					} else if( !value.is_missing() && !value.is_int() ) {
+						return eString ;
+					}
+				}
+				return result ;
+			}
+		}
+
+		bool is_columnar_filename( std::string const& filename ) {
+			return filename.size() > 5 && filename.compare( filename.size() - 5, 5, ".qcol" ) == 0 ;
+		}
+
+		Compression parse_compression( std::string const& spec ) {
+			if( spec == "zstd" ) {
+				return eZstdCompression ;
+			} else if( spec == "none" ) {
+				return eNoCompression ;
+			}
+			throw genfile::BadArgumentError( "statfile::columnar::parse_compression()", "spec=\"" + spec + "\"", "Compression must be \"zstd\" or \"none\"." ) ;
+		}
+
+		Chunk::Chunk():
+			type( eInt64 ),
+			compression( eNoCompression ),
+			offset( 0 ),
+			stored_size( 0 ),
+			uncompressed_size( 0 ),
+			has_range( false )
+		{}
+
+		void Column::set_missing( std::size_t number_of_rows ) {
+			type = eInt64 ;
+			present.assign( number_of_rows, 0 ) ;
+			integers.assign( number_of_rows, 0 ) ;
+			doubles.clear() ;
+			dictionary.clear() ;
+			indices.clear() ;
+		}
+
+		genfile::VariantEntry Column::get( std::size_t i ) const {
+			if( !present[i] ) {
+				return genfile::MissingValue() ;
+			}
+			switch( type ) {
+				case eInt64: return genfile::VariantEntry::Integer( integers[i] ) ; break ;
+				case eDouble: return doubles[i] ; break ;
+				default: return dictionary[ indices[i] ] ; break ;
+			}
+		}
+
+		Writer::UniquePtr Writer::create( std::string const& filename, Compression compression ) {
+			return UniquePtr( new Writer( filename, compression )) ;
+		}
+
+		Writer::Writer( std::string const& filename, Compression compression ):
+			m_filename( filename ),
+			m_compression( compression ),
+			m_stream( filename.c_str(), std::ios::binary ),
+			m_number_of_rows( 0 ),
+			m_finalised( false )
+		{
+			if( !m_stream ) {
+				throw genfile::ResourceNotOpenedError( filename ) ;
+			}
+			m_stream.write( magic, magic_size ) ;
+			genfile::write_little_endian_integer( m_stream, version ) ;
+		}
+
+		Writer::~Writer() {
+			if( !m_finalised ) {
+				finalise( "", std::vector< std::string >() ) ;
+			}
+		}
+
+		void Writer::write_row_group( std::vector< std::vector< genfile::VariantEntry > > const& columns ) {
+			RowGroup row_group ;
+			row_group.number_of_rows = columns.empty() ? 0 : columns[0].size() ;
+			row_group.chunks.resize( columns.size() ) ;
+			for( std::size_t i = 0; i < columns.size(); ++i ) {
+				assert( columns[i].size() == row_group.number_of_rows ) ;
+				write_chunk( columns[i], &row_group.chunks[i] ) ;
+			}
+			m_row_groups.push_back( row_group ) ;
+			m_number_of_rows += row_group.number_of_rows ;
+			if( !m_stream ) {
+				throw genfile::OutputError( m_filename ) ;
+			}
+		}
+
+		void Writer::write_chunk( std::vector< genfile::VariantEntry > const& values, Chunk* chunk ) {
+			std::size_t const N = values.size() ;
+			chunk->type = get_column_type( values ) ;
+			chunk->offset = m_stream.tellp() ;
+			m_buffer.assign( ( N + 7 ) / 8, 0 ) ;
+			for( std::size_t i = 0; i < N; ++i ) {
+				if( !values[i].is_missing() ) {
+					m_buffer[ i / 8 ] |= ( 1 << ( i % 8 )) ;
+				}
+			}
+			switch( chunk->type ) {
+				case eInt64: {
+					int64_t minimum = std::numeric_limits< int64_t >::max() ;
+					int64_t maximum = std::numeric_limits< int64_t >::min() ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						int64_t value = 0 ;
+						if( !values[i].is_missing() ) {
+							value = values[i].as< genfile::VariantEntry::Integer >() ;
+							minimum = std::min( minimum, value ) ;
+							maximum = std::max( maximum, value ) ;
+							chunk->has_range = true ;
+						}
+						append( &m_buffer, value ) ;
+					}
+					if( chunk->has_range ) {
+						chunk->minimum = genfile::VariantEntry::Integer( minimum ) ;
+						chunk->maximum = genfile::VariantEntry::Integer( maximum ) ;
+					}
+					break ;
+				}
+				case eDouble: {
+					double minimum = std::numeric_limits< double >::infinity() ;
+					double maximum = -std::numeric_limits< double >::infinity() ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						double value = 0 ;
+						if( !values[i].is_missing() ) {
+							value = values[i].as< double >() ;
+							// NaNs do not take part in the range.
+							if( value == value ) {
+								minimum = std::min( minimum, value ) ;
+								maximum = std::max( maximum, value ) ;
+								chunk->has_range = true ;
+							}
+						}
+						append( &m_buffer, value ) ;
+					}
+					if( chunk->has_range ) {
+						chunk->minimum = minimum ;
+						chunk->maximum = maximum ;
+					}
+					break ;
+				}
+				case eString: {
+					std::map< std::string, uint32_t > dictionary ;
+					std::vector< std::string > strings( N ) ;
+					std::vector< std::string > entries ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						if( !values[i].is_missing() ) {
+							strings[i] = to_string( values[i] ) ;
+							if( dictionary.insert( std::make_pair( strings[i], uint32_t( entries.size() ))).second ) {
+								entries.push_back( strings[i] ) ;
+							}
+						}
+					}
+					append( &m_buffer, uint32_t( entries.size() )) ;
+					for( std::size_t i = 0; i < entries.size(); ++i ) {
+						append( &m_buffer, entries[i] ) ;
+					}
+					for( std::size_t i = 0; i < N; ++i ) {
+						append( &m_buffer, values[i].is_missing() ? uint32_t( 0 ) : dictionary[ strings[i] ] ) ;
+					}
+					if( !dictionary.empty() ) {
+						chunk->has_range = true ;
+						chunk->minimum = dictionary.begin()->first ;
+						chunk->maximum = dictionary.rbegin()->first ;
+					}
+					break ;
+				}
+			}
+			chunk->uncompressed_size = m_buffer.size() ;
+			chunk->compression = m_compression ;
+			if( m_compression == eZstdCompression && !m_buffer.empty() ) {
+				genfile::zstd_compress( &m_buffer[0], &m_buffer[0] + m_buffer.size(), &m_compressed, 0, zstd_compression_level ) ;
+				m_stream.write( reinterpret_cast< char const* >( &m_compressed[0] ), m_compressed.size() ) ;
+				chunk->stored_size = m_compressed.size() ;
+			} else {
+				chunk->compression = eNoCompression ;
+				m_stream.write( reinterpret_cast< char const* >( m_buffer.empty() ? 0 : &m_buffer[0] ), m_buffer.size() ) ;
+				chunk->stored_size = m_buffer.size() ;
+			}
+		}
+
+		void Writer::finalise( std::string const& metadata, std::vector< std::string > const& column_names ) {
+			uint64_t const footer_offset = m_stream.tellp() ;
+			m_buffer.clear() ;
+			append( &m_buffer, metadata ) ;
+			append( &m_buffer, uint32_t( column_names.size() )) ;
+			for( std::size_t i = 0; i < column_names.size(); ++i ) {
+				append( &m_buffer, column_names[i] ) ;
+			}
+			append( &m_buffer, m_number_of_rows ) ;
+			append( &m_buffer, uint32_t( m_row_groups.size() )) ;
+			for( std::size_t g = 0; g < m_row_groups.size(); ++g ) {
+				RowGroup const& row_group = m_row_groups[g] ;
+				append( &m_buffer, row_group.number_of_rows ) ;
+				append( &m_buffer, uint32_t( row_group.chunks.size() )) ;
+				for( std::size_t i = 0; i < row_group.chunks.size(); ++i ) {
+					Chunk const& chunk = row_group.chunks[i] ;
+					append( &m_buffer, uint8_t( chunk.type )) ;
+					append( &m_buffer, uint8_t( chunk.compression )) ;
+					append( &m_buffer, uint16_t( 0 )) ;
+					append( &m_buffer, chunk.offset ) ;
+					append( &m_buffer, chunk.stored_size ) ;
+					append( &m_buffer, chunk.uncompressed_size ) ;
+					append( &m_buffer, uint8_t( chunk.has_range )) ;
+					if( chunk.has_range ) {
+						switch( chunk.type ) {
+							case eInt64:
+								append( &m_buffer, int64_t( chunk.minimum.as< genfile::VariantEntry::Integer >() )) ;
+								append( &m_buffer, int64_t( chunk.maximum.as< genfile::VariantEntry::Integer >() )) ;
+								break ;
+							case eDouble:
+								append( &m_buffer, chunk.minimum.as< double >() ) ;
+								append( &m_buffer, chunk.maximum.as< double >() ) ;
+								break ;
+							case eString:
+								append( &m_buffer, chunk.minimum.as< std::string >() ) ;
+								append( &m_buffer, chunk.maximum.as< std::string >() ) ;
+								break ;
+						}
+					}
+				}
+			}
+			append( &m_buffer, footer_offset ) ;
+			m_buffer.insert( m_buffer.end(), magic, magic + magic_size ) ;
+			m_stream.write( reinterpret_cast< char const* >( &m_buffer[0] ), m_buffer.size() ) ;
+			m_stream.close() ;
+			m_finalised = true ;
+			if( !m_stream ) {
+				throw genfile::OutputError( m_filename ) ;
+			}
+		}
+
+		Reader::UniquePtr Reader::open( std::string const& filename ) {
+			return UniquePtr( new Reader( filename )) ;
+		}
+
+		Reader::Reader( std::string const& filename ):
+			m_filename( filename ),
+			m_stream( filename.c_str(), std::ios::binary ),
+			m_number_of_rows( 0 )
+		{
+			if( !m_stream ) {
+				throw genfile::ResourceNotOpenedError( filename ) ;
+			}
+			read_footer() ;
+		}
+
+		void Reader::read_footer() {
+			char header[ magic_size ] ;
+			uint32_t file_version = 0 ;
+			m_stream.read( header, magic_size ) ;
+			genfile::read_little_endian_integer( m_stream, &file_version ) ;
+			if( !m_stream || std::string( header, header + magic_size ) != magic ) {
+				throw genfile::MalformedInputError( m_filename, "File is not a columnar file", 0 ) ;
+			}
+			if( file_version != version ) {
+				throw genfile::MalformedInputError( m_filename, "Unsupported columnar file version", 0 ) ;
+			}
+
+			m_stream.seekg( 0, std::ios::end ) ;
+			uint64_t const file_size = m_stream.tellg() ;
+			if( file_size < 2 * magic_size + 12 ) {
+				throw genfile::MalformedInputError( m_filename, "File is truncated", 0 ) ;
+			}
+			uint64_t footer_offset = 0 ;
+			m_stream.seekg( file_size - magic_size - 8 ) ;
+			genfile::read_little_endian_integer( m_stream, &footer_offset ) ;
+			m_stream.read( header, magic_size ) ;
+			if( !m_stream || std::string( header, header + magic_size ) != magic || footer_offset > file_size - magic_size - 8 ) {
+				throw genfile::MalformedInputError( m_filename, "File is truncated or has no footer", 0 ) ;
+			}
+
+			m_buffer.resize( file_size - magic_size - 8 - footer_offset ) ;
+			m_stream.seekg( footer_offset ) ;
+			m_stream.read( reinterpret_cast< char* >( m_buffer.empty() ? 0 : &m_buffer[0] ), m_buffer.size() ) ;
+			Cursor cursor( m_filename, m_buffer.empty() ? 0 : &m_buffer[0], m_buffer.empty() ? 0 : &m_buffer[0] + m_buffer.size() ) ;
+			m_metadata = cursor.read_string() ;
+			m_column_names.resize( cursor.read< uint32_t >() ) ;
+			for( std::size_t i = 0; i < m_column_names.size(); ++i ) {
+				m_column_names[i] = cursor.read_string() ;
+			}
+			m_number_of_rows = cursor.read< uint64_t >() ;
+			m_row_groups.resize( cursor.read< uint32_t >() ) ;
+			for( std::size_t g = 0; g < m_row_groups.size(); ++g ) {
+				RowGroup& row_group = m_row_groups[g] ;
+				row_group.number_of_rows = cursor.read< uint64_t >() ;
+				row_group.chunks.resize( cursor.read< uint32_t >() ) ;
+				for( std::size_t i = 0; i < row_group.chunks.size(); ++i ) {
+					Chunk& chunk = row_group.chunks[i] ;
+					chunk.type = ColumnType( cursor.read< uint8_t >() ) ;
+					chunk.compression = Compression( cursor.read< uint8_t >() ) ;
+					cursor.read< uint16_t >() ;
+					chunk.offset = cursor.read< uint64_t >() ;
+					chunk.stored_size = cursor.read< uint64_t >() ;
+					chunk.uncompressed_size = cursor.read< uint64_t >() ;
+					chunk.has_range = cursor.read< uint8_t >() ;
+					if(
+						( chunk.type != eInt64 && chunk.type != eDouble && chunk.type != eString )
+						|| ( chunk.compression != eNoCompression && chunk.compression != eZstdCompression )
+						|| chunk.offset + chunk.stored_size > footer_offset
+					) {
+						throw genfile::MalformedInputError( m_filename, "Invalid column chunk in footer", 0 ) ;
+					}
+					if( chunk.has_range ) {
+						switch( chunk.type ) {
+							case eInt64:
+								chunk.minimum = genfile::VariantEntry::Integer( cursor.read< int64_t >() ) ;
+								chunk.maximum = genfile::VariantEntry::Integer( cursor.read< int64_t >() ) ;
+								break ;
+							case eDouble:
+								chunk.minimum = cursor.read_double() ;
+								chunk.maximum = cursor.read_double() ;
+								break ;
+							case eString:
+								chunk.minimum = cursor.read_string() ;
+								chunk.maximum = cursor.read_string() ;
+								break ;
+						}
+					}
+				}
+			}
+		}
+
+		void Reader::read_column( std::size_t row_group_index, std::size_t column_index, Column* result ) {
+			assert( row_group_index < m_row_groups.size() ) ;
+			RowGroup const& row_group = m_row_groups[ row_group_index ] ;
+			std::size_t const N = row_group.number_of_rows ;
+			if( column_index >= row_group.chunks.size() ) {
+				result->set_missing( N ) ;
+				return ;
+			}
+			Chunk const& chunk = row_group.chunks[ column_index ] ;
+			m_buffer.resize( chunk.stored_size ) ;
+			m_stream.clear() ;
+			m_stream.seekg( chunk.offset ) ;
+			m_stream.read( reinterpret_cast< char* >( m_buffer.empty() ? 0 : &m_buffer[0] ), m_buffer.size() ) ;
+			if( !m_stream ) {
+				throw genfile::MalformedInputError( m_filename, "Unable to read column chunk", 0 ) ;
+			}
+			std::vector< uint8_t >* data = &m_buffer ;
+			if( chunk.compression == eZstdCompression ) {
+				m_uncompressed.resize( chunk.uncompressed_size ) ;
+				genfile::zstd_uncompress( &m_buffer[0], &m_buffer[0] + m_buffer.size(), &m_uncompressed ) ;
+				data = &m_uncompressed ;
+			}
+			if( data->size() != chunk.uncompressed_size ) {
+				throw genfile::MalformedInputError( m_filename, "Column chunk has the wrong size", 0 ) ;
+			}
+
+			Cursor cursor( m_filename, data->empty() ? 0 : &(*data)[0], data->empty() ? 0 : &(*data)[0] + data->size() ) ;
+			uint8_t const* presence = cursor.read_bytes( ( N + 7 ) / 8 ) ;
+			result->type = chunk.type ;
+			result->present.resize( N ) ;
+			for( std::size_t i = 0; i < N; ++i ) {
+				result->present[i] = ( presence[ i / 8 ] >> ( i % 8 )) & 1 ;
+			}
+			switch( chunk.type ) {
+				case eInt64:
+					result->integers.resize( N ) ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						result->integers[i] = cursor.read< int64_t >() ;
+					}
+					break ;
+				case eDouble:
+					result->doubles.resize( N ) ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						result->doubles[i] = cursor.read_double() ;
+					}
+					break ;
+				case eString:
+					result->dictionary.resize( cursor.read< uint32_t >() ) ;
+					for( std::size_t i = 0; i < result->dictionary.size(); ++i ) {
+						result->dictionary[i] = cursor.read_string() ;
+					}
+					result->indices.resize( N ) ;
+					for( std::size_t i = 0; i < N; ++i ) {
+						result->indices[i] = cursor.read< uint32_t >() ;
+						if( result->present[i] && result->indices[i] >= result->dictionary.size() ) {
+							throw genfile::MalformedInputError( m_filename, "String index out of range", 0 ) ;
+						}
+					}
+					break ;
+			}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include "genfile/VariantEntry.hpp"
+#include "statfile/ColumnarFormat.hpp"
+#include "statfile/ColumnarStatSink.hpp"
+
+namespace statfile {
+	ColumnarStatSink::ColumnarStatSink(
+		std::string const& filename,
+		columnar::Compression compression,
+		std::size_t rows_per_group
+	):
+		m_writer( columnar::Writer::create( filename, compression )),
+		m_rows_per_group( rows_per_group )
+	{
+		assert( m_rows_per_group > 0 ) ;
+	}
+
+	ColumnarStatSink::~ColumnarStatSink() {
+		write_row_group() ;
+		m_writer->finalise( m_metadata, column_names() ) ;
+	}
+
+	void ColumnarStatSink::write_comment( std::string const& comment ) {
+		m_metadata += ( m_metadata.size() > 0 ? "\n" : "" ) + comment ;
+	}
+
+	void ColumnarStatSink::store( genfile::VariantEntry const& value ) {
+		if( m_columns.size() < number_of_columns() ) {
+			m_columns.resize( number_of_columns() ) ;
+		}
+		m_columns[ current_column() ].push_back( value ) ;
+	}
+
+	void ColumnarStatSink::move_to_next_row_impl() {
+		if( m_columns.size() > 0 && m_columns[0].size() == m_rows_per_group ) {
+			write_row_group() ;
+		}
+	}
+
+	void ColumnarStatSink::write_row_group() {
+		if( m_columns.size() > 0 && m_columns[0].size() > 0 ) {
+			m_writer->write_row_group( m_columns ) ;
+			for( std::size_t i = 0; i < m_columns.size(); ++i ) {
+				m_columns[i].clear() ;
+			}
+		}
+	}
+}
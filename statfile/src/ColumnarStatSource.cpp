@@ -0,0 +1,243 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include "genfile/Error.hpp"
+#include "genfile/string_utils.hpp"
+#include "statfile/ColumnarFormat.hpp"
+#include "statfile/ColumnarStatSource.hpp"
+
+namespace statfile {
+	ColumnarStatSource::UniquePtr ColumnarStatSource::open( std::string const& filename ) {
+		return UniquePtr( new ColumnarStatSource( filename )) ;
+	}
+
+	ColumnarStatSource::ColumnarStatSource( std::string const& filename ):
+		m_reader( columnar::Reader::open( filename )),
+		m_group( 0 ),
+		m_row( 0 ),
+		m_have_more_data( false ),
+		m_number_of_row_groups_read( 0 )
+	{
+		std::vector< std::string > const& names = m_reader->column_names() ;
+		for( std::size_t i = 0; i < names.size(); ++i ) {
+			add_column( names[i] ) ;
+		}
+		m_columns.resize( names.size() ) ;
+		m_loaded.resize( names.size(), 0 ) ;
+		reset_to_start() ;
+	}
+
+	void ColumnarStatSource::add_range_filter( std::string const& column, double lower, double upper ) {
+		RangeFilter filter ;
+		filter.column = index_of_column( column ) ;
+		filter.numeric = true ;
+		filter.lower = lower ;
+		filter.upper = upper ;
+		m_filters.push_back( filter ) ;
+		reset_to_start() ;
+	}
+
+	void ColumnarStatSource::add_range_filter( std::string const& column, std::string const& lower, std::string const& upper ) {
+		RangeFilter filter ;
+		filter.column = index_of_column( column ) ;
+		filter.numeric = false ;
+		filter.lower = filter.upper = 0 ;
+		filter.lower_string = lower ;
+		filter.upper_string = upper ;
+		m_filters.push_back( filter ) ;
+		reset_to_start() ;
+	}
+
+	void ColumnarStatSource::reset_to_start() {
+		Base::reset_to_start() ;
+		m_group = m_reader->number_of_row_groups() ;
+		m_number_of_row_groups_read = 0 ;
+		find_next_row( 0, 0 ) ;
+	}
+
+	ColumnarStatSource::OptionalCount ColumnarStatSource::number_of_rows() const {
+		if( m_filters.empty() ) {
+			return std::size_t( m_reader->number_of_rows() ) ;
+		}
+		return OptionalCount() ;
+	}
+
+	void ColumnarStatSource::move_to_next_row_impl() {
+		if( m_have_more_data ) {
+			find_next_row( m_group, m_row + 1 ) ;
+		}
+	}
+
+	void ColumnarStatSource::find_next_row( std::size_t group, std::size_t row ) {
+		m_have_more_data = false ;
+		for( ; group < m_reader->number_of_row_groups(); ++group, row = 0 ) {
+			if( row == 0 ) {
+				if( !row_group_may_match( group ) ) {
+					continue ;
+				}
+				load_group( group ) ;
+			}
+			for( ; row < m_reader->row_group( group ).number_of_rows; ++row ) {
+				if( row_matches( row )) {
+					m_row = row ;
+					m_have_more_data = true ;
+					return ;
+				}
+			}
+		}
+	}
+
+	void ColumnarStatSource::load_group( std::size_t group ) {
+		m_group = group ;
+		m_loaded.assign( m_loaded.size(), 0 ) ;
+		++m_number_of_row_groups_read ;
+	}
+
+	columnar::Column const& ColumnarStatSource::column( std::size_t i ) {
+		assert( i < m_columns.size() ) ;
+		if( !m_loaded[i] ) {
+			m_reader->read_column( m_group, i, &m_columns[i] ) ;
+			m_loaded[i] = 1 ;
+		}
+		return m_columns[i] ;
+	}
+
+	bool ColumnarStatSource::row_group_may_match( std::size_t group ) const {
+		columnar::RowGroup const& row_group = m_reader->row_group( group ) ;
+		for( std::size_t i = 0; i < m_filters.size(); ++i ) {
+			RangeFilter const& filter = m_filters[i] ;
+			if( filter.column >= row_group.chunks.size() || !row_group.chunks[ filter.column ].has_range ) {
+				// All values are missing.
+				return false ;
+			}
+			columnar::Chunk const& chunk = row_group.chunks[ filter.column ] ;
+			if( filter.numeric && chunk.type != columnar::eString ) {
+				if( chunk.maximum.as< double >() < filter.lower || chunk.minimum.as< double >() > filter.upper ) {
+					return false ;
+				}
+			} else if( !filter.numeric && chunk.type == columnar::eString ) {
+				if( chunk.maximum.as< std::string >() < filter.lower_string || chunk.minimum.as< std::string >() > filter.upper_string ) {
+					return false ;
+				}
+			}
+		}
+		return true ;
+	}
+
+	bool ColumnarStatSource::row_matches( std::size_t row ) {
+		for( std::size_t i = 0; i < m_filters.size(); ++i ) {
+			RangeFilter const& filter = m_filters[i] ;
+			columnar::Column const& values = column( filter.column ) ;
+			if( values.is_missing( row ) ) {
+				return false ;
+			}
+			if( filter.numeric ) {
+				if( values.type == columnar::eString ) {
+					return false ;
+				}
+				double const value = ( values.type == columnar::eInt64 ) ? double( values.integers[ row ] ) : values.doubles[ row ] ;
+				if( !( value >= filter.lower && value <= filter.upper )) {
+					return false ;
+				}
+			} else {
+				if( values.type != columnar::eString ) {
+					return false ;
+				}
+				std::string const& value = values.dictionary[ values.indices[ row ] ] ;
+				if( value < filter.lower_string || value > filter.upper_string ) {
+					return false ;
+				}
+			}
+		}
+		return true ;
+	}
+
+	int64_t ColumnarStatSource::read_integer() {
+		columnar::Column const& values = column( current_column() ) ;
+		if( !values.is_missing( m_row ) ) {
+			switch( values.type ) {
+				case columnar::eInt64:
+					return values.integers[ m_row ] ;
+				case columnar::eDouble: {
+					double const value = values.doubles[ m_row ] ;
+					if( value == std::floor( value ) && std::abs( value ) < 1E18 ) {
+						return int64_t( value ) ;
+					}
+					break ;
+				}
+				case columnar::eString:
+					try {
+						return genfile::string_utils::to_repr< long >( values.dictionary[ values.indices[ m_row ] ] ) ;
+					}
+					catch( genfile::string_utils::StringConversionError const& ) {
+					}
+					break ;
+			}
+		}
+		throw genfile::MalformedInputError( get_source_spec(), number_of_rows_read(), current_column() ) ;
+	}
+
+	void ColumnarStatSource::read_value( int32_t& value ) {
+		int64_t const result = read_integer() ;
+		if( result < std::numeric_limits< int32_t >::min() || result > std::numeric_limits< int32_t >::max() ) {
+			throw genfile::MalformedInputError( get_source_spec(), number_of_rows_read(), current_column() ) ;
+		}
+		value = result ;
+	}
+
+	void ColumnarStatSource::read_value( uint32_t& value ) {
+		int64_t const result = read_integer() ;
+		if( result < 0 || result > std::numeric_limits< uint32_t >::max() ) {
+			throw genfile::MalformedInputError( get_source_spec(), number_of_rows_read(), current_column() ) ;
+		}
+		value = result ;
+	}
+
+	void ColumnarStatSource::read_value( double& value ) {
+		columnar::Column const& values = column( current_column() ) ;
+		if( values.is_missing( m_row ) ) {
+			value = std::numeric_limits< double >::quiet_NaN() ;
+			return ;
+		}
+		switch( values.type ) {
+			case columnar::eInt64:
+				value = values.integers[ m_row ] ;
+				break ;
+			case columnar::eDouble:
+				value = values.doubles[ m_row ] ;
+				break ;
+			case columnar::eString: {
+				std::string const& string_value = values.dictionary[ values.indices[ m_row ] ] ;
+				if( string_value == "NA" ) {
+					value = std::numeric_limits< double >::quiet_NaN() ;
+				} else {
+					try {
+						value = genfile::string_utils::to_repr< double >( string_value ) ;
+					}
+					catch( genfile::string_utils::StringConversionError const& ) {
+						throw genfile::MalformedInputError( get_source_spec(), number_of_rows_read(), current_column() ) ;
+					}
+				}
+				break ;
+			}
+		}
+	}
+
+	void ColumnarStatSource::read_value( std::string& value ) {
+		columnar::Column const& values = column( current_column() ) ;
+		if( values.is_missing( m_row ) ) {
+			value = "NA" ;
+		} else if( values.type == columnar::eString ) {
+			value = values.dictionary[ values.indices[ m_row ] ] ;
+		} else {
+			value = genfile::string_utils::to_string( values.get( m_row ) ) ;
+		}
+	}
+}
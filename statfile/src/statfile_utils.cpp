@@ -47,6 +47,7 @@ namespace statfile {
 		types[ ".txt" ]     = types[ ".txt.gz" ]        = e_SpaceDelimited ;
 		types[ ".csv" ]     = types[ ".csv.gz" ] 		= e_CommaDelimitedFormat ;
 		types[ ".tsv" ]     = types[ ".tsv.gz" ] 		= e_TabDelimitedFormat ;
+		types[ ".qcol" ]    = e_ColumnarFormat ;
 
 		for(
 			std::map< std::string, FileFormatType >::const_iterator i = types.begin();
@@ -0,0 +1,127 @@
+
+//          Copyright Gavin Band 2008 - 2012.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <boost/lexical_cast.hpp>
+#include "test_case.hpp"
+#include "genfile/MissingValue.hpp"
+#include "statfile/ColumnarFormat.hpp"
+#include "statfile/ColumnarStatSink.hpp"
+#include "statfile/ColumnarStatSource.hpp"
+
+BOOST_AUTO_TEST_SUITE( test_columnar_format )
+
+namespace {
+	// Write 10 rows in groups of 3, with chromosome 01 for the first 5 rows and 02 for the rest.
+	void write_test_file( std::string const& filename, statfile::columnar::Compression compression ) {
+		statfile::ColumnarStatSink sink( filename, compression, 3 ) ;
+		sink | "rsid" | "chromosome" | "position" | "p" ;
+		sink.write_metadata( "test metadata" ) ;
+		for( int i = 0; i < 10; ++i ) {
+			sink << ( "rs" + boost::lexical_cast< std::string >( i ))
+				<< std::string( i < 5 ? "01" : "02" )
+				<< int32_t( 1000 + 100 * i ) ;
+			if( i == 4 ) {
+				sink << genfile::MissingValue() ;
+			} else {
+				sink << ( i / 10.0 ) ;
+			}
+			sink << statfile::end_row() ;
+		}
+	}
+}
+
+AUTO_TEST_CASE( test_round_trip ) {
+	std::cerr << "Testing columnar format round trip..." ;
+	std::string const filename = std::string( std::tmpnam(0) ) + ".qcol" ;
+	TEST_ASSERT( statfile::columnar::is_columnar_filename( filename ) ) ;
+	TEST_ASSERT( !statfile::columnar::is_columnar_filename( "test.txt" ) ) ;
+
+	for( int compression = 0; compression < 2; ++compression ) {
+		write_test_file( filename, statfile::columnar::Compression( compression ) ) ;
+
+		statfile::ColumnarStatSource source( filename ) ;
+		TEST_ASSERT( source.number_of_columns() == 4 ) ;
+		TEST_ASSERT( source.name_of_column( 2 ) == "position" ) ;
+		TEST_ASSERT( *source.number_of_rows() == 10 ) ;
+		TEST_ASSERT( source.get_descriptive_text() == "test metadata" ) ;
+
+		std::string rsid, chromosome ;
+		int position ;
+		double p ;
+		int count = 0 ;
+		while( source >> rsid ) {
+			source >> chromosome >> position >> p >> statfile::end_row() ;
+			TEST_ASSERT( rsid == "rs" + boost::lexical_cast< std::string >( count )) ;
+			TEST_ASSERT( chromosome == ( count < 5 ? "01" : "02" )) ;
+			TEST_ASSERT( position == 1000 + 100 * count ) ;
+			if( count == 4 ) {
+				TEST_ASSERT( p != p ) ;
+			} else {
+				TEST_ASSERT( p == count / 10.0 ) ;
+			}
+			++count ;
+		}
+		TEST_ASSERT( count == 10 ) ;
+		TEST_ASSERT( source.number_of_row_groups_read() == 4 ) ;
+
+		statfile::columnar::Reader::UniquePtr reader = statfile::columnar::Reader::open( filename ) ;
+		TEST_ASSERT( reader->number_of_row_groups() == 4 ) ;
+		TEST_ASSERT( reader->row_group( 3 ).number_of_rows == 1 ) ;
+		statfile::columnar::Chunk const& chunk = reader->row_group( 1 ).chunks[2] ;
+		TEST_ASSERT( chunk.type == statfile::columnar::eInt64 ) ;
+		TEST_ASSERT( chunk.has_range ) ;
+		TEST_ASSERT( chunk.minimum.as< int >() == 1300 ) ;
+		TEST_ASSERT( chunk.maximum.as< int >() == 1500 ) ;
+		TEST_ASSERT( reader->row_group( 1 ).chunks[3].type == statfile::columnar::eDouble ) ;
+		TEST_ASSERT( reader->row_group( 1 ).chunks[0].type == statfile::columnar::eString ) ;
+	}
+	std::remove( filename.c_str() ) ;
+	std::cerr << "ok.\n" ;
+}
+
+AUTO_TEST_CASE( test_range_filter ) {
+	std::cerr << "Testing columnar format range filters..." ;
+	std::string const filename = std::string( std::tmpnam(0) ) + ".qcol" ;
+	write_test_file( filename, statfile::columnar::eZstdCompression ) ;
+
+	{
+		statfile::ColumnarStatSource source( filename ) ;
+		source.add_range_filter( "position", 1350, 1650 ) ;
+		std::vector< std::string > rsids ;
+		std::string rsid ;
+		while( source >> rsid ) {
+			source >> statfile::ignore_all() ;
+			rsids.push_back( rsid ) ;
+		}
+		TEST_ASSERT( rsids.size() == 3 ) ;
+		TEST_ASSERT( rsids[0] == "rs4" && rsids[1] == "rs5" && rsids[2] == "rs6" ) ;
+		// Only the second and third row groups can contain matching rows.
+		TEST_ASSERT( source.number_of_row_groups_read() == 2 ) ;
+	}
+
+	{
+		statfile::ColumnarStatSource source( filename ) ;
+		source.add_range_filter( "chromosome", "02", "02" ) ;
+		source.add_range_filter( "p", 0.0, 0.75 ) ;
+		std::vector< std::string > rsids ;
+		std::string rsid ;
+		while( source >> rsid ) {
+			source >> statfile::ignore_all() ;
+			rsids.push_back( rsid ) ;
+		}
+		TEST_ASSERT( rsids.size() == 3 ) ;
+		TEST_ASSERT( rsids[0] == "rs5" && rsids[2] == "rs7" ) ;
+		TEST_ASSERT( source.number_of_row_groups_read() == 2 ) ;
+	}
+	std::remove( filename.c_str() ) ;
+	std::cerr << "ok.\n" ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()